@@ -161,6 +161,11 @@ struct DbgScriptTypedObject
 	bool ValueValid;
 };
 
+// Number of live TypedObjects each provider can find again by identity (see
+// DsTypedDataHash).
+//
+const ULONG TYPED_OBJECT_IDENTITY_SLOTS = 1024;
+
 _Check_return_ HRESULT
 DsInitializeTypedObject(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -179,6 +184,15 @@ DsWrapTypedData(
 	_In_ const DEBUG_TYPED_DATA* typedData,
 	_Out_ DbgScriptTypedObject* typObj);
 
+_Check_return_ UINT64
+DsTypedDataHash(
+	_In_ const DEBUG_TYPED_DATA* typedData);
+
+_Check_return_ bool
+DsTypedDataSameObject(
+	_In_ const DEBUG_TYPED_DATA* a,
+	_In_ const DEBUG_TYPED_DATA* b);
+
 _Check_return_ HRESULT
 DsTypedObjectGetField(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -194,6 +208,13 @@ DsTypedObjectGetArrayElement(
 	_In_ UINT64 index,
 	_Out_ DEBUG_TYPED_DATA* outData);
 
+_Check_return_ HRESULT
+DsTypedObjectOffset(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_In_ INT64 count,
+	_Out_ DbgScriptTypedObject* newTypObj);
+
 _Check_return_ bool
 DsTypedObjectIsPrimitive(
 	_In_ DbgScriptTypedObject* typObj);
@@ -204,3 +225,128 @@ DsTypedObjectGetRuntimeType(
 	_In_ const DbgScriptTypedObject* typObj,
 	_Out_ DbgScriptTypedObject* newTypObj);
 
+_Check_return_ HRESULT
+DsTypedObjectTryGetRuntimeType(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptTypedObject* newTypObj);
+
+
+_Check_return_ HRESULT
+DsTypedObjectGetArrayLength(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ UINT64* numElems);
+
+// Count of a slice with no upper bound, e.g. over the buffer a pointer points
+// to.
+//
+const UINT64 ARRAY_SLICE_UNBOUNDED = _UI64_MAX;
+
+// DbgScriptArraySlice - Lazy view over a range of elements of an array, or of
+// a buffer that a pointer points to.
+//
+// Elements are synthesized from element zero by offset arithmetic. Nothing is
+// read from the target until elements or their values are requested.
+//
+struct DbgScriptArraySlice
+{
+	// Element zero of the underlying array or buffer. Serves as the template
+	// for every element produced.
+	//
+	DbgScriptTypedObject Elem;
+
+	// Typed data of the underlying array or pointer.
+	//
+	DEBUG_TYPED_DATA Base;
+
+	// Size of a single element in bytes.
+	//
+	ULONG ElemSize;
+
+	// Index, relative to element zero, of the first element in the view.
+	//
+	INT64 Start;
+
+	// Distance, in elements, between consecutive elements of the view. May be
+	// negative.
+	//
+	INT64 Step;
+
+	// Number of elements in the view.
+	//
+	UINT64 Count;
+};
+
+_Check_return_ HRESULT
+DsArraySliceInit(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptArraySlice* slice);
+
+_Check_return_ HRESULT
+DsArraySliceGetSubSlice(
+	_In_ const DbgScriptArraySlice* slice,
+	_In_ UINT64 start,
+	_In_ UINT64 count,
+	_In_ INT64 step,
+	_Out_ DbgScriptArraySlice* subSlice);
+
+_Check_return_ HRESULT
+DsArraySliceGetElement(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DbgScriptArraySlice* slice,
+	_In_ UINT64 index,
+	_Out_ DbgScriptTypedObject* elem);
+
+// Number of bytes an array cursor reads ahead at a time when the elements are
+// of a primitive type.
+//
+const ULONG ARRAY_CURSOR_PREFETCH_SIZE = 4096;
+
+// DbgScriptArrayCursor - Sequential iterator over the elements of a slice.
+//
+// Values of primitive elements are read ahead in chunks of
+// ARRAY_CURSOR_PREFETCH_SIZE bytes, or, when the rest of the walk is captured
+// in the mapped dump, straight out of the mapping all at once.
+//
+struct DbgScriptArrayCursor
+{
+	// Elements to visit.
+	//
+	DbgScriptArraySlice Slice;
+
+	// Index, within the slice, of the next element to be returned.
+	//
+	UINT64 Index;
+
+	// Read-ahead window. Only used for primitive element types.
+	//
+	UINT64 PrefetchAddr;
+	ULONG PrefetchLen;
+	BYTE PrefetchBuf[ARRAY_CURSOR_PREFETCH_SIZE];
+
+	// If non-null, the window lives in the mapped dump rather than in
+	// 'PrefetchBuf'. Only valid while the host context's DumpMapGeneration
+	// matches 'PrefetchGeneration'.
+	//
+	const BYTE* PrefetchSpan;
+	ULONG PrefetchGeneration;
+};
+
+_Check_return_ HRESULT
+DsArrayCursorInit(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptArrayCursor* cursor);
+
+void
+DsArrayCursorInitFromSlice(
+	_In_ const DbgScriptArraySlice* slice,
+	_Out_ DbgScriptArrayCursor* cursor);
+
+_Check_return_ HRESULT
+DsArrayCursorNext(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptArrayCursor* cursor,
+	_Out_ DbgScriptTypedObject* elem);
@@ -5,6 +5,11 @@
 
 struct IScriptProvider;
 struct ScriptProviderInfo;
+struct DumpMemoryMap;
+struct DbgScriptTrace;
+struct DbgScriptStats;
+struct DbgScriptTimeline;
+struct DbgScriptProfiler;
 class DbgScriptOutputCallbacks;
 
 struct ScriptPathElem
@@ -18,6 +23,56 @@ struct ScriptPathElem
 	char Path[MAX_PATH];
 };
 
+// RuntimeTypeCacheEntry - Cached result of resolving a vtable address to the
+// type that owns it.
+//
+struct RuntimeTypeCacheEntry
+{
+	// Vtable address. Zero if the slot is unused.
+	//
+	UINT64 VtableAddr;
+
+	// Module containing the type. Zero if 'VtableAddr' is not a vtable.
+	//
+	UINT64 ModuleBase;
+
+	// Type ID of the type.
+	//
+	ULONG TypeId;
+};
+
+// Number of slots in the runtime type cache. Must be a power of two.
+//
+const ULONG RUNTIME_TYPE_CACHE_SIZE = 4096;
+
+// ScriptPathCacheEntry - Cached result of resolving a script name against the
+// current directory and the script path.
+//
+struct ScriptPathCacheEntry
+{
+	// Name as passed to !runscript. Empty if the slot is unused.
+	//
+	WCHAR Name[MAX_PATH];
+
+	// Path the name resolved to.
+	//
+	WCHAR FullPath[MAX_PATH];
+
+	// Hash of the current directory at the time, since relative names
+	// resolve against it.
+	//
+	UINT64 CurDirHash;
+
+	// Tick count (GetTickCount64) after which the entry must be resolved
+	// again.
+	//
+	ULONGLONG Expiry;
+};
+
+// Number of slots in the script path cache. Must be a power of two.
+//
+const ULONG SCRIPT_PATH_CACHE_SIZE = 32;
+
 struct DbgScriptHostContext
 {
 	// Handle to the DbgScript DLL.
@@ -41,6 +96,11 @@ struct DbgScriptHostContext
 	//
 	ScriptPathElem* ScriptPath;
 
+	// ScriptPathCache - Direct-mapped cache of script name to resolved path.
+	// Flushed whenever 'ScriptPath' changes. See UtilFindScriptFile.
+	//
+	ScriptPathCacheEntry ScriptPathCache[SCRIPT_PATH_CACHE_SIZE];
+
 	// Are we buffering output? This is a refcount to support nested calls.
 	//
 	LONG IsBuffering;
@@ -62,6 +122,69 @@ struct DbgScriptHostContext
 	// the existing VM state instead of recycling it each time.
 	//
 	bool StartVMEnabled;
+
+	// ResetVMEnabled - If this is true (!startvm -reset), the VM is still
+	// reused but each run gets fresh script state via IScriptProvider::ResetVM.
+	//
+	bool ResetVMEnabled;
+
+	// RuntimeTypeCache - Direct-mapped cache of vtable address to runtime
+	// type. Lives here rather than in the support library so that all
+	// providers share it.
+	//
+	RuntimeTypeCacheEntry RuntimeTypeCache[RUNTIME_TYPE_CACHE_SIZE];
+
+	// ModuleSignature - Hash of the target's module list and symbol state, as
+	// of the last !runscript or !evalstring.
+	//
+	UINT64 ModuleSignature;
+
+	// SymbolGeneration - Bumped whenever 'ModuleSignature' changes (modules
+	// loaded, unloaded or rebased, symbols reloaded, or a different target).
+	// Caches of symbols by address flush when they see a new value.
+	//
+	ULONG SymbolGeneration;
+
+	// DumpMap - Memory-mapped dump file serving reads directly (!mapdump), or
+	// null if reads go through DbgEng.
+	//
+	DumpMemoryMap* DumpMap;
+
+	// DumpMapGeneration - Bumped whenever 'DumpMap' is mapped or unmapped.
+	// Pointers into the mapping (see UtilGetSpan) are dropped when it moves.
+	//
+	ULONG DumpMapGeneration;
+
+	// Trace - Active record or replay trace of debugger engine calls
+	// (!recordtrace, !replaytrace), or null.
+	//
+	DbgScriptTrace* Trace;
+
+	// Stats - Call counters and latency histograms (!dbgscriptstats,
+	// !runscript -stats), or null if not collecting.
+	//
+	DbgScriptStats* Stats;
+
+	// Timeline - Timeline being recorded for the current run
+	// (!runscript -timeline), or null.
+	//
+	DbgScriptTimeline* Timeline;
+
+	// Profiler - Sampling profiler for the current run
+	// (!runscript -profile), or null.
+	//
+	DbgScriptProfiler* Profiler;
+
+	// NextAbortCheck - Tick count (GetTickCount64) before which abort checks
+	// return false without asking DbgEng. Shared so that every provider
+	// amortizes against the same clock.
+	//
+	ULONGLONG NextAbortCheck;
+
+	// BytecodeCacheDir - Directory of the bytecode cache (!bytecodecache), or
+	// empty if the cache is disabled. See bytecodecache.h.
+	//
+	char BytecodeCacheDir[MAX_PATH];
 };
 
 char*
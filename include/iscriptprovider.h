@@ -24,6 +24,12 @@ struct IScriptProvider
 	
 	virtual void
 	StopVM() = 0;
+
+	// Give the next run a fresh script environment (globals, argv) without
+	// restarting the VM. Imported modules stay loaded. Used by !startvm -reset.
+	//
+	virtual _Check_return_ HRESULT
+	ResetVM() = 0;
 	
 	virtual _Check_return_ HRESULT 
 	Run(
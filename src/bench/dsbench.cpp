@@ -0,0 +1,624 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: dsbench.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Microbenchmarks for the hot paths of the support library.
+//
+// Notes:
+//
+//  Usage: dsbench <dump> [iterations]
+//
+//  Opens 'dump' (test\bench\bench.dmp) in a private debugger engine and times
+//  support library routines against the locals of its current frame. Results
+//  go to stdout as JSON, in the layout Google Benchmark uses, so they can be
+//  diffed across versions.
+//
+//  Each benchmark is run once to warm caches before it is timed, so the
+//  numbers are for the steady state a script sees after its first access.
+//  Allocations are counted through operator new, which the support library's
+//  STL containers go through.
+//
+// @EndHeader@
+//******************************************************************************
+#include <windows.h>
+#include <dbgeng.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <strsafe.h>
+#include "../common.h"
+#include "../support/util.h"
+#include "../support/symcache.h"
+#include "../support/arena.h"
+
+const ULONG DEFAULT_ITERATIONS = 100000;
+
+// Length of the 'path' local in benchapp.
+//
+const ULONG PATH_LEN = 16;
+
+// Number of calls to operator new so far.
+//
+static UINT64 s_Allocs;
+
+void* __cdecl
+operator new(
+	_In_ size_t size)
+{
+	++s_Allocs;
+
+	void* p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void __cdecl
+operator delete(
+	_In_opt_ void* p) noexcept
+{
+	free(p);
+}
+
+// BenchContext - State shared by all benchmarks.
+//
+struct BenchContext
+{
+	DbgScriptHostContext* HostCtxt;
+
+	DbgScriptThread Thread;
+
+	DbgScriptStackFrame Frame;
+
+	// The 'particle' local, and what's needed to rebuild it.
+	//
+	DbgScriptTypedObject Particle;
+
+	DEBUG_SYMBOL_ENTRY ParticleEntry;
+
+	// The 'path' local, an array.
+	//
+	DbgScriptTypedObject Path;
+
+	// Were both locals found?
+	//
+	bool FoundParticle;
+
+	bool FoundPath;
+
+	// Address of 'particle.name'.
+	//
+	UINT64 NameAddr;
+
+	// Module and type ID of 'Particle'.
+	//
+	ModuleAndTypeId ParticleType;
+
+	// Iteration number, for benchmarks that vary their input.
+	//
+	ULONG Iteration;
+
+	// Arena for the allocator benchmark, as a VM would use it.
+	//
+	Arena VMArena;
+};
+
+typedef _Check_return_ HRESULT
+(*BenchFn)(
+	_In_ BenchContext* ctxt);
+
+// Benchmark - A routine to time, and its name in the results.
+//
+struct Benchmark
+{
+	const char* Name;
+
+	BenchFn Fn;
+};
+
+//------------------------------------------------------------------------------
+// Function: findLocalsCallback
+//
+// Description:
+//
+//  Pick out the locals the benchmarks need.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+findLocalsCallback(
+	_In_ DEBUG_SYMBOL_ENTRY* entry,
+	_In_z_ const char* symName,
+	_In_ ULONG /*idx*/,
+	_In_opt_ void* userctxt)
+{
+	HRESULT hr = S_OK;
+	BenchContext* ctxt = (BenchContext*)userctxt;
+	DbgScriptTypedObject* obj = nullptr;
+
+	if (!strcmp(symName, "particle"))
+	{
+		ctxt->ParticleEntry = *entry;
+		ctxt->FoundParticle = true;
+		obj = &ctxt->Particle;
+	}
+	else if (!strcmp(symName, "path"))
+	{
+		ctxt->FoundPath = true;
+		obj = &ctxt->Path;
+	}
+	else
+	{
+		goto exit;
+	}
+
+	hr = DsInitializeTypedObject(
+		ctxt->HostCtxt,
+		entry->Size,
+		symName,
+		entry->TypeId,
+		entry->ModuleBase,
+		entry->Offset,
+		false /* wantPointer */,
+		obj);
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: nullLocalsCallback
+//
+// Description:
+//
+//  Stack variable callback that does nothing.
+//
+// Parameters:
+//
+// Returns:
+//
+//  S_OK.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+nullLocalsCallback(
+	_In_ DEBUG_SYMBOL_ENTRY* /*entry*/,
+	_In_z_ const char* /*symName*/,
+	_In_ ULONG /*idx*/,
+	_In_opt_ void* /*userctxt*/)
+{
+	return S_OK;
+}
+
+//
+// Benchmarks. Each performs one operation on the locals found by openDump.
+//
+
+static _Check_return_ HRESULT
+benchInitializeTypedObject(
+	_In_ BenchContext* ctxt)
+{
+	DbgScriptTypedObject obj;
+	const DEBUG_SYMBOL_ENTRY& entry = ctxt->ParticleEntry;
+
+	return DsInitializeTypedObject(
+		ctxt->HostCtxt,
+		entry.Size,
+		"particle",
+		entry.TypeId,
+		entry.ModuleBase,
+		entry.Offset,
+		false /* wantPointer */,
+		&obj);
+}
+
+static _Check_return_ HRESULT
+benchGetField(
+	_In_ BenchContext* ctxt)
+{
+	DEBUG_TYPED_DATA data = {};
+	return DsTypedObjectGetField(
+		ctxt->HostCtxt, &ctxt->Particle, "pos", false /* fPrintMissing */, &data);
+}
+
+static _Check_return_ HRESULT
+benchGetArrayElement(
+	_In_ BenchContext* ctxt)
+{
+	DEBUG_TYPED_DATA data = {};
+	return DsTypedObjectGetArrayElement(
+		ctxt->HostCtxt, &ctxt->Path, ctxt->Iteration % PATH_LEN, &data);
+}
+
+static _Check_return_ HRESULT
+benchGetCachedSymbolType(
+	_In_ BenchContext* ctxt)
+{
+	return GetCachedSymbolType(ctxt->HostCtxt, "benchapp!Particle") ?
+		S_OK : E_FAIL;
+}
+
+static _Check_return_ HRESULT
+benchGetCachedTypeName(
+	_In_ BenchContext* ctxt)
+{
+	return GetCachedTypeName(ctxt->HostCtxt, ctxt->ParticleType) ?
+		S_OK : E_FAIL;
+}
+
+static _Check_return_ HRESULT
+benchBufferOutput(
+	_In_ BenchContext* ctxt)
+{
+	const char line[] = "benchmark output line\n";
+
+	ctxt->HostCtxt->IsBuffering++;
+	UtilBufferOutput(ctxt->HostCtxt, line, _countof(line) - 1);
+	ctxt->HostCtxt->IsBuffering--;
+	return S_OK;
+}
+
+static _Check_return_ HRESULT
+benchReadAnsiString(
+	_In_ BenchContext* ctxt)
+{
+	char buf[64];
+	return UtilReadAnsiString(
+		ctxt->HostCtxt, ctxt->NameAddr, buf, sizeof(buf), -1 /* cbMaxToRead */);
+}
+
+static _Check_return_ HRESULT
+benchEnumStackFrameVariables(
+	_In_ BenchContext* ctxt)
+{
+	HRESULT hr = S_OK;
+	ULONG numSym = 0;
+	IDebugSymbolGroup2* symGrp = nullptr;
+
+	hr = UtilCountStackFrameVariables(
+		ctxt->HostCtxt,
+		&ctxt->Thread,
+		&ctxt->Frame,
+		DEBUG_SCOPE_GROUP_LOCALS,
+		&numSym,
+		&symGrp);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	// Releases 'symGrp'.
+	//
+	hr = UtilEnumStackFrameVariables(
+		ctxt->HostCtxt, symGrp, numSym, nullLocalsCallback, nullptr);
+
+exit:
+	return hr;
+}
+
+static _Check_return_ HRESULT
+benchArenaAllocFree(
+	_In_ BenchContext* ctxt)
+{
+	// A mix of sizes, like a VM's strings, tables and closures.
+	//
+	const SIZE_T size = 16 + (ctxt->Iteration % 64) * 8;
+
+	void* a = ArenaAlloc(&ctxt->VMArena, size);
+	void* b = ArenaAlloc(&ctxt->VMArena, 40);
+	if (!a || !b)
+	{
+		ArenaFree(&ctxt->VMArena, a, size);
+		ArenaFree(&ctxt->VMArena, b, 40);
+		return E_OUTOFMEMORY;
+	}
+
+	ArenaFree(&ctxt->VMArena, b, 40);
+	ArenaFree(&ctxt->VMArena, a, size);
+	return S_OK;
+}
+
+static const Benchmark s_Benchmarks[] =
+{
+	{ "DsInitializeTypedObject", benchInitializeTypedObject },
+	{ "DsTypedObjectGetField", benchGetField },
+	{ "DsTypedObjectGetArrayElement", benchGetArrayElement },
+	{ "GetCachedSymbolType", benchGetCachedSymbolType },
+	{ "GetCachedTypeName", benchGetCachedTypeName },
+	{ "UtilBufferOutput", benchBufferOutput },
+	{ "UtilReadAnsiString", benchReadAnsiString },
+	{ "UtilEnumStackFrameVariables", benchEnumStackFrameVariables },
+	{ "ArenaAllocFree", benchArenaAllocFree },
+};
+
+//------------------------------------------------------------------------------
+// Function: openDump
+//
+// Description:
+//
+//  Open a dump in a new debugger engine and set up the host context and
+//  benchmark context against it.
+//
+// Parameters:
+//
+//  dumpPath - Dump to open. Its symbols are looked for next to it.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+openDump(
+	_In_z_ const char* dumpPath,
+	_Inout_ BenchContext* ctxt)
+{
+	HRESULT hr = S_OK;
+	DbgScriptHostContext* hostCtxt = ctxt->HostCtxt;
+	IDebugClient* client = nullptr;
+	char dir[MAX_PATH] = ".";
+	const char* slash = strrchr(dumpPath, '\\');
+	ULONG numSym = 0;
+	IDebugSymbolGroup2* symGrp = nullptr;
+	DEBUG_TYPED_DATA nameData = {};
+
+	hr = DebugCreate(__uuidof(IDebugClient), (void **)&client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	hostCtxt->DebugClient = client;
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugControl), (void **)&hostCtxt->DebugControl);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugSystemObjects), (void **)&hostCtxt->DebugSysObj);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugSymbols3), (void **)&hostCtxt->DebugSymbols);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugAdvanced2), (void **)&hostCtxt->DebugAdvanced);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugDataSpaces4), (void **)&hostCtxt->DebugDataSpaces);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	if (slash)
+	{
+		hr = StringCchCopyNA(STRING_AND_CCH(dir), dumpPath, slash - dumpPath);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+	}
+
+	hr = hostCtxt->DebugSymbols->AppendSymbolPath(dir);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->OpenDumpFile(dumpPath);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = hostCtxt->DebugControl->WaitForEvent(DEBUG_WAIT_DEFAULT, INFINITE);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = hostCtxt->DebugSysObj->GetCurrentThreadId(&ctxt->Thread.EngineId);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = hostCtxt->DebugSysObj->GetCurrentThreadSystemId(&ctxt->Thread.ThreadId);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = DsGetCurrentStackFrame(hostCtxt, &ctxt->Thread, &ctxt->Frame);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = UtilCountStackFrameVariables(
+		hostCtxt,
+		&ctxt->Thread,
+		&ctxt->Frame,
+		DEBUG_SCOPE_GROUP_LOCALS,
+		&numSym,
+		&symGrp);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = UtilEnumStackFrameVariables(
+		hostCtxt, symGrp, numSym, findLocalsCallback, ctxt);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	if (!ctxt->FoundParticle || !ctxt->FoundPath)
+	{
+		fprintf(stderr, "Error: 'particle' or 'path' not found in current frame.\n");
+		hr = E_FAIL;
+		goto exit;
+	}
+
+	hr = DsTypedObjectGetField(
+		hostCtxt, &ctxt->Particle, "name", true /* fPrintMissing */, &nameData);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	ctxt->NameAddr = nameData.Offset;
+	ctxt->ParticleType.ModuleBase = ctxt->ParticleEntry.ModuleBase;
+	ctxt->ParticleType.TypeId = ctxt->ParticleEntry.TypeId;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: main
+//
+// Description:
+//
+//  Entry point.
+//
+// Parameters:
+//
+// Returns:
+//
+//  0 on success, 1 otherwise.
+//
+// Notes:
+//
+int __cdecl
+main(
+	_In_ int argc,
+	_In_reads_(argc) char** argv)
+{
+	HRESULT hr = S_OK;
+	BenchContext ctxt = {};
+	ULONG iterations = DEFAULT_ITERATIONS;
+	LARGE_INTEGER freq = {};
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: dsbench <dump> [iterations]\n");
+		return 1;
+	}
+
+	if (argc > 2)
+	{
+		iterations = strtoul(argv[2], nullptr, 10);
+		if (!iterations)
+		{
+			fprintf(stderr, "Error: iterations must be a positive number.\n");
+			return 1;
+		}
+	}
+
+	// Zero-initialized, like the host's.
+	//
+	ctxt.HostCtxt = new DbgScriptHostContext();
+
+	hr = openDump(argv[1], &ctxt);
+	if (FAILED(hr))
+	{
+		fprintf(stderr, "Error: Failed to open '%s'. Error 0x%08x.\n", argv[1], hr);
+		return 1;
+	}
+
+	QueryPerformanceFrequency(&freq);
+
+	printf("{\n");
+	printf("  \"context\": {\n");
+	printf("    \"executable\": \"dsbench\",\n");
+	printf("    \"iterations\": %lu\n", iterations);
+	printf("  },\n");
+	printf("  \"benchmarks\": [\n");
+
+	for (ULONG i = 0; i < _countof(s_Benchmarks); ++i)
+	{
+		const Benchmark& bench = s_Benchmarks[i];
+		LARGE_INTEGER start = {};
+		LARGE_INTEGER end = {};
+
+		// Warm up.
+		//
+		ctxt.Iteration = 0;
+		hr = bench.Fn(&ctxt);
+		if (FAILED(hr))
+		{
+			fprintf(stderr, "Error: %s failed. Error 0x%08x.\n", bench.Name, hr);
+			break;
+		}
+
+		const UINT64 allocsBefore = s_Allocs;
+		QueryPerformanceCounter(&start);
+
+		for (ctxt.Iteration = 0; ctxt.Iteration < iterations; ++ctxt.Iteration)
+		{
+			hr = bench.Fn(&ctxt);
+			if (FAILED(hr))
+			{
+				break;
+			}
+		}
+
+		QueryPerformanceCounter(&end);
+		const UINT64 allocs = s_Allocs - allocsBefore;
+
+		if (FAILED(hr))
+		{
+			fprintf(stderr, "Error: %s failed. Error 0x%08x.\n", bench.Name, hr);
+			break;
+		}
+
+		const double ns =
+			(double)(end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart;
+
+		printf("    {\n");
+		printf("      \"name\": \"%s\",\n", bench.Name);
+		printf("      \"iterations\": %lu,\n", iterations);
+		printf("      \"real_time\": %.1f,\n", ns / iterations);
+		printf("      \"time_unit\": \"ns\",\n");
+		printf("      \"allocs_per_iter\": %.2f\n", (double)allocs / iterations);
+		printf("    }%s\n", i + 1 < _countof(s_Benchmarks) ? "," : "");
+	}
+
+	printf("  ]\n");
+	printf("}\n");
+
+	UtilFlushMessageBuffer(ctxt.HostCtxt);
+	ArenaDestroy(&ctxt.VMArena);
+
+	return FAILED(hr) ? 1 : 0;
+}
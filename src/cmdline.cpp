@@ -91,6 +91,42 @@ ParseArgs(
 			{
 				parsedArgs->TimeRun = true;
 			}
+			else if (!strcmp(tok, "-stats"))
+			{
+				parsedArgs->Stats = true;
+			}
+			else if (!strcmp(tok, "-timeline"))
+			{
+				// Capture value for key.
+				//
+				tok = strtok_s(nullptr, " \t", &nextTok);
+				if (!tok)
+				{
+					hr = E_INVALIDARG;
+					hostCtxt->DebugControl->Output(
+						DEBUG_OUTPUT_ERROR,
+						"Error: -timeline requires a file name.\n");
+					goto exit;
+				}
+
+				parsedArgs->TimelinePath = tok;
+			}
+			else if (!strcmp(tok, "-profile"))
+			{
+				// Capture value for key.
+				//
+				tok = strtok_s(nullptr, " \t", &nextTok);
+				if (!tok)
+				{
+					hr = E_INVALIDARG;
+					hostCtxt->DebugControl->Output(
+						DEBUG_OUTPUT_ERROR,
+						"Error: -profile requires a file name.\n");
+					goto exit;
+				}
+
+				parsedArgs->ProfilePath = tok;
+			}
 			else if (!strcmp(tok, "-l"))
 			{
 				// Capture value for key.
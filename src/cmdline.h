@@ -22,6 +22,19 @@ struct ParsedArgs
 	//
 	bool TimeRun;
 
+	// Stats - was -stats provided? Statistics will be collected for the run
+	// and reported.
+	//
+	bool Stats;
+
+	// TimelinePath - file to write the run's timeline to, or null.
+	//
+	const char* TimelinePath; // -timeline <file>
+
+	// ProfilePath - file to write the run's profile to, or null.
+	//
+	const char* ProfilePath; // -profile <file>
+
 	// LangId - language id provided.
 	//
 	WCHAR LangId[MAX_LANG_ID]; // -l <lang>
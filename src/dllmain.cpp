@@ -20,6 +20,11 @@
 #include "common.h"
 #include "cmdline.h"
 #include "support/util.h"
+#include "support/dumpmap.h"
+#include "support/trace.h"
+#include "support/stats.h"
+#include "support/timeline.h"
+#include "support/profiler.h"
 
 static DbgScriptHostContext g_HostCtxt;
 
@@ -87,6 +92,11 @@ struct ScriptProviderInfo
 	//
 	WCHAR LangId[MAX_LANG_ID]; // -l <lang>
 
+	// Reference taken by the background prefetch (see
+	// prefetchScriptProviders), or null.
+	//
+	HMODULE PrefetchModule;
+
 	//
 	// CRT memory leak debugging information.
 	//
@@ -122,6 +132,220 @@ static const ScriptProvCallbackBinding x_CallbackBindings[] =
 	{ SCRIPT_PROV_CREATE, offsetof(ScriptProviderInfo, CreateFunc) },
 };
 
+// DbgEngIfaces - DbgEng interfaces acquired from one client.
+//
+struct DbgEngIfaces
+{
+	// Client the interfaces came from, with a reference held. Null if the
+	// slot is unused.
+	//
+	IDebugClient* Client;
+	IDebugControl* DebugControl;
+	IDebugSystemObjects* DebugSysObj;
+	IDebugSymbols3* DebugSymbols;
+	IDebugAdvanced2* DebugAdvanced;
+	IDebugDataSpaces4* DebugDataSpaces;
+
+	// Value of s_IfaceClock when last made current.
+	//
+	UINT64 LastUse;
+};
+
+// Interfaces of the most recently used clients. The current set is the one
+// copied into g_HostCtxt.
+//
+static DbgEngIfaces s_IfaceCache[4];
+
+static UINT64 s_IfaceClock;
+
+// Background load of provider DLLs started by !startvm, or null.
+//
+static PTP_WORK s_PrefetchWork;
+
+// StartupPhase - A phase of the first script command, for
+// !dbgscriptstats startup.
+//
+enum StartupPhase
+{
+	StartupPhaseInterfaces,
+	StartupPhaseDiscovery,
+	StartupPhasePrefetchWait,
+	StartupPhaseProviderLoad,
+	StartupPhaseVMStart,
+	StartupPhaseScript,
+
+	StartupPhaseMax
+};
+
+static const char* const s_StartupPhaseNames[StartupPhaseMax] =
+{
+	"Interfaces",
+	"Discovery",
+	"PrefetchWait",
+	"ProviderLoad",
+	"VMStart",
+	"Script",
+};
+
+// StartupTimes - Where the time went between loading the extension and
+// finishing the first !runscript or !evalstring. Unlike !dbgscriptstats,
+// always collected, since it's over by the time anyone could turn it on.
+//
+struct StartupTimes
+{
+	// Performance counter frequency, in ticks per second.
+	//
+	LONGLONG Frequency;
+
+	// Time spent in DebugExtensionInitialize, in ticks.
+	//
+	LONGLONG InitTicks;
+
+	// Set while the first script command runs.
+	//
+	bool InFirstCommand;
+
+	// Set once it's finished.
+	//
+	bool Done;
+
+	// Name of the first script command.
+	//
+	const char* Command;
+
+	// Time spent in the first script command, and in each of its phases, in
+	// ticks.
+	//
+	LONGLONG CommandTicks;
+
+	LONGLONG PhaseTicks[StartupPhaseMax];
+};
+
+static StartupTimes s_Startup;
+
+//------------------------------------------------------------------------------
+// Function: startupNow
+//
+// Description:
+//
+//  Current performance counter value.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static LONGLONG
+startupNow()
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+// Function: startupBegin
+//
+// Description:
+//
+//  Start timing a phase of the first script command.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Value to pass to startupEnd. Zero outside the first script command.
+//
+// Notes:
+//
+static LONGLONG
+startupBegin()
+{
+	return s_Startup.InFirstCommand ? startupNow() : 0;
+}
+
+//------------------------------------------------------------------------------
+// Function: startupEnd
+//
+// Description:
+//
+//  Charge the time since startupBegin to a phase of the first script command.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+startupEnd(
+	_In_ StartupPhase phase,
+	_In_ LONGLONG start)
+{
+	if (start && s_Startup.InFirstCommand)
+	{
+		s_Startup.PhaseTicks[phase] += startupNow() - start;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: startupCommandBegin
+//
+// Description:
+//
+//  Called on entry to a script command.
+//
+// Parameters:
+//
+//  command - Name of the command.
+//
+// Returns:
+//
+//  Value to pass to startupCommandEnd. Zero unless this is the first script
+//  command.
+//
+// Notes:
+//
+static LONGLONG
+startupCommandBegin(
+	_In_z_ const char* command)
+{
+	if (s_Startup.Done || s_Startup.InFirstCommand)
+	{
+		return 0;
+	}
+
+	s_Startup.InFirstCommand = true;
+	s_Startup.Command = command;
+	return startupNow();
+}
+
+//------------------------------------------------------------------------------
+// Function: startupCommandEnd
+//
+// Description:
+//
+//  Called on exit from a script command.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+startupCommandEnd(
+	_In_ LONGLONG start)
+{
+	if (start)
+	{
+		s_Startup.CommandTicks = startupNow() - start;
+		s_Startup.InFirstCommand = false;
+		s_Startup.Done = true;
+	}
+}
+
 //------------------------------------------------------------------------------
 // Function: DllMain
 //
@@ -218,6 +442,138 @@ unloadScriptProvider(
 	}
 }
 
+//------------------------------------------------------------------------------
+// Function: prefetchScriptProvidersCb
+//
+// Description:
+//
+//  Threadpool callback that loads the DLL of every provider that isn't
+//  loaded yet.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Only maps the DLLs and their dependencies; providers are still initialized
+//  on the debugger's thread when first used. LOAD_WITH_ALTERED_SEARCH_PATH
+//  finds dependencies next to the provider without touching the process-wide
+//  DLL directory.
+//
+static void CALLBACK
+prefetchScriptProvidersCb(
+	_Inout_ PTP_CALLBACK_INSTANCE /* instance */,
+	_Inout_opt_ PVOID /* ctxt */,
+	_Inout_ PTP_WORK /* work */)
+{
+	ScriptProviderInfo* cur = g_HostCtxt.ScriptProviders;
+	while (cur)
+	{
+		if (!cur->Module && !cur->PrefetchModule)
+		{
+			cur->PrefetchModule = LoadLibraryEx(
+				cur->DllFileName, nullptr, LOAD_WITH_ALTERED_SEARCH_PATH);
+		}
+		cur = cur->Next;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: prefetchScriptProviders
+//
+// Description:
+//
+//  Start loading provider DLLs in the background.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Used by !startvm, so that the first script doesn't wait for the
+//  interpreter DLLs to load. Without a persistent VM, providers are unloaded
+//  after every run, and holding them loaded would leak state between runs.
+//
+//  Best effort: if the work can't be queued, providers load on first use as
+//  usual.
+//
+static void
+prefetchScriptProviders()
+{
+	if (s_PrefetchWork)
+	{
+		return;
+	}
+
+	s_PrefetchWork = CreateThreadpoolWork(prefetchScriptProvidersCb, nullptr, nullptr);
+	if (s_PrefetchWork)
+	{
+		SubmitThreadpoolWork(s_PrefetchWork);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: waitForPrefetch
+//
+// Description:
+//
+//  Wait for the background load of provider DLLs, if any, to finish.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Must be called before touching the provider list, which the prefetch
+//  reads.
+//
+static void
+waitForPrefetch()
+{
+	if (s_PrefetchWork)
+	{
+		const LONGLONG startupStart = startupBegin();
+		WaitForThreadpoolWorkCallbacks(s_PrefetchWork, FALSE /* cancel */);
+		CloseThreadpoolWork(s_PrefetchWork);
+		s_PrefetchWork = nullptr;
+		startupEnd(StartupPhasePrefetchWait, startupStart);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: releasePrefetchedProviders
+//
+// Description:
+//
+//  Drop the references taken by the prefetch, so that unloading a provider
+//  really unloads its DLL.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+releasePrefetchedProviders()
+{
+	waitForPrefetch();
+
+	ScriptProviderInfo* cur = g_HostCtxt.ScriptProviders;
+	while (cur)
+	{
+		if (cur->PrefetchModule)
+		{
+			FreeLibrary(cur->PrefetchModule);
+			cur->PrefetchModule = nullptr;
+		}
+		cur = cur->Next;
+	}
+}
+
 //------------------------------------------------------------------------------
 // Function: loadAndCreateScriptProvider
 //
@@ -236,6 +592,8 @@ loadAndCreateScriptProvider(
 	_Inout_ ScriptProviderInfo* info)
 {
 	HRESULT hr = S_OK;
+	LONGLONG statsStart = 0;
+	LONGLONG startupStart = 0;
 
 	WCHAR dllPath[MAX_PATH] = {};
 	StringCchCopy(STRING_AND_CCH(dllPath), info->DllFileName);
@@ -266,6 +624,10 @@ loadAndCreateScriptProvider(
 	//
 	_CrtMemCheckpoint(&info->MemStateBefore);
 	
+	waitForPrefetch();
+
+	statsStart = StatsBegin(&g_HostCtxt);
+	startupStart = startupBegin();
 	info->Module = LoadLibrary(info->DllFileName);
 	if (!info->Module)
 	{
@@ -273,6 +635,14 @@ loadAndCreateScriptProvider(
 		goto exit;
 	}
 
+	// Our own reference keeps the DLL loaded now.
+	//
+	if (info->PrefetchModule)
+	{
+		FreeLibrary(info->PrefetchModule);
+		info->PrefetchModule = nullptr;
+	}
+
 	// Bind all the callbacks.
 	//
 	for (int i = 0; i < _countof(x_CallbackBindings); ++i)
@@ -302,9 +672,16 @@ loadAndCreateScriptProvider(
 		goto exit;
 	}
 
+	StatsEnd(&g_HostCtxt, StatsTimerProviderLoad, statsStart);
+	startupEnd(StartupPhaseProviderLoad, startupStart);
+
 	// Call provider instance's init routine.
 	//
+	statsStart = StatsBegin(&g_HostCtxt);
+	startupStart = startupBegin();
 	hr = info->ScriptProvider->Init();
+	StatsEnd(&g_HostCtxt, StatsTimerVMStart, statsStart);
+	startupEnd(StartupPhaseVMStart, startupStart);
 	if (FAILED(hr))
 	{
 		goto exit;
@@ -326,15 +703,33 @@ exit:
 //
 // Notes:
 //
+//  Under !startvm -reset, the provider's script state is reset before every
+//  run, including the first, so that providers can isolate each run.
+//
 static _Check_return_ HRESULT
 loadScriptProviderIfNeeded(
 	_Inout_ ScriptProviderInfo* info)
 {
+	HRESULT hr = S_OK;
+	LONGLONG statsStart = 0;
+
 	if (!info->ScriptProvider)
 	{
-		return loadAndCreateScriptProvider(info);
+		hr = loadAndCreateScriptProvider(info);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+	}
+
+	if (g_HostCtxt.ResetVMEnabled)
+	{
+		statsStart = StatsBegin(&g_HostCtxt);
+		hr = info->ScriptProvider->ResetVM();
+		StatsEnd(&g_HostCtxt, StatsTimerVMReset, statsStart);
 	}
-	return S_OK;
+exit:
+	return hr;
 }
 
 //------------------------------------------------------------------------------
@@ -353,6 +748,8 @@ loadScriptProviderIfNeeded(
 static void
 unloadAllScriptProviders()
 {
+	releasePrefetchedProviders();
+
 	ScriptProviderInfo* cur = g_HostCtxt.ScriptProviders;
 	while (cur)
 	{
@@ -377,6 +774,8 @@ unloadAllScriptProviders()
 static void
 cleanupScriptProviders()
 {
+	releasePrefetchedProviders();
+
 	ScriptProviderInfo* cur = g_HostCtxt.ScriptProviders;
 	while (cur)
 	{
@@ -495,12 +894,11 @@ exit:
 }
 
 //------------------------------------------------------------------------------
-// Function: acquireDbgEngIfaces
+// Function: ensureScriptProvidersRegistered
 //
 // Description:
 //
-//  Obtain commonly used DbgEng interfaces from IDebugClient and save them in
-//  g_HostCtxt.
+//  Build the list of script providers on first use.
 //
 // Parameters:
 //
@@ -508,47 +906,94 @@ exit:
 //
 // Notes:
 //
-static _Check_return_ HRESULT 
-acquireDbgEngIfaces(
-	_In_ IDebugClient* client)
+//  Deferred from extension load so that loading dbgscript, and commands that
+//  don't run scripts, never touch the registry. A failed attempt is retried
+//  next time, e.g. after the providers are installed.
+//
+static _Check_return_ HRESULT
+ensureScriptProvidersRegistered()
 {
 	HRESULT hr = S_OK;
+	LONGLONG startupStart = 0;
 
-	// Save the passed-in client.
-	//
-	g_HostCtxt.DebugClient = client;
-	
-	hr = client->QueryInterface(
-		__uuidof(IDebugControl), (void **)&g_HostCtxt.DebugControl);
-	if (FAILED(hr))
-	{
-		goto exit;
-	}
-
-	hr = client->QueryInterface(
-		__uuidof(IDebugSystemObjects), (void **)&g_HostCtxt.DebugSysObj);
-	if (FAILED(hr))
-	{
-		goto exit;
-	}
-
-	hr = client->QueryInterface(
-		__uuidof(IDebugSymbols3), (void **)&g_HostCtxt.DebugSymbols);
-	if (FAILED(hr))
+	if (g_HostCtxt.ScriptProviders)
 	{
 		goto exit;
 	}
 
-	hr = client->QueryInterface(
-		__uuidof(IDebugAdvanced2), (void **)&g_HostCtxt.DebugAdvanced);
+	startupStart = startupBegin();
+	hr = registerScriptProviders();
+	startupEnd(StartupPhaseDiscovery, startupStart);
 	if (FAILED(hr))
 	{
+		// Discard a partial list.
+		//
+		cleanupScriptProviders();
 		goto exit;
 	}
+exit:
+	return hr;
+}
 
-	hr = client->QueryInterface(
-		__uuidof(IDebugDataSpaces4), (void **)&g_HostCtxt.DebugDataSpaces);
-	if (FAILED(hr))
+//------------------------------------------------------------------------------
+// Function: acquireDbgEngIfaces
+//
+// Description:
+//
+//  Obtain commonly used DbgEng interfaces from IDebugClient.
+//
+// Parameters:
+//
+//  ifaces - Receives the client, with a reference, and its interfaces.
+//
+// Returns:
+//
+// Notes:
+//
+//  On failure, whatever was acquired is left in 'ifaces' for the caller to
+//  release.
+//
+static _Check_return_ HRESULT 
+acquireDbgEngIfaces(
+	_In_ IDebugClient* client,
+	_Inout_ DbgEngIfaces* ifaces)
+{
+	HRESULT hr = S_OK;
+
+	client->AddRef();
+	ifaces->Client = client;
+	
+	hr = client->QueryInterface(
+		__uuidof(IDebugControl), (void **)&ifaces->DebugControl);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugSystemObjects), (void **)&ifaces->DebugSysObj);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugSymbols3), (void **)&ifaces->DebugSymbols);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugAdvanced2), (void **)&ifaces->DebugAdvanced);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client->QueryInterface(
+		__uuidof(IDebugDataSpaces4), (void **)&ifaces->DebugDataSpaces);
+	if (FAILED(hr))
 	{
 		goto exit;
 	}
@@ -561,7 +1006,7 @@ exit:
 //
 // Description:
 //
-//  Releases DbgEng interfaces in g_HostCtxt, including the IDebugClient.
+//  Releases a set of DbgEng interfaces, including the IDebugClient.
 //
 // Parameters:
 //
@@ -569,55 +1014,82 @@ exit:
 //
 // Notes:
 //
-//  Idempotent: checks for NULL.
+//  Idempotent: checks for NULL, and leaves 'ifaces' empty.
 //
 static void 
-releaseDbgEngIfaces()
+releaseDbgEngIfaces(
+	_Inout_ DbgEngIfaces* ifaces)
 {
-	if (g_HostCtxt.DebugDataSpaces)
+	if (ifaces->DebugDataSpaces)
 	{
-		g_HostCtxt.DebugDataSpaces->Release();
-		g_HostCtxt.DebugDataSpaces = nullptr;
+		ifaces->DebugDataSpaces->Release();
 	}
 
-	if (g_HostCtxt.DebugAdvanced)
+	if (ifaces->DebugAdvanced)
 	{
-		g_HostCtxt.DebugAdvanced->Release();
-		g_HostCtxt.DebugAdvanced = nullptr;
+		ifaces->DebugAdvanced->Release();
 	}
 
-	if (g_HostCtxt.DebugSymbols)
+	if (ifaces->DebugSymbols)
 	{
-		g_HostCtxt.DebugSymbols->Release();
-		g_HostCtxt.DebugSymbols = nullptr;
+		ifaces->DebugSymbols->Release();
 	}
 
-	if (g_HostCtxt.DebugSysObj)
+	if (ifaces->DebugSysObj)
 	{
-		g_HostCtxt.DebugSysObj->Release();
-		g_HostCtxt.DebugSysObj = nullptr;
+		ifaces->DebugSysObj->Release();
 	}
 
-	if (g_HostCtxt.DebugControl)
+	if (ifaces->DebugControl)
 	{
-		g_HostCtxt.DebugControl->Release();
-		g_HostCtxt.DebugControl = nullptr;
+		ifaces->DebugControl->Release();
 	}
 
-	if (g_HostCtxt.DebugClient)
+	if (ifaces->Client)
 	{
-		g_HostCtxt.DebugClient->Release();
-		g_HostCtxt.DebugClient = nullptr;
+		ifaces->Client->Release();
 	}
+
+	ZeroMemory(ifaces, sizeof(*ifaces));
 }
 
 //------------------------------------------------------------------------------
-// Function: releaseDbgEngIfaces
+// Function: releaseAllDbgEngIfaces
+//
+// Description:
+//
+//  Releases every cached set of DbgEng interfaces and clears them from
+//  g_HostCtxt.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void 
+releaseAllDbgEngIfaces()
+{
+	for (ULONG i = 0; i < _countof(s_IfaceCache); ++i)
+	{
+		releaseDbgEngIfaces(&s_IfaceCache[i]);
+	}
+
+	g_HostCtxt.DebugClient = nullptr;
+	g_HostCtxt.DebugControl = nullptr;
+	g_HostCtxt.DebugSysObj = nullptr;
+	g_HostCtxt.DebugSymbols = nullptr;
+	g_HostCtxt.DebugAdvanced = nullptr;
+	g_HostCtxt.DebugDataSpaces = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Function: reAcquireIfacesIfNeeded
 //
 // Description:
 //
-//  Releases and re-acquires DbgEng interfaces from the given client if it
-//  differs from the cached one.
+//  Make the DbgEng interfaces of the given client current in g_HostCtxt,
+//  acquiring them if they aren't cached.
 //
 // Parameters:
 //
@@ -625,29 +1097,197 @@ releaseDbgEngIfaces()
 //
 // Notes:
 //
+//  Often times we'll be given the same client for each extension invocation,
+//  in which case this is a pointer compare. Debuggers that alternate between
+//  a few clients hit the cache instead of re-querying every interface. The
+//  least recently used set is released to make room.
+//
 static _Check_return_ HRESULT 
 reAcquireIfacesIfNeeded(
 	_In_ IDebugClient* client)
 {
 	HRESULT hr = S_OK;
+	DbgEngIfaces* ifaces = nullptr;
+	LONGLONG startupStart = 0;
 	
-	// Often times we'll be given the same client for each extension invocation.
-	// Only reacquire the ifaces if the client is different to what we have
-	// cached.
-	//
-	if (client != g_HostCtxt.DebugClient)
+	if (client == g_HostCtxt.DebugClient)
+	{
+		goto exit;
+	}
+
+	startupStart = startupBegin();
+
+	ifaces = &s_IfaceCache[0];
+	for (ULONG i = 0; i < _countof(s_IfaceCache); ++i)
+	{
+		DbgEngIfaces* cur = &s_IfaceCache[i];
+		if (cur->Client == client)
+		{
+			ifaces = cur;
+			break;
+		}
+
+		if (cur->LastUse < ifaces->LastUse)
+		{
+			ifaces = cur;
+		}
+	}
+
+	if (ifaces->Client != client)
 	{
-		releaseDbgEngIfaces();
-		hr = acquireDbgEngIfaces(client);
+		releaseDbgEngIfaces(ifaces);
+		hr = acquireDbgEngIfaces(client, ifaces);
 		if (FAILED(hr))
 		{
+			releaseDbgEngIfaces(ifaces);
 			goto exit;
 		}
 	}
+
+	ifaces->LastUse = ++s_IfaceClock;
+
+	g_HostCtxt.DebugClient = ifaces->Client;
+	g_HostCtxt.DebugControl = ifaces->DebugControl;
+	g_HostCtxt.DebugSysObj = ifaces->DebugSysObj;
+	g_HostCtxt.DebugSymbols = ifaces->DebugSymbols;
+	g_HostCtxt.DebugAdvanced = ifaces->DebugAdvanced;
+	g_HostCtxt.DebugDataSpaces = ifaces->DebugDataSpaces;
+
+	startupEnd(StartupPhaseInterfaces, startupStart);
 exit:
 	return hr;
 }
 
+//------------------------------------------------------------------------------
+// Function: initBytecodeCacheDir
+//
+// Description:
+//
+//  Set the default bytecode cache directory: %LOCALAPPDATA%\dbgscript\bytecode.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Leaves the cache disabled if LOCALAPPDATA isn't set. Lockdown builds
+//  don't write files, so the cache stays disabled there.
+//
+static void
+initBytecodeCacheDir()
+{
+#ifndef LOCKDOWN
+	char appData[MAX_PATH] = {};
+	const DWORD cch = GetEnvironmentVariableA("LOCALAPPDATA", appData, _countof(appData));
+	if (cch && cch < _countof(appData))
+	{
+		StringCchPrintfA(
+			STRING_AND_CCH(g_HostCtxt.BytecodeCacheDir),
+			"%s\\dbgscript\\bytecode",
+			appData);
+	}
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Function: hashModuleBytes
+//
+// Description:
+//
+//  Continue an FNV-1a hash over some bytes.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+hashModuleBytes(
+	_In_ UINT64 hash,
+	_In_reads_bytes_(cb) const void* data,
+	_In_ ULONG cb)
+{
+	const BYTE* bytes = (const BYTE*)data;
+	for (ULONG i = 0; i < cb; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: checkSymbolState
+//
+// Description:
+//
+//  Flush caches of symbols by address if the target's modules or their
+//  symbols have changed since the last command.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  DbgEng doesn't tell extensions about module loads or .reload, so this
+//  compares a hash of every module's parameters (base, size, timestamp,
+//  symbol type and symbol file) with the last one. That costs a couple of
+//  DbgEng calls per command. The support library's caches, linked into each
+//  provider, flush on their next lookup; the shared runtime type cache is
+//  flushed here.
+//
+static void
+checkSymbolState()
+{
+	ULONG cLoaded = 0;
+	ULONG cUnloaded = 0;
+	DEBUG_MODULE_PARAMETERS params[64];
+	UINT64 hash = 14695981039346656037ULL;
+
+	if (SUCCEEDED(g_HostCtxt.DebugSymbols->GetNumberModules(&cLoaded, &cUnloaded)))
+	{
+		hash = hashModuleBytes(hash, &cLoaded, sizeof(cLoaded));
+		hash = hashModuleBytes(hash, &cUnloaded, sizeof(cUnloaded));
+
+		for (ULONG start = 0; start < cLoaded; start += _countof(params))
+		{
+			const ULONG count = min(cLoaded - start, (ULONG)_countof(params));
+			if (FAILED(g_HostCtxt.DebugSymbols->GetModuleParameters(
+					count, nullptr, start, params)))
+			{
+				// Can't tell; assume it changed.
+				//
+				hash = ~g_HostCtxt.ModuleSignature;
+				break;
+			}
+
+			for (ULONG i = 0; i < count; ++i)
+			{
+				const DEBUG_MODULE_PARAMETERS& mod = params[i];
+				hash = hashModuleBytes(hash, &mod.Base, sizeof(mod.Base));
+				hash = hashModuleBytes(hash, &mod.Size, sizeof(mod.Size));
+				hash = hashModuleBytes(
+					hash, &mod.TimeDateStamp, sizeof(mod.TimeDateStamp));
+				hash = hashModuleBytes(hash, &mod.Checksum, sizeof(mod.Checksum));
+				hash = hashModuleBytes(hash, &mod.Flags, sizeof(mod.Flags));
+				hash = hashModuleBytes(hash, &mod.SymbolType, sizeof(mod.SymbolType));
+				hash = hashModuleBytes(
+					hash, &mod.SymbolFileNameSize, sizeof(mod.SymbolFileNameSize));
+			}
+		}
+	}
+
+	if (hash != g_HostCtxt.ModuleSignature)
+	{
+		g_HostCtxt.ModuleSignature = hash;
+		++g_HostCtxt.SymbolGeneration;
+		ZeroMemory(g_HostCtxt.RuntimeTypeCache, sizeof(g_HostCtxt.RuntimeTypeCache));
+	}
+}
+
 //------------------------------------------------------------------------------
 // Function: DebugExtensionInitialize
 //
@@ -666,40 +1306,25 @@ DebugExtensionInitialize(
 	_Out_ PULONG Version,
 	_Out_ PULONG Flags)
 {
-	HRESULT hr = S_OK;
+	LARGE_INTEGER frequency;
+	const LONGLONG initStart = startupNow();
+
 	*Version = DEBUG_EXTENSION_VERSION(1, 0);
 	*Flags = 0;
-	IDebugClient* client = nullptr;
-
-	// Make an initial client so we can output to the debugger in this routine.
-	// Future extension calls might overwrite it.
-	//
-	hr = DebugCreate(__uuidof(IDebugClient), (void **)&client);
-	if (FAILED(hr))
-	{
-		goto exit;
-	}
 
-	hr = acquireDbgEngIfaces(client);
-	if (FAILED(hr))
-	{
-		goto exit;
-	}
+	QueryPerformanceFrequency(&frequency);
+	s_Startup.Frequency = frequency.QuadPart;
 
+	// DbgEng interfaces are acquired from the client passed to the first
+	// command, and script providers are found on first use, so that loading
+	// the extension stays cheap.
+	//
 	g_HostCtxt.BufferedOutputCallbacks = GetDbgScriptOutputCb();
 
-	// Initialize all registered script providers.
-	//
-	hr = registerScriptProviders();
-	if (FAILED(hr))
-	{
-		goto exit;
-	}
+	initBytecodeCacheDir();
 
-exit:
-	// Here all the registered engines should be initialized.
-	//
-	return hr;
+	s_Startup.InitTicks = startupNow() - initStart;
+	return S_OK;
 }
 
 //------------------------------------------------------------------------------
@@ -720,7 +1345,15 @@ DebugExtensionUninitialize()
 {
 	cleanupScriptProviders();
 
-	releaseDbgEngIfaces();
+	DumpMapClose(&g_HostCtxt);
+
+	// Nowhere to report a failed flush at this point.
+	//
+	(void)TraceStop(&g_HostCtxt);
+
+	StatsDisable(&g_HostCtxt);
+
+	releaseAllDbgEngIfaces();
 }
 
 //------------------------------------------------------------------------------
@@ -771,6 +1404,10 @@ scriptpath(
 
 		elem = g_HostCtxt.ScriptPath = nullptr;
 
+		// Names resolved against the old path are no longer valid.
+		//
+		UtilFlushScriptPathCache(&g_HostCtxt);
+
 		// Can't use semi-colon since the debugger's command parser interprets that
 		// as a new command. Use comma instead.
 		//
@@ -839,100 +1476,286 @@ exit:
 }
 
 //------------------------------------------------------------------------------
-// Function: findScriptProvider
+// Function: startRunTimeline
 //
 // Description:
 //
-//  Look up a script provider by its language id in the list of registered
-//  providers.
+//  Start recording a timeline for a run, if -timeline was given.
 //
 // Parameters:
 //
+//  started - Set to true if a timeline was started for this run, and must be
+//   written out with stopRunTimeline when it ends.
+//
 // Returns:
 //
+//  HRESULT.
+//
 // Notes:
 //
+//  A run nested in another (via a debugger command) records into the outer
+//  run's timeline.
+//
 static _Check_return_ HRESULT
-findScriptProvider(
-	_In_opt_z_ const WCHAR* langId,
-	_Outptr_ ScriptProviderInfo** scriptProv)
+startRunTimeline(
+	_In_ const ParsedArgs* parsedArgs,
+	_Out_ bool* started)
 {
 	HRESULT hr = S_OK;
 
-	// Validated during DLL initalization that we found at least one provider.
-	//
-	assert(GetHostContext()->ScriptProviders);
-
-	// Default to the head of the list.
-	//
-	*scriptProv = GetHostContext()->ScriptProviders;
-	assert(scriptProv);
-
-	if (langId)
+	*started = false;
+	if (!parsedArgs->TimelinePath)
 	{
-		ScriptProviderInfo* cur = GetHostContext()->ScriptProviders;
-		bool found = false;
-		while (cur)
-		{
-			if (!wcscmp(cur->LangId, langId))
-			{
-				*scriptProv = cur;
-				found = true;
-				break;
-			}
-
-			cur = cur->Next;
-		}
+		goto exit;
+	}
 
-		if (!found)
-		{
-			hr = E_INVALIDARG;
-			GetHostContext()->DebugControl->Output(
-				DEBUG_OUTPUT_ERROR,
-				"Error: No script provider with lang ID '%ls' found.\n", langId);
-			goto exit;
-		}
+	hr = TimelineStart(&g_HostCtxt, parsedArgs->TimelinePath);
+	if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to create timeline file '%s'. Error 0x%08x.\n",
+			parsedArgs->TimelinePath,
+			hr);
+		goto exit;
 	}
+
+	*started = hr == S_OK;
+	hr = S_OK;
 exit:
 	return hr;
 }
 
 //------------------------------------------------------------------------------
-// Function: runscript
-//
-// Synopsis:
-//
-//  !runscript [host args] [--] [provider args] <scriptfile> [script args]
+// Function: stopRunTimeline
 //
 // Description:
 //
-//  Run a script against a given script provider.
-//
-//  [host args] can be
-//
-//  -l <lang id>  - specifies the language id, and thus script provider to
-//                  invoke.
-//  -t            - display the execution time at the end of the run.
-//
-//  '--' can be used to terminate the parsing of arguments by the host layer.
-//
-//  [provider args] are arguments that are specific to each script provider.
+//  Write out the timeline started by startRunTimeline.
 //
-//  <scriptfile>  - names the script file to run. This can be an absolute path
-//                  or just a filename. In the latter case it will be searched
-//                  for in the cwd and in the list of paths specified by
-//                  !scriptpath. (This parameter is required.)
+// Parameters:
 //
-//  [script args] are any optional arguments to be passed to the script itself.
-//  
 // Returns:
 //
 // Notes:
 //
-DLLEXPORT HRESULT CALLBACK
-runscript(
-	_In_     IDebugClient* client,
-	_In_opt_ PCSTR         args)
+static void
+stopRunTimeline(
+	_In_ const ParsedArgs* parsedArgs)
+{
+	const HRESULT hr = TimelineStop(&g_HostCtxt);
+	if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to write timeline file '%s'. Error 0x%08x.\n",
+			parsedArgs->TimelinePath,
+			hr);
+	}
+	else
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"Timeline written to '%s'.\n",
+			parsedArgs->TimelinePath);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: startRunProfile
+//
+// Description:
+//
+//  Start profiling a run, if -profile was given.
+//
+// Parameters:
+//
+//  started - Set to true if profiling was started for this run, and the
+//   profile must be written out with stopRunProfile when it ends.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  A run nested in another (via a debugger command) is profiled as part of
+//  the outer run.
+//
+static _Check_return_ HRESULT
+startRunProfile(
+	_In_ const ParsedArgs* parsedArgs,
+	_Out_ bool* started)
+{
+	HRESULT hr = S_OK;
+
+	*started = false;
+	if (!parsedArgs->ProfilePath)
+	{
+		goto exit;
+	}
+
+	hr = ProfilerStart(&g_HostCtxt, parsedArgs->ProfilePath);
+	if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to create profile file '%s'. Error 0x%08x.\n",
+			parsedArgs->ProfilePath,
+			hr);
+		goto exit;
+	}
+
+	*started = hr == S_OK;
+	hr = S_OK;
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: stopRunProfile
+//
+// Description:
+//
+//  Write out the profile started by startRunProfile.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+stopRunProfile(
+	_In_ const ParsedArgs* parsedArgs)
+{
+	const HRESULT hr = ProfilerStop(&g_HostCtxt);
+	if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to write profile file '%s'. Error 0x%08x.\n",
+			parsedArgs->ProfilePath,
+			hr);
+	}
+	else
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"Profile written to '%s'.\n",
+			parsedArgs->ProfilePath);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: findScriptProvider
+//
+// Description:
+//
+//  Look up a script provider by its language id in the list of registered
+//  providers.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+findScriptProvider(
+	_In_opt_z_ const WCHAR* langId,
+	_Outptr_ ScriptProviderInfo** scriptProv)
+{
+	HRESULT hr = S_OK;
+
+	hr = ensureScriptProvidersRegistered();
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	// Registration fails unless it finds at least one provider.
+	//
+	assert(GetHostContext()->ScriptProviders);
+
+	// Default to the head of the list.
+	//
+	*scriptProv = GetHostContext()->ScriptProviders;
+	assert(scriptProv);
+
+	if (langId)
+	{
+		ScriptProviderInfo* cur = GetHostContext()->ScriptProviders;
+		bool found = false;
+		while (cur)
+		{
+			if (!wcscmp(cur->LangId, langId))
+			{
+				*scriptProv = cur;
+				found = true;
+				break;
+			}
+
+			cur = cur->Next;
+		}
+
+		if (!found)
+		{
+			hr = E_INVALIDARG;
+			GetHostContext()->DebugControl->Output(
+				DEBUG_OUTPUT_ERROR,
+				"Error: No script provider with lang ID '%ls' found.\n", langId);
+			goto exit;
+		}
+	}
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: runscript
+//
+// Synopsis:
+//
+//  !runscript [host args] [--] [provider args] <scriptfile> [script args]
+//
+// Description:
+//
+//  Run a script against a given script provider.
+//
+//  [host args] can be
+//
+//  -l <lang id>  - specifies the language id, and thus script provider to
+//                  invoke.
+//  -t            - display the execution time at the end of the run.
+//  -stats        - collect statistics (see !dbgscriptstats) during the run
+//                  and display them at the end.
+//  -timeline <file>
+//                - write a timeline of the run to 'file' in Chrome trace
+//                  event format.
+//  -profile <file>
+//                - sample the script's stack during the run and write the
+//                  samples to 'file' as folded stacks, for flame graphs.
+//
+//  '--' can be used to terminate the parsing of arguments by the host layer.
+//
+//  [provider args] are arguments that are specific to each script provider.
+//
+//  <scriptfile>  - names the script file to run. This can be an absolute path
+//                  or just a filename. In the latter case it will be searched
+//                  for in the cwd and in the list of paths specified by
+//                  !scriptpath. (This parameter is required.)
+//
+//  [script args] are any optional arguments to be passed to the script itself.
+//  
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+runscript(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args)
 {
 	HRESULT hr = S_OK;
 	DWORD startTime = 0;
@@ -946,12 +1769,20 @@ runscript(
 	int cArgs = 0;
 	WCHAR** argList = nullptr;
 	DbgScriptHostContext* hostCtxt = GetHostContext();
+	bool statsForRun = false;
+	bool timelineForRun = false;
+	bool profileForRun = false;
+	LONGLONG statsStart = 0;
+	LONGLONG startupStart = 0;
+	const LONGLONG startupCommand = startupCommandBegin("!runscript");
 
 	hr = reAcquireIfacesIfNeeded(client);
 	if (FAILED(hr))
 	{
 		goto exit;
 	}
+
+	checkSymbolState();
 	
 	if (!args[0])
 	{
@@ -970,6 +1801,26 @@ runscript(
 		goto exit;
 	}
 
+	// Only discard the statistics afterwards if they weren't already being
+	// collected.
+	//
+	if (parsedArgs.Stats)
+	{
+		statsForRun = StatsEnable(hostCtxt) == S_OK;
+	}
+
+	hr = startRunTimeline(&parsedArgs, &timelineForRun);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = startRunProfile(&parsedArgs, &profileForRun);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
 	startTime = GetTickCount();
 
 	hr = findScriptProvider(parsedArgs.LangId, &scriptProv);
@@ -1010,7 +1861,11 @@ runscript(
 
 	// Execute the script.
 	//
+	statsStart = StatsBegin(hostCtxt);
+	startupStart = startupBegin();
 	hr = scriptProv->ScriptProvider->Run(cArgs, argList);
+	StatsEnd(hostCtxt, StatsTimerScript, statsStart);
+	startupEnd(StartupPhaseScript, startupStart);
 	if (FAILED(hr))
 	{
 		goto exit;
@@ -1054,6 +1909,26 @@ exit:
 			DEBUG_OUTPUT_ERROR, "Script failed: 0x%08x.\n", hr);
 	}
 
+	if (timelineForRun)
+	{
+		stopRunTimeline(&parsedArgs);
+	}
+
+	if (profileForRun)
+	{
+		stopRunProfile(&parsedArgs);
+	}
+
+	if (parsedArgs.Stats)
+	{
+		StatsOutput(hostCtxt);
+	}
+
+	if (statsForRun)
+	{
+		StatsDisable(hostCtxt);
+	}
+
 	// Free memory.
 	// NULL is safe to use with all these functions.
 	//
@@ -1061,6 +1936,7 @@ exit:
 	LocalFree(argList);
 	free(argsMutable);
 
+	startupCommandEnd(startupCommand);
 	return hr;
 }
 
@@ -1094,12 +1970,20 @@ evalstring(
 	const bool startVMEnabled = GetHostContext()->StartVMEnabled;
 	bool initializedProvider = false;
 	char* argsMutable = nullptr;
+	bool statsForRun = false;
+	bool timelineForRun = false;
+	bool profileForRun = false;
+	LONGLONG statsStart = 0;
+	LONGLONG startupStart = 0;
+	const LONGLONG startupCommand = startupCommandBegin("!evalstring");
 	
 	hr = reAcquireIfacesIfNeeded(client);
 	if (FAILED(hr))
 	{
 		goto exit;
 	}
+
+	checkSymbolState();
 	
 	if (!args[0])
 	{
@@ -1125,6 +2009,23 @@ evalstring(
 		goto exit;
 	}
 	
+	if (parsedArgs.Stats)
+	{
+		statsForRun = StatsEnable(&g_HostCtxt) == S_OK;
+	}
+	
+	hr = startRunTimeline(&parsedArgs, &timelineForRun);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = startRunProfile(&parsedArgs, &profileForRun);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
 	// Skip empty strings.
 	//
 	if (!*parsedArgs.RemainingArgs)
@@ -1144,7 +2045,11 @@ evalstring(
 		DEBUG_OUTPUT_VERBOSE,
 		"Evaluating string '%s'.\n", parsedArgs.RemainingArgs);
 
+	statsStart = StatsBegin(&g_HostCtxt);
+	startupStart = startupBegin();
 	hr = scriptProv->ScriptProvider->RunString(parsedArgs.RemainingArgs);
+	StatsEnd(&g_HostCtxt, StatsTimerScript, statsStart);
+	startupEnd(StartupPhaseScript, startupStart);
 	if (FAILED(hr))
 	{
 		goto exit;
@@ -1160,7 +2065,28 @@ exit:
 		GetHostContext()->DebugControl->Output(DEBUG_OUTPUT_ERROR, "Script failed: 0x%08x.\n", hr);
 	}
 	
+	if (timelineForRun)
+	{
+		stopRunTimeline(&parsedArgs);
+	}
+
+	if (profileForRun)
+	{
+		stopRunProfile(&parsedArgs);
+	}
+
+	if (parsedArgs.Stats)
+	{
+		StatsOutput(&g_HostCtxt);
+	}
+
+	if (statsForRun)
+	{
+		StatsDisable(&g_HostCtxt);
+	}
+	
 	free(argsMutable);
+	startupCommandEnd(startupCommand);
 	return hr;
 }
 
@@ -1169,7 +2095,7 @@ exit:
 //
 // Synopsis:
 //
-//  !startvm
+//  !startvm [-reset]
 //
 // Description:
 //
@@ -1179,6 +2105,10 @@ exit:
 //  This command instructs dbgscript to retain the VM state after each execution,
 //  until !stopvm is called.
 //
+//  -reset keeps the VM and the modules it imported, but gives each run fresh
+//  globals and arguments. Scripts start without reloading the provider, yet
+//  don't see each other's state.
+//
 // Returns:
 //
 // Notes:
@@ -1186,9 +2116,10 @@ exit:
 DLLEXPORT HRESULT CALLBACK
 startvm(
 	_In_     IDebugClient* client,
-	_In_opt_ PCSTR         /*args*/)
+	_In_opt_ PCSTR         args)
 {
 	HRESULT hr = S_OK;
+	bool reset = false;
 	
 	hr = reAcquireIfacesIfNeeded(client);
 	if (FAILED(hr))
@@ -1196,6 +2127,20 @@ startvm(
 		goto exit;
 	}
 	
+	if (args && args[0])
+	{
+		if (strcmp(args, "-reset"))
+		{
+			g_HostCtxt.DebugControl->Output(
+				DEBUG_OUTPUT_ERROR,
+				"Error: Unknown argument '%s'. Expected -reset.\n",
+				args);
+			hr = E_INVALIDARG;
+			goto exit;
+		}
+		reset = true;
+	}
+	
 	if (GetHostContext()->StartVMEnabled)
 	{
 		g_HostCtxt.DebugControl->Output(
@@ -1206,7 +2151,19 @@ startvm(
 	}
 	else
 	{
+		hr = ensureScriptProvidersRegistered();
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+
 		GetHostContext()->StartVMEnabled = true;
+		GetHostContext()->ResetVMEnabled = reset;
+
+		// Providers now stay loaded, so get them loading while the user
+		// sets up the first run.
+		//
+		prefetchScriptProviders();
 	}
 exit:
 	return hr;
@@ -1254,8 +2211,549 @@ stopvm(
 		//
 		unloadAllScriptProviders();
 		GetHostContext()->StartVMEnabled = false;
+		GetHostContext()->ResetVMEnabled = false;
 	}
 exit:
 	return hr;
 }
 
+//------------------------------------------------------------------------------
+// Function: mapdump
+//
+// Synopsis:
+//
+//  !mapdump
+//
+// Description:
+//
+//  Memory-map the current dump file and serve memory reads and searches
+//  directly from it until !unmapdump is called. Anything not captured in the
+//  dump still goes through the debugger engine.
+//
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+mapdump(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         /*args*/)
+{
+	HRESULT hr = S_OK;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
+	hr = DumpMapOpen(&g_HostCtxt);
+	if (hr == S_FALSE)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Dump already mapped. Use !unmapdump to unmap it.\n");
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+	else if (hr == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Target is not a user-mode dump.\n");
+		goto exit;
+	}
+	else if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to map dump file. Error 0x%08x.\n",
+			hr);
+		goto exit;
+	}
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: unmapdump
+//
+// Synopsis:
+//
+//  !unmapdump
+//
+// Description:
+//
+//  Unmaps the dump file mapped by !mapdump.
+//  
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+unmapdump(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         /*args*/)
+{
+	HRESULT hr = S_OK;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
+	if (!g_HostCtxt.DumpMap)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Dump not mapped. Use !mapdump to map it.\n");
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	DumpMapClose(&g_HostCtxt);
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: startTrace
+//
+// Description:
+//
+//  Common implementation of !recordtrace and !replaytrace.
+//
+// Parameters:
+//
+//  args - Command arguments: [-latency <us>] <file>. -latency is only valid
+//   for replays.
+//  replay - Replay the trace rather than record it.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+startTrace(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args,
+	_In_     bool          replay)
+{
+	HRESULT hr = S_OK;
+	const char* cmd = replay ? "!replaytrace" : "!recordtrace";
+	const char latencySwitch[] = "-latency";
+	ULONG latencyUs = 0;
+	char* end = nullptr;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
+	if (replay && args &&
+		!strncmp(args, latencySwitch, _countof(latencySwitch) - 1) &&
+		isspace((UCHAR)args[_countof(latencySwitch) - 1]))
+	{
+		latencyUs = strtoul(args + _countof(latencySwitch) - 1, &end, 10);
+		if (end == args + _countof(latencySwitch) - 1 || !isspace((UCHAR)*end))
+		{
+			g_HostCtxt.DebugControl->Output(
+				DEBUG_OUTPUT_ERROR,
+				"Error: -latency requires a number of microseconds.\n");
+			hr = E_INVALIDARG;
+			goto exit;
+		}
+		
+		args = end;
+		while (isspace((UCHAR)*args))
+		{
+			++args;
+		}
+	}
+	
+	if (!args || !args[0])
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: %s requires a trace file.\n",
+			cmd);
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+	
+	hr = replay ?
+		TraceStartReplay(&g_HostCtxt, args, latencyUs) :
+		TraceStartRecording(&g_HostCtxt, args);
+	if (hr == S_FALSE)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Trace already active. Use !stoptrace to end it.\n");
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+	else if (hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: '%s' is not a trace file.\n",
+			args);
+		goto exit;
+	}
+	else if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: %s failed to open '%s'. Error 0x%08x.\n",
+			cmd,
+			args,
+			hr);
+		goto exit;
+	}
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: recordtrace
+//
+// Synopsis:
+//
+//  !recordtrace <file>
+//
+// Description:
+//
+//  Record the debugger engine calls made by scripts (memory reads and searches,
+//  type and symbol lookups) and their results to 'file', until !stoptrace is
+//  called.
+//
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+recordtrace(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args)
+{
+	return startTrace(client, args, false /* replay */);
+}
+
+//------------------------------------------------------------------------------
+// Function: replaytrace
+//
+// Synopsis:
+//
+//  !replaytrace [-latency <us>] <file>
+//
+// Description:
+//
+//  Answer the calls recorded by !recordtrace from 'file' instead of the
+//  debugger engine, until !stoptrace is called. Calls missing from the trace
+//  fail rather than reaching the engine.
+//
+//  -latency adds 'us' microseconds to every call, to simulate the round trip
+//  to a remote debugger engine.
+//
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+replaytrace(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args)
+{
+	return startTrace(client, args, true /* replay */);
+}
+
+//------------------------------------------------------------------------------
+// Function: stoptrace
+//
+// Synopsis:
+//
+//  !stoptrace
+//
+// Description:
+//
+//  Ends the trace started by !recordtrace or !replaytrace, and outputs how many
+//  engine requests of each kind were made during it and how long it took. A
+//  recording is flushed to its file.
+//  
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+stoptrace(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         /*args*/)
+{
+	HRESULT hr = S_OK;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
+	if (!g_HostCtxt.Trace)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: No trace active. Use !recordtrace or !replaytrace to start one.\n");
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	TraceOutputStats(&g_HostCtxt);
+
+	hr = TraceStop(&g_HostCtxt);
+	if (FAILED(hr))
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Failed to write trace file. Error 0x%08x.\n",
+			hr);
+		goto exit;
+	}
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: ticksToMs
+//
+// Description:
+//
+//  Convert performance counter ticks to milliseconds.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static double
+ticksToMs(
+	_In_ LONGLONG ticks)
+{
+	return s_Startup.Frequency ? ticks * 1000.0 / s_Startup.Frequency : 0.0;
+}
+
+//------------------------------------------------------------------------------
+// Function: outputStartupTimes
+//
+// Description:
+//
+//  Display how long the extension took to load, and where the time went in
+//  the first script command.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  'Other' is argument parsing, output and anything else not broken out.
+//
+static void
+outputStartupTimes()
+{
+	LONGLONG other = s_Startup.CommandTicks;
+
+	g_HostCtxt.DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"Extension load:    %10.3f ms\n",
+		ticksToMs(s_Startup.InitTicks));
+
+	if (!s_Startup.Done)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"No script has run yet.\n");
+		return;
+	}
+
+	g_HostCtxt.DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"First command:     %10.3f ms (%s)\n",
+		ticksToMs(s_Startup.CommandTicks),
+		s_Startup.Command);
+
+	for (ULONG i = 0; i < StartupPhaseMax; ++i)
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"  %-16s%10.3f ms\n",
+			s_StartupPhaseNames[i],
+			ticksToMs(s_Startup.PhaseTicks[i]));
+		other -= s_Startup.PhaseTicks[i];
+	}
+
+	g_HostCtxt.DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"  %-16s%10.3f ms\n",
+		"Other",
+		ticksToMs(other > 0 ? other : 0));
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscriptstats
+//
+// Synopsis:
+//
+//  !dbgscriptstats [on|off|reset|startup]
+//
+// Description:
+//
+//  Controls collection of statistics: calls to each script API, count and
+//  latency histogram of each debugger engine call and host phase (provider
+//  load, VM start, script execution, output flushes), bytes read from the
+//  target, symbol cache hits and misses, and memory use.
+//
+//  'on' starts collecting, 'off' stops and discards what was collected, and
+//  'reset' zeroes it. With no arguments, displays the statistics collected
+//  so far.
+//
+//  'startup' displays the time taken to load the extension and a breakdown
+//  of the first !runscript or !evalstring, which are always recorded.
+//
+// Returns:
+//
+// Notes:
+//
+DLLEXPORT HRESULT CALLBACK
+dbgscriptstats(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args)
+{
+	HRESULT hr = S_OK;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+	
+	if (!args || !args[0])
+	{
+		if (!g_HostCtxt.Stats)
+		{
+			g_HostCtxt.DebugControl->Output(
+				DEBUG_OUTPUT_NORMAL,
+				"Statistics are not being collected. Use !dbgscriptstats on to start.\n");
+			goto exit;
+		}
+
+		StatsOutput(&g_HostCtxt);
+	}
+	else if (!strcmp(args, "on"))
+	{
+		hr = StatsEnable(&g_HostCtxt);
+	}
+	else if (!strcmp(args, "off"))
+	{
+		StatsDisable(&g_HostCtxt);
+	}
+	else if (!strcmp(args, "reset"))
+	{
+		StatsReset(&g_HostCtxt);
+	}
+	else if (!strcmp(args, "startup"))
+	{
+		outputStartupTimes();
+	}
+	else
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Unknown argument '%s'. Expected on, off, reset or startup.\n",
+			args);
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: bytecodecache
+//
+// Synopsis:
+//
+//  !bytecodecache [off | <dir>]
+//
+// Description:
+//
+//  Sets the directory where the Lua and Ruby providers cache compiled
+//  scripts, or turns the cache off. With no arguments, displays the current
+//  setting.
+//
+// Returns:
+//
+// Notes:
+//
+//  Not available in lockdown builds.
+//
+DLLEXPORT HRESULT CALLBACK
+bytecodecache(
+	_In_     IDebugClient* client,
+	_In_opt_ PCSTR         args)
+{
+	HRESULT hr = S_OK;
+	
+	hr = reAcquireIfacesIfNeeded(client);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+#ifdef LOCKDOWN
+	UNREFERENCED_PARAMETER(args);
+	g_HostCtxt.DebugControl->Output(
+		DEBUG_OUTPUT_ERROR,
+		"Error: The bytecode cache is not available in this build.\n");
+	hr = E_ACCESSDENIED;
+	goto exit;
+#else
+	if (args && args[0])
+	{
+		if (!strcmp(args, "off"))
+		{
+			g_HostCtxt.BytecodeCacheDir[0] = 0;
+		}
+		else
+		{
+			hr = StringCchCopyA(STRING_AND_CCH(g_HostCtxt.BytecodeCacheDir), args);
+			if (FAILED(hr))
+			{
+				g_HostCtxt.BytecodeCacheDir[0] = 0;
+				g_HostCtxt.DebugControl->Output(
+					DEBUG_OUTPUT_ERROR,
+					"Error: Path too long. Bytecode cache is off.\n");
+				goto exit;
+			}
+		}
+	}
+
+	if (g_HostCtxt.BytecodeCacheDir[0])
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"Bytecode cache: '%s'\n", g_HostCtxt.BytecodeCacheDir);
+	}
+	else
+	{
+		g_HostCtxt.DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"Bytecode cache is off.\n");
+	}
+#endif
+exit:
+	return hr;
+}
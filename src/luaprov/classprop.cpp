@@ -95,6 +95,121 @@ LuaSetProperties(
 	lua_setfield(L, -2, LUA_PROPERTIES_KEY);
 }
 
+//------------------------------------------------------------------------------
+// Function: LuaClassPropTryIndex
+//
+// Description:
+//
+//  Look up a key among an object's methods and properties.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//  methodsIdx - Stack index of the metatable holding the methods.
+//  propsIdx - Stack index of the properties table.
+//
+// Input Stack:
+//
+//  1 - Object to lookup properties on
+//  2 - Key (string)
+//
+// Returns:
+//
+//  true if the key was a method or property, with the method or the result of
+//  the getter pushed. false otherwise, with the stack unchanged.
+//
+// Notes:
+//
+//  Uses raw lookups only, and calls the getter directly, so indexers can
+//  probe for properties cheaply before falling back to something else.
+//
+bool
+LuaClassPropTryIndex(
+	_In_ lua_State* L,
+	_In_ int methodsIdx,
+	_In_ int propsIdx)
+{
+	// Check if an element exists with this key name. (Hopefully a method)
+	//
+	lua_pushvalue(L, 2);
+	if (lua_rawget(L, methodsIdx) != LUA_TNIL)
+	{
+		return true;
+	}
+	lua_pop(L, 1);
+
+	// From the properties table, get the key sought.
+	//
+	lua_pushvalue(L, 2);
+	if (lua_rawget(L, propsIdx) == LUA_TNIL)
+	{
+		lua_pop(L, 1);
+		return false;
+	}
+
+	luaL_checktype(L, -1, LUA_TTABLE);
+
+	// Property is another table, with a get/set method.
+	//
+	if (lua_getfield(L, -1, CLASSPROP_GET) == LUA_TNIL)
+	{
+		// No accessor.
+		//
+		luaL_error(L, "no accessor '%s' on property '%s'.",
+			CLASSPROP_GET, lua_tostring(L, 2));
+	}
+
+	luaL_checktype(L, -1, LUA_TFUNCTION);
+
+	// Replace the property table with the getter, and push the object as the
+	// first param.
+	//
+	lua_replace(L, -2);
+	lua_pushvalue(L, 1);
+
+	lua_call(L, 1 /* num args */, 1 /* num results */);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: LuaSetClassIndexer
+//
+// Description:
+//
+//  Set the __index metamethod of a metatable that has properties, binding the
+//  metatable and its properties table to it.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//  indexer - Indexer. Its upvalue 1 is the metatable and upvalue 2 is the
+//   properties table, for LuaClassPropTryIndex.
+//
+// Input Stack:
+//
+//  -1 - Metatable, with properties set by LuaSetProperties.
+//
+// Returns:
+//
+//  void.
+//
+// Notes:
+//
+//  Saves the indexer from looking up the metatable and properties table on
+//  every access.
+//
+void
+LuaSetClassIndexer(
+	_In_ lua_State* L,
+	_In_ lua_CFunction indexer)
+{
+	lua_pushvalue(L, -1);
+	lua_getfield(L, -1, LUA_PROPERTIES_KEY);
+	luaL_checktype(L, -1, LUA_TTABLE);
+	lua_pushcclosure(L, indexer, 2);
+	lua_setfield(L, -2, "__index");
+}
+
 //------------------------------------------------------------------------------
 // Function: LuaClassPropIndexer
 //
@@ -135,27 +250,12 @@ LuaClassPropIndexer(lua_State* L)
 
 	// First param must have a metatable.
 	//
-	lua_getmetatable(L, 1);
-
-	// Copy the key to the top of the stack.
-	//
-	lua_pushvalue(L, 2);
-
-	// Check if an element exists with this key name. (Hopefully a method)
-	//
-	lua_gettable(L, -2);
-	
-	if (!lua_isnil(L, -1))
+	if (!lua_getmetatable(L, 1))
 	{
-		// Return element if present.
-		//
+		lua_pushnil(L);
 		return 1;
 	}
 
-	// Pop the nil. Get the metatable back on the top.
-	//
-	lua_pop(L, 1);
-
 	// Get the properties table from the metatable.
 	//
 	lua_getfield(L, -1, LUA_PROPERTIES_KEY);
@@ -164,47 +264,14 @@ LuaClassPropIndexer(lua_State* L)
 	//
 	luaL_checktype(L, -1, LUA_TTABLE);
 
-	// From the properties table, get the key sought.
-	//
-	// Copy the key to the top of the stack.
-	//
-	lua_pushvalue(L, 2);
-
-	// Get the property.
-	//
-	lua_gettable(L, -2);
-	
-	if (lua_isnil(L, -1))
+	if (!LuaClassPropTryIndex(L, lua_absindex(L, -2), lua_absindex(L, -1)))
 	{
 		// No such property. Return nil.
 		//
-		return 1;
-	}
-	
-	luaL_checktype(L, -1, LUA_TTABLE);
-	
-	// Property is another table, with a get/set method.
-	//
-	lua_getfield(L, -1, CLASSPROP_GET);
-
-	if (lua_isnil(L, -1))
-	{
-		// No accessor.
-		//
-		return luaL_error(L, "no accessor '%s' on property '%s'.",
-			CLASSPROP_GET, lua_tostring(L, 2));
+		lua_pushnil(L);
 	}
-	
-	luaL_checktype(L, -1, LUA_TFUNCTION);
-
-	// Push the object as the first param.
-	//
-	lua_pushvalue(L, 1);
-
-	lua_call(L, 1 /* num args */, 1 /* num results */);
 
 	// Lua saves this many results, and clears the entire stack.
 	//
 	return 1;
 }
-
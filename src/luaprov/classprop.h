@@ -41,6 +41,17 @@ struct LuaClassProperty
 int
 LuaClassPropIndexer(lua_State* L);
 
+bool
+LuaClassPropTryIndex(
+	_In_ lua_State* L,
+	_In_ int methodsIdx,
+	_In_ int propsIdx);
+
+void
+LuaSetClassIndexer(
+	_In_ lua_State* L,
+	_In_ lua_CFunction indexer);
+
 void
 LuaSetProperties(
 	_In_ lua_State* L,
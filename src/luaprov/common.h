@@ -18,6 +18,8 @@
 #include <hostcontext.h>
 #include "../common.h"
 #include "../support/util.h"
+#include "../support/stats.h"
+#include "../support/arena.h"
 
 // Enable Lua StdIO redirection extension.
 //
@@ -41,16 +43,22 @@ struct LuaProvGlobals
 	int NextInputChar;
 
 	ULONG ValidInputChars;
+
+	// Everything the VM allocates. Released whole when the VM stops.
+	//
+	Arena VMArena;
 };
 
 _Check_return_ LuaProvGlobals*
 GetLuaProvGlobals();
 
 // Helper macro to call in every Python entry point that checks for abort
-// and raises a KeyboardInterrupt exception.
+// and raises a KeyboardInterrupt exception. Also counts the call when
+// collecting statistics (see stats.h).
 //
 #define CHECK_ABORT(ctxt) \
 	do { \
+		StatsCountApi(ctxt, __FUNCTION__); \
 		if (UtilCheckAbort(ctxt)) \
 		{ \
 			luaL_error(L, "execution interrupted."); \
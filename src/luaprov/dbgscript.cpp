@@ -17,6 +17,7 @@
 #include "typedobject.h"
 #include "thread.h"
 #include "../support/symcache.h"
+#include "../support/timeline.h"
 
 //------------------------------------------------------------------------------
 // Function: createTypedObjectHelper
@@ -112,6 +113,87 @@ dbgscript_createTypedPointer(lua_State* L)
 	return createTypedObjectHelper(L, true /* wantPointer */);
 }
 
+//------------------------------------------------------------------------------
+// Function: dbgscript_containerOf
+//
+// Synopsis:
+// 
+//  dbgscript.containerOf(addr, type, field) -> TypedObject
+//
+// Description:
+//
+//  Create a typed object of type 'type' given the address of its field 'field'.
+//  Equivalent to the CONTAINING_RECORD macro.
+//
+// Notes:
+//
+//  Only the first use of a type and field issues DbgEng requests.
+//
+static int
+dbgscript_containerOf(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	const UINT64 addr = luaL_checkinteger(L, 1);
+
+	// Explictly check for string, not convertible to string.
+	//
+	luaL_checktype(L, 2, LUA_TSTRING);
+	luaL_checktype(L, 3, LUA_TSTRING);
+
+	const char* typeName = lua_tostring(L, 2);
+	const char* field = lua_tostring(L, 3);
+	
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, typeName);
+	if (!typeInfo)
+	{
+		return luaL_error(L, "Failed to get type id for type '%s'.", typeName);
+	}
+
+	ULONG offset = 0;
+	HRESULT hr = GetCachedFieldOffset(hostCtxt, *typeInfo, field, &offset);
+	if (FAILED(hr))
+	{
+		return LuaError(
+			L,
+			"Failed to get field offset for type '%s' and field '%s'. Error 0x%08x.",
+			typeName,
+			field,
+			hr);
+	}
+
+	AllocNewTypedObject(
+		L,
+		0,
+		nullptr,
+		typeInfo->TypeId,
+		typeInfo->ModuleBase,
+		addr - offset,
+		false /* wantPointer */);
+	
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_getRuntimeObjects
+//
+// Synopsis:
+// 
+//  dbgscript.getRuntimeObjects(objs) -> table
+//
+// Description:
+//
+//  Batch version of TypedObject:getRuntimeObject. Returns a sequence with the
+//  downcast object for each typed object in 'objs', or false where an object
+//  has no vtable.
+//
+static int
+dbgscript_getRuntimeObjects(lua_State* L)
+{
+	return GetRuntimeObjects(L);
+}
+
 //------------------------------------------------------------------------------
 // Function: dbgscript_execCommand
 //
@@ -436,18 +518,7 @@ dbgscript_resolveEnum(lua_State* L)
 	
 	char enumElementName[MAX_SYMBOL_NAME_LEN] = {};
 
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, enumTypeName);
-	if (!typeInfo)
-	{
-		return LuaError(L, "Failed to get type id for type '%s'.", enumTypeName);
-	}
-
-	HRESULT hr = hostCtxt->DebugSymbols->GetConstantName(
-		typeInfo->ModuleBase,
-		typeInfo->TypeId,
-		value,
-		STRING_AND_CCH(enumElementName),
-		nullptr);
+	HRESULT hr = UtilResolveEnum(hostCtxt, enumTypeName, value, enumElementName);
 	if (FAILED(hr))
 	{
 		return LuaError(L, "Failed to get element name for enum '%s' with value '%llu'. Error 0x%08x.", enumTypeName, value, hr);
@@ -673,6 +744,136 @@ dbgscript_getNearestSym(lua_State* L)
 	return 1;
 }
 
+// Context threaded through UtilGetNearestSymbols for getNearestSyms.
+//
+struct NearestSymsCtxt
+{
+	DbgScriptHostContext* HostCtxt;
+	lua_State* L;
+	int ResultIdx;
+};
+
+//------------------------------------------------------------------------------
+// Function: nearestSymsCallback
+//
+// Description:
+//
+//  Store one result of UtilGetNearestSymbols into the result table.
+//
+// Parameters:
+//
+//  idx - Index of the address.
+//  name - Symbol name, or null if resolution failed.
+//  userctxt - NearestSymsCtxt.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+nearestSymsCallback(
+	_In_ ULONG idx,
+	_In_opt_z_ const char* name,
+	_In_opt_ void* userctxt)
+{
+	NearestSymsCtxt* ctxt = (NearestSymsCtxt*)userctxt;
+	lua_State* L = ctxt->L;
+
+	if (UtilCheckAbort(ctxt->HostCtxt))
+	{
+		return E_ABORT;
+	}
+
+	if (name)
+	{
+		lua_pushstring(L, name);
+	}
+	else
+	{
+		lua_pushboolean(L, false);
+	}
+
+	lua_rawseti(L, ctxt->ResultIdx, idx + 1);
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_getNearestSyms
+//
+// Description:
+//
+//  Batch version of getNearestSym.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  1 - Sequence of addresses to probe (table)
+//
+// Returns:
+//
+//  A table with the nearest symbol name of each address, or false where no
+//  symbol was found.
+//
+// Notes:
+//
+static int
+dbgscript_getNearestSyms(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	const lua_Integer len = luaL_len(L, 1);
+	if (len < 0 || len > ULONG_MAX)
+	{
+		return luaL_error(L, "invalid number of addresses.");
+	}
+
+	lua_createtable(L, (int)len, 0);
+
+	NearestSymsCtxt ctxt = {};
+	ctxt.HostCtxt = hostCtxt;
+	ctxt.L = L;
+	ctxt.ResultIdx = lua_gettop(L);
+
+	UINT64* addrs = new UINT64[len ? len : 1];
+	for (lua_Integer i = 1; i <= len; ++i)
+	{
+		int isnum = 0;
+		lua_rawgeti(L, 1, i);
+		addrs[i - 1] = lua_tointegerx(L, -1, &isnum);
+		lua_pop(L, 1);
+
+		if (!isnum)
+		{
+			delete[] addrs;
+			return luaL_error(L, "expected a sequence of addresses.");
+		}
+	}
+
+	HRESULT hr = UtilGetNearestSymbols(
+		hostCtxt, (ULONG)len, addrs, nearestSymsCallback, &ctxt);
+
+	delete[] addrs;
+
+	if (hr == E_ABORT)
+	{
+		return luaL_error(L, "execution interrupted.");
+	}
+	else if (FAILED(hr))
+	{
+		return LuaError(L, "UtilGetNearestSymbols failed. Error 0x%08x.", hr);
+	}
+
+	return 1;
+}
+
 //------------------------------------------------------------------------------
 // Function: dbgscript_searchMemory
 //
@@ -705,7 +906,8 @@ dbgscript_searchMemory(lua_State* L)
 	const size_t cbPat = lua_rawlen(L, 3);
 	const UINT64 patGran = luaL_checkinteger(L, 4);
 
-	HRESULT hr = hostCtxt->DebugDataSpaces->SearchVirtual(
+	HRESULT hr = UtilSearchMemory(
+		hostCtxt,
 		ui64Start,
 		ui64Size,
 		(void*)pat,
@@ -771,12 +973,131 @@ dbgscript_getPeb(lua_State* L)
 	return 1;
 }
 
+//------------------------------------------------------------------------------
+// Function: addStatToTable
+//
+// Description:
+//
+//  StatsEnumerate callback to add a statistic to the table at the top of the
+//  stack.
+//
+// Parameters:
+//
+//  ctxt - pointer to Lua state.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+addStatToTable(
+	_In_z_ const char* name,
+	_In_ UINT64 value,
+	_In_opt_ void* ctxt)
+{
+	lua_State* L = (lua_State*)ctxt;
+
+	lua_pushinteger(L, (lua_Integer)value);
+	lua_setfield(L, -2, name);
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_stats
+//
+// Description:
+//
+//  Get the statistics collected so far (see !dbgscriptstats).
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  None.
+//
+// Returns:
+//
+//  Table of name to value, or nil if not collecting.
+//
+// Notes:
+//
+static int
+dbgscript_stats(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	lua_newtable(L);
+	if (!StatsEnumerate(hostCtxt, addStatToTable, L))
+	{
+		lua_pop(L, 1);
+		lua_pushnil(L);
+	}
+
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_traceSpan
+//
+// Description:
+//
+//  Call a function, marking the call as a span on the timeline (see
+//  !runscript -timeline).
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the name of the span (string).
+//  Param 2 is the function to call.
+//  Remaining params are passed to the function.
+//
+// Returns:
+//
+//  The function's results.
+//
+// Notes:
+//
+//  Errors raised by the function close the span and are re-raised.
+//
+static int
+dbgscript_traceSpan(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	const char* name = luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+	const int cArgs = lua_gettop(L) - 2;
+
+	TimelineBeginSpan(hostCtxt, name);
+	const int status = lua_pcall(L, cArgs, LUA_MULTRET, 0 /* err handler idx */);
+	TimelineEndSpan(hostCtxt);
+
+	if (status != LUA_OK)
+	{
+		// Re-raise the error object at the top of the stack.
+		//
+		return lua_error(L);
+	}
+
+	// Everything above the name is a result.
+	//
+	return lua_gettop(L) - 1;
+}
+
 // Functions in module.
 //
 static const luaL_Reg dbgscript[] =
 {
 	{"createTypedObject", dbgscript_createTypedObject},
 	{"createTypedPointer", dbgscript_createTypedPointer},
+	{"containerOf", dbgscript_containerOf},
+	{"getRuntimeObjects", dbgscript_getRuntimeObjects},
 	{"execCommand", dbgscript_execCommand},
 	{"startBuffering", dbgscript_startBuffering},
 	{"stopBuffering", dbgscript_stopBuffering},
@@ -788,11 +1109,14 @@ static const luaL_Reg dbgscript[] =
 	{"fieldOffset", dbgscript_fieldOffset},
 	{"getTypeSize", dbgscript_getTypeSize},
 	{"getNearestSym", dbgscript_getNearestSym},
+	{"getNearestSyms", dbgscript_getNearestSyms},
 	{"getPeb", dbgscript_getPeb},
 	{"readBytes", dbgscript_readBytes},
 	{"readString", dbgscript_readString},
 	{"readWideString", dbgscript_readWideString},
 	{"searchMemory", dbgscript_searchMemory},
+	{"stats", dbgscript_stats},
+	{"traceSpan", dbgscript_traceSpan},
 	{nullptr, nullptr}  // sentinel.
 };
 
@@ -20,6 +20,29 @@
 #include "typedobject.h"
 #include "thread.h"
 #include "stackframe.h"
+#include "../support/profiler.h"
+#include "../support/bytecodecache.h"
+#include "../support/evalcache.h"
+
+// Number of VM instructions between calls to the VM hook.
+//
+const int VM_HOOK_COUNT = 1000;
+
+// Deepest Lua stack described in a profile sample. Outer frames beyond this
+// are left out.
+//
+const int PROFILER_MAX_FRAMES = 128;
+
+// Registry keys (by address) of the globals and package.path as they were
+// after the VM started. Restored by ResetVM.
+//
+static const char s_InitialGlobalsKey = 0;
+static const char s_InitialPackagePathKey = 0;
+
+// Registry key (by address) of the table of chunks compiled by RunString,
+// indexed by EvalCache slot + 1.
+//
+static const char s_EvalChunksKey = 0;
 
 // Lua modules and classes.
 //
@@ -41,6 +64,9 @@ public:
 	void
 	StopVM() override;
 
+	_Check_return_ HRESULT
+	ResetVM() override;
+
 	_Check_return_ HRESULT
 	Run(
 		_In_ int argc,
@@ -56,9 +82,16 @@ public:
 private:
 	
 	lua_State* LuaState;
+
+	// Strings compiled by RunString. The chunks themselves are kept in the
+	// registry (see s_EvalChunksKey).
+	//
+	EvalCache EvalChunkCache;
 };
 
-CLuaScriptProvider::CLuaScriptProvider()
+CLuaScriptProvider::CLuaScriptProvider() :
+	LuaState(nullptr),
+	EvalChunkCache()
 {
 
 }
@@ -212,6 +245,336 @@ appendScriptPathToPackagePath(
 	lua_pop(L, 1);
 }
 
+#ifndef LOCKDOWN
+// lua_Writer that appends a dumped chunk to a luaL_Buffer.
+//
+static int
+dumpWriter(
+	_In_ lua_State* /* L */,
+	_In_reads_bytes_(cb) const void* p,
+	_In_ size_t cb,
+	_In_ void* ud)
+{
+	luaL_addlstring((luaL_Buffer*)ud, (const char*)p, cb);
+	return 0;
+}
+#endif
+
+// Like luaL_loadfile, but use the bytecode cache (see bytecodecache.h). On a
+// miss, the compiled chunk is dumped, with debug info, into the cache.
+//
+static int
+loadFileCached(
+	_In_ lua_State* L,
+	_In_z_ const char* path)
+{
+#ifdef LOCKDOWN
+	// Lockdown builds neither write files nor load bytecode.
+	//
+	return luaL_loadfile(L, path);
+#else
+	BytecodeCacheKey key;
+	BYTE* code = nullptr;
+	ULONG cbCode = 0;
+	char chunkName[MAX_PATH + 1] = {};
+	luaL_Buffer b;
+	size_t cbDump = 0;
+	const char* dump = nullptr;
+	int err = 0;
+
+	// Same chunk name luaL_loadfile uses, so errors and tracebacks look the
+	// same either way.
+	//
+	StringCchPrintfA(STRING_AND_CCH(chunkName), "@%s", path);
+
+	if (BytecodeCacheLookup(
+			GetLuaProvGlobals()->HostCtxt, path, "luac", &key, &code, &cbCode) == S_OK)
+	{
+		err = luaL_loadbufferx(L, (const char*)code, cbCode, chunkName, "b");
+		BytecodeCacheFree(code);
+		if (err == LUA_OK)
+		{
+			return LUA_OK;
+		}
+
+		// Most likely from a different Lua version. Recompile and replace it.
+		//
+		lua_pop(L, 1);
+	}
+
+	err = luaL_loadfile(L, path);
+	if (err != LUA_OK || !key.CachePath[0])
+	{
+		return err;
+	}
+
+	luaL_buffinit(L, &b);
+	lua_dump(L, dumpWriter, &b, 0 /* strip */);
+	luaL_pushresult(&b);
+	dump = lua_tolstring(L, -1, &cbDump);
+
+	// Failing to cache is harmless; the script is compiled next time.
+	//
+	(void)BytecodeCacheStore(&key, dump, (ULONG)cbDump);
+
+	// Pop the dump, leaving the chunk.
+	//
+	lua_pop(L, 1);
+	return LUA_OK;
+#endif
+}
+
+#ifndef LOCKDOWN
+// Replacement for the standard Lua file searcher (package.searchers[2]) that
+// loads modules through the bytecode cache.
+//
+static int
+cachedFileSearcher(
+	_In_ lua_State* L)
+{
+	const char* name = luaL_checkstring(L, 1);
+
+	// Find the package table through package.loaded rather than the globals,
+	// which a script can replace.
+	//
+	luaL_getsubtable(L, LUA_REGISTRYINDEX, "_LOADED");
+	lua_getfield(L, -1, "package");
+	lua_getfield(L, -1, "searchpath");
+	lua_pushvalue(L, 1);
+	lua_getfield(L, -3, "path");
+	lua_call(L, 2 /* nargs */, 2 /* nresults */);
+	if (lua_isnil(L, -2))
+	{
+		// Module not found. Return the message listing the files tried.
+		//
+		return 1;
+	}
+
+	lua_pop(L, 1);
+	const char* fileName = lua_tostring(L, -1);
+	if (loadFileCached(L, fileName) != LUA_OK)
+	{
+		return luaL_error(
+			L,
+			"error loading module '%s' from file '%s':\n\t%s",
+			name,
+			fileName,
+			lua_tostring(L, -1));
+	}
+
+	// Return the chunk and the file name, which is passed to it.
+	//
+	lua_pushvalue(L, -2);
+	return 2;
+}
+#endif
+
+// Chunks live in the registry, and are dropped with their table, so there's
+// nothing to release per entry.
+//
+static void
+releaseEvalChunk(
+	_In_ UINT_PTR /* code */)
+{
+}
+
+// Push the table of chunks compiled by RunString, creating it if needed.
+//
+static void
+pushEvalChunks(
+	_In_ lua_State* L)
+{
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_EvalChunksKey) == LUA_TNIL)
+	{
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushvalue(L, -1);
+		lua_rawsetp(L, LUA_REGISTRYINDEX, &s_EvalChunksKey);
+	}
+}
+
+// Push the chunk for a string, compiling it on a cache miss. Like
+// luaL_loadstring, returns the error code and pushes the message on failure.
+//
+static int
+loadStringCached(
+	_In_ lua_State* L,
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* scriptString)
+{
+	EvalCacheEntry* entry = EvalCacheFind(cache, scriptString);
+
+	StatsCountEval(GetLuaProvGlobals()->HostCtxt, scriptString, entry != nullptr);
+	if (entry)
+	{
+		pushEvalChunks(L);
+		lua_rawgeti(L, -1, entry - cache->Entries + 1);
+		lua_remove(L, -2);
+		return LUA_OK;
+	}
+
+	const int err = luaL_loadstring(L, scriptString);
+	if (err != LUA_OK)
+	{
+		return err;
+	}
+
+	entry = EvalCacheInsert(cache, scriptString, 0, releaseEvalChunk);
+	if (entry)
+	{
+		// Store a copy of the chunk, replacing any evicted one.
+		//
+		pushEvalChunks(L);
+		lua_pushvalue(L, -2);
+		lua_rawseti(L, -2, entry - cache->Entries + 1);
+		lua_pop(L, 1);
+	}
+	return LUA_OK;
+}
+
+// Copy the fields of the table at -1 into the table at -2.
+//
+static void
+copyTableFields(
+	_In_ lua_State* L)
+{
+	lua_pushnil(L);
+	while (lua_next(L, -2))
+	{
+		// Stack: dest, src, key, value. Keep a copy of the key for lua_next.
+		//
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, -5);
+	}
+}
+
+// Save the globals and package.path for ResetVM. Called once the VM has
+// loaded the standard and dbgscript modules, before any script runs.
+//
+static void
+saveInitialGlobals(
+	_In_ lua_State* L)
+{
+	// Shallow copy: the library tables themselves are shared.
+	//
+	lua_newtable(L);
+	lua_pushglobaltable(L);
+	copyTableFields(L);
+	lua_pop(L, 1);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_InitialGlobalsKey);
+
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "path");
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_InitialPackagePathKey);
+	lua_pop(L, 1);
+}
+
+// Describe the running script's stack for the profiler (see profiler.h).
+// 'walkCtxt' is the Lua state the hook was called for, if any.
+//
+static void
+profilerWalkStack(
+	_In_opt_ void* walkCtxt,
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf)
+{
+	lua_State* L = (lua_State*)walkCtxt;
+	lua_Debug ar;
+	int depth = 0;
+
+	if (!L)
+	{
+		return;
+	}
+
+	while (depth < PROFILER_MAX_FRAMES && lua_getstack(L, depth, &ar))
+	{
+		++depth;
+	}
+
+	// Outermost first.
+	//
+	while (depth--)
+	{
+		lua_getstack(L, depth, &ar);
+		lua_getinfo(L, "Sn", &ar);
+
+		const char* name = ar.name;
+		if (!name)
+		{
+			name = !strcmp(ar.what, "main") ? "main chunk" : "?";
+		}
+
+		ProfilerAppendFrame(
+			buf,
+			cchBuf,
+			name,
+			ar.source[0] == '@' ? ar.source + 1 : ar.short_src,
+			ar.linedefined);
+	}
+}
+
+// Count hook installed while a script runs. Raises an error if the user asked
+// to abort, so loops that never call into dbgscript can still be interrupted,
+// and samples for the profiler when one is due.
+//
+static void
+vmHook(
+	_In_ lua_State* L,
+	_In_ lua_Debug* /* ar */)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+
+	if (UtilCheckAbort(hostCtxt))
+	{
+		luaL_error(L, "execution interrupted.");
+	}
+
+	ProfilerSample(hostCtxt, L);
+}
+
+// Install the VM hook for a script about to run, and attach to the profiler
+// if the host is profiling.
+//
+// Returns true if the hook was installed, in which case stopHooks must be
+// called when the script ends. A script nested in another of this provider's
+// runs uses the outer run's hook.
+//
+static _Check_return_ bool
+startHooks(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ lua_State* L,
+	_Out_ bool* profiling)
+{
+	*profiling = false;
+	if (lua_gethook(L) == vmHook)
+	{
+		return false;
+	}
+
+	// Coroutines created by the script inherit the hook.
+	//
+	lua_sethook(L, vmHook, LUA_MASKCOUNT, VM_HOOK_COUNT);
+	*profiling = ProfilerAttach(hostCtxt, profilerWalkStack);
+	return true;
+}
+
+// Remove the hook installed by startHooks.
+//
+static void
+stopHooks(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ lua_State* L,
+	_In_ bool profiling)
+{
+	lua_sethook(L, nullptr, 0, 0);
+	if (profiling)
+	{
+		ProfilerDetach(hostCtxt);
+	}
+}
+
 _Check_return_ HRESULT
 CLuaScriptProvider::Run(
 	_In_ int argc,
@@ -226,6 +589,10 @@ CLuaScriptProvider::Run(
 
 	int i = 0;
 	bool debug = false;
+	bool hooked = false;
+	bool profiling = false;
+
+	ClearTypedObjectIdentities(LuaState);
 
 	// TODO: Generalize arg processing.
 	//
@@ -303,7 +670,7 @@ CLuaScriptProvider::Run(
 
 	// Compile the script file and push the executable chunk on the stack.
 	//
-	err = luaL_loadfile(LuaState, ansiScriptFileName);
+	err = loadFileCached(LuaState, ansiScriptFileName);
 	if (err)
 	{
 		hostCtxt->DebugControl->Output(
@@ -384,9 +751,16 @@ CLuaScriptProvider::Run(
 
 	appendScriptPathToPackagePath(LuaState, ansiScriptFileName);
 	
+	hooked = startHooks(hostCtxt, LuaState, &profiling);
+
 	// Call what's on the top of the stack.
 	//
 	err = lua_pcall(LuaState, 0, 0, -2 /* position of debug.traceback */);
+
+	if (hooked)
+	{
+		stopHooks(hostCtxt, LuaState, profiling);
+	}
 	
 	if (err)
 	{
@@ -408,6 +782,7 @@ CLuaScriptProvider::Run(
 	}
 	
 exit:
+	reportVMMemory();
 	return hr;
 }
 
@@ -417,14 +792,19 @@ CLuaScriptProvider::RunString(
 {
 	HRESULT hr = S_OK;
 	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	bool hooked = false;
+	bool profiling = false;
 
 	// Host ensures string is not empty.
 	//
 	assert(*scriptString);
+
+	ClearTypedObjectIdentities(LuaState);
 	
-	// Compile the string and push the chunk on the stack.
+	// Compile the string and push the chunk on the stack. Repeated strings
+	// (e.g. breakpoint commands) are only compiled once.
 	//
-	int err = luaL_loadstring(LuaState, scriptString);
+	int err = loadStringCached(LuaState, &EvalChunkCache, scriptString);
 	if (err)
 	{
 		hostCtxt->DebugControl->Output(
@@ -440,9 +820,16 @@ CLuaScriptProvider::RunString(
 		goto exit;
 	}
 	
+	hooked = startHooks(hostCtxt, LuaState, &profiling);
+
 	// Call the chunk.
 	//
 	err = lua_pcall(LuaState, 0 /* num args */, 0 /* num results */, 0 /* err handler idx */);
+
+	if (hooked)
+	{
+		stopHooks(hostCtxt, LuaState, profiling);
+	}
 	
 	if (err)
 	{
@@ -464,26 +851,82 @@ CLuaScriptProvider::RunString(
 	}
 	
 exit:
-	
+	reportVMMemory();
 	return hr;
 }
 
+// Lua allocator function, serving the VM from its arena.
+//
+static void*
+arenaAlloc(
+	_In_ void* ud,
+	_In_opt_ void* ptr,
+	_In_ size_t osize,
+	_In_ size_t nsize)
+{
+	Arena* arena = (Arena*)ud;
+
+	if (nsize == 0)
+	{
+		ArenaFree(arena, ptr, osize);
+		return nullptr;
+	}
+
+	// When 'ptr' is null, 'osize' is the kind of object being allocated, not a
+	// size.
+	//
+	return ptr ?
+		ArenaRealloc(arena, ptr, osize, nsize) :
+		ArenaAlloc(arena, nsize);
+}
+
+// Called on an error outside any protected call. Lua aborts the process when
+// this returns, so at least say why.
+//
+static int
+luaPanic(
+	_In_ lua_State* L)
+{
+	const char* msg = lua_tostring(L, -1);
+	GetLuaProvGlobals()->HostCtxt->DebugControl->Output(
+		DEBUG_OUTPUT_ERROR,
+		"Lua panic: %s\n",
+		msg ? msg : "error object is not a string");
+	return 0;
+}
+
+// Record how much memory the VM holds, for !dbgscriptstats.
+//
+static void
+reportVMMemory()
+{
+	const Arena* arena = &GetLuaProvGlobals()->VMArena;
+	StatsSetVMMemory(
+		GetLuaProvGlobals()->HostCtxt,
+		"lua",
+		arena->CurrentBytes,
+		arena->PeakBytes);
+}
+
 _Check_return_ HRESULT
 CLuaScriptProvider::StartVM()
 {
 	HRESULT hr = S_OK;
 	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
 	lua_StdioRedir redir = { 0 };
-	LuaState = luaL_newstate();
+	LuaState = lua_newstate(arenaAlloc, &GetLuaProvGlobals()->VMArena);
 	if (!LuaState)
 	{
 		hr = E_OUTOFMEMORY;
 		hostCtxt->DebugControl->Output(
 			DEBUG_OUTPUT_ERROR,
-			"Error: luaL_newstate failed.\n");
+			"Error: lua_newstate failed.\n");
+		ArenaDestroy(&GetLuaProvGlobals()->VMArena);
 		goto exit;
 	}
 
+	lua_atpanic(LuaState, luaPanic);
+
 	// Redirect stdio.
 	//
 	redir.cb_output = luaOutputCb;
@@ -514,17 +957,78 @@ CLuaScriptProvider::StartVM()
 	// Open StackFrame class.
 	//
 	luaL_requiref(LuaState, "StackFrame", luaopen_StackFrame, 0 /* set global */);
+
+	// luaL_requiref leaves each module on the stack.
+	//
+	lua_settop(LuaState, 0);
+
+#ifndef LOCKDOWN
+	// Load modules through the bytecode cache.
+	//
+	lua_getglobal(LuaState, "package");
+	lua_getfield(LuaState, -1, "searchers");
+	lua_pushcfunction(LuaState, cachedFileSearcher);
+	lua_rawseti(LuaState, -2, 2 /* Lua file searcher */);
+	lua_pop(LuaState, 2);
+#endif
+
+	saveInitialGlobals(LuaState);
 exit:
 	return hr;
 }
 
+// Install a fresh global table, copied from the one saved by StartVM, and
+// restore package.path (see appendScriptPathToPackagePath). Modules loaded
+// by earlier runs stay in package.loaded, so requiring them again is free.
+//
+_Check_return_ HRESULT
+CLuaScriptProvider::ResetVM()
+{
+	lua_newtable(LuaState);
+	lua_rawgetp(LuaState, LUA_REGISTRYINDEX, &s_InitialGlobalsKey);
+	copyTableFields(LuaState);
+	lua_pop(LuaState, 1);
+
+	// Point _G, both the global and the one in package.loaded, at the new
+	// table.
+	//
+	lua_pushvalue(LuaState, -1);
+	lua_setfield(LuaState, -2, "_G");
+	luaL_getsubtable(LuaState, LUA_REGISTRYINDEX, "_LOADED");
+	lua_pushvalue(LuaState, -2);
+	lua_setfield(LuaState, -2, "_G");
+	lua_pop(LuaState, 1);
+
+	// Chunks loaded from now on get the new table as their _ENV. Cached
+	// RunString chunks are bound to the old one, so drop them.
+	//
+	lua_rawseti(LuaState, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+
+	EvalCacheClear(&EvalChunkCache, releaseEvalChunk);
+	lua_pushnil(LuaState);
+	lua_rawsetp(LuaState, LUA_REGISTRYINDEX, &s_EvalChunksKey);
+
+	lua_getglobal(LuaState, "package");
+	lua_rawgetp(LuaState, LUA_REGISTRYINDEX, &s_InitialPackagePathKey);
+	lua_setfield(LuaState, -2, "path");
+	lua_pop(LuaState, 1);
+
+	return S_OK;
+}
+
 void
 CLuaScriptProvider::StopVM()
 {
 	if (LuaState)
 	{
+		EvalCacheClear(&EvalChunkCache, releaseEvalChunk);
 		lua_close(LuaState);
 		LuaState = nullptr;
+
+		// Return the VM's memory to the system, including anything lua_close
+		// left behind.
+		//
+		ArenaDestroy(&GetLuaProvGlobals()->VMArena);
 	}
 }
 
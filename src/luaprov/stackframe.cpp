@@ -57,7 +57,7 @@ AllocStackFrameObject(
 	// Allocate a user datum.
 	//
 	DbgScriptStackFrame* frame = (DbgScriptStackFrame*)
-		lua_newuserdata(L, sizeof(DbgScriptStackFrame));
+		LuaNewWrapper(L, sizeof(DbgScriptStackFrame));
 
 	// Bind userdatum to our metatable.
 	//
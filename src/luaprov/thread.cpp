@@ -44,7 +44,7 @@ AllocThreadObject(
 	// Allocate a user datum.
 	//
 	DbgScriptThread* thd = (DbgScriptThread*)
-		lua_newuserdata(L, sizeof(DbgScriptThread));
+		LuaNewWrapper(L, sizeof(DbgScriptThread));
 
 	// Bind userdatum to our metatable.
 	//
@@ -16,8 +16,16 @@
 #include "typedobject.h"
 #include "classprop.h"
 #include "util.h"
+#include "../support/symcache.h"
 
 #define TYPED_OBJECT_METATABLE  "dbgscript.TypedObject"
+#define ARRAY_SLICE_METATABLE  "dbgscript.ArraySlice"
+
+// Registry key (by address) of the table of live TypedObjects, indexed by hash
+// of their identity (see DsTypedDataHash). Its values are weak, so the GC
+// removes objects the script no longer references.
+//
+static const char s_IdentitiesKey = 0;
 
 //------------------------------------------------------------------------------
 // Function: AllocTypedObject
@@ -43,7 +51,7 @@ allocTypedObject(
 	// Allocate a user datum.
 	//
 	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
-		lua_newuserdata(L, sizeof(DbgScriptTypedObject));
+		LuaNewWrapper(L, sizeof(DbgScriptTypedObject));
 
 	// Bind userdatum to our metatable.
 	//
@@ -53,6 +61,169 @@ allocTypedObject(
 	return typObj;
 }
 
+//------------------------------------------------------------------------------
+// Function: identitySlot
+//
+// Description:
+//
+//  Index of an object in the identity table.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static lua_Integer
+identitySlot(
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	return (lua_Integer)(DsTypedDataHash(typedData) & (TYPED_OBJECT_IDENTITY_SLOTS - 1)) + 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: findIdentity
+//
+// Description:
+//
+//  Find a live TypedObject for the same object, with the same name.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Returns:
+//
+//  true if found, in which case it's pushed on the stack.
+//
+// Notes:
+//
+static bool
+findIdentity(
+	_In_ lua_State* L,
+	_In_z_ const char* name,
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &s_IdentitiesKey);
+	if (lua_rawgeti(L, -1, identitySlot(typedData)) == LUA_TUSERDATA)
+	{
+		// Only TypedObjects are stored.
+		//
+		const DbgScriptTypedObject* obj =
+			(const DbgScriptTypedObject*)lua_touserdata(L, -1);
+		if (DsTypedDataSameObject(&obj->TypedData, typedData) &&
+			!strcmp(obj->Name, name))
+		{
+			lua_remove(L, -2);
+			return true;
+		}
+	}
+
+	lua_pop(L, 2);
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Function: rememberIdentity
+//
+// Description:
+//
+//  Make the new TypedObject on top of the stack the one findIdentity returns
+//  for its object.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+rememberIdentity(
+	_In_ lua_State* L,
+	_In_ const DbgScriptTypedObject* typObj)
+{
+	if (!typObj->TypedDataValid)
+	{
+		return;
+	}
+
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &s_IdentitiesKey);
+	lua_pushvalue(L, -2);
+	lua_rawseti(L, -2, identitySlot(&typObj->TypedData));
+	lua_pop(L, 1);
+}
+
+//------------------------------------------------------------------------------
+// Function: internTypedObject
+//
+// Description:
+//
+//  Swap the newly initialized TypedObject on top of the stack for a live one
+//  for the same object, if there is one.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//  typObj - The new TypedObject. Not to be used afterwards.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+internTypedObject(
+	_In_ lua_State* L,
+	_In_ const DbgScriptTypedObject* typObj)
+{
+	if (!typObj->TypedDataValid)
+	{
+		return;
+	}
+
+	if (findIdentity(L, typObj->Name, &typObj->TypedData))
+	{
+		lua_replace(L, -2);
+	}
+	else
+	{
+		rememberIdentity(L, typObj);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: ClearTypedObjectIdentities
+//
+// Description:
+//
+//  Stop returning existing TypedObjects for new lookups.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Returns:
+//
+// Notes:
+//
+//  Called at the start of each run. Target memory may have changed since the
+//  last one, and with it the values the live objects have cached.
+//
+void
+ClearTypedObjectIdentities(
+	_In_ lua_State* L)
+{
+	lua_createtable(L, TYPED_OBJECT_IDENTITY_SLOTS, 0);
+
+	lua_createtable(L, 0, 1);
+	lua_pushliteral(L, "v");
+	lua_setfield(L, -2, "__mode");
+	lua_setmetatable(L, -2);
+
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_IdentitiesKey);
+}
+
 //------------------------------------------------------------------------------
 // Function: AllocTypedObject
 //
@@ -70,6 +241,8 @@ allocTypedObject(
 //
 // Notes:
 //
+//  Returns the live TypedObject for the same object instead, if any.
+//
 void
 allocSubTypedObject(
 	_In_ lua_State* L,
@@ -78,6 +251,11 @@ allocSubTypedObject(
 {
 	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
 	CHECK_ABORT(hostCtxt);
+
+	if (findIdentity(L, name, typedData))
+	{
+		return;
+	}
 	
 	DbgScriptTypedObject* typObj = allocTypedObject(L);
 	
@@ -88,6 +266,8 @@ allocSubTypedObject(
 		LuaError(
 			L, "DsWrapTypedData failed. Error 0x%08x.", hr);
 	}
+
+	rememberIdentity(L, typObj);
 }
 
 //------------------------------------------------------------------------------
@@ -138,6 +318,8 @@ AllocNewTypedObject(
 		LuaError(
 			L, "DsInitializeTypedObject failed. Error 0x%08x.", hr);
 	}
+
+	internTypedObject(L, typObj);
 }
 
 static void
@@ -237,12 +419,23 @@ getFieldHelper(
 //  Param 1 is the user datum (TypedObject).
 //  Param 2 is the key. Key could be an int or string.
 //
+// Upvalues:
+//
+//  1 - TypedObject metatable (methods).
+//  2 - Properties table.
+//
 // Returns:
 //
 //  One result: Varies.
 //
 // Notes:
 //
+//  Runs on every 'obj.field', so it avoids the registry and nested calls:
+//  the self check compares metatables against upvalue 1, and methods and
+//  properties are probed with raw lookups before falling back to a field.
+//  Methods and properties are the same for every type, so a key that misses
+//  both is a field name whatever the type, and costs two raw lookups.
+//
 static int
 TypedObject_index(lua_State* L)
 {
@@ -253,8 +446,14 @@ TypedObject_index(lua_State* L)
 	// type. (Having the right metatable).
 	//
 	HRESULT hr = S_OK;
-	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)lua_touserdata(L, 1);
+	if (!typObj ||
+		!lua_getmetatable(L, 1) ||
+		!lua_rawequal(L, -1, lua_upvalueindex(1)))
+	{
 		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
+	}
+	lua_settop(L, 2);
 
 	if (lua_isinteger(L, 2))
 	{
@@ -286,44 +485,54 @@ TypedObject_index(lua_State* L)
 		//
 		luaL_checktype(L, 2, LUA_TSTRING);
 		
+		// First check if the key is a method or Lua class property.
 		//
-		// First check if the key is a Lua class property.
-		//
-		
-		// Push the C function we're about to call.
-		//
-		lua_pushcfunction(L, LuaClassPropIndexer);
-
-		// Param 1: push the typed object on the top.
-		//
-		lua_pushvalue(L, 1);
-
-		// Param 2: Copy the key and push it on top.
-		//
-		lua_pushvalue(L, 2);
-
-		// Call it. The return value could be the result of a getter call.
-		// It could also be an existing field we fetched from the metatable
-		// which lua will try to call (if the scripter attempted method call
-		// syntax)
-		//
-		lua_call(L, 2, 1);
-
-		if (!lua_isnil(L, -1))
+		if (LuaClassPropTryIndex(L, lua_upvalueindex(1), lua_upvalueindex(2)))
 		{
 			return 1;
 		}
-		else
-		{
-			// Else fall back to dbg-eng field lookup.
-			//
-			checkTypedData(L, typObj);
-			
-			return getFieldHelper(L, typObj);
-		}
+
+		// Else fall back to dbg-eng field lookup.
+		//
+		checkTypedData(L, typObj);
+		
+		return getFieldHelper(L, typObj);
 	}
 }
 
+//------------------------------------------------------------------------------
+// Function: TypedObject_eq
+//
+// Description:
+//
+//  __eq metamethod (a == b). TypedObjects are equal if they're the same type at
+//  the same address, whatever their names.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Returns:
+//
+//  One result: boolean.
+//
+// Notes:
+//
+static int
+TypedObject_eq(lua_State* L)
+{
+	const DbgScriptTypedObject* a = (const DbgScriptTypedObject*)
+		luaL_testudata(L, 1, TYPED_OBJECT_METATABLE);
+	const DbgScriptTypedObject* b = (const DbgScriptTypedObject*)
+		luaL_testudata(L, 2, TYPED_OBJECT_METATABLE);
+
+	lua_pushboolean(
+		L,
+		a && b && a->TypedDataValid && b->TypedDataValid &&
+			DsTypedDataSameObject(&a->TypedData, &b->TypedData));
+	return 1;
+}
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_len
 //
@@ -367,27 +576,141 @@ TypedObject_len(lua_State* L)
 		return luaL_error(L, "object not array.");
 	}
 	
-	DEBUG_TYPED_DATA typedData = {0};
-	hr = DsTypedObjectGetArrayElement(
+	UINT64 numElems = 0;
+	hr = DsTypedObjectGetArrayLength(
 		hostCtxt,
 		typObj,
-		0,  // index
-		&typedData);
+		&numElems);
 	if (FAILED(hr))
 	{
 		return LuaError(
-			L, "DsTypedObjectGetArrayElement failed. Error 0x%08x.", hr);
+			L, "DsTypedObjectGetArrayLength failed. Error 0x%08x.", hr);
 	}
 	
-	const ULONG elemSize = typedData.Size;
-	
-	const ULONG numElems = typObj->TypedData.Size / elemSize;
-	
 	lua_pushinteger(L, numElems);
 	
 	return 1;
 }
 
+//------------------------------------------------------------------------------
+// Function: TypedObject_pairsIter
+//
+// Description:
+//
+//  Iterator function returned by __pairs. Produces the next array element.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Ignored. The cursor is held in upvalue 1.
+//
+// Returns:
+//
+//  Two results: (index, element), or nil when the array is exhausted.
+//
+// Notes:
+//
+static int
+TypedObject_pairsIter(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptArrayCursor* cursor = (DbgScriptArrayCursor*)
+		lua_touserdata(L, lua_upvalueindex(1));
+	
+	// Indices are zero-based, like obj[i].
+	//
+	lua_pushinteger(L, cursor->Index);
+	
+	DbgScriptTypedObject* elem = allocTypedObject(L);
+	
+	HRESULT hr = DsArrayCursorNext(hostCtxt, cursor, elem);
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+	}
+	else if (hr == S_FALSE)
+	{
+		// Exhausted. A nil control variable ends the loop.
+		//
+		lua_pushnil(L);
+		return 1;
+	}
+
+	internTypedObject(L, elem);
+	return 2;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_pairs
+//
+// Description:
+//
+//  __pairs metamethod. Allows iterating over an array with:
+//
+//    for i, elem in pairs(arr) do ... end
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (TypedObject).
+//
+// Returns:
+//
+//  Three results: iterator function, nil, nil.
+//
+// Notes:
+//
+//  Only the first element is resolved through the debugger engine, so this is
+//  much cheaper than indexing each element in turn.
+//
+static int
+TypedObject_pairs(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	// Validate that the first param was 'self'. I.e. a Userdatum of the right
+	// type. (Having the right metatable).
+	//
+	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
+	
+	checkTypedData(L, typObj);
+
+	if (typObj->TypedData.Tag != SymTagArrayType)
+	{
+		// Not array. Pointers have no length, so we can't know when to stop.
+		//
+		return luaL_error(L, "object not array.");
+	}
+	
+	// The cursor lives in a plain user datum that the iterator closure holds
+	// on to as an upvalue.
+	//
+	DbgScriptArrayCursor* cursor = (DbgScriptArrayCursor*)
+		lua_newuserdata(L, sizeof(DbgScriptArrayCursor));
+	
+	HRESULT hr = DsArrayCursorInit(hostCtxt, typObj, cursor);
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsArrayCursorInit failed. Error 0x%08x.", hr);
+	}
+	
+	lua_pushcclosure(L, TypedObject_pairsIter, 1);
+	lua_pushnil(L);
+	lua_pushnil(L);
+	
+	return 3;
+}
+
 //------------------------------------------------------------------------------
 // Function: luaValueFromCValue
 //
@@ -490,17 +813,71 @@ luaValueFromCValue(
 }
 
 //------------------------------------------------------------------------------
-// Function: TypedObject_getvalue
+// Function: ensureValue
 //
 // Description:
 //
-//  Value getter for typed object, if object is a primitive type.
+//  Read the value of a primitive object from the target, unless it has already
+//  been fetched (e.g. by an array cursor reading ahead). Raises an error on
+//  failure.
 //
 // Parameters:
 //
 //  L - pointer to Lua state.
+//  typObj - Primitive object whose value is needed.
 //
-// Input Stack:
+// Returns:
+//
+//  void.
+//
+// Notes:
+//
+static void
+ensureValue(
+	_In_ lua_State* L,
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptTypedObject* typObj)
+{
+	if (typObj->ValueValid)
+	{
+		return;
+	}
+
+	// Read the appropriate size from memory.
+	//
+	// What primitive type is bigger than 8 bytes?
+	//
+	ULONG cbRead = 0;
+	assert(typObj->TypedData.Size <= 8);
+	HRESULT hr = UtilReadTypedData(
+		hostCtxt,
+		&typObj->TypedData,
+		&typObj->Value.Value,
+		sizeof(typObj->Value.Value),
+		&cbRead);
+	if (FAILED(hr))
+	{
+		LuaError(L, "Failed to read typed data. Error 0x%08x.", hr);
+	}
+	assert(cbRead == typObj->TypedData.Size);
+
+	// Value has been populated.
+	//
+	typObj->ValueValid = true;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_getvalue
+//
+// Description:
+//
+//  Value getter for typed object, if object is a primitive type.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
 //
 //  Param 1 is the user datum (TypedObject).
 //
@@ -519,7 +896,6 @@ TypedObject_getvalue(lua_State* L)
 	// Validate that the first param was 'self'. I.e. a Userdatum of the right
 	// type. (Having the right metatable).
 	//
-	HRESULT hr = S_OK;
 	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
 		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
 	
@@ -530,28 +906,7 @@ TypedObject_getvalue(lua_State* L)
 		return luaL_error(L, "not a primitive type.");
 	}
 
-	// Read the appropriate size from memory.
-	//
-	// What primitive type is bigger than 8 bytes?
-	//
-	ULONG cbRead = 0;
-	assert(typObj->TypedData.Size <= 8);
-	hr = hostCtxt->DebugSymbols->ReadTypedDataVirtual(
-		typObj->TypedData.Offset,
-		typObj->TypedData.ModBase,
-		typObj->TypedData.TypeId,
-		&typObj->Value.Value,
-		sizeof(typObj->Value.Value),
-		&cbRead);
-	if (FAILED(hr))
-	{
-		return LuaError(L, "Failed to read typed data. Error 0x%08x.", hr);
-	}
-	assert(cbRead == typObj->TypedData.Size);
-
-	// Value has been populated.
-	//
-	typObj->ValueValid = true;
+	ensureValue(L, hostCtxt, typObj);
 
 	return luaValueFromCValue(L, typObj);
 }
@@ -785,10 +1140,208 @@ TypedObject_getRuntimeObject(lua_State* L)
 	{
 		return LuaError(L, "DsTypedObjectGetRuntimeType failed. Error 0x%08x.", hr);
 	}
+
+	internTypedObject(L, newTypObj);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_cast
+//
+// Description:
+//
+//  Reinterpret the object's memory as another type, like a C cast of its
+//  address.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the typed object.
+//  Param 2 is the name of the type to cast to.
+//
+// Returns:
+//
+//  One result: A new typed object of the given type.
+//
+// Notes:
+//
+//  Only the first cast to a given aggregate type issues DbgEng requests.
+//
+static int
+TypedObject_cast(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
+
+	// Explictly check for string, not convertible to string.
+	//
+	luaL_checktype(L, 2, LUA_TSTRING);
+	const char* typeName = lua_tostring(L, 2);
+
+	checkTypedData(L, typObj);
+
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, typeName);
+	if (!typeInfo)
+	{
+		return luaL_error(L, "Failed to get type id for type '%s'.", typeName);
+	}
+
+	AllocNewTypedObject(
+		L,
+		0,
+		typObj->Name,
+		typeInfo->TypeId,
+		typeInfo->ModuleBase,
+		typObj->TypedData.Offset,
+		false /* wantPointer */);
 	
 	return 1;
 }
 
+//------------------------------------------------------------------------------
+// Function: TypedObject_offset
+//
+// Description:
+//
+//  Pointer arithmetic. If the object is a pointer, returns a pointer advanced
+//  by 'n' elements. Otherwise returns the object of the same type 'n' elements
+//  away, as if it were an element of an array.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the typed object.
+//  Param 2 is the number of elements to move by. May be negative.
+//
+// Returns:
+//
+//  One result: A new typed object.
+//
+// Notes:
+//
+//  Computed locally; at most one DbgEng request per pointer type.
+//
+static int
+TypedObject_offset(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
+	const lua_Integer count = luaL_checkinteger(L, 2);
+
+	checkTypedData(L, typObj);
+	
+	DbgScriptTypedObject* newTypObj = allocTypedObject(L);
+	
+	HRESULT hr = DsTypedObjectOffset(hostCtxt, typObj, count, newTypObj);
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsTypedObjectOffset failed. Error 0x%08x.", hr);
+	}
+
+	internTypedObject(L, newTypObj);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: GetRuntimeObjects
+//
+// Description:
+//
+//  Batch version of getRuntimeObject. Resolve the runtime type of each object
+//  in a sequence.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is a sequence (table) of typed objects.
+//
+// Returns:
+//
+//  One result: A sequence with the downcast object for each input, or false
+//  where the object has no vtable (or no typed data).
+//
+// Notes:
+//
+//  'false' rather than 'nil' keeps the result a proper sequence.
+//
+int
+GetRuntimeObjects(
+	_In_ lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	const lua_Integer len = luaL_len(L, 1);
+
+	lua_createtable(L, (int)len, 0);
+
+	for (lua_Integer i = 1; i <= len; ++i)
+	{
+		CHECK_ABORT(hostCtxt);
+
+		lua_rawgeti(L, 1, i);
+
+		DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+			luaL_testudata(L, -1, TYPED_OBJECT_METATABLE);
+		if (!typObj)
+		{
+			return luaL_error(L, "expected a sequence of typed objects.");
+		}
+
+		if (typObj->TypedDataValid)
+		{
+			DbgScriptTypedObject* newTypObj = allocTypedObject(L);
+
+			HRESULT hr = DsTypedObjectTryGetRuntimeType(
+				hostCtxt, typObj, newTypObj);
+			if (FAILED(hr))
+			{
+				return LuaError(
+					L, "DsTypedObjectTryGetRuntimeType failed. Error 0x%08x.", hr);
+			}
+			else if (hr == S_FALSE)
+			{
+				// No vtable.
+				//
+				lua_pop(L, 1);
+				lua_pushboolean(L, false);
+			}
+			else
+			{
+				internTypedObject(L, newTypObj);
+			}
+		}
+		else
+		{
+			lua_pushboolean(L, false);
+		}
+
+		// Store the result and pop the input.
+		//
+		lua_rawseti(L, -3, i);
+		lua_pop(L, 1);
+	}
+
+	return 1;
+}
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_getfield
 //
@@ -995,6 +1548,382 @@ TypedObject_deref(lua_State* L)
 	return 1;
 }
 
+//------------------------------------------------------------------------------
+// Function: narrowSlice
+//
+// Description:
+//
+//  Narrow an array slice, in place, to the range given by the arguments
+//  (start, stop [, step]) on the stack.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//  slice - Slice to narrow.
+//  arg - Stack index of the 'start' argument.
+//
+// Returns:
+//
+//  void. Raises an error on invalid bounds.
+//
+// Notes:
+//
+//  Indices are zero-based and 'stop' is exclusive, like obj[i]. 'step' must
+//  be positive.
+//
+static void
+narrowSlice(
+	_In_ lua_State* L,
+	_Inout_ DbgScriptArraySlice* slice,
+	_In_ int arg)
+{
+	const lua_Integer start = luaL_checkinteger(L, arg);
+	const lua_Integer stop = luaL_checkinteger(L, arg + 1);
+	const lua_Integer step = luaL_optinteger(L, arg + 2, 1 /* default val */);
+
+	luaL_argcheck(L, start >= 0, arg, "must be non-negative");
+	luaL_argcheck(L, stop >= start, arg + 1, "must not be less than start");
+	luaL_argcheck(L, step > 0, arg + 2, "must be positive");
+
+	if (slice->Count != ARRAY_SLICE_UNBOUNDED)
+	{
+		luaL_argcheck(
+			L, (UINT64)stop <= slice->Count, arg + 1, "out of range");
+	}
+
+	const UINT64 count = (UINT64)((stop - start + step - 1) / step);
+
+	HRESULT hr = DsArraySliceGetSubSlice(slice, start, count, step, slice);
+	if (FAILED(hr))
+	{
+		LuaError(L, "DsArraySliceGetSubSlice failed. Error 0x%08x.", hr);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: allocArraySlice
+//
+// Description:
+//
+//  Helper to allocate an array slice.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Returns:
+//
+//  One result: User datum representing the slice.
+//
+// Notes:
+//
+static DbgScriptArraySlice*
+allocArraySlice(
+	_In_ lua_State* L)
+{
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		lua_newuserdata(L, sizeof(DbgScriptArraySlice));
+
+	luaL_getmetatable(L, ARRAY_SLICE_METATABLE);
+	lua_setmetatable(L, -2);
+
+	return slice;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_slice
+//
+// Synopsis:
+//
+//  obj:slice(start, stop [, step]) -> ArraySlice
+//
+// Description:
+//
+//  Get a lazy view over a range of elements of an array or pointer. No memory
+//  is read until elements are requested from the view.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (TypedObject).
+//  Param 2: start. Index of first element.
+//  Param 3: stop. Index one past the last element.
+//  Param 4: step. [opt] Distance between elements. Defaults to 1.
+//
+// Returns:
+//
+//  One result: The new slice.
+//
+// Notes:
+//
+static int
+TypedObject_slice(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	// Validate that the first param was 'self'. I.e. a Userdatum of the right
+	// type. (Having the right metatable).
+	//
+	DbgScriptTypedObject* typObj = (DbgScriptTypedObject*)
+		luaL_checkudata(L, 1, TYPED_OBJECT_METATABLE);
+	
+	checkTypedData(L, typObj);
+
+	DbgScriptArraySlice* slice = allocArraySlice(L);
+
+	HRESULT hr = DsArraySliceInit(hostCtxt, typObj, slice);
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsArraySliceInit failed. Error 0x%08x.", hr);
+	}
+
+	narrowSlice(L, slice, 2);
+
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_index
+//
+// Description:
+//
+//  Read indexer for array slices.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (ArraySlice).
+//  Param 2 is the key. Either an integer index or a method name.
+//
+// Returns:
+//
+//  One result: The element at that index, or the method.
+//
+// Notes:
+//
+//  Only elements of primitive type are resolved through DbgEng.
+//
+static int
+ArraySlice_index(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		luaL_checkudata(L, 1, ARRAY_SLICE_METATABLE);
+
+	if (!lua_isinteger(L, 2))
+	{
+		// Method lookup.
+		//
+		lua_getmetatable(L, 1);
+		lua_pushvalue(L, 2);
+		lua_rawget(L, -2);
+		return 1;
+	}
+
+	const lua_Integer index = lua_tointeger(L, 2);
+	if (index < 0 || (UINT64)index >= slice->Count)
+	{
+		return luaL_error(L, "index out of range.");
+	}
+
+	DbgScriptTypedObject* typObj = allocTypedObject(L);
+
+	HRESULT hr = DsArraySliceGetElement(
+		GetLuaProvGlobals()->HostCtxt, slice, index, typObj);
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsArraySliceGetElement failed. Error 0x%08x.", hr);
+	}
+
+	internTypedObject(L, typObj);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_len
+//
+// Description:
+//
+//  __len metamethod (#foo) to obtain the number of elements in the slice.
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (ArraySlice).
+//
+// Returns:
+//
+//  One result: Length.
+//
+// Notes:
+//
+static int
+ArraySlice_len(lua_State* L)
+{
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		luaL_checkudata(L, 1, ARRAY_SLICE_METATABLE);
+
+	lua_pushinteger(L, slice->Count);
+	
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_pairs
+//
+// Description:
+//
+//  __pairs metamethod. Allows iterating over a slice with:
+//
+//    for i, elem in pairs(slice) do ... end
+//
+// Parameters:
+//
+//  L - pointer to Lua state.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (ArraySlice).
+//
+// Returns:
+//
+//  Three results: iterator function, nil, nil.
+//
+// Notes:
+//
+//  Indices are relative to the slice.
+//
+static int
+ArraySlice_pairs(lua_State* L)
+{
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		luaL_checkudata(L, 1, ARRAY_SLICE_METATABLE);
+	
+	DbgScriptArrayCursor* cursor = (DbgScriptArrayCursor*)
+		lua_newuserdata(L, sizeof(DbgScriptArrayCursor));
+	
+	DsArrayCursorInitFromSlice(slice, cursor);
+	
+	lua_pushcclosure(L, TypedObject_pairsIter, 1);
+	lua_pushnil(L);
+	lua_pushnil(L);
+	
+	return 3;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_slice
+//
+// Synopsis:
+//
+//  slice:slice(start, stop [, step]) -> ArraySlice
+//
+// Description:
+//
+//  Get a narrower view. Indices are relative to this slice.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (ArraySlice).
+//  Param 2: start. Index of first element.
+//  Param 3: stop. Index one past the last element.
+//  Param 4: step. [opt] Distance between elements. Defaults to 1.
+//
+// Returns:
+//
+//  One result: The new slice.
+//
+// Notes:
+//
+static int
+ArraySlice_slice(lua_State* L)
+{
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		luaL_checkudata(L, 1, ARRAY_SLICE_METATABLE);
+
+	DbgScriptArraySlice* newSlice = allocArraySlice(L);
+	*newSlice = *slice;
+
+	narrowSlice(L, newSlice, 2);
+
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_values
+//
+// Synopsis:
+//
+//  slice:values() -> table
+//
+// Description:
+//
+//  Return the values of all elements in the slice as a sequence (with the
+//  usual 1-based Lua indices). Raises an error if the elements are not of a
+//  primitive type.
+//
+// Input Stack:
+//
+//  Param 1 is the user datum (ArraySlice).
+//
+// Returns:
+//
+//  One result: Table of values.
+//
+// Notes:
+//
+//  Values are read from the target in bulk, and no TypedObjects are created,
+//  which makes this the fastest way to extract an array of primitives.
+//
+static int
+ArraySlice_values(lua_State* L)
+{
+	DbgScriptHostContext* hostCtxt = GetLuaProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptArraySlice* slice = (DbgScriptArraySlice*)
+		luaL_checkudata(L, 1, ARRAY_SLICE_METATABLE);
+
+	if (!DsTypedObjectIsPrimitive(&slice->Elem))
+	{
+		return luaL_error(L, "not a primitive type.");
+	}
+
+	DbgScriptArrayCursor cursor;
+	DbgScriptTypedObject elem;
+	lua_Integer i = 1;
+
+	lua_createtable(L, (int)slice->Count, 0);
+
+	HRESULT hr = S_OK;
+
+	DsArrayCursorInitFromSlice(slice, &cursor);
+
+	while ((hr = DsArrayCursorNext(hostCtxt, &cursor, &elem)) == S_OK)
+	{
+		CHECK_ABORT(hostCtxt);
+
+		ensureValue(L, hostCtxt, &elem);
+		luaValueFromCValue(L, &elem);
+		lua_rawseti(L, -2, i++);
+	}
+
+	if (FAILED(hr))
+	{
+		return LuaError(L, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+	}
+
+	return 1;
+}
+
 // Static (class) methods.
 //
 static const luaL_Reg g_typedObjectFunc[] =
@@ -1024,8 +1953,9 @@ static const LuaClassProperty x_TypedObjectProps[] =
 //
 static const luaL_Reg g_typedObjectMethods[] =
 {
-	{"__index", TypedObject_index},  // indexer. Serves array, field and property access.
 	{"__len", TypedObject_len},  // Length of array, if valid.
+	{"__eq", TypedObject_eq},  // Same type at the same address.
+	{"__pairs", TypedObject_pairs},  // Iteration over array elements.
 	
 	// Explicit field access, in case a property hides a field with the same
 	// name. 'f' and 'field' are aliases.
@@ -1037,10 +1967,31 @@ static const luaL_Reg g_typedObjectMethods[] =
 	//
 	{"getRuntimeObject", TypedObject_getRuntimeObject},
 
+	// Reinterpretation and pointer arithmetic, computed locally.
+	//
+	{"cast", TypedObject_cast},
+	{"offset", TypedObject_offset},
+
 	{"readString", TypedObject_readString},
 	{"readWideString", TypedObject_readWideString},
 
 	{"readBytes", TypedObject_readBytes},
+
+	// Lazy view over a range of array elements.
+	//
+	{"slice", TypedObject_slice},
+	{nullptr, nullptr}  // sentinel.
+};
+
+// Array slice methods.
+//
+static const luaL_Reg g_arraySliceMethods[] =
+{
+	{"__index", ArraySlice_index},  // Element access and method lookup.
+	{"__len", ArraySlice_len},
+	{"__pairs", ArraySlice_pairs},
+	{"slice", ArraySlice_slice},
+	{"values", ArraySlice_values},
 	{nullptr, nullptr}  // sentinel.
 };
 
@@ -1065,6 +2016,10 @@ static const luaL_Reg g_typedObjectMethods[] =
 int
 luaopen_TypedObject(lua_State* L)
 {
+	luaL_newmetatable(L, ARRAY_SLICE_METATABLE);
+	luaL_setfuncs(L, g_arraySliceMethods, 0);
+	lua_pop(L, 1);
+
 	luaL_newmetatable(L, TYPED_OBJECT_METATABLE);
 
 	// Set methods.
@@ -1074,6 +2029,12 @@ luaopen_TypedObject(lua_State* L)
 	// Set properties.
 	//
 	LuaSetProperties(L, x_TypedObjectProps, _countof(x_TypedObjectProps));
+
+	// Indexer. Serves array, field and property access.
+	//
+	LuaSetClassIndexer(L, TypedObject_index);
+
+	ClearTypedObjectIdentities(L);
 	
 	luaL_newlib(L, g_typedObjectFunc);
 	return 1;  // Number of results.
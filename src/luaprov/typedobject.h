@@ -28,3 +28,11 @@ AllocNewTypedObject(
 	_In_ UINT64 moduleBase,
 	_In_ UINT64 virtualAddress,
 	_In_ bool wantPointer);
+
+void
+ClearTypedObjectIdentities(
+	_In_ lua_State* L);
+
+int
+GetRuntimeObjects(
+	_In_ lua_State* L);
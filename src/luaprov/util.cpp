@@ -45,6 +45,45 @@ LuaError(
 	return luaL_error(L, "%s", buf);
 }
 
+//------------------------------------------------------------------------------
+// Function: LuaNewWrapper
+//
+// Description:
+//
+//  Allocate a user datum for a TypedObject, Thread or StackFrame and push it.
+//
+// Parameters:
+//
+//  size - Size of the wrapped object.
+//
+// Returns:
+//
+//  The user datum's memory.
+//
+// Notes:
+//
+//  The VM allocates from its arena, whose size classes act as free lists for
+//  wrappers: a wrapper the GC has collected makes room for the next one of the
+//  same size. Counts whether the block was reused, for !dbgscriptstats.
+//
+_Ret_notnull_ void*
+LuaNewWrapper(
+	_In_ lua_State* L,
+	_In_ size_t size)
+{
+	LuaProvGlobals* globals = GetLuaProvGlobals();
+	const UINT64 reused = globals->VMArena.ReusedBlocks;
+
+	void* ud = lua_newuserdata(L, size);
+
+	StatsCount(
+		globals->HostCtxt,
+		globals->VMArena.ReusedBlocks != reused ?
+			StatsCounterWrapperReuses : StatsCounterWrapperAllocs,
+		1);
+	return ud;
+}
+
 //------------------------------------------------------------------------------
 // Function: LuaReadBytes
 //
@@ -22,6 +22,11 @@ LuaError(
 	_In_z_ const char* fmt,
 	...);
 
+_Ret_notnull_ void*
+LuaNewWrapper(
+	_In_ lua_State* L,
+	_In_ size_t size);
+
 int
 LuaReadBytes(
 	_In_ lua_State* L,
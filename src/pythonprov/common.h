@@ -1,11 +1,18 @@
 #pragma once
 
 #include <hostcontext.h>
+#include "../support/wrapperpool.h"
 
 struct PythonProvGlobals
 {
 	HMODULE HModule;
 	DbgScriptHostContext* HostCtxt;
+
+	// Freed wrapper objects, for reuse.
+	//
+	WrapperPool TypedObjectPool;
+	WrapperPool ThreadPool;
+	WrapperPool StackFramePool;
 };
 
 _Check_return_ PythonProvGlobals*
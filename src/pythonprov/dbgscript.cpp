@@ -24,6 +24,7 @@
 #include "process.h"
 #include "thread.h"
 #include "stackframe.h"
+#include "tracespan.h"
 #include "typedobject.h"
 
 //------------------------------------------------------------------------------
@@ -105,6 +106,100 @@ dbgscript_create_typed_pointer(
 	return createTypedObjectHelper(args, true /* wantPtr */);
 }
 
+//------------------------------------------------------------------------------
+// Function: dbgscript_container_of
+//
+// Synopsis:
+// 
+//  dbgscript.container_of(addr, type, field) -> TypedObject
+//
+// Description:
+//
+//  Create a typed object of type 'type' given the address of its field 'field'.
+//  Equivalent to the CONTAINING_RECORD macro.
+//
+// Notes:
+//
+//  Only the first use of a type and field issues DbgEng requests.
+//
+static PyObject*
+dbgscript_container_of(
+	_In_ PyObject* /*self*/,
+	_In_ PyObject* args)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+
+	CHECK_ABORT(hostCtxt);
+
+	PyObject *ret = nullptr;
+	UINT64 addr = 0;
+	const char* typeName = nullptr;
+	const char* field = nullptr;
+	ULONG offset = 0;
+	HRESULT hr = S_OK;
+
+	if (!PyArg_ParseTuple(args, "Kss:container_of", &addr, &typeName, &field))
+	{
+		return nullptr;
+	}
+
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, typeName);
+	if (!typeInfo)
+	{
+		PyErr_Format(PyExc_ValueError, "Failed to get type id for type '%s'.", typeName);
+		goto exit;
+	}
+
+	hr = GetCachedFieldOffset(hostCtxt, *typeInfo, field, &offset);
+	if (FAILED(hr))
+	{
+		PyErr_Format(
+			PyExc_ValueError,
+			"Failed to get field offset for type '%s' and field '%s'. Error 0x%08x.",
+			typeName,
+			field,
+			hr);
+		goto exit;
+	}
+
+	ret = AllocTypedObject(
+		0, nullptr, typeInfo->TypeId, typeInfo->ModuleBase, addr - offset, false);
+exit:
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_get_runtime_objs
+//
+// Synopsis:
+// 
+//  dbgscript.get_runtime_objs(objs) -> list
+//
+// Description:
+//
+//  Batch version of TypedObject.get_runtime_obj. Returns a list with the
+//  downcast object for each TypedObject in 'objs', or None where an object
+//  has no vtable.
+//
+static PyObject*
+dbgscript_get_runtime_objs(
+	_In_ PyObject* /*self*/,
+	_In_ PyObject* args)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+
+	CHECK_ABORT(hostCtxt);
+
+	PyObject* objs = nullptr;
+
+	if (!PyArg_ParseTuple(args, "O:get_runtime_objs", &objs))
+	{
+		return nullptr;
+	}
+
+	return GetRuntimeObjects(objs);
+}
+
 //------------------------------------------------------------------------------
 // Function: dbgscript_resolve_enum
 //
@@ -134,19 +229,7 @@ dbgscript_resolve_enum(
 		return nullptr;
 	}
 
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, enumTypeName);
-	if (!typeInfo)
-	{
-		PyErr_Format(PyExc_ValueError, "Failed to get type id for type '%s'.", enumTypeName);
-		goto exit;
-	}
-
-	HRESULT hr = hostCtxt->DebugSymbols->GetConstantName(
-		typeInfo->ModuleBase,
-		typeInfo->TypeId,
-		value,
-		STRING_AND_CCH(enumElementName),
-		nullptr);
+	HRESULT hr = UtilResolveEnum(hostCtxt, enumTypeName, value, enumElementName);
 	if (FAILED(hr))
 	{
 		PyErr_Format(PyExc_ValueError, "Failed to get element name for enum '%s' with value '%llu'. Error 0x%08x.", enumTypeName, value, hr);
@@ -526,6 +609,153 @@ exit:
 	return ret;
 }
 
+// Context threaded through UtilGetNearestSymbols for get_nearest_syms.
+//
+struct NearestSymsCtxt
+{
+	DbgScriptHostContext* HostCtxt;
+	PyObject* Results;
+};
+
+//------------------------------------------------------------------------------
+// Function: nearestSymsCallback
+//
+// Description:
+//
+//  Store one result of UtilGetNearestSymbols into the result list.
+//
+// Parameters:
+//
+//  idx - Index of the address.
+//  name - Symbol name, or null if resolution failed.
+//  userctxt - NearestSymsCtxt.
+//
+// Returns:
+//
+//  HRESULT. On failure, a Python exception is set.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+nearestSymsCallback(
+	_In_ ULONG idx,
+	_In_opt_z_ const char* name,
+	_In_opt_ void* userctxt)
+{
+	NearestSymsCtxt* ctxt = (NearestSymsCtxt*)userctxt;
+	PyObject* item = nullptr;
+
+	if (UtilCheckAbort(ctxt->HostCtxt))
+	{
+		PyErr_SetNone(PyExc_KeyboardInterrupt);
+		return E_ABORT;
+	}
+
+	if (name)
+	{
+		item = PyUnicode_FromString(name);
+		if (!item)
+		{
+			return E_OUTOFMEMORY;
+		}
+	}
+	else
+	{
+		item = Py_None;
+		Py_INCREF(item);
+	}
+
+	// Steals reference.
+	//
+	PyList_SET_ITEM(ctxt->Results, idx, item);
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_get_nearest_syms
+//
+// Synopsis:
+// 
+//  dbgscript.get_nearest_syms(addrs) -> list
+//
+// Description:
+//
+//  Batch version of get_nearest_sym. Returns a list with the nearest symbol
+//  name of each address in 'addrs', or None where no symbol was found.
+//
+static PyObject*
+dbgscript_get_nearest_syms(
+	_In_ PyObject* /*self*/,
+	_In_ PyObject* args)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+
+	CHECK_ABORT(hostCtxt);
+
+	PyObject* ret = nullptr;
+	PyObject* addrs = nullptr;
+	PyObject* seq = nullptr;
+	UINT64* addrArr = nullptr;
+	Py_ssize_t count = 0;
+	NearestSymsCtxt ctxt = {};
+	HRESULT hr = S_OK;
+
+	if (!PyArg_ParseTuple(args, "O:get_nearest_syms", &addrs))
+	{
+		return nullptr;
+	}
+
+	seq = PySequence_Fast(addrs, "expected a sequence of addresses.");
+	if (!seq)
+	{
+		goto exit;
+	}
+
+	count = PySequence_Fast_GET_SIZE(seq);
+	if (count > ULONG_MAX)
+	{
+		PyErr_SetString(PyExc_ValueError, "Too many addresses.");
+		goto exit;
+	}
+
+	addrArr = new UINT64[count ? count : 1];
+	for (Py_ssize_t i = 0; i < count; ++i)
+	{
+		addrArr[i] = PyLong_AsUnsignedLongLong(
+			PySequence_Fast_GET_ITEM(seq, i));
+		if (PyErr_Occurred())
+		{
+			goto exit;
+		}
+	}
+
+	ctxt.HostCtxt = hostCtxt;
+	ctxt.Results = PyList_New(count);
+	if (!ctxt.Results)
+	{
+		goto exit;
+	}
+
+	hr = UtilGetNearestSymbols(
+		hostCtxt, (ULONG)count, addrArr, nearestSymsCallback, &ctxt);
+	if (FAILED(hr))
+	{
+		if (!PyErr_Occurred())
+		{
+			PyErr_Format(PyExc_RuntimeError, "UtilGetNearestSymbols failed. Error 0x%08x.", hr);
+		}
+		Py_CLEAR(ctxt.Results);
+		goto exit;
+	}
+
+	ret = ctxt.Results;
+
+exit:
+	delete[] addrArr;
+	Py_XDECREF(seq);
+	return ret;
+}
+
 //------------------------------------------------------------------------------
 // Function: dbgscript_search_memory
 //
@@ -563,7 +793,8 @@ dbgscript_search_memory(
 		goto exit;
 	}
 
-	HRESULT hr = hostCtxt->DebugDataSpaces->SearchVirtual(
+	HRESULT hr = UtilSearchMemory(
+		hostCtxt,
 		start,
 		size,
 		PyBytes_AsString(pattern),
@@ -822,6 +1053,122 @@ exit:
 	Py_RETURN_NONE;
 }
 
+// StatsDictContext - Context of addStatToDict.
+//
+struct StatsDictContext
+{
+	PyObject* Dict;
+
+	// Did adding an item fail? Python error is set.
+	//
+	bool Failed;
+};
+
+//------------------------------------------------------------------------------
+// Function: addStatToDict
+//
+// Description:
+//
+//  StatsEnumerate callback to add a statistic to a dictionary.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+addStatToDict(
+	_In_z_ const char* name,
+	_In_ UINT64 value,
+	_In_opt_ void* ctxt)
+{
+	StatsDictContext* dictCtxt = (StatsDictContext*)ctxt;
+	if (dictCtxt->Failed)
+	{
+		return;
+	}
+
+	PyObject* val = PyLong_FromUnsignedLongLong(value);
+	if (!val || PyDict_SetItemString(dictCtxt->Dict, name, val) < 0)
+	{
+		dictCtxt->Failed = true;
+	}
+	Py_XDECREF(val);
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_stats
+//
+// Synopsis:
+// 
+//  dbgscript.stats() -> dict or None
+//
+// Description:
+//
+//  Return the statistics collected so far (see !dbgscriptstats) as a dict of
+//  name to value, or None if not collecting.
+//
+static PyObject*
+dbgscript_stats(
+	_In_ PyObject* /*self*/,
+	_In_ PyObject* /*args*/)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	StatsDictContext dictCtxt = {};
+	CHECK_ABORT(hostCtxt);
+
+	dictCtxt.Dict = PyDict_New();
+	if (!dictCtxt.Dict)
+	{
+		return nullptr;
+	}
+
+	if (!StatsEnumerate(hostCtxt, addStatToDict, &dictCtxt))
+	{
+		Py_DECREF(dictCtxt.Dict);
+		Py_RETURN_NONE;
+	}
+
+	if (dictCtxt.Failed)
+	{
+		Py_DECREF(dictCtxt.Dict);
+		return nullptr;
+	}
+
+	return dictCtxt.Dict;
+}
+
+//------------------------------------------------------------------------------
+// Function: dbgscript_trace_span
+//
+// Synopsis:
+// 
+//  dbgscript.trace_span(name) -> TraceSpan
+//
+// Description:
+//
+//  Return a context manager that marks the code it wraps as a span named
+//  'name' on the timeline (see !runscript -timeline). Does nothing if no
+//  timeline is being recorded.
+//
+static PyObject*
+dbgscript_trace_span(
+	_In_ PyObject* /*self*/,
+	_In_ PyObject* args)
+{
+	PyObject* name = nullptr;
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	if (!PyArg_ParseTuple(args, "U:trace_span", &name))
+	{
+		return nullptr;
+	}
+
+	return AllocTraceSpanObj(name);
+}
+
 static PyMethodDef dbgscript_MethodsDef[] = 
 {
 	{
@@ -866,6 +1213,18 @@ static PyMethodDef dbgscript_MethodsDef[] =
 		METH_VARARGS,
 		PyDoc_STR("Return a pointer to a TypedObject with a given type and address.")
 	},
+	{
+		"container_of",
+		dbgscript_container_of,
+		METH_VARARGS,
+		PyDoc_STR("Return the TypedObject of a given type containing a field at a given address.")
+	},
+	{
+		"get_runtime_objs",
+		dbgscript_get_runtime_objs,
+		METH_VARARGS,
+		PyDoc_STR("Return the runtime type of each of a sequence of TypedObjects.")
+	},
 	{
 		"read_ptr",
 		dbgscript_read_ptr,
@@ -908,6 +1267,12 @@ static PyMethodDef dbgscript_MethodsDef[] =
 		METH_VARARGS,
 		PyDoc_STR("Lookup the nearest symbol at given address.")
 	},
+	{
+		"get_nearest_syms",
+		dbgscript_get_nearest_syms,
+		METH_VARARGS,
+		PyDoc_STR("Lookup the nearest symbol of each of a sequence of addresses.")
+	},
 	{
 		"get_global",
 		dbgscript_get_global,
@@ -932,6 +1297,18 @@ static PyMethodDef dbgscript_MethodsDef[] =
 		METH_VARARGS,
 		PyDoc_STR("Search for a memory pattern in the address space.")
 	},
+	{
+		"stats",
+		dbgscript_stats,
+		METH_NOARGS,
+		PyDoc_STR("Get the statistics collected so far.")
+	},
+	{
+		"trace_span",
+		dbgscript_trace_span,
+		METH_VARARGS,
+		PyDoc_STR("Mark a span of the script on the timeline.")
+	},
 	{NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -970,6 +1347,11 @@ InitTypes()
 	{
 		return false;
 	}
+
+	if (!InitTraceSpanType())
+	{
+		return false;
+	}
 	return true;
 }
 
@@ -1,14 +1,33 @@
 #include <python.h>
+#include <frameobject.h>
 
 #include "pythonscriptprovider.h"
 #include "util.h"
 #include <strsafe.h>
 #include "common.h"
 #include "dbgscript.h"
+#include "typedobject.h"
+#include "../support/profiler.h"
 
-CPythonScriptProvider::CPythonScriptProvider()
+// Deepest Python stack described in a profile sample. Outer frames beyond
+// this are left out.
+//
+const ULONG PROFILER_MAX_FRAMES = 128;
+
+CPythonScriptProvider::CPythonScriptProvider() :
+	InitialSysPath(nullptr),
+	EvalCodeCache()
 {}
 
+// Release a code object held by the RunString cache.
+//
+static void
+releaseEvalCode(
+	_In_ UINT_PTR code)
+{
+	Py_DECREF((PyObject*)code);
+}
+
 
 _Check_return_ HRESULT
 CPythonScriptProvider::StartVM()
@@ -59,14 +78,97 @@ CPythonScriptProvider::StartVM()
 	//
 	PySys_SetObject("exit", nullptr);
 
+	// Remember sys.path for ResetVM. Returns a new ref.
+	//
+	InitialSysPath = PySequence_List(PySys_GetObject("path"));
+
 	return hr;
 }
 
 void
 CPythonScriptProvider::StopVM()
 {
+	Py_CLEAR(InitialSysPath);
+	EvalCacheClear(&EvalCodeCache, releaseEvalCode);
 	Py_Finalize();
 	PyMem_DestroyGlobalHeap();
+
+	// Wrapper blocks come from the process heap, not the global heap.
+	//
+	PythonProvGlobals* globals = GetPythonProvGlobals();
+	WrapperPoolDrain(&globals->TypedObjectPool);
+	WrapperPoolDrain(&globals->ThreadPool);
+	WrapperPoolDrain(&globals->StackFramePool);
+}
+
+// Replace __main__ with a fresh module and restore sys.argv and sys.path.
+// Modules imported by earlier runs stay in sys.modules, so importing them
+// again is free.
+//
+_Check_return_ HRESULT
+CPythonScriptProvider::ResetVM()
+{
+	HRESULT hr = S_OK;
+	PyObject* mainMod = nullptr;
+	PyObject* builtinsMod = nullptr;
+	PyObject* dbgscriptMod = nullptr;
+	PyObject* sysPath = nullptr;
+	WCHAR emptyArg[] = L"";
+	WCHAR* argv[] = { emptyArg };
+
+	mainMod = PyModule_New("__main__");
+	builtinsMod = PyImport_ImportModule("builtins");
+	dbgscriptMod = PyImport_ImportModule(x_DbgScriptModuleName);
+	if (!mainMod || !builtinsMod || !dbgscriptMod)
+	{
+		hr = E_FAIL;
+		goto exit;
+	}
+
+	// Same globals Py_Initialize and StartVM give the original __main__.
+	//
+	if (PyObject_SetAttrString(mainMod, "__builtins__", builtinsMod) ||
+		PyObject_SetAttrString(mainMod, x_DbgScriptModuleName, dbgscriptMod))
+	{
+		hr = E_FAIL;
+		goto exit;
+	}
+
+	// The previous __main__ goes away with its last reference.
+	//
+	if (PyDict_SetItemString(PyImport_GetModuleDict(), "__main__", mainMod))
+	{
+		hr = E_FAIL;
+		goto exit;
+	}
+
+	// PySys_SetArgv prepends the script's directory on every run. Returns
+	// a borrowed ref.
+	//
+	sysPath = PySys_GetObject("path");
+	if (sysPath && InitialSysPath && PyList_Check(sysPath))
+	{
+		if (PyList_SetSlice(sysPath, 0, PyList_GET_SIZE(sysPath), InitialSysPath))
+		{
+			hr = E_FAIL;
+			goto exit;
+		}
+	}
+
+	// RunString doesn't set sys.argv, so don't leave the last script's.
+	//
+	PySys_SetArgvEx(_countof(argv), argv, 0 /* updatepath */);
+
+exit:
+	if (FAILED(hr))
+	{
+		PyErr_Print();
+	}
+
+	Py_XDECREF(dbgscriptMod);
+	Py_XDECREF(builtinsMod);
+	Py_XDECREF(mainMod);
+	return hr;
 }
 
 _Check_return_ HRESULT
@@ -126,6 +228,170 @@ exit:
 	return ret;
 }
 
+// Describe the running script's stack for the profiler (see profiler.h).
+//
+static void
+profilerWalkStack(
+	_In_opt_ void* /* walkCtxt */,
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf)
+{
+	PyFrameObject* frames[PROFILER_MAX_FRAMES];
+	ULONG depth = 0;
+
+	for (PyFrameObject* frame = PyEval_GetFrame();
+		 frame && depth < _countof(frames);
+		 frame = frame->f_back)
+	{
+		frames[depth++] = frame;
+	}
+
+	// Outermost first.
+	//
+	while (depth--)
+	{
+		PyCodeObject* code = frames[depth]->f_code;
+		const char* name = PyUnicode_AsUTF8(code->co_name);
+		const char* file = PyUnicode_AsUTF8(code->co_filename);
+
+		// Don't leave an error behind in the traced code if a name couldn't
+		// be encoded.
+		//
+		if (!name || !file)
+		{
+			PyErr_Clear();
+		}
+
+		ProfilerAppendFrame(buf, cchBuf, name, file, code->co_firstlineno);
+	}
+}
+
+// Trace function installed while profiling. Called on every line, call and
+// return; samples when one is due.
+//
+static int
+profilerTrace(
+	_In_ PyObject* /* obj */,
+	_In_ PyFrameObject* /* frame */,
+	_In_ int /* what */,
+	_In_opt_ PyObject* /* arg */)
+{
+	ProfilerSample(GetPythonProvGlobals()->HostCtxt, nullptr);
+	return 0;
+}
+
+// Start profiling a script about to run, if the host is profiling.
+//
+static _Check_return_ bool
+startProfiling(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	if (!ProfilerAttach(hostCtxt, profilerWalkStack))
+	{
+		return false;
+	}
+
+	PyEval_SetTrace(profilerTrace, nullptr);
+	return true;
+}
+
+// Stop profiling started by startProfiling.
+//
+static void
+stopProfiling(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	PyEval_SetTrace(nullptr, nullptr);
+	ProfilerDetach(hostCtxt);
+}
+
+// Run whose abort timer is live, or 0 outside of any run. Abort checks are
+// tagged with the run that queued them, so that one still pending when its run
+// ends can't act on the next run's state, or outside of a run.
+//
+static volatile LONG s_AbortCheckRun;
+
+// Last run number handed out.
+//
+static LONG s_LastAbortCheckRun;
+
+// Pending call queued by the abort timer. Raises KeyboardInterrupt in the
+// running script if the user asked to abort, so loops that never call into
+// dbgscript can still be interrupted.
+//
+static int
+checkAbortPending(
+	_In_opt_ void* arg)
+{
+	if ((LONG)(LONG_PTR)arg != s_AbortCheckRun)
+	{
+		// Queued by a run that has since ended.
+		//
+		return 0;
+	}
+
+	if (UtilCheckAbort(GetPythonProvGlobals()->HostCtxt))
+	{
+		PyErr_SetNone(PyExc_KeyboardInterrupt);
+		return -1;
+	}
+	return 0;
+}
+
+// Abort timer callback. Runs on a thread pool thread, so it only queues the
+// check for the interpreter to make between bytecodes.
+//
+static void
+abortTimerCb()
+{
+	const LONG run = s_AbortCheckRun;
+	if (run)
+	{
+		Py_AddPendingCall(checkAbortPending, (void*)(LONG_PTR)run);
+	}
+}
+
+// Start the abort timer for a run about to start. 'outerRun' receives the run
+// it interrupts, if any, for stopAbortChecks to restore.
+//
+static _Check_return_ PTP_TIMER
+startAbortChecks(
+	_Out_ LONG* outerRun)
+{
+	LONG run = ++s_LastAbortCheckRun;
+	if (!run)
+	{
+		run = ++s_LastAbortCheckRun;
+	}
+
+	*outerRun = s_AbortCheckRun;
+	InterlockedExchange(&s_AbortCheckRun, run);
+
+	PTP_TIMER timer = UtilStartAbortTimer(abortTimerCb);
+	if (!timer)
+	{
+		InterlockedExchange(&s_AbortCheckRun, *outerRun);
+	}
+	return timer;
+}
+
+// Stop abort checks started by startAbortChecks. Checks the run queued that
+// are still pending are ignored when the interpreter gets to them.
+//
+static void
+stopAbortChecks(
+	_In_opt_ PTP_TIMER timer,
+	_In_ LONG outerRun)
+{
+	if (!timer)
+	{
+		return;
+	}
+
+	UtilStopAbortTimer(timer);
+	InterlockedExchange(&s_AbortCheckRun, outerRun);
+}
+
 // Python is odd in that PySys_SetArgv takes a wide string, but PyRun_SimpleFile
 // takes a narrow one.
 //
@@ -139,9 +405,14 @@ CPythonScriptProvider::Run(
 	HRESULT hr = S_OK;
 	FILE* fp = nullptr;
 	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	bool profiling = false;
+	PTP_TIMER abortTimer = nullptr;
+	LONG outerAbortRun = 0;
 
 	int i = 0;
 
+	ClearTypedObjectIdentities();
+
 	// TODO: Generalize arg processing.
 	//
 	for (i = 0; i < argc; ++i)
@@ -245,6 +516,9 @@ CPythonScriptProvider::Run(
 		}
 	}
 
+	abortTimer = startAbortChecks(&outerAbortRun);
+	profiling = startProfiling(hostCtxt);
+
 	if (moduleToRun)
 	{
 		if (!runModule(moduleToRun))
@@ -278,6 +552,13 @@ CPythonScriptProvider::Run(
 	}
 
 exit:
+	if (profiling)
+	{
+		stopProfiling(hostCtxt);
+	}
+
+	stopAbortChecks(abortTimer, outerAbortRun);
+
 	if (fp)
 	{
 		fclose(fp);
@@ -286,6 +567,40 @@ exit:
 	return hr;
 }
 
+// Get the code object for a string, compiling it on a cache miss. Returns a
+// new ref, or nullptr with an exception set.
+//
+static PyObject*
+getEvalCode(
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* scriptString)
+{
+	PyObject* code = nullptr;
+	EvalCacheEntry* entry = EvalCacheFind(cache, scriptString);
+
+	StatsCountEval(GetPythonProvGlobals()->HostCtxt, scriptString, entry != nullptr);
+	if (entry)
+	{
+		code = (PyObject*)entry->Code;
+		Py_INCREF(code);
+		return code;
+	}
+
+	// Returns a new ref.
+	//
+	code = Py_CompileString(scriptString, "<string>", Py_file_input);
+	if (!code)
+	{
+		return nullptr;
+	}
+
+	// Another ref for the cache. Released again if it can't be cached.
+	//
+	Py_INCREF(code);
+	(void)EvalCacheInsert(cache, scriptString, (UINT_PTR)code, releaseEvalCode);
+	return code;
+}
+
 _Check_return_ HRESULT
 CPythonScriptProvider::RunString(
 	_In_z_ const char* scriptString)
@@ -302,6 +617,12 @@ CPythonScriptProvider::RunString(
     PyObject *m = nullptr;
 	PyObject *d = nullptr;
 	PyObject *v = nullptr;
+	PyObject *code = nullptr;
+	bool profiling = false;
+	PTP_TIMER abortTimer = nullptr;
+	LONG outerAbortRun = 0;
+
+	ClearTypedObjectIdentities();
 
 	// Returns borrowed ref.
 	//
@@ -316,9 +637,27 @@ CPythonScriptProvider::RunString(
 	//
     d = PyModule_GetDict(m);
 
+	abortTimer = startAbortChecks(&outerAbortRun);
+	profiling = startProfiling(hostCtxt);
+
+	// Repeated strings (e.g. breakpoint commands) are only compiled once.
 	// Returns a new ref.
 	//
-    v = PyRun_StringFlags(scriptString, Py_file_input, d, d, nullptr /* flags */);
+	code = getEvalCode(&EvalCodeCache, scriptString);
+
+	// Returns a new ref.
+	//
+	if (code)
+	{
+		v = PyEval_EvalCode(code, d, d);
+	}
+
+	if (profiling)
+	{
+		stopProfiling(hostCtxt);
+	}
+
+	stopAbortChecks(abortTimer, outerAbortRun);
 	
     if (!v)
 	{
@@ -355,6 +694,7 @@ exit:
 	// X is the checked version.
 	//
     Py_XDECREF(v);
+	Py_XDECREF(code);
 	return hr;
 }
 
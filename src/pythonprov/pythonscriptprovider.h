@@ -2,6 +2,7 @@
 #include <windows.h>
 
 #include <iscriptprovider.h>
+#include "../support/evalcache.h"
 
 class CPythonScriptProvider : public IScriptProvider
 {
@@ -17,6 +18,9 @@ public:
 	void
 	StopVM() override;
 
+	_Check_return_ HRESULT
+	ResetVM() override;
+
 	_Check_return_ HRESULT
 	Run(
 		_In_ int argc,
@@ -28,4 +32,14 @@ public:
 
 	void
 	Cleanup() override;
+
+private:
+
+	// sys.path as it was after the VM started. Restored by ResetVM.
+	//
+	PyObject* InitialSysPath;
+
+	// Code objects compiled by RunString.
+	//
+	EvalCache EvalCodeCache;
 };
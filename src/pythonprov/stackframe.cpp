@@ -167,6 +167,21 @@ static PyTypeObject StackFrameType =
 	sizeof(StackFrameObj)       /* tp_basicsize */
 };
 
+static PyObject*
+StackFrame_alloc(
+	_In_ PyTypeObject* type,
+	_In_ Py_ssize_t /* nitems */)
+{
+	return PyWrapperAlloc(type, &GetPythonProvGlobals()->StackFramePool);
+}
+
+static void
+StackFrame_free(
+	_In_ void* self)
+{
+	WrapperPoolFree(&GetPythonProvGlobals()->StackFramePool, self);
+}
+
 _Check_return_ bool
 InitStackFrameType()
 {
@@ -176,6 +191,9 @@ InitStackFrameType()
 	StackFrameType.tp_methods = StackFrame_MethodDef;
 	StackFrameType.tp_new = PyType_GenericNew;
 	StackFrameType.tp_dealloc = StackFrame_dealloc;
+	StackFrameType.tp_alloc = StackFrame_alloc;
+	StackFrameType.tp_free = StackFrame_free;
+	GetPythonProvGlobals()->StackFramePool.BlockSize = sizeof(StackFrameObj);
 
 	// Finalize the type definition.
 	//
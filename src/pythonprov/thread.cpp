@@ -211,6 +211,21 @@ static PyTypeObject ThreadType =
 	sizeof(ThreadObj)       /* tp_basicsize */
 };
 
+static PyObject*
+Thread_alloc(
+	_In_ PyTypeObject* type,
+	_In_ Py_ssize_t /* nitems */)
+{
+	return PyWrapperAlloc(type, &GetPythonProvGlobals()->ThreadPool);
+}
+
+static void
+Thread_free(
+	_In_ void* self)
+{
+	WrapperPoolFree(&GetPythonProvGlobals()->ThreadPool, self);
+}
+
 //------------------------------------------------------------------------------
 // Function: InitThreadType
 //
@@ -233,6 +248,9 @@ InitThreadType()
 	ThreadType.tp_members = Thread_MemberDef;
 	ThreadType.tp_methods = Thread_MethodDef;
 	ThreadType.tp_new = PyType_GenericNew;
+	ThreadType.tp_alloc = Thread_alloc;
+	ThreadType.tp_free = Thread_free;
+	GetPythonProvGlobals()->ThreadPool.BlockSize = sizeof(ThreadObj);
 
 	// Finalize the type definition.
 	//
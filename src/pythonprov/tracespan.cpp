@@ -0,0 +1,135 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: tracespan.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  TraceSpan class for Python Provider: a context manager that marks a span
+//  of the script on the timeline (see !runscript -timeline).
+//  
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************  
+
+#include "tracespan.h"
+#include "util.h"
+#include "common.h"
+#include "../support/timeline.h"
+
+struct TraceSpanObj
+{
+	PyObject_HEAD
+
+	// Name of the span. A str.
+	//
+	PyObject* Name;
+};
+
+static PyObject*
+TraceSpan_enter(
+	_In_ PyObject* self,
+	_In_ PyObject* /* args */)
+{
+	TraceSpanObj* span = (TraceSpanObj*)self;
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+
+	const char* name = PyUnicode_AsUTF8(span->Name);
+	if (!name)
+	{
+		return nullptr;
+	}
+
+	TimelineBeginSpan(hostCtxt, name);
+
+	Py_INCREF(self);
+	return self;
+}
+
+static PyObject*
+TraceSpan_exit(
+	_In_ PyObject* /* self */,
+	_In_ PyObject* /* args */)
+{
+	TimelineEndSpan(GetPythonProvGlobals()->HostCtxt);
+
+	// Don't swallow exceptions.
+	//
+	Py_RETURN_FALSE;
+}
+
+static void
+TraceSpan_dealloc(PyObject* self)
+{
+	TraceSpanObj* span = (TraceSpanObj*)self;
+
+	Py_XDECREF(span->Name);
+
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef TraceSpan_MethodDef[] =
+{
+	{
+		"__enter__",
+		TraceSpan_enter,
+		METH_NOARGS,
+		PyDoc_STR("Open the span.")
+	},
+	{
+		"__exit__",
+		TraceSpan_exit,
+		METH_VARARGS,
+		PyDoc_STR("Close the span.")
+	},
+	{ NULL }  /* Sentinel */
+};
+
+static PyTypeObject TraceSpanType =
+{
+	PyVarObject_HEAD_INIT(0, 0)
+	"dbgscript.TraceSpan",     /* tp_name */
+	sizeof(TraceSpanObj)       /* tp_basicsize */
+};
+
+_Check_return_ bool
+InitTraceSpanType()
+{
+	TraceSpanType.tp_flags = Py_TPFLAGS_DEFAULT;
+	TraceSpanType.tp_doc = PyDoc_STR("dbgscript.TraceSpan objects");
+	TraceSpanType.tp_methods = TraceSpan_MethodDef;
+	TraceSpanType.tp_new = PyType_GenericNew;
+	TraceSpanType.tp_dealloc = TraceSpan_dealloc;
+
+	// Finalize the type definition.
+	//
+	if (PyType_Ready(&TraceSpanType) < 0)
+	{
+		return false;
+	}
+	return true;
+}
+
+_Check_return_ PyObject*
+AllocTraceSpanObj(
+	_In_ PyObject* name)
+{
+	// Alloc a single instance of the TraceSpanType class. (Calls __new__())
+	// If the allocation fails, the allocator will set the appropriate exception
+	// internally. (i.e. OOM)
+	//
+	PyObject* obj = TraceSpanType.tp_new(&TraceSpanType, nullptr, nullptr);
+	if (!obj)
+	{
+		return nullptr;
+	}
+
+	// Take a ref on the name we're going to store.
+	//
+	Py_INCREF(name);
+	((TraceSpanObj*)obj)->Name = name;
+
+	return obj;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../common.h"
+#include <python.h>
+
+_Check_return_ bool
+InitTraceSpanType();
+
+_Check_return_ PyObject*
+AllocTraceSpanObj(
+	_In_ PyObject* name);
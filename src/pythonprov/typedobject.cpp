@@ -20,6 +20,7 @@
 #include <structmember.h>
 #include "process.h"
 #include "util.h"
+#include "../support/symcache.h"
 #include "common.h"
 
 struct TypedObject
@@ -29,6 +30,130 @@ struct TypedObject
 	DbgScriptTypedObject Data;
 };
 
+// Live TypedObjects by hash of their identity (see DsTypedDataHash). Borrowed
+// references: TypedObject_dealloc removes an object before it goes away.
+//
+static TypedObject* s_Identities[TYPED_OBJECT_IDENTITY_SLOTS];
+
+//------------------------------------------------------------------------------
+// Function: findIdentity
+//
+// Description:
+//
+//  Find a live TypedObject for the same object, with the same name.
+//
+// Parameters:
+//
+// Returns:
+//
+//  New reference, or nullptr if there's none.
+//
+// Notes:
+//
+static PyObject*
+findIdentity(
+	_In_z_ const char* name,
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	TypedObject* obj = s_Identities[
+		DsTypedDataHash(typedData) & (TYPED_OBJECT_IDENTITY_SLOTS - 1)];
+
+	if (obj &&
+		DsTypedDataSameObject(&obj->Data.TypedData, typedData) &&
+		!strcmp(obj->Data.Name, name))
+	{
+		Py_INCREF(obj);
+		return (PyObject*)obj;
+	}
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Function: rememberIdentity
+//
+// Description:
+//
+//  Make a new TypedObject the one findIdentity returns for its object.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+rememberIdentity(
+	_In_ TypedObject* obj)
+{
+	if (obj->Data.TypedDataValid)
+	{
+		s_Identities[
+			DsTypedDataHash(&obj->Data.TypedData) &
+			(TYPED_OBJECT_IDENTITY_SLOTS - 1)] = obj;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: internTypedObject
+//
+// Description:
+//
+//  Swap a newly initialized TypedObject for a live one for the same object,
+//  if there is one.
+//
+// Parameters:
+//
+//  obj - New TypedObject. Reference is stolen.
+//
+// Returns:
+//
+//  New reference to 'obj' or the live object.
+//
+// Notes:
+//
+static PyObject*
+internTypedObject(
+	_In_ PyObject* obj)
+{
+	TypedObject* typObj = (TypedObject*)obj;
+	if (!typObj->Data.TypedDataValid)
+	{
+		return obj;
+	}
+
+	PyObject* existing = findIdentity(typObj->Data.Name, &typObj->Data.TypedData);
+	if (existing)
+	{
+		Py_DECREF(obj);
+		return existing;
+	}
+
+	rememberIdentity(typObj);
+	return obj;
+}
+
+//------------------------------------------------------------------------------
+// Function: ClearTypedObjectIdentities
+//
+// Description:
+//
+//  Stop returning existing TypedObjects for new lookups.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Called at the start of each run. Target memory may have changed since the
+//  last one, and with it the values the live objects have cached.
+//
+void
+ClearTypedObjectIdentities()
+{
+	ZeroMemory(s_Identities, sizeof(s_Identities));
+}
+
 static PyMemberDef TypedObject_MemberDef[] =
 {
 	{ "size", T_ULONG, offsetof(TypedObject, Data.TypedData.Size), READONLY },
@@ -46,6 +171,38 @@ static PyTypeObject TypedObjectType =
 	sizeof(TypedObject)       /* tp_basicsize */
 };
 
+// Iterator returned by iter(obj) for arrays.
+//
+struct TypedObjectIterator
+{
+	PyObject_HEAD
+
+	DbgScriptArrayCursor Cursor;
+};
+
+static PyTypeObject TypedObjectIteratorType =
+{
+	PyVarObject_HEAD_INIT(0, 0)
+	"dbgscript.TypedObjectIterator",     /* tp_name */
+	sizeof(TypedObjectIterator)       /* tp_basicsize */
+};
+
+// Lazy view over a range of array elements, returned by obj[start:stop:step].
+//
+struct ArraySliceObj
+{
+	PyObject_HEAD
+
+	DbgScriptArraySlice Slice;
+};
+
+static PyTypeObject ArraySliceType =
+{
+	PyVarObject_HEAD_INIT(0, 0)
+	"dbgscript.ArraySlice",     /* tp_name */
+	sizeof(ArraySliceObj)       /* tp_basicsize */
+};
+
 // Call when you already have a DEBUG_TYPED_DATA you want wrapped in a TypedObject.
 //
 static _Check_return_ PyObject*
@@ -57,6 +214,14 @@ allocSubTypedObject(
 	PyObject* obj = nullptr;
 	PyObject* ret = nullptr;
 
+	// Walks often reach the same object again.
+	//
+	ret = findIdentity(name, typedData);
+	if (ret)
+	{
+		return ret;
+	}
+
 	// Alloc a single instance of the TypedObjectType class. (Calls __new__())
 	// If the allocation fails, the allocator will set the appropriate exception
 	// internally. (i.e. OOM)
@@ -77,6 +242,8 @@ allocSubTypedObject(
 		PyErr_Format(PyExc_RuntimeError, "DsWrapTypedData failed. Error 0x%08x.", hr);
 		goto exit;
 	}
+
+	rememberIdentity(typObj);
 	
 	// Transfer ownership on success.
 	//
@@ -206,6 +373,186 @@ exit:
 	return ret;
 }
 
+//------------------------------------------------------------------------------
+// Function: checkUnboundedSliceIndex
+//
+// Description:
+//
+//  Validate one index of a Python slice applied to an unbounded array slice
+//  (i.e. one over a pointer). Such slices have no length to resolve negative
+//  or omitted indices against.
+//
+// Returns:
+//
+//  true if valid. On failure, sets a Python exception and returns false.
+//
+static bool
+checkUnboundedSliceIndex(
+	_In_ PyObject* index,
+	_In_ bool required)
+{
+	if (index == Py_None)
+	{
+		if (required)
+		{
+			PyErr_SetString(PyExc_ValueError, "Slicing a pointer requires explicit bounds.");
+			return false;
+		}
+		return true;
+	}
+
+	const Py_ssize_t val = PyNumber_AsSsize_t(index, PyExc_IndexError);
+	if (val == -1 && PyErr_Occurred())
+	{
+		return false;
+	}
+
+	if (val < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "Slicing a pointer requires non-negative bounds.");
+		return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: narrowSlice
+//
+// Description:
+//
+//  Apply a Python slice object to an array slice, in place.
+//
+// Returns:
+//
+//  true on success. On failure, sets a Python exception and returns false.
+//
+static bool
+narrowSlice(
+	_Inout_ DbgScriptArraySlice* slice,
+	_In_ PyObject* key)
+{
+	Py_ssize_t start = 0;
+	Py_ssize_t stop = 0;
+	Py_ssize_t step = 0;
+	Py_ssize_t sliceLen = 0;
+	Py_ssize_t len = 0;
+
+	if (slice->Count == ARRAY_SLICE_UNBOUNDED)
+	{
+		// The buffer behind a pointer has no length. The stop index is always
+		// required, and so is the start index when walking backwards.
+		//
+		PySliceObject* pySlice = (PySliceObject*)key;
+		bool backwards = false;
+		if (pySlice->step != Py_None)
+		{
+			const Py_ssize_t stepVal = PyNumber_AsSsize_t(pySlice->step, PyExc_IndexError);
+			if (stepVal == -1 && PyErr_Occurred())
+			{
+				return false;
+			}
+			backwards = stepVal < 0;
+		}
+
+		if (!checkUnboundedSliceIndex(pySlice->start, backwards) ||
+			!checkUnboundedSliceIndex(pySlice->stop, true))
+		{
+			return false;
+		}
+
+		len = PY_SSIZE_T_MAX;
+	}
+	else
+	{
+		len = (Py_ssize_t)slice->Count;
+	}
+
+	if (PySlice_GetIndicesEx(key, len, &start, &stop, &step, &sliceLen) < 0)
+	{
+		return false;
+	}
+
+	HRESULT hr = DsArraySliceGetSubSlice(
+		slice,
+		start,
+		sliceLen,
+		step,
+		slice);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_IndexError, "DsArraySliceGetSubSlice failed. Error 0x%08x.", hr);
+		return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_get_slice
+//
+// Synopsis:
+// 
+//  obj[start:stop:step] -> ArraySlice
+//
+// Description:
+//
+//  Get a lazy view over a range of elements of an array or pointer. No memory
+//  is read until elements are requested from the view.
+//
+//  Pointers have no length, so the stop index must be given explicitly, and
+//  indices can't be negative.
+//  
+static PyObject*
+TypedObject_get_slice(
+	_In_ PyObject* self,
+	_In_ PyObject* key)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	TypedObject* typObj = (TypedObject*)self;
+	PyObject* sliceObj = nullptr;
+	PyObject* ret = nullptr;
+	HRESULT hr = S_OK;
+
+	if (!checkTypedData(typObj))
+	{
+		return nullptr;
+	}
+
+	sliceObj = ArraySliceType.tp_new(&ArraySliceType, nullptr, nullptr);
+	if (!sliceObj)
+	{
+		return nullptr;
+	}
+
+	DbgScriptArraySlice* slice = &((ArraySliceObj*)sliceObj)->Slice;
+
+	hr = DsArraySliceInit(hostCtxt, &typObj->Data, slice);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "DsArraySliceInit failed. Error 0x%08x.", hr);
+		goto exit;
+	}
+
+	if (!narrowSlice(slice, key))
+	{
+		goto exit;
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = sliceObj;
+	sliceObj = nullptr;
+
+exit:
+	if (sliceObj)
+	{
+		Py_DECREF(sliceObj);
+		sliceObj = nullptr;
+	}
+	return ret;
+}
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_mapping_subscript
 //
@@ -248,6 +595,10 @@ TypedObject_mapping_subscript(
 
 		return TypedObject_sequence_get_item(self, index);
 	}
+	else if (PySlice_Check(key))
+	{
+		return TypedObject_get_slice(self, key);
+	}
 
 	HRESULT hr = S_OK;
 	if (!PyUnicode_Check(key))
@@ -306,12 +657,12 @@ static PyMappingMethods TypedObject_MappingDef =
 
 static PyObject*
 pyValueFromCValue(
-	_In_ TypedObject* typObj)
+	_In_ DbgScriptTypedObject* typObj)
 {
-	assert(typObj->Data.ValueValid);
-	assert(typObj->Data.TypedDataValid);
-	const TypedObjectValue* cValue = &typObj->Data.Value;
-	DEBUG_TYPED_DATA* typedData = &typObj->Data.TypedData;
+	assert(typObj->ValueValid);
+	assert(typObj->TypedDataValid);
+	const TypedObjectValue* cValue = &typObj->Value;
+	DEBUG_TYPED_DATA* typedData = &typObj->TypedData;
 	PyObject* ret = nullptr;
 
 	if (typedData->Tag == SymTagPointerType)
@@ -380,13 +731,61 @@ pyValueFromCValue(
 		default:
 			PyErr_Format(PyExc_ValueError, "Unsupported type id: %d (%s)",
 				typedData->BaseTypeId,
-				typObj->Data.TypeName);
+				typObj->TypeName);
 			break;
 		}
 	}
 	return ret;
 }
 
+//------------------------------------------------------------------------------
+// Function: ensureValue
+//
+// Description:
+//
+//  Read the value of a primitive object from the target, unless it has already
+//  been fetched (e.g. by an array cursor reading ahead).
+//
+// Returns:
+//
+//  true on success. On failure, sets a Python exception and returns false.
+//
+static bool
+ensureValue(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptTypedObject* typObj)
+{
+	if (typObj->ValueValid)
+	{
+		return true;
+	}
+
+	// Read the appropriate size from memory.
+	//
+	// What primitive type is bigger than 8 bytes?
+	//
+	ULONG cbRead = 0;
+	assert(typObj->TypedData.Size <= 8);
+	HRESULT hr = UtilReadTypedData(
+		hostCtxt,
+		&typObj->TypedData,
+		&typObj->Value.Value,
+		sizeof(typObj->Value.Value),
+		&cbRead);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "Failed to read typed data. Error 0x%08x.", hr);
+		return false;
+	}
+	assert(cbRead == typObj->TypedData.Size);
+	
+	// Value has been populated.
+	//
+	typObj->ValueValid = true;
+
+	return true;
+}
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_str
 //
@@ -421,9 +820,14 @@ TypedObject_str(
 //
 // Description:
 //
-//  Virtual attribute getter for Typed Objects. First calls the generic attribute
-//  lookup routine. If that fails with an AttributeError, attempts a field
-//  lookup.
+//  Virtual attribute getter for Typed Objects. Attributes defined by the type
+//  (methods/members/getset) take precedence; anything else is a field lookup.
+//
+// Notes:
+//
+//  TypedObjects have no instance dictionary and can't be subclassed, so the
+//  type is all the generic lookup would consult. Checking it directly avoids
+//  raising (and formatting) an AttributeError for every field access.
 //
 static PyObject*
 TypedObject_getattro(
@@ -432,46 +836,18 @@ TypedObject_getattro(
 {
 	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
 
-	// First, call the generic attribute handler, to handle methods/members/getset.
-	// I.e. the usual Python stuff.
-	//
-	PyObject* ret = PyObject_GenericGetAttr(self, attr);
-	if (ret)
+	if (!PyUnicode_Check(attr) || _PyType_Lookup(Py_TYPE(self), attr))
 	{
-		// Success: No special handling, just pass through.
+		// The usual Python stuff.
 		//
-		return ret;
-	}
-
-	assert(PyErr_Occurred());
-
-	// If it was something other than an attribute error, pass it through.
-	// We don't want to swallow other error types.
-	//
-	if (!PyErr_ExceptionMatches(PyExc_AttributeError))
-	{
-		assert(!ret);
-		return nullptr;
+		return PyObject_GenericGetAttr(self, attr);
 	}
-	
-	// We got an attribute error: This means the attribute was not present.
-	// => attempt a struct field lookup.
-	//
-	
-	// Clear the attribute error.
-	//
-	PyErr_Clear();
 
-	// Get the key as an ANSI string.
+	// Attempt a struct field lookup. The UTF-8 form is cached in the string
+	// object, and attribute names are interned, so this doesn't allocate.
 	//
-	PyObject* asciiStrAsBytes = PyUnicode_AsASCIIString(attr);
-	if (!asciiStrAsBytes)
-	{
-		return nullptr;
-	}
-
-	const char* fieldName = PyBytes_AsString(asciiStrAsBytes);
-	if (!fieldName)
+	const char* fieldName = PyUnicode_AsUTF8(attr);
+	if (!fieldName)
 	{
 		return nullptr;
 	}
@@ -527,31 +903,12 @@ TypedObject_get_value(
 		return nullptr;
 	}
 
-	// Read the appropriate size from memory.
-	//
-	// What primitive type is bigger than 8 bytes?
-	//
-	ULONG cbRead = 0;
-	assert(typObj->Data.TypedData.Size <= 8);
-	HRESULT hr = hostCtxt->DebugSymbols->ReadTypedDataVirtual(
-		typObj->Data.TypedData.Offset,
-		typObj->Data.TypedData.ModBase,
-		typObj->Data.TypedData.TypeId,
-		&typObj->Data.Value.Value,
-		sizeof(typObj->Data.Value.Value),
-		&cbRead);
-	if (FAILED(hr))
+	if (!ensureValue(hostCtxt, &typObj->Data))
 	{
-		PyErr_Format(PyExc_RuntimeError, "Failed to read typed data. Error 0x%08x.", hr);
 		goto exit;
 	}
-	assert(cbRead == typObj->Data.TypedData.Size);
-	
-	// Value has been populated.
-	//
-	typObj->Data.ValueValid = true;
 
-	ret = pyValueFromCValue(typObj);
+	ret = pyValueFromCValue(&typObj->Data);
 
 exit:
 
@@ -590,25 +947,406 @@ TypedObject_sequence_length(
 		return -1;
 	}
 
-	// Get the zero'th item in order to get its size.
-	//
-	DEBUG_TYPED_DATA typedData = {0};
-	HRESULT hr = DsTypedObjectGetArrayElement(
+	UINT64 numElems = 0;
+	HRESULT hr = DsTypedObjectGetArrayLength(
 		hostCtxt,
 		&typObj->Data,
-		0,
-		&typedData);
+		&numElems);
 	if (FAILED(hr))
 	{
-		PyErr_Format(PyExc_RuntimeError, "DsTypedObjectGetArrayElement failed. Error 0x%08x.", hr);
+		PyErr_Format(PyExc_RuntimeError, "DsTypedObjectGetArrayLength failed. Error 0x%08x.", hr);
 		return -1;
 	}
 
-	const ULONG elemSize = typedData.Size;
+	return (Py_ssize_t)numElems;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObjectIterator_next
+//
+// Synopsis:
+// 
+//  next(it) -> TypedObject
+//
+// Description:
+//
+//  Return the next element of the array being iterated. Raises StopIteration
+//  once all elements have been returned.
+//
+static PyObject*
+TypedObjectIterator_next(
+	_In_ PyObject* self)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	TypedObjectIterator* iter = (TypedObjectIterator*)self;
+	PyObject* obj = nullptr;
+	PyObject* ret = nullptr;
+
+	obj = TypedObjectType.tp_new(&TypedObjectType, nullptr, nullptr);
+	if (!obj)
+	{
+		return nullptr;
+	}
+
+	HRESULT hr = DsArrayCursorNext(
+		hostCtxt,
+		&iter->Cursor,
+		&((TypedObject*)obj)->Data);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+		goto exit;
+	}
+	else if (hr == S_FALSE)
+	{
+		// Exhausted. Returning null without an exception set signals
+		// StopIteration.
+		//
+		goto exit;
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = internTypedObject(obj);
+	obj = nullptr;
+
+exit:
+	if (obj)
+	{
+		Py_DECREF(obj);
+		obj = nullptr;
+	}
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_iter
+//
+// Synopsis:
+// 
+//  iter(obj) -> iterator
+//
+// Description:
+//
+//  Return an iterator over the elements of an array. Throws if object is not
+//  an array.
+//
+// Notes:
+//
+//  Only the first element is resolved through the debugger engine, so this is
+//  much cheaper than indexing each element in turn.
+//
+static PyObject*
+TypedObject_iter(
+	_In_ PyObject* self)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
 
-	return typObj->Data.TypedData.Size / elemSize;
+	TypedObject* typObj = (TypedObject*)self;
+	PyObject* iter = nullptr;
+	PyObject* ret = nullptr;
+	HRESULT hr = S_OK;
+
+	if (!checkTypedData(typObj))
+	{
+		return nullptr;
+	}
+
+	if (typObj->Data.TypedData.Tag != SymTagArrayType)
+	{
+		// Not array. Pointers have no length, so we can't know when to stop.
+		//
+		PyErr_SetString(PyExc_ValueError, "Object not array.");
+		return nullptr;
+	}
+
+	iter = TypedObjectIteratorType.tp_new(&TypedObjectIteratorType, nullptr, nullptr);
+	if (!iter)
+	{
+		return nullptr;
+	}
+
+	hr = DsArrayCursorInit(
+		hostCtxt,
+		&typObj->Data,
+		&((TypedObjectIterator*)iter)->Cursor);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "DsArrayCursorInit failed. Error 0x%08x.", hr);
+		goto exit;
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = iter;
+	iter = nullptr;
+
+exit:
+	if (iter)
+	{
+		Py_DECREF(iter);
+		iter = nullptr;
+	}
+	return ret;
 }
 
+//------------------------------------------------------------------------------
+// Function: ArraySlice_sequence_length
+//
+// Synopsis:
+// 
+//  len(slice) -> int
+//
+// Description:
+//
+//  Return the number of elements in the view.
+//
+static Py_ssize_t
+ArraySlice_sequence_length(
+	_In_ PyObject* self)
+{
+	ArraySliceObj* sliceObj = (ArraySliceObj*)self;
+
+	return (Py_ssize_t)sliceObj->Slice.Count;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_mapping_subscript
+//
+// Synopsis:
+// 
+//  slice[index] -> TypedObject
+//  slice[start:stop:step] -> ArraySlice
+//
+// Description:
+//
+//  Get an element of the view, or a narrower view. Negative indices count
+//  from the end of the view. Only elements of primitive type are resolved
+//  through DbgEng.
+//  
+static PyObject*
+ArraySlice_mapping_subscript(
+	_In_ PyObject* self,
+	_In_ PyObject* key)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	ArraySliceObj* sliceObj = (ArraySliceObj*)self;
+	PyObject* obj = nullptr;
+	PyObject* ret = nullptr;
+
+	if (PySlice_Check(key))
+	{
+		obj = ArraySliceType.tp_new(&ArraySliceType, nullptr, nullptr);
+		if (!obj)
+		{
+			return nullptr;
+		}
+
+		ArraySliceObj* newSliceObj = (ArraySliceObj*)obj;
+		newSliceObj->Slice = sliceObj->Slice;
+
+		if (!narrowSlice(&newSliceObj->Slice, key))
+		{
+			goto exit;
+		}
+	}
+	else
+	{
+		Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
+		if (index == -1 && PyErr_Occurred())
+		{
+			return nullptr;
+		}
+
+		if (index < 0)
+		{
+			index += (Py_ssize_t)sliceObj->Slice.Count;
+		}
+
+		if (index < 0 || (UINT64)index >= sliceObj->Slice.Count)
+		{
+			PyErr_SetString(PyExc_IndexError, "Index out of range.");
+			return nullptr;
+		}
+
+		obj = TypedObjectType.tp_new(&TypedObjectType, nullptr, nullptr);
+		if (!obj)
+		{
+			return nullptr;
+		}
+
+		HRESULT hr = DsArraySliceGetElement(
+			GetPythonProvGlobals()->HostCtxt,
+			&sliceObj->Slice,
+			index,
+			&((TypedObject*)obj)->Data);
+		if (FAILED(hr))
+		{
+			PyErr_Format(PyExc_RuntimeError, "DsArraySliceGetElement failed. Error 0x%08x.", hr);
+			goto exit;
+		}
+
+		obj = internTypedObject(obj);
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = obj;
+	obj = nullptr;
+
+exit:
+	if (obj)
+	{
+		Py_DECREF(obj);
+		obj = nullptr;
+	}
+	return ret;
+}
+
+static PyMappingMethods ArraySlice_MappingDef =
+{
+	ArraySlice_sequence_length,  // mp_length
+	ArraySlice_mapping_subscript,  // mp_subscript
+	nullptr   // mp_ass_subscript
+};
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_iter
+//
+// Synopsis:
+// 
+//  iter(slice) -> iterator
+//
+// Description:
+//
+//  Return an iterator over the elements of the view.
+//
+static PyObject*
+ArraySlice_iter(
+	_In_ PyObject* self)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	ArraySliceObj* sliceObj = (ArraySliceObj*)self;
+
+	PyObject* iter = TypedObjectIteratorType.tp_new(
+		&TypedObjectIteratorType, nullptr, nullptr);
+	if (!iter)
+	{
+		return nullptr;
+	}
+
+	DsArrayCursorInitFromSlice(
+		&sliceObj->Slice,
+		&((TypedObjectIterator*)iter)->Cursor);
+
+	return iter;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_values
+//
+// Synopsis:
+// 
+//  slice.values() -> list
+//
+// Description:
+//
+//  Return the values of all elements in the view as a list. Throws if the
+//  elements are not of a primitive type.
+//
+// Notes:
+//
+//  Values are read from the target in bulk, and no TypedObjects are created,
+//  which makes this the fastest way to extract an array of primitives.
+//
+static PyObject*
+ArraySlice_values(
+	_In_ PyObject* self,
+	_In_ PyObject* /* args */)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	ArraySliceObj* sliceObj = (ArraySliceObj*)self;
+	PyObject* list = nullptr;
+	PyObject* ret = nullptr;
+	DbgScriptArrayCursor cursor;
+	DbgScriptTypedObject elem;
+	Py_ssize_t i = 0;
+	HRESULT hr = S_OK;
+
+	if (!DsTypedObjectIsPrimitive(&sliceObj->Slice.Elem))
+	{
+		PyErr_SetString(PyExc_ValueError, "Not a primitive type.");
+		return nullptr;
+	}
+
+	list = PyList_New((Py_ssize_t)sliceObj->Slice.Count);
+	if (!list)
+	{
+		return nullptr;
+	}
+
+	DsArrayCursorInitFromSlice(&sliceObj->Slice, &cursor);
+
+	while ((hr = DsArrayCursorNext(hostCtxt, &cursor, &elem)) == S_OK)
+	{
+		if (UtilCheckAbort(hostCtxt))
+		{
+			PyErr_SetNone(PyExc_KeyboardInterrupt);
+			goto exit;
+		}
+
+		if (!ensureValue(hostCtxt, &elem))
+		{
+			goto exit;
+		}
+
+		PyObject* value = pyValueFromCValue(&elem);
+		if (!value)
+		{
+			goto exit;
+		}
+
+		// Steals reference.
+		//
+		PyList_SET_ITEM(list, i++, value);
+	}
+
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+		goto exit;
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = list;
+	list = nullptr;
+
+exit:
+	Py_XDECREF(list);
+	return ret;
+}
+
+static PyMethodDef ArraySlice_MethodDef[] =
+{
+	{
+		"values",
+		ArraySlice_values,
+		METH_NOARGS,
+		PyDoc_STR("Return the values of all elements as a list.")
+	},
+	{ NULL }  /* Sentinel */
+};
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_read_wide_string
 //
@@ -778,7 +1516,126 @@ TypedObject_get_runtime_obj(
 		goto exit;
 	}
 
-	ret = newObj;
+	ret = internTypedObject(newObj);
+	
+exit:
+	if (FAILED(hr))
+	{
+		Py_XDECREF(newObj);
+	}
+	
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_cast
+//
+// Synopsis:
+// 
+//  obj.cast(type) -> TypedObject
+//
+// Description:
+//
+//  Reinterpret the object's memory as 'type', like a C cast of its address.
+//
+// Notes:
+//
+//  Only the first cast to a given aggregate type issues DbgEng requests.
+//
+static PyObject*
+TypedObject_cast(
+	_In_ PyObject* self,
+	_In_ PyObject* args)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	TypedObject* typObj = (TypedObject*)self;
+	const char* typeName = nullptr;
+
+	if (!PyArg_ParseTuple(args, "s:cast", &typeName))
+	{
+		return nullptr;
+	}
+
+	if (!checkTypedData(typObj))
+	{
+		return nullptr;
+	}
+
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, typeName);
+	if (!typeInfo)
+	{
+		PyErr_Format(PyExc_ValueError, "Failed to get type id for type '%s'.", typeName);
+		return nullptr;
+	}
+
+	return AllocTypedObject(
+		0,
+		typObj->Data.Name,
+		typeInfo->TypeId,
+		typeInfo->ModuleBase,
+		typObj->Data.TypedData.Offset,
+		false /* wantPointer */);
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_offset
+//
+// Synopsis:
+// 
+//  obj.offset(n) -> TypedObject
+//
+// Description:
+//
+//  Pointer arithmetic. If 'obj' is a pointer, returns a pointer advanced by 'n'
+//  elements. Otherwise returns the object of the same type 'n' elements away,
+//  as if 'obj' were an element of an array.
+//
+// Notes:
+//
+//  Computed locally; at most one DbgEng request per pointer type.
+//
+static PyObject*
+TypedObject_offset(
+	_In_ PyObject* self,
+	_In_ PyObject* args)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	TypedObject* typObj = (TypedObject*)self;
+	PyObject* ret = nullptr;
+	HRESULT hr = S_OK;
+	INT64 count = 0;
+	CHECK_ABORT(hostCtxt);
+
+	if (!PyArg_ParseTuple(args, "L:offset", &count))
+	{
+		return nullptr;
+	}
+
+	if (!checkTypedData(typObj))
+	{
+		return nullptr;
+	}
+	
+	PyObject* newObj = TypedObjectType.tp_new(
+		&TypedObjectType,
+		nullptr,
+		nullptr);
+	if (!newObj)
+	{
+		return nullptr;
+	}
+
+	hr = DsTypedObjectOffset(
+		hostCtxt, &typObj->Data, count, &((TypedObject*)newObj)->Data);
+	if (FAILED(hr))
+	{
+		PyErr_Format(PyExc_RuntimeError, "DsTypedObjectOffset failed. Error 0x%08x.", hr);
+		goto exit;
+	}
+
+	ret = internTypedObject(newObj);
 	
 exit:
 	if (FAILED(hr))
@@ -816,6 +1673,18 @@ static PyMethodDef TypedObject_MethodDef[] =
 		METH_NOARGS,
 		PyDoc_STR("Return the runtime type of this object as a new typed object.")
 	},
+	{
+		"cast",
+		TypedObject_cast,
+		METH_VARARGS,
+		PyDoc_STR("Reinterpret this object's memory as another type.")
+	},
+	{
+		"offset",
+		TypedObject_offset,
+		METH_VARARGS,
+		PyDoc_STR("Return the object (or pointer) a number of elements away from this one.")
+	},
 	{
 		"read_wide_string",
 		TypedObject_read_wide_string,
@@ -837,6 +1706,89 @@ static PyMethodDef TypedObject_MethodDef[] =
 	{ NULL }  /* Sentinel */
 };
 
+static void
+TypedObject_dealloc(
+	_In_ PyObject* self)
+{
+	TypedObject* typObj = (TypedObject*)self;
+
+	if (typObj->Data.TypedDataValid)
+	{
+		TypedObject** slot = &s_Identities[
+			DsTypedDataHash(&typObj->Data.TypedData) &
+			(TYPED_OBJECT_IDENTITY_SLOTS - 1)];
+		if (*slot == typObj)
+		{
+			*slot = nullptr;
+		}
+	}
+
+	Py_TYPE(self)->tp_free(self);
+}
+
+// Hash consistent with TypedObject_richcompare: objects of the same type at the
+// same address hash alike.
+//
+static Py_hash_t
+TypedObject_hash(
+	_In_ PyObject* self)
+{
+	TypedObject* typObj = (TypedObject*)self;
+
+	if (!typObj->Data.TypedDataValid)
+	{
+		return _Py_HashPointer(self);
+	}
+
+	const Py_hash_t hash = (Py_hash_t)DsTypedDataHash(&typObj->Data.TypedData);
+	return hash == -1 ? -2 : hash;
+}
+
+// TypedObjects are equal if they're the same type at the same address,
+// whatever their names. Objects without typed data only equal themselves.
+//
+static PyObject*
+TypedObject_richcompare(
+	_In_ PyObject* self,
+	_In_ PyObject* other,
+	_In_ int op)
+{
+	if ((op != Py_EQ && op != Py_NE) || !PyObject_TypeCheck(other, &TypedObjectType))
+	{
+		Py_RETURN_NOTIMPLEMENTED;
+	}
+
+	TypedObject* a = (TypedObject*)self;
+	TypedObject* b = (TypedObject*)other;
+	bool equal = self == other;
+
+	if (!equal && a->Data.TypedDataValid && b->Data.TypedDataValid)
+	{
+		equal = DsTypedDataSameObject(&a->Data.TypedData, &b->Data.TypedData);
+	}
+
+	if (op == Py_NE)
+	{
+		equal = !equal;
+	}
+	return PyBool_FromLong(equal);
+}
+
+static PyObject*
+TypedObject_alloc(
+	_In_ PyTypeObject* type,
+	_In_ Py_ssize_t /* nitems */)
+{
+	return PyWrapperAlloc(type, &GetPythonProvGlobals()->TypedObjectPool);
+}
+
+static void
+TypedObject_free(
+	_In_ void* self)
+{
+	WrapperPoolFree(&GetPythonProvGlobals()->TypedObjectPool, self);
+}
+
 _Check_return_ bool
 InitTypedObjectType()
 {
@@ -850,17 +1802,49 @@ InitTypedObjectType()
 	TypedObjectType.tp_methods = TypedObject_MethodDef;
 	TypedObjectType.tp_getset = TypedObject_GetSetDef;
 	TypedObjectType.tp_new = PyType_GenericNew;
+	TypedObjectType.tp_alloc = TypedObject_alloc;
+	TypedObjectType.tp_free = TypedObject_free;
+	TypedObjectType.tp_dealloc = TypedObject_dealloc;
+	TypedObjectType.tp_hash = TypedObject_hash;
+	TypedObjectType.tp_richcompare = TypedObject_richcompare;
 	TypedObjectType.tp_str = TypedObject_str;
 	TypedObjectType.tp_as_mapping = &TypedObject_MappingDef;
 	TypedObjectType.tp_as_sequence = &s_SequenceMethodsDef;
 	TypedObjectType.tp_getattro = TypedObject_getattro;
-
-	// Finalize the type definition.
+	TypedObjectType.tp_iter = TypedObject_iter;
+	GetPythonProvGlobals()->TypedObjectPool.BlockSize = sizeof(TypedObject);
+
+	TypedObjectIteratorType.tp_flags = Py_TPFLAGS_DEFAULT;
+	TypedObjectIteratorType.tp_doc = PyDoc_STR("dbgscript.TypedObject array iterator");
+	TypedObjectIteratorType.tp_new = PyType_GenericNew;
+	TypedObjectIteratorType.tp_iter = PyObject_SelfIter;
+	TypedObjectIteratorType.tp_iternext = TypedObjectIterator_next;
+
+	static PySequenceMethods s_SliceSequenceMethodsDef;
+	s_SliceSequenceMethodsDef.sq_length = ArraySlice_sequence_length;
+
+	ArraySliceType.tp_flags = Py_TPFLAGS_DEFAULT;
+	ArraySliceType.tp_doc = PyDoc_STR("dbgscript.ArraySlice objects");
+	ArraySliceType.tp_methods = ArraySlice_MethodDef;
+	ArraySliceType.tp_new = PyType_GenericNew;
+	ArraySliceType.tp_as_mapping = &ArraySlice_MappingDef;
+	ArraySliceType.tp_as_sequence = &s_SliceSequenceMethodsDef;
+	ArraySliceType.tp_iter = ArraySlice_iter;
+
+	// Finalize the type definitions.
 	//
 	if (PyType_Ready(&TypedObjectType) < 0)
 	{
 		return false;
 	}
+	if (PyType_Ready(&TypedObjectIteratorType) < 0)
+	{
+		return false;
+	}
+	if (PyType_Ready(&ArraySliceType) < 0)
+	{
+		return false;
+	}
 	return true;
 }
 
@@ -913,7 +1897,7 @@ AllocTypedObject(
 	
 	// Transfer ownership on success.
 	//
-	ret = obj;
+	ret = internTypedObject(obj);
 	obj = nullptr;
 
 exit:
@@ -925,3 +1909,119 @@ exit:
 	}
 	return ret;
 }
+
+//------------------------------------------------------------------------------
+// Function: GetRuntimeObjects
+//
+// Description:
+//
+//  Batch version of TypedObject.get_runtime_obj. Resolve the runtime type of
+//  each object in a sequence.
+//
+// Parameters:
+//
+//  objs - Sequence of TypedObjects.
+//
+// Returns:
+//
+//  New list with the downcast object for each input, or None where the object
+//  has no vtable (or no typed data).
+//
+// Notes:
+//
+//  Vtable lookups are cached, so this costs little more than reading each
+//  object's vptr.
+//
+_Check_return_ PyObject*
+GetRuntimeObjects(
+	_In_ PyObject* objs)
+{
+	DbgScriptHostContext* hostCtxt = GetPythonProvGlobals()->HostCtxt;
+	PyObject* seq = nullptr;
+	PyObject* list = nullptr;
+	PyObject* ret = nullptr;
+	Py_ssize_t len = 0;
+	
+	seq = PySequence_Fast(objs, "expected a sequence of TypedObjects");
+	if (!seq)
+	{
+		return nullptr;
+	}
+
+	len = PySequence_Fast_GET_SIZE(seq);
+
+	list = PyList_New(len);
+	if (!list)
+	{
+		goto exit;
+	}
+
+	for (Py_ssize_t i = 0; i < len; ++i)
+	{
+		if (UtilCheckAbort(hostCtxt))
+		{
+			PyErr_SetNone(PyExc_KeyboardInterrupt);
+			goto exit;
+		}
+
+		PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+		if (!PyObject_TypeCheck(item, &TypedObjectType))
+		{
+			PyErr_SetString(PyExc_TypeError, "expected a sequence of TypedObjects");
+			goto exit;
+		}
+
+		TypedObject* typObj = (TypedObject*)item;
+		PyObject* result = Py_None;
+
+		if (typObj->Data.TypedDataValid)
+		{
+			PyObject* newObj = TypedObjectType.tp_new(
+				&TypedObjectType,
+				nullptr,
+				nullptr);
+			if (!newObj)
+			{
+				goto exit;
+			}
+
+			HRESULT hr = DsTypedObjectTryGetRuntimeType(
+				hostCtxt, &typObj->Data, &((TypedObject*)newObj)->Data);
+			if (FAILED(hr))
+			{
+				Py_DECREF(newObj);
+				PyErr_Format(PyExc_RuntimeError, "DsTypedObjectTryGetRuntimeType failed. Error 0x%08x.", hr);
+				goto exit;
+			}
+			else if (hr == S_OK)
+			{
+				result = internTypedObject(newObj);
+			}
+			else
+			{
+				// No vtable.
+				//
+				Py_DECREF(newObj);
+			}
+		}
+
+		if (result == Py_None)
+		{
+			Py_INCREF(Py_None);
+		}
+
+		// Steals the reference.
+		//
+		PyList_SET_ITEM(list, i, result);
+	}
+
+	// Transfer ownership on success.
+	//
+	ret = list;
+	list = nullptr;
+
+exit:
+	Py_XDECREF(list);
+	Py_DECREF(seq);
+	return ret;
+}
@@ -14,3 +14,10 @@ AllocTypedObject(
 	_In_ UINT64 moduleBase,
 	_In_ UINT64 virtualAddress,
 	_In_ bool wantPointer);
+
+void
+ClearTypedObjectIdentities();
+
+_Check_return_ PyObject*
+GetRuntimeObjects(
+	_In_ PyObject* objs);
@@ -26,6 +26,39 @@ RedirectStdIO(
 	PySys_SetObject("__stdin__", obj);
 }
 
+//------------------------------------------------------------------------------
+// Function: PyWrapperAlloc
+//
+// Description:
+//
+//  Allocate a TypedObject, Thread or StackFrame from its type's pool. Used as
+//  the types' tp_alloc, with WrapperPoolFree as their tp_free.
+//
+// Parameters:
+//
+// Returns:
+//
+//  New reference, zeroed apart from the object header.
+//
+// Notes:
+//
+//  The types aren't heap types or GC-tracked, so no reference is taken on the
+//  type and no GC header is needed.
+//
+PyObject*
+PyWrapperAlloc(
+	_In_ PyTypeObject* type,
+	_Inout_ WrapperPool* pool)
+{
+	void* block = WrapperPoolAlloc(GetPythonProvGlobals()->HostCtxt, pool);
+	if (!block)
+	{
+		return PyErr_NoMemory();
+	}
+
+	return PyObject_Init((PyObject*)block, type);
+}
+
 //------------------------------------------------------------------------------
 // Function: PyReadBytes
 //
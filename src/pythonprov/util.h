@@ -2,6 +2,7 @@
 
 #include <python.h>
 #include "../support/util.h"
+#include "../support/stats.h"
 
 // Attribute is read-only.
 //
@@ -13,6 +14,13 @@ void
 RedirectStdIO(
 	_In_ PyObject* obj);
 
+struct WrapperPool;
+
+PyObject*
+PyWrapperAlloc(
+	_In_ PyTypeObject* type,
+	_Inout_ WrapperPool* pool);
+
 PyObject*
 PyReadBytes(
 	_In_ UINT64 addr,
@@ -29,10 +37,12 @@ PyReadWideString(
 	_In_ int count);
 
 // Helper macro to call in every Python entry point that checks for abort
-// and raises a KeyboardInterrupt exception.
+// and raises a KeyboardInterrupt exception. Also counts the call when
+// collecting statistics (see stats.h).
 //
 #define CHECK_ABORT(ctxt) \
 	do { \
+		StatsCountApi(ctxt, __FUNCTION__); \
 		if (UtilCheckAbort(ctxt)) \
 		{ \
 			PyErr_SetNone(PyExc_KeyboardInterrupt); \
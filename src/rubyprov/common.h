@@ -7,7 +7,10 @@
 
 #include <hostcontext.h>
 #include "../support/util.h"
+#include "../support/stats.h"
 #include "../support/symcache.h"
+#include "../support/evalcache.h"
+#include "../support/wrapperpool.h"
 #include "util.h"
 
 struct RubyProvGlobals
@@ -31,16 +34,45 @@ struct RubyProvGlobals
 	// Ruby DbgScript::TypedObject class.
 	//
 	VALUE TypedObjectClass;
+	
+	// Ruby DbgScript::ArraySlice class.
+	//
+	VALUE ArraySliceClass;
+
+	// Tracepoint that raises Interrupt in the running script. Enabled once
+	// the abort timer finds the user asked to abort.
+	//
+	VALUE AbortTracepoint;
+
+	// Strings compiled by RunString, and their instruction sequences, indexed
+	// by EvalCache slot.
+	//
+	EvalCache EvalIseqCache;
+
+	VALUE EvalIseqs;
+
+	// Recent TypedObjects, indexed by hash of their identity (see
+	// DsTypedDataHash). Emptied at the start of each run.
+	//
+	VALUE Identities;
+
+	// Freed wrapper objects, for reuse.
+	//
+	WrapperPool TypedObjectPool;
+	WrapperPool ThreadPool;
+	WrapperPool StackFramePool;
 };
 
 _Check_return_ RubyProvGlobals*
 GetRubyProvGlobals();
 
 // Helper macro to call in every Python entry point that checks for abort
-// and raises a KeyboardInterrupt exception.
+// and raises a KeyboardInterrupt exception. Also counts the call when
+// collecting statistics (see stats.h).
 //
 #define CHECK_ABORT(ctxt) \
 	do { \
+		StatsCountApi(ctxt, __FUNCTION__); \
 		if (UtilCheckAbort(ctxt)) \
 		{ \
 			rb_raise(rb_eInterrupt, "Execution interrupted."); \
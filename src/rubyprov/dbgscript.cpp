@@ -16,6 +16,7 @@
 #include "common.h"
 #include "typedobject.h"
 #include "thread.h"
+#include "../support/timeline.h"
 
 //------------------------------------------------------------------------------
 // Function: DbgScript_read_ptr
@@ -287,6 +288,108 @@ DbgScript_get_nearest_sym(
 	return rb_str_new2(name);
 }
 
+// Context threaded through UtilGetNearestSymbols for get_nearest_syms.
+//
+struct NearestSymsCtxt
+{
+	DbgScriptHostContext* HostCtxt;
+	VALUE Results;
+};
+
+//------------------------------------------------------------------------------
+// Function: nearestSymsCallback
+//
+// Description:
+//
+//  Store one result of UtilGetNearestSymbols into the result array.
+//
+// Parameters:
+//
+//  idx - Index of the address.
+//  name - Symbol name, or null if resolution failed.
+//  userctxt - NearestSymsCtxt.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+nearestSymsCallback(
+	_In_ ULONG idx,
+	_In_opt_z_ const char* name,
+	_In_opt_ void* userctxt)
+{
+	NearestSymsCtxt* ctxt = (NearestSymsCtxt*)userctxt;
+
+	if (UtilCheckAbort(ctxt->HostCtxt))
+	{
+		return E_ABORT;
+	}
+
+	rb_ary_store(ctxt->Results, idx, name ? rb_str_new2(name) : Qnil);
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: DbgScript_get_nearest_syms
+//
+// Synopsis:
+//
+//  DbgScript.get_nearest_syms(addrs) -> Array
+//
+// Description:
+//
+//  Batch version of get_nearest_sym. Returns an array with the nearest symbol
+//  name of each address in 'addrs', or nil where no symbol was found.
+//
+static VALUE
+DbgScript_get_nearest_syms(
+	_In_ VALUE /* self */,
+	_In_ VALUE addrs)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	Check_Type(addrs, T_ARRAY);
+
+	const long len = RARRAY_LEN(addrs);
+	NearestSymsCtxt ctxt = {};
+	ctxt.HostCtxt = hostCtxt;
+	ctxt.Results = rb_ary_new2(len);
+
+	// Validate all addresses up front so that a bad element raises before
+	// the native buffer is allocated.
+	//
+	for (long i = 0; i < len; ++i)
+	{
+		(void)NUM2ULL(rb_ary_entry(addrs, i));
+	}
+
+	UINT64* ui64Addrs = new UINT64[len ? len : 1];
+	for (long i = 0; i < len; ++i)
+	{
+		ui64Addrs[i] = NUM2ULL(rb_ary_entry(addrs, i));
+	}
+
+	HRESULT hr = UtilGetNearestSymbols(
+		hostCtxt, (ULONG)len, ui64Addrs, nearestSymsCallback, &ctxt);
+
+	delete[] ui64Addrs;
+
+	if (hr == E_ABORT)
+	{
+		rb_raise(rb_eInterrupt, "Execution interrupted.");
+	}
+	else if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "UtilGetNearestSymbols failed. Error: 0x%08x", hr);
+	}
+
+	return ctxt.Results;
+}
+
 //------------------------------------------------------------------------------
 // Function: DbgScript_search_memory
 //
@@ -322,7 +425,8 @@ DbgScript_search_memory(
 	const UINT64 ui64Size = NUM2ULL(size);
 	const ULONG patGran = NUM2ULONG(pattern_granularity);
 
-	HRESULT hr = hostCtxt->DebugDataSpaces->SearchVirtual(
+	HRESULT hr = UtilSearchMemory(
+		hostCtxt,
 		ui64Start,
 		ui64Size,
 		StringValuePtr(pattern),
@@ -373,18 +477,7 @@ DbgScript_resolve_enum(
 	UINT64 value = NUM2ULL(val);
 	char enumElementName[MAX_SYMBOL_NAME_LEN] = {};
 
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, enumTypeName);
-	if (!typeInfo)
-	{
-		rb_raise(rb_eArgError, "Failed to get type id for type '%s'.", enumTypeName);
-	}
-
-	HRESULT hr = hostCtxt->DebugSymbols->GetConstantName(
-		typeInfo->ModuleBase,
-		typeInfo->TypeId,
-		value,
-		STRING_AND_CCH(enumElementName),
-		nullptr);
+	HRESULT hr = UtilResolveEnum(hostCtxt, enumTypeName, value, enumElementName);
 	if (FAILED(hr))
 	{
 		rb_raise(rb_eArgError, "Failed to get element name for enum '%s' with value '%llu'. Error 0x%08x.", enumTypeName, value, hr);
@@ -700,6 +793,189 @@ DbgScript_create_typed_pointer(
 	return createTypedObjectHelper(type, addr, true /* wantPointer */);
 }
 
+//------------------------------------------------------------------------------
+// Function: DbgScript_container_of
+//
+// Synopsis:
+//
+//  DbgScript.container_of(address, type, field) -> TypedObject
+//
+// Description:
+//
+//  Create a TypedObject of type 'type' given the address of its field 'field'.
+//  Equivalent to the CONTAINING_RECORD macro.
+//
+// Notes:
+//
+//  Only the first use of a type and field issues DbgEng requests.
+//
+static VALUE
+DbgScript_container_of(
+	_In_ VALUE /* self */,
+	_In_ VALUE addr,
+	_In_ VALUE type,
+	_In_ VALUE field)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	const UINT64 ui64Addr = NUM2ULL(addr);
+	const char* szType = StringValuePtr(type);
+	const char* szField = StringValuePtr(field);
+
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, szType);
+	if (!typeInfo)
+	{
+		rb_raise(rb_eArgError, "Failed to get type id for type '%s'.", szType);
+	}
+
+	ULONG offset = 0;
+	HRESULT hr = GetCachedFieldOffset(hostCtxt, *typeInfo, szField, &offset);
+	if (FAILED(hr))
+	{
+		rb_raise(
+			rb_eArgError,
+			"Failed to get field offset for type '%s' and field '%s'. Error 0x%08x.",
+			szType,
+			szField,
+			hr);
+	}
+
+	return AllocTypedObject(
+		0 /* size */,
+		nullptr /* name */,
+		typeInfo->TypeId,
+		typeInfo->ModuleBase,
+		ui64Addr - offset,
+		false /* wantPointer */);
+}
+
+//------------------------------------------------------------------------------
+// Function: DbgScript_get_runtime_objs
+//
+// Synopsis:
+//
+//  DbgScript.get_runtime_objs(objs) -> Array
+//
+// Description:
+//
+//  Batch version of TypedObject#get_runtime_obj. Returns an array with the
+//  downcast object for each TypedObject in 'objs', or nil where an object
+//  has no vtable.
+//
+static VALUE
+DbgScript_get_runtime_objs(
+	_In_ VALUE /* self */,
+	_In_ VALUE objs)
+{
+	return GetRuntimeObjects(objs);
+}
+
+//------------------------------------------------------------------------------
+// Function: addStatToHash
+//
+// Description:
+//
+//  StatsEnumerate callback to add a statistic to a Hash.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+addStatToHash(
+	_In_z_ const char* name,
+	_In_ UINT64 value,
+	_In_opt_ void* ctxt)
+{
+	rb_hash_aset(*(VALUE*)ctxt, rb_str_new2(name), ULL2NUM(value));
+}
+
+//------------------------------------------------------------------------------
+// Function: DbgScript_stats
+//
+// Synopsis:
+//
+//  DbgScript.stats -> Hash or nil
+//
+// Description:
+//
+//  Return the statistics collected so far (see !dbgscriptstats) as a Hash of
+//  name to value, or nil if not collecting.
+//
+static VALUE
+DbgScript_stats(
+	_In_ VALUE /* self */)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	VALUE hash = rb_hash_new();
+	if (!StatsEnumerate(hostCtxt, addStatToHash, &hash))
+	{
+		return Qnil;
+	}
+
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: traceSpanBody
+//
+// Description:
+//
+//  Body of DbgScript.trace_span: yield to the block.
+//
+static VALUE
+traceSpanBody(
+	_In_ VALUE /* arg */)
+{
+	return rb_yield_values(0);
+}
+
+//------------------------------------------------------------------------------
+// Function: traceSpanEnsure
+//
+// Description:
+//
+//  Ensure clause of DbgScript.trace_span: close the span.
+//
+static VALUE
+traceSpanEnsure(
+	_In_ VALUE /* arg */)
+{
+	TimelineEndSpan(GetRubyProvGlobals()->HostCtxt);
+	return Qnil;
+}
+
+//------------------------------------------------------------------------------
+// Function: DbgScript_trace_span
+//
+// Synopsis:
+//
+//  DbgScript.trace_span(name) { ... } -> Object
+//
+// Description:
+//
+//  Run the block, marking it as a span named 'name' on the timeline (see
+//  !runscript -timeline). Returns the block's value.
+//
+static VALUE
+DbgScript_trace_span(
+	_In_ VALUE /* self */,
+	_In_ VALUE name)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	rb_need_block();
+
+	TimelineBeginSpan(hostCtxt, StringValueCStr(name));
+	return rb_ensure(traceSpanBody, Qnil, traceSpanEnsure, Qnil);
+}
+
 void
 Init_DbgScript()
 {
@@ -729,6 +1005,9 @@ Init_DbgScript()
 	rb_define_module_function(
 		module, "get_nearest_sym", RUBY_METHOD_FUNC(DbgScript_get_nearest_sym), 1 /* argc */);
 	
+	rb_define_module_function(
+		module, "get_nearest_syms", RUBY_METHOD_FUNC(DbgScript_get_nearest_syms), 1 /* argc */);
+	
 	rb_define_module_function(
 		module, "current_thread", RUBY_METHOD_FUNC(DbgScript_current_thread), 0 /* argc */);
 	
@@ -741,6 +1020,12 @@ Init_DbgScript()
 	rb_define_module_function(
 		module, "create_typed_pointer", RUBY_METHOD_FUNC(DbgScript_create_typed_pointer), 2 /* argc */);
 	
+	rb_define_module_function(
+		module, "container_of", RUBY_METHOD_FUNC(DbgScript_container_of), 3 /* argc */);
+	
+	rb_define_module_function(
+		module, "get_runtime_objs", RUBY_METHOD_FUNC(DbgScript_get_runtime_objs), 1 /* argc */);
+	
 	rb_define_module_function(
 		module, "resolve_enum", RUBY_METHOD_FUNC(DbgScript_resolve_enum), 2 /* argc */);
 	
@@ -759,6 +1044,12 @@ Init_DbgScript()
 	rb_define_module_function(
 		module, "search_memory", RUBY_METHOD_FUNC(DbgScript_search_memory), 4 /* argc */);
 
+	rb_define_module_function(
+		module, "stats", RUBY_METHOD_FUNC(DbgScript_stats), 0 /* argc */);
+
+	rb_define_module_function(
+		module, "trace_span", RUBY_METHOD_FUNC(DbgScript_trace_span), 1 /* argc */);
+
 	// Save off the module.
 	//
 	GetRubyProvGlobals()->DbgScriptModule = module;
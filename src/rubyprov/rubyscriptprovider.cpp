@@ -16,6 +16,9 @@
 #include "common.h"
 #include <crtdbg.h>
 #include <iscriptprovider.h>
+#include <ruby/debug.h>
+#include "../support/profiler.h"
+#include "../support/bytecodecache.h"
 
 // Ruby modules and classes.
 //
@@ -38,6 +41,9 @@ public:
 	void
 	StopVM() override;
 
+	_Check_return_ HRESULT
+	ResetVM() override;
+
 	_Check_return_ HRESULT
 	Run(
 		_In_ int argc,
@@ -52,6 +58,10 @@ public:
 	
 private:
 
+	// Run the next script or string in isolation (see ResetVM).
+	//
+	bool IsolateNextRun;
+
 	_CrtMemState MemStateBefore;
 
 	_CrtMemState MemStateAfter;
@@ -59,7 +69,8 @@ private:
 	_CrtMemState MemStateDiff;
 };
 
-CRubyScriptProvider::CRubyScriptProvider()
+CRubyScriptProvider::CRubyScriptProvider() :
+	IsolateNextRun(false)
 {
 
 }
@@ -237,6 +248,264 @@ exit:
 	return hr;
 }
 
+// Deepest Ruby stack described in a profile sample. Outer frames beyond this
+// are left out.
+//
+const int PROFILER_MAX_FRAMES = 128;
+
+// Describe the running script's stack for the profiler (see profiler.h).
+//
+static void
+profilerWalkStack(
+	_In_opt_ void* /* walkCtxt */,
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf)
+{
+	VALUE frames[PROFILER_MAX_FRAMES];
+	int lines[PROFILER_MAX_FRAMES];
+
+	const int depth = rb_profile_frames(0, PROFILER_MAX_FRAMES, frames, lines);
+
+	// Outermost first.
+	//
+	for (int i = depth - 1; i >= 0; --i)
+	{
+		const VALUE label = rb_profile_frame_full_label(frames[i]);
+		const VALUE path = rb_profile_frame_path(frames[i]);
+		const VALUE firstLine = rb_profile_frame_first_lineno(frames[i]);
+
+		ProfilerAppendFrame(
+			buf,
+			cchBuf,
+			RB_TYPE_P(label, T_STRING) ? RSTRING_PTR(label) : nullptr,
+			RB_TYPE_P(path, T_STRING) ? RSTRING_PTR(path) : nullptr,
+			FIXNUM_P(firstLine) ? FIX2INT(firstLine) : 0);
+	}
+}
+
+// Line tracepoint enabled while profiling. Samples when one is due.
+//
+static void
+profilerTracepoint(
+	_In_ VALUE /* tpval */,
+	_In_opt_ void* /* data */)
+{
+	ProfilerSample(GetRubyProvGlobals()->HostCtxt, nullptr);
+}
+
+// Start profiling a script about to run, if the host is profiling.
+//
+// Returns the tracepoint to pass to stopProfiling, or Qnil if not profiling.
+//
+static VALUE
+startProfiling(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	if (!ProfilerAttach(hostCtxt, profilerWalkStack))
+	{
+		return Qnil;
+	}
+
+	const VALUE tp = rb_tracepoint_new(
+		0 /* all threads */, RUBY_EVENT_LINE, profilerTracepoint, nullptr);
+	rb_tracepoint_enable(tp);
+	return tp;
+}
+
+// Stop profiling started by startProfiling.
+//
+static void
+stopProfiling(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ VALUE tp)
+{
+	if (NIL_P(tp))
+	{
+		return;
+	}
+
+	rb_tracepoint_disable(tp);
+	ProfilerDetach(hostCtxt);
+}
+
+// Abort tracepoint (see RubyProvGlobals). Raises Interrupt at the script's
+// next line or call.
+//
+static void
+abortTracepoint(
+	_In_ VALUE tpval,
+	_In_opt_ void* /* data */)
+{
+	rb_tracepoint_disable(tpval);
+	rb_raise(rb_eInterrupt, "Execution interrupted.");
+}
+
+// Run whose abort timer is live, or 0 outside of any run. Abort checks are
+// tagged with the run that queued them, so that one still pending when its run
+// ends can't enable the abort tracepoint in the next run.
+//
+static volatile LONG s_AbortCheckRun;
+
+// Last run number handed out.
+//
+static LONG s_LastAbortCheckRun;
+
+// Postponed job queued by the abort timer. Runs on the script's thread at the
+// next safe point. Ruby swallows exceptions raised by postponed jobs, so the
+// interrupt is raised from the abort tracepoint instead.
+//
+static void
+checkAbortJob(
+	_In_opt_ void* data)
+{
+	if ((LONG)(LONG_PTR)data != s_AbortCheckRun)
+	{
+		// Queued by a run that has since ended.
+		//
+		return;
+	}
+
+	if (UtilCheckAbort(GetRubyProvGlobals()->HostCtxt))
+	{
+		rb_tracepoint_enable(GetRubyProvGlobals()->AbortTracepoint);
+	}
+}
+
+// Abort timer callback. Runs on a thread pool thread, so it only queues the
+// check, which lets loops that never call into DbgScript be interrupted.
+//
+static void
+abortTimerCb()
+{
+	const LONG run = s_AbortCheckRun;
+	if (run)
+	{
+		rb_postponed_job_register_one(0 /* flags */, checkAbortJob, (void*)(LONG_PTR)run);
+	}
+}
+
+// Start the abort timer for a run about to start. 'outerRun' receives the run
+// it interrupts, if any, for stopAbortChecks to restore.
+//
+static _Check_return_ PTP_TIMER
+startAbortChecks(
+	_Out_ LONG* outerRun)
+{
+	LONG run = ++s_LastAbortCheckRun;
+	if (!run)
+	{
+		run = ++s_LastAbortCheckRun;
+	}
+
+	*outerRun = s_AbortCheckRun;
+	InterlockedExchange(&s_AbortCheckRun, run);
+
+	PTP_TIMER timer = UtilStartAbortTimer(abortTimerCb);
+	if (!timer)
+	{
+		InterlockedExchange(&s_AbortCheckRun, *outerRun);
+	}
+	return timer;
+}
+
+// Stop abort checks started by startAbortChecks. Jobs the run queued that are
+// still pending are ignored when Ruby gets to them.
+//
+static void
+stopAbortChecks(
+	_In_opt_ PTP_TIMER timer,
+	_In_ LONG outerRun)
+{
+	if (!timer)
+	{
+		return;
+	}
+
+	UtilStopAbortTimer(timer);
+	InterlockedExchange(&s_AbortCheckRun, outerRun);
+}
+
+#ifndef LOCKDOWN
+static VALUE
+loadIseqFromBinary(VALUE binary)
+{
+	return rb_funcall(
+		rb_path2class("RubyVM::InstructionSequence"),
+		rb_intern("load_from_binary"),
+		1,
+		binary);
+}
+
+// Load the instruction sequence for a file from the bytecode cache (see
+// bytecodecache.h), or compile it and add it to the cache. Raises on failure.
+//
+static VALUE
+loadIseqGuarded(VALUE path)
+{
+	BytecodeCacheKey key;
+	BYTE* code = nullptr;
+	ULONG cbCode = 0;
+	int state = 0;
+	VALUE iseq = Qnil;
+	VALUE binary = Qnil;
+
+	if (BytecodeCacheLookup(
+			GetRubyProvGlobals()->HostCtxt,
+			StringValueCStr(path),
+			"rbc",
+			&key,
+			&code,
+			&cbCode) == S_OK)
+	{
+		binary = rb_str_new((const char*)code, cbCode);
+		BytecodeCacheFree(code);
+		iseq = rb_protect(loadIseqFromBinary, binary, &state);
+		if (!state)
+		{
+			return iseq;
+		}
+
+		// Most likely from a different Ruby version. Recompile and replace it.
+		//
+		rb_set_errinfo(Qnil);
+	}
+
+	iseq = rb_funcall(
+		rb_path2class("RubyVM::InstructionSequence"),
+		rb_intern("compile_file"),
+		1,
+		path);
+	if (key.CachePath[0])
+	{
+		binary = rb_funcall(iseq, rb_intern("to_binary"), 0);
+
+		// Failing to cache is harmless; the file is compiled next time.
+		//
+		(void)BytecodeCacheStore(&key, RSTRING_PTR(binary), (ULONG)RSTRING_LEN(binary));
+	}
+	return iseq;
+}
+
+// RubyVM::InstructionSequence.load_iseq. Ruby calls this for every file it
+// loads or requires, including the script itself. Returning nil makes Ruby
+// compile the file as usual, which also reports any syntax errors.
+//
+static VALUE
+loadIseq(
+	_In_ VALUE /* self */,
+	_In_ VALUE path)
+{
+	int state = 0;
+	const VALUE iseq = rb_protect(loadIseqGuarded, path, &state);
+	if (state)
+	{
+		rb_set_errinfo(Qnil);
+		return Qnil;
+	}
+	return iseq;
+}
+#endif
+
 static VALUE
 runScriptGuarded(VALUE name)
 {
@@ -244,11 +513,83 @@ runScriptGuarded(VALUE name)
 	return Qnil;
 }
 
+// Like runScriptGuarded, but the script's top-level methods, classes and
+// constants go into an anonymous module instead of Object.
+//
+static VALUE
+runScriptIsolatedGuarded(VALUE name)
+{
+	rb_load(name, 1 /* wrap */);
+	return Qnil;
+}
+
+// Instruction sequences live in the EvalIseqs array, and are dropped with it
+// or when their slot is reused, so there's nothing to release per entry.
+//
+static void
+releaseEvalIseq(
+	_In_ UINT_PTR /* code */)
+{
+}
+
+// Get the instruction sequence for a string, compiling it on a cache miss.
+// Raises on syntax errors.
+//
+static VALUE
+getEvalIseq(
+	_In_z_ const char* str)
+{
+	RubyProvGlobals* globals = GetRubyProvGlobals();
+	EvalCacheEntry* entry = EvalCacheFind(&globals->EvalIseqCache, str);
+
+	StatsCountEval(globals->HostCtxt, str, entry != nullptr);
+	if (entry)
+	{
+		return rb_ary_entry(
+			globals->EvalIseqs, entry - globals->EvalIseqCache.Entries);
+	}
+
+	// Same file name rb_eval_string uses, for backtraces.
+	//
+	const VALUE iseq = rb_funcall(
+		rb_path2class("RubyVM::InstructionSequence"),
+		rb_intern("compile"),
+		2,
+		rb_str_new_cstr(str),
+		rb_str_new_cstr("(eval)"));
+
+	entry = EvalCacheInsert(&globals->EvalIseqCache, str, 0, releaseEvalIseq);
+	if (entry)
+	{
+		rb_ary_store(
+			globals->EvalIseqs, entry - globals->EvalIseqCache.Entries, iseq);
+	}
+	return iseq;
+}
+
+// Evaluate a string at the top level. Repeated strings (e.g. breakpoint
+// commands) are only compiled once.
+//
 static VALUE
 runStringGuarded(
 	_In_ const char* str)
 {
-	return rb_eval_string(str);
+	return rb_funcall(getEvalIseq(str), rb_intern("eval"), 0);
+}
+
+// Like runStringGuarded, but evaluates the string with a fresh object as
+// self, so its methods, classes and constants are defined on that object's
+// singleton class instead of Object.
+//
+static VALUE
+runStringIsolatedGuarded(
+	_In_ const char* str)
+{
+	return rb_funcall(
+		rb_obj_alloc(rb_cObject),
+		rb_intern("instance_eval"),
+		1,
+		rb_str_new_cstr(str));
 }
 
 _Check_return_ HRESULT
@@ -259,6 +600,13 @@ CRubyScriptProvider::Run(
 	HRESULT hr = S_OK;
 	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
 	WCHAR fullScriptName[MAX_PATH] = {};
+	VALUE profileTp = Qnil;
+	PTP_TIMER abortTimer = nullptr;
+	LONG outerAbortRun = 0;
+	const bool isolate = IsolateNextRun;
+
+	IsolateNextRun = false;
+	ClearTypedObjectIdentities();
 	
 	if (!argc)
 	{
@@ -305,13 +653,20 @@ CRubyScriptProvider::Run(
 	// NOTE: rb_rescue only filters for StandardError exceptions (and subclasses).
 	// This does NOT include LoadError. Thus we must use rb_rescue2.
 	//
+	abortTimer = startAbortChecks(&outerAbortRun);
+	profileTp = startProfiling(hostCtxt);
 	rb_rescue2(
-		RUBY_METHOD_FUNC(runScriptGuarded),
+		isolate ?
+			RUBY_METHOD_FUNC(runScriptIsolatedGuarded) :
+			RUBY_METHOD_FUNC(runScriptGuarded),
 		rb_str_new2(narrowArgv[0]),
 		RUBY_METHOD_FUNC(topLevelExceptionHandler),
 		Qnil,
 		rb_eException,
 		0 /* sentinel */);
+	stopProfiling(hostCtxt, profileTp);
+	stopAbortChecks(abortTimer, outerAbortRun);
+	rb_tracepoint_disable(GetRubyProvGlobals()->AbortTracepoint);
 
 exit:
 	return hr;
@@ -321,6 +676,12 @@ _Check_return_ HRESULT
 CRubyScriptProvider::RunString(
 	_In_z_ const char* scriptString)
 {
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	const bool isolate = IsolateNextRun;
+
+	IsolateNextRun = false;
+	ClearTypedObjectIdentities();
+
 	// Host ensures string is not empty.
 	//
 	assert(*scriptString);
@@ -331,13 +692,21 @@ CRubyScriptProvider::RunString(
 	// NOTE: rb_rescue only filters for StandardError exceptions (and subclasses).
 	// This does NOT include LoadError. Thus we must use rb_rescue2.
 	//
+	LONG outerAbortRun = 0;
+	PTP_TIMER abortTimer = startAbortChecks(&outerAbortRun);
+	const VALUE profileTp = startProfiling(hostCtxt);
 	rb_rescue2(
-		RUBY_METHOD_FUNC(runStringGuarded),
+		isolate ?
+			RUBY_METHOD_FUNC(runStringIsolatedGuarded) :
+			RUBY_METHOD_FUNC(runStringGuarded),
 		(VALUE)scriptString,
 		RUBY_METHOD_FUNC(topLevelExceptionHandler),
 		Qnil,
 		rb_eException,
 		0 /* sentinel */);
+	stopProfiling(hostCtxt, profileTp);
+	stopAbortChecks(abortTimer, outerAbortRun);
+	rb_tracepoint_disable(GetRubyProvGlobals()->AbortTracepoint);
 	
 	return S_OK;
 }
@@ -554,15 +923,58 @@ CRubyScriptProvider::StartVM()
 	//
 	Init_TypedObject();
 
+	// Abort tracepoint. Created disabled; kept alive for the VM's lifetime.
+	//
+	GetRubyProvGlobals()->AbortTracepoint = rb_tracepoint_new(
+		0 /* all threads */,
+		RUBY_EVENT_LINE | RUBY_EVENT_CALL | RUBY_EVENT_B_CALL | RUBY_EVENT_C_CALL,
+		abortTracepoint,
+		nullptr);
+	rb_gc_register_mark_object(GetRubyProvGlobals()->AbortTracepoint);
+
+	GetRubyProvGlobals()->EvalIseqs = rb_ary_new();
+	rb_gc_register_mark_object(GetRubyProvGlobals()->EvalIseqs);
+
+	GetRubyProvGlobals()->Identities = rb_ary_new2(TYPED_OBJECT_IDENTITY_SLOTS);
+	rb_gc_register_mark_object(GetRubyProvGlobals()->Identities);
+
+#ifndef LOCKDOWN
+	// Load scripts and the files they require through the bytecode cache.
+	//
+	rb_define_singleton_method(
+		rb_path2class("RubyVM::InstructionSequence"),
+		"load_iseq",
+		RUBY_METHOD_FUNC(loadIseq),
+		1 /* numParams */);
+#endif
+
 	lockdownRuby();
 
 exit:
 	return hr;
 }
 
+// Ruby can't drop the definitions a script makes on Object, so instead the
+// next run is isolated: scripts are loaded wrapped in an anonymous module, and
+// strings are evaluated against a fresh object. Global variables ($foo) are
+// still shared. Libraries the scripts required stay loaded.
+//
+_Check_return_ HRESULT
+CRubyScriptProvider::ResetVM()
+{
+	// RunString doesn't set ARGV, so don't leave the last script's.
+	//
+	rb_ary_clear(rb_get_argv());
+
+	IsolateNextRun = true;
+	return S_OK;
+}
+
 void
 CRubyScriptProvider::StopVM()
 {
+	EvalCacheClear(&GetRubyProvGlobals()->EvalIseqCache, releaseEvalIseq);
+
 	int status = ruby_cleanup(0);
 	if (status)
 	{
@@ -572,6 +984,13 @@ CRubyScriptProvider::StopVM()
 	}
 
 	rb_cleanup_global_heap();
+
+	// Wrapper blocks come from the process heap, not Ruby's.
+	//
+	RubyProvGlobals* globals = GetRubyProvGlobals();
+	WrapperPoolDrain(&globals->TypedObjectPool);
+	WrapperPoolDrain(&globals->ThreadPool);
+	WrapperPoolDrain(&globals->StackFramePool);
 	
 	_CrtMemCheckpoint(&MemStateAfter);
 	
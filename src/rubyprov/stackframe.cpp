@@ -209,8 +209,7 @@ static void
 StackFrame_free(
 	_In_ void* obj)
 {
-	StackFrameObj* frame = (StackFrameObj*)obj;
-	delete frame;
+	WrapperPoolFree(&GetRubyProvGlobals()->StackFramePool, obj);
 }
 
 //------------------------------------------------------------------------------
@@ -248,8 +247,13 @@ static VALUE
 StackFrame_alloc(
 	_In_ VALUE klass)
 {
-	StackFrameObj* frame = new StackFrameObj;
-	memset(frame, 0, sizeof(*frame));
+	RubyProvGlobals* globals = GetRubyProvGlobals();
+	StackFrameObj* frame = (StackFrameObj*)
+		WrapperPoolAlloc(globals->HostCtxt, &globals->StackFramePool);
+	if (!frame)
+	{
+		rb_memerror();
+	}
 
 	return Data_Wrap_Struct(klass, StackFrame_mark, StackFrame_free, frame);
 }
@@ -306,4 +310,5 @@ Init_StackFrame()
 	// Save the thread class so others can instantiate it.
 	//
 	GetRubyProvGlobals()->StackFrameClass = stackFrameClass;
+	GetRubyProvGlobals()->StackFramePool.BlockSize = sizeof(StackFrameObj);
 }
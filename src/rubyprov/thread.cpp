@@ -228,8 +228,7 @@ static void
 Thread_free(
 	_In_ void* obj)
 {
-	DbgScriptThread* thd = (DbgScriptThread*)obj;
-	delete thd;
+	WrapperPoolFree(&GetRubyProvGlobals()->ThreadPool, obj);
 }
 
 //------------------------------------------------------------------------------
@@ -247,8 +246,13 @@ static VALUE
 Thread_alloc(
 	_In_ VALUE klass)
 {
-	DbgScriptThread* thd = new DbgScriptThread;
-	memset(thd, 0, sizeof(*thd));
+	RubyProvGlobals* globals = GetRubyProvGlobals();
+	DbgScriptThread* thd = (DbgScriptThread*)
+		WrapperPoolAlloc(globals->HostCtxt, &globals->ThreadPool);
+	if (!thd)
+	{
+		rb_memerror();
+	}
 
 	return Data_Wrap_Struct(klass, nullptr /* mark */, Thread_free, thd);
 }
@@ -342,4 +346,5 @@ Init_Thread()
 	// Save the thread class so others can instantiate it.
 	//
 	GetRubyProvGlobals()->ThreadClass = threadClass;
+	GetRubyProvGlobals()->ThreadPool.BlockSize = sizeof(DbgScriptThread);
 }
@@ -15,6 +15,153 @@
 #include "common.h"
 #include "typedobject.h"
 
+//------------------------------------------------------------------------------
+// Function: identitySlot
+//
+// Description:
+//
+//  Index of an object in the identity table.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static long
+identitySlot(
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	return (long)(DsTypedDataHash(typedData) & (TYPED_OBJECT_IDENTITY_SLOTS - 1));
+}
+
+//------------------------------------------------------------------------------
+// Function: findIdentity
+//
+// Description:
+//
+//  Find a recent TypedObject for the same object, with the same name.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The object, or Qnil.
+//
+// Notes:
+//
+//  Unlike the other providers' tables, this one holds strong references: the
+//  GC may free an unreferenced object after it has been found. It's bounded
+//  and emptied at the start of each run.
+//
+static VALUE
+findIdentity(
+	_In_z_ const char* name,
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	VALUE obj = rb_ary_entry(GetRubyProvGlobals()->Identities, identitySlot(typedData));
+	if (!NIL_P(obj))
+	{
+		DbgScriptTypedObject* typObj = nullptr;
+		Data_Get_Struct(obj, DbgScriptTypedObject, typObj);
+
+		if (DsTypedDataSameObject(&typObj->TypedData, typedData) &&
+			!strcmp(typObj->Name, name))
+		{
+			return obj;
+		}
+	}
+	return Qnil;
+}
+
+//------------------------------------------------------------------------------
+// Function: rememberIdentity
+//
+// Description:
+//
+//  Make a new TypedObject the one findIdentity returns for its object.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+rememberIdentity(
+	_In_ VALUE obj,
+	_In_ const DbgScriptTypedObject* typObj)
+{
+	if (typObj->TypedDataValid)
+	{
+		rb_ary_store(
+			GetRubyProvGlobals()->Identities,
+			identitySlot(&typObj->TypedData),
+			obj);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: internTypedObject
+//
+// Description:
+//
+//  Swap a newly initialized TypedObject for a recent one for the same object,
+//  if there is one.
+//
+// Parameters:
+//
+//  obj - New TypedObject.
+//  typObj - Its data.
+//
+// Returns:
+//
+//  'obj' or the recent object.
+//
+// Notes:
+//
+static VALUE
+internTypedObject(
+	_In_ VALUE obj,
+	_In_ const DbgScriptTypedObject* typObj)
+{
+	if (!typObj->TypedDataValid)
+	{
+		return obj;
+	}
+
+	const VALUE existing = findIdentity(typObj->Name, &typObj->TypedData);
+	if (!NIL_P(existing))
+	{
+		return existing;
+	}
+
+	rememberIdentity(obj, typObj);
+	return obj;
+}
+
+//------------------------------------------------------------------------------
+// Function: ClearTypedObjectIdentities
+//
+// Description:
+//
+//  Stop returning existing TypedObjects for new lookups.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Called at the start of each run. Target memory may have changed since the
+//  last one, and with it the values the objects have cached.
+//
+void
+ClearTypedObjectIdentities()
+{
+	rb_ary_clear(GetRubyProvGlobals()->Identities);
+}
+
 //------------------------------------------------------------------------------
 // Function: allocTypedObjFromTypedData
 //
@@ -39,7 +186,16 @@ allocTypedObjFromTypedData(
 	_In_ DEBUG_TYPED_DATA* typedData)
 {
 	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
-	VALUE newObj = rb_class_new_instance(
+
+	// Walks often reach the same object again.
+	//
+	VALUE newObj = findIdentity(name, typedData);
+	if (!NIL_P(newObj))
+	{
+		return newObj;
+	}
+
+	newObj = rb_class_new_instance(
 		0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
 
 	DbgScriptTypedObject* obj = nullptr;
@@ -52,6 +208,7 @@ allocTypedObjFromTypedData(
 		rb_raise(rb_eRuntimeError, "DsWrapTypedData failed. Error 0x%08x.", hr);
 	}
 
+	rememberIdentity(newObj, obj);
 	return newObj;
 }
 
@@ -70,8 +227,7 @@ static void
 TypedObject_free(
 	_In_ void* obj)
 {
-	DbgScriptTypedObject* o = (DbgScriptTypedObject*)obj;
-	delete o;
+	WrapperPoolFree(&GetRubyProvGlobals()->TypedObjectPool, obj);
 }
 
 //------------------------------------------------------------------------------
@@ -89,8 +245,13 @@ static VALUE
 TypedObject_alloc(
 	_In_ VALUE klass)
 {
-	DbgScriptTypedObject* obj = new DbgScriptTypedObject;
-	memset(obj, 0, sizeof(*obj));
+	RubyProvGlobals* globals = GetRubyProvGlobals();
+	DbgScriptTypedObject* obj = (DbgScriptTypedObject*)
+		WrapperPoolAlloc(globals->HostCtxt, &globals->TypedObjectPool);
+	if (!obj)
+	{
+		rb_memerror();
+	}
 
 	return Data_Wrap_Struct(klass, nullptr /* mark */, TypedObject_free, obj);
 }
@@ -207,6 +368,51 @@ rbValueFromCValue(
 	return ret;
 }
 
+//------------------------------------------------------------------------------
+// Function: ensureValue
+//
+// Description:
+//
+//  Read the value of a primitive object from the target, unless already
+//  fetched (e.g. by an array cursor reading ahead).
+//  
+// Returns:
+//
+// Notes:
+//
+static void
+ensureValue(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptTypedObject* typObj)
+{
+	if (typObj->ValueValid)
+	{
+		return;
+	}
+
+	// Read the appropriate size from memory.
+	//
+	// What primitive type is bigger than 8 bytes?
+	//
+	ULONG cbRead = 0;
+	assert(typObj->TypedData.Size <= 8);
+	HRESULT hr = UtilReadTypedData(
+		hostCtxt,
+		&typObj->TypedData,
+		&typObj->Value.Value,
+		sizeof(typObj->Value.Value),
+		&cbRead);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "Failed to read typed data. Error 0x%08x.", hr);
+	}
+	assert(cbRead == typObj->TypedData.Size);
+	
+	// Value has been populated.
+	//
+	typObj->ValueValid = true;
+}
+
 //------------------------------------------------------------------------------
 // Function: TypedObject_get_runtime_obj
 //
@@ -245,7 +451,170 @@ TypedObject_get_runtime_obj(
 		rb_raise(rb_eRuntimeError, "DsTypedObjectGetRuntimeType failed. Error: 0x%08x", hr);
 	}
 	
-	return newObj;
+	return internTypedObject(newObj, newTypObj);
+}
+
+//------------------------------------------------------------------------------
+// Function: GetRuntimeObjects
+//
+// Description:
+//
+//  Batch version of TypedObject#get_runtime_obj. Resolve the runtime type of
+//  each object in an array.
+//
+// Returns:
+//
+//  New array with the downcast object for each input, or nil where the object
+//  has no vtable (or no typed data).
+//
+// Notes:
+//
+//  Vtable lookups are cached, so this costs little more than reading each
+//  object's vptr.
+//
+_Check_return_ VALUE
+GetRuntimeObjects(
+	_In_ VALUE objs)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	Check_Type(objs, T_ARRAY);
+
+	const long len = RARRAY_LEN(objs);
+	VALUE results = rb_ary_new2(len);
+
+	for (long i = 0; i < len; ++i)
+	{
+		CHECK_ABORT(hostCtxt);
+
+		VALUE item = rb_ary_entry(objs, i);
+		if (!rb_obj_is_kind_of(item, GetRubyProvGlobals()->TypedObjectClass))
+		{
+			rb_raise(rb_eTypeError, "expected an array of TypedObjects");
+		}
+
+		DbgScriptTypedObject* typObj = nullptr;
+		Data_Get_Struct(item, DbgScriptTypedObject, typObj);
+
+		VALUE result = Qnil;
+
+		if (checkTypedData(typObj, false /* fRaise */))
+		{
+			VALUE newObj = rb_class_new_instance(
+				0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
+
+			DbgScriptTypedObject* newTypObj = nullptr;
+			Data_Get_Struct(newObj, DbgScriptTypedObject, newTypObj);
+
+			HRESULT hr = DsTypedObjectTryGetRuntimeType(
+				hostCtxt, typObj, newTypObj);
+			if (FAILED(hr))
+			{
+				rb_raise(rb_eRuntimeError, "DsTypedObjectTryGetRuntimeType failed. Error: 0x%08x", hr);
+			}
+			else if (hr == S_OK)
+			{
+				result = internTypedObject(newObj, newTypObj);
+			}
+		}
+
+		rb_ary_push(results, result);
+	}
+
+	return results;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_cast
+//
+// Synopsis:
+// 
+//  obj.cast(type) -> TypedObject
+//
+// Description:
+//
+//  Reinterpret the object's memory as 'type', like a C cast of its address.
+//
+// Notes:
+//
+//  Only the first cast to a given aggregate type issues DbgEng requests.
+//
+static VALUE
+TypedObject_cast(
+	_In_ VALUE self,
+	_In_ VALUE type)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptTypedObject* typObj = nullptr;
+	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
+
+	const char* szType = StringValuePtr(type);
+
+	checkTypedData(typObj, true /* fRaise */);
+
+	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, szType);
+	if (!typeInfo)
+	{
+		rb_raise(rb_eArgError, "Failed to get type id for type '%s'.", szType);
+	}
+
+	return AllocTypedObject(
+		0 /* size */,
+		typObj->Name,
+		typeInfo->TypeId,
+		typeInfo->ModuleBase,
+		typObj->TypedData.Offset,
+		false /* wantPointer */);
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_offset
+//
+// Synopsis:
+// 
+//  obj.offset(n) -> TypedObject
+//
+// Description:
+//
+//  Pointer arithmetic. If 'obj' is a pointer, returns a pointer advanced by 'n'
+//  elements. Otherwise returns the object of the same type 'n' elements away,
+//  as if 'obj' were an element of an array.
+//
+// Notes:
+//
+//  Computed locally; at most one DbgEng request per pointer type.
+//
+static VALUE
+TypedObject_offset(
+	_In_ VALUE self,
+	_In_ VALUE n)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptTypedObject* typObj = nullptr;
+	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
+
+	const INT64 count = NUM2LL(n);
+
+	checkTypedData(typObj, true /* fRaise */);
+
+	VALUE newObj = rb_class_new_instance(
+		0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
+
+	DbgScriptTypedObject* newTypObj = nullptr;
+	Data_Get_Struct(newObj, DbgScriptTypedObject, newTypObj);
+
+	HRESULT hr = DsTypedObjectOffset(hostCtxt, typObj, count, newTypObj);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsTypedObjectOffset failed. Error 0x%08x.", hr);
+	}
+
+	return internTypedObject(newObj, newTypObj);
 }
 
 //------------------------------------------------------------------------------
@@ -445,28 +814,7 @@ TypedObject_value(
 		rb_raise(rb_eTypeError, "Not a primitive type.");
 	}
 
-	// Read the appropriate size from memory.
-	//
-	// What primitive type is bigger than 8 bytes?
-	//
-	ULONG cbRead = 0;
-	assert(typObj->TypedData.Size <= 8);
-	HRESULT hr = hostCtxt->DebugSymbols->ReadTypedDataVirtual(
-		typObj->TypedData.Offset,
-		typObj->TypedData.ModBase,
-		typObj->TypedData.TypeId,
-		&typObj->Value.Value,
-		sizeof(typObj->Value.Value),
-		&cbRead);
-	if (FAILED(hr))
-	{
-		rb_raise(rb_eRuntimeError, "Failed to read typed data. Error 0x%08x.", hr);
-	}
-	assert(cbRead == typObj->TypedData.Size);
-	
-	// Value has been populated.
-	//
-	typObj->ValueValid = true;
+	ensureValue(hostCtxt, typObj);
 
 	return rbValueFromCValue(typObj);
 }
@@ -636,11 +984,12 @@ TypedObject_method_missing(
 	DbgScriptTypedObject* typObj = nullptr;
 	CHECK_ABORT(hostCtxt);
 
-	VALUE methodStr = rb_sym2str(argv[0]);
-	const char* fieldName = StringValuePtr(methodStr);
+	// The symbol's name is owned by the symbol table, so unlike converting
+	// the symbol to a string, this doesn't allocate.
+	//
+	const char* fieldName = rb_id2name(SYM2ID(argv[0]));
 
 	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
-	const ID methodMissing = rb_intern("method_missing");
 
 	bool fOk = checkTypedData(typObj, false);
 	if (!fOk)
@@ -648,7 +997,7 @@ TypedObject_method_missing(
 		// Call super class.
 		//
 		VALUE super = rb_class_superclass(CLASS_OF(self));
-		return rb_funcallv(super, methodMissing, argc, argv);
+		return rb_funcallv(super, rb_intern("method_missing"), argc, argv);
 	}
 	
 	DEBUG_TYPED_DATA typedData = {0};
@@ -663,7 +1012,7 @@ TypedObject_method_missing(
 		// Call super class.
 		//
 		VALUE super = rb_class_superclass(CLASS_OF(self));
-		return rb_funcallv(super, methodMissing, argc, argv);
+		return rb_funcallv(super, rb_intern("method_missing"), argc, argv);
 	}
 	
 	return allocTypedObjFromTypedData(fieldName, &typedData);
@@ -699,22 +1048,93 @@ TypedObject_length(
 		rb_raise(rb_eTypeError, "Object not array.");
 	}
 
-	// Get the zero'th item in order to get its size.
-	//
-	DEBUG_TYPED_DATA typedData = {0};
-	HRESULT hr = DsTypedObjectGetArrayElement(
+	UINT64 numElems = 0;
+	HRESULT hr = DsTypedObjectGetArrayLength(
 		hostCtxt,
 		typObj,
-		0 /* index */,
-		&typedData);
+		&numElems);
 	if (FAILED(hr))
 	{
-		rb_raise(rb_eRuntimeError, "DsTypedObjectGetArrayElement failed. Error 0x%08x.", hr);
+		rb_raise(rb_eRuntimeError, "DsTypedObjectGetArrayLength failed. Error 0x%08x.", hr);
+	}
+
+	return ULL2NUM(numElems);
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_each
+//
+// Synopsis:
+// 
+//  obj.each { |elem| block } -> obj
+//  obj.each -> Enumerator
+//
+// Description:
+//
+//  Yield each element of an array in turn. Throws if object is not an array.
+//  Returns an Enumerator if no block is given.
+//
+// Notes:
+//
+//  Only the first element is resolved through the debugger engine, so this is
+//  much cheaper than indexing each element in turn.
+//
+static VALUE
+TypedObject_each(
+	_In_ VALUE self)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	DbgScriptTypedObject* typObj = nullptr;
+	CHECK_ABORT(hostCtxt);
+
+	RETURN_ENUMERATOR(self, 0, nullptr);
+
+	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
+
+	checkTypedData(typObj, true);
+	
+	if (typObj->TypedData.Tag != SymTagArrayType)
+	{
+		// Not array. Pointers have no length, so we can't know when to stop.
+		//
+		rb_raise(rb_eTypeError, "Object not array.");
+	}
+
+	// The cursor is plain data, so it's fine for it to live on the stack even
+	// if the block raises and Ruby unwinds past us.
+	//
+	DbgScriptArrayCursor cursor;
+
+	HRESULT hr = DsArrayCursorInit(hostCtxt, typObj, &cursor);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsArrayCursorInit failed. Error 0x%08x.", hr);
 	}
 
-	const ULONG elemSize = typedData.Size;
+	for (;;)
+	{
+		CHECK_ABORT(hostCtxt);
+		
+		VALUE elemObj = rb_class_new_instance(
+			0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
+
+		DbgScriptTypedObject* elem = nullptr;
+		Data_Get_Struct(elemObj, DbgScriptTypedObject, elem);
 
-	return ULONG2NUM(typObj->TypedData.Size / elemSize);
+		hr = DsArrayCursorNext(hostCtxt, &cursor, elem);
+		if (FAILED(hr))
+		{
+			rb_raise(rb_eRuntimeError, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+		}
+		else if (hr == S_FALSE)
+		{
+			break;
+		}
+
+		rb_yield(internTypedObject(elemObj, elem));
+	}
+
+	return self;
 }
 
 //------------------------------------------------------------------------------
@@ -772,7 +1192,7 @@ AllocTypedObject(
 		rb_raise(rb_eRuntimeError, "DsInitializeTypedObject failed. Error 0x%08x.", hr);
 	}
 
-	return typObj;
+	return internTypedObject(typObj, obj);
 }
 
 //------------------------------------------------------------------------------
@@ -845,6 +1265,425 @@ TypedObject_get_item(
 	}
 }
 
+//------------------------------------------------------------------------------
+// Function: ArraySlice_free
+//
+// Description:
+//
+//  Frees a DbgScriptArraySlice object allocated by 'ArraySlice_alloc'.
+//  
+// Returns:
+//
+// Notes:
+//
+static void
+ArraySlice_free(
+	_In_ void* obj)
+{
+	DbgScriptArraySlice* o = (DbgScriptArraySlice*)obj;
+	delete o;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_alloc
+//
+// Description:
+//
+//  Allocates a Ruby-wrapped DbgScriptArraySlice object.
+//  
+// Returns:
+//
+// Notes:
+//
+static VALUE
+ArraySlice_alloc(
+	_In_ VALUE klass)
+{
+	DbgScriptArraySlice* obj = new DbgScriptArraySlice;
+	memset(obj, 0, sizeof(*obj));
+
+	return Data_Wrap_Struct(klass, nullptr /* mark */, ArraySlice_free, obj);
+}
+
+//------------------------------------------------------------------------------
+// Function: narrowSlice
+//
+// Description:
+//
+//  Narrow an array slice, in place, to [start, stop) with the given step.
+//  
+// Returns:
+//
+// Notes:
+//
+//  Indices are zero-based and relative to the slice. 'step' must be positive.
+//
+static void
+narrowSlice(
+	_Inout_ DbgScriptArraySlice* slice,
+	_In_ int argc,
+	_In_reads_(argc) VALUE* argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		rb_raise(rb_eArgError, "wrong number of arguments");
+	}
+
+	const INT64 start = NUM2LL(argv[0]);
+	const INT64 stop = NUM2LL(argv[1]);
+	const INT64 step = argc == 3 ? NUM2LL(argv[2]) : 1;
+
+	if (start < 0 || stop < start)
+	{
+		rb_raise(rb_eArgError, "invalid slice bounds");
+	}
+	else if (step <= 0)
+	{
+		rb_raise(rb_eArgError, "step must be positive");
+	}
+	else if (slice->Count != ARRAY_SLICE_UNBOUNDED &&
+		(UINT64)stop > slice->Count)
+	{
+		rb_raise(rb_eIndexError, "index out of range");
+	}
+
+	const UINT64 count = (UINT64)((stop - start + step - 1) / step);
+
+	HRESULT hr = DsArraySliceGetSubSlice(slice, start, count, step, slice);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsArraySliceGetSubSlice failed. Error 0x%08x.", hr);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_slice
+//
+// Synopsis:
+// 
+//  obj.slice(start, stop, step=1) -> ArraySlice
+//
+// Description:
+//
+//  Get a lazy view over a range of elements of an array or pointer. No memory
+//  is read until elements are requested from the view.
+//
+static VALUE
+TypedObject_slice(
+	_In_ int argc,
+	_In_reads_(argc) VALUE* argv,
+	_In_ VALUE self)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptTypedObject* typObj = nullptr;
+	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
+
+	checkTypedData(typObj, true /* fRaise */);
+
+	VALUE sliceObj = rb_class_new_instance(
+		0, nullptr, GetRubyProvGlobals()->ArraySliceClass);
+
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(sliceObj, DbgScriptArraySlice, slice);
+
+	HRESULT hr = DsArraySliceInit(hostCtxt, typObj, slice);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsArraySliceInit failed. Error 0x%08x.", hr);
+	}
+
+	narrowSlice(slice, argc, argv);
+
+	return sliceObj;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_slice
+//
+// Synopsis:
+// 
+//  slice.slice(start, stop, step=1) -> ArraySlice
+//
+// Description:
+//
+//  Get a narrower view. Indices are relative to this slice.
+//
+static VALUE
+ArraySlice_slice(
+	_In_ int argc,
+	_In_reads_(argc) VALUE* argv,
+	_In_ VALUE self)
+{
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(self, DbgScriptArraySlice, slice);
+
+	VALUE sliceObj = rb_class_new_instance(
+		0, nullptr, GetRubyProvGlobals()->ArraySliceClass);
+
+	DbgScriptArraySlice* newSlice = nullptr;
+	Data_Get_Struct(sliceObj, DbgScriptArraySlice, newSlice);
+
+	*newSlice = *slice;
+
+	narrowSlice(newSlice, argc, argv);
+
+	return sliceObj;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_length
+//
+// Synopsis:
+// 
+//  slice.length -> Integer
+//
+// Description:
+//
+//  Return the number of elements in the slice.
+//
+static VALUE
+ArraySlice_length(
+	_In_ VALUE self)
+{
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(self, DbgScriptArraySlice, slice);
+
+	return ULL2NUM(slice->Count);
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_get_item
+//
+// Synopsis:
+// 
+//  slice[index] -> TypedObject
+//
+// Description:
+//
+//  Return the element at 'index'. Negative indices count from the end.
+//
+// Notes:
+//
+//  Only elements of primitive type are resolved through DbgEng.
+//
+static VALUE
+ArraySlice_get_item(
+	_In_ VALUE self,
+	_In_ VALUE key)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+	
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(self, DbgScriptArraySlice, slice);
+
+	INT64 index = NUM2LL(rb_check_to_int(key));
+	if (index < 0)
+	{
+		index += slice->Count;
+	}
+
+	if (index < 0 || (UINT64)index >= slice->Count)
+	{
+		rb_raise(rb_eIndexError, "index out of range");
+	}
+
+	VALUE elemObj = rb_class_new_instance(
+		0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
+
+	DbgScriptTypedObject* elem = nullptr;
+	Data_Get_Struct(elemObj, DbgScriptTypedObject, elem);
+
+	HRESULT hr = DsArraySliceGetElement(
+		GetRubyProvGlobals()->HostCtxt, slice, index, elem);
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsArraySliceGetElement failed. Error 0x%08x.", hr);
+	}
+
+	return internTypedObject(elemObj, elem);
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_each
+//
+// Synopsis:
+// 
+//  slice.each { |elem| block } -> slice
+//  slice.each -> Enumerator
+//
+// Description:
+//
+//  Yield each element of the slice in turn. Returns an Enumerator if no block
+//  is given.
+//
+static VALUE
+ArraySlice_each(
+	_In_ VALUE self)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	RETURN_ENUMERATOR(self, 0, nullptr);
+
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(self, DbgScriptArraySlice, slice);
+
+	DbgScriptArrayCursor cursor;
+	DsArrayCursorInitFromSlice(slice, &cursor);
+
+	for (;;)
+	{
+		CHECK_ABORT(hostCtxt);
+		
+		VALUE elemObj = rb_class_new_instance(
+			0, nullptr, GetRubyProvGlobals()->TypedObjectClass);
+
+		DbgScriptTypedObject* elem = nullptr;
+		Data_Get_Struct(elemObj, DbgScriptTypedObject, elem);
+
+		HRESULT hr = DsArrayCursorNext(hostCtxt, &cursor, elem);
+		if (FAILED(hr))
+		{
+			rb_raise(rb_eRuntimeError, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+		}
+		else if (hr == S_FALSE)
+		{
+			break;
+		}
+
+		rb_yield(internTypedObject(elemObj, elem));
+	}
+
+	return self;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArraySlice_values
+//
+// Synopsis:
+// 
+//  slice.values -> Array
+//
+// Description:
+//
+//  Return the values of all elements in the slice. Throws if the elements are
+//  not of a primitive type.
+//
+// Notes:
+//
+//  Values are read from the target in bulk, and no TypedObjects are created,
+//  which makes this the fastest way to extract an array of primitives.
+//
+static VALUE
+ArraySlice_values(
+	_In_ VALUE self)
+{
+	DbgScriptHostContext* hostCtxt = GetRubyProvGlobals()->HostCtxt;
+	CHECK_ABORT(hostCtxt);
+
+	DbgScriptArraySlice* slice = nullptr;
+	Data_Get_Struct(self, DbgScriptArraySlice, slice);
+
+	if (!DsTypedObjectIsPrimitive(&slice->Elem))
+	{
+		rb_raise(rb_eTypeError, "Not a primitive type.");
+	}
+
+	VALUE values = rb_ary_new2((long)slice->Count);
+
+	DbgScriptArrayCursor cursor;
+	DbgScriptTypedObject elem;
+	HRESULT hr = S_OK;
+
+	DsArrayCursorInitFromSlice(slice, &cursor);
+
+	while ((hr = DsArrayCursorNext(hostCtxt, &cursor, &elem)) == S_OK)
+	{
+		CHECK_ABORT(hostCtxt);
+
+		ensureValue(hostCtxt, &elem);
+		rb_ary_push(values, rbValueFromCValue(&elem));
+	}
+
+	if (FAILED(hr))
+	{
+		rb_raise(rb_eRuntimeError, "DsArrayCursorNext failed. Error 0x%08x.", hr);
+	}
+
+	return values;
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_hash
+//
+// Synopsis:
+// 
+//  obj.hash -> Integer
+//
+// Description:
+//
+//  Hash consistent with 'eql?': objects of the same type at the same address
+//  hash alike.
+//
+static VALUE
+TypedObject_hash(
+	_In_ VALUE self)
+{
+	DbgScriptTypedObject* typObj = nullptr;
+	Data_Get_Struct(self, DbgScriptTypedObject, typObj);
+
+	if (!typObj->TypedDataValid)
+	{
+		return rb_obj_id(self);
+	}
+
+	const UINT64 hash = DsTypedDataHash(&typObj->TypedData);
+
+	// Fold into a Fixnum.
+	//
+	return LONG2FIX((long)((hash ^ (hash >> 32)) & 0x3fffffff));
+}
+
+//------------------------------------------------------------------------------
+// Function: TypedObject_eql
+//
+// Synopsis:
+// 
+//  obj.eql?(other) -> true or false
+//  obj == other -> true or false
+//
+// Description:
+//
+//  TypedObjects are equal if they're the same type at the same address,
+//  whatever their names. Objects without typed data only equal themselves.
+//
+static VALUE
+TypedObject_eql(
+	_In_ VALUE self,
+	_In_ VALUE other)
+{
+	if (self == other)
+	{
+		return Qtrue;
+	}
+
+	if (!rb_obj_is_kind_of(other, GetRubyProvGlobals()->TypedObjectClass))
+	{
+		return Qfalse;
+	}
+
+	DbgScriptTypedObject* a = nullptr;
+	DbgScriptTypedObject* b = nullptr;
+	Data_Get_Struct(self, DbgScriptTypedObject, a);
+	Data_Get_Struct(other, DbgScriptTypedObject, b);
+
+	return a->TypedDataValid && b->TypedDataValid &&
+		DsTypedDataSameObject(&a->TypedData, &b->TypedData) ? Qtrue : Qfalse;
+}
+
 //------------------------------------------------------------------------------
 // Function: Init_TypedObject
 //
@@ -912,6 +1751,18 @@ Init_TypedObject()
 		RUBY_METHOD_FUNC(TypedObject_get_runtime_obj),
 		0 /* argc */);
 	
+	rb_define_method(
+		typedObjectClass,
+		"cast",
+		RUBY_METHOD_FUNC(TypedObject_cast),
+		1 /* argc */);
+	
+	rb_define_method(
+		typedObjectClass,
+		"offset",
+		RUBY_METHOD_FUNC(TypedObject_offset),
+		1 /* argc */);
+	
 	rb_define_method(
 		typedObjectClass,
 		"read_bytes",
@@ -939,6 +1790,17 @@ Init_TypedObject()
 		0 /* argc */);
 	
     rb_define_alias(typedObjectClass, "size", "length");
+
+	// Iteration over array elements. Mixing in Enumerable gives scripts map,
+	// select, to_a, etc. for free.
+	//
+	rb_define_method(
+		typedObjectClass,
+		"each",
+		RUBY_METHOD_FUNC(TypedObject_each),
+		0 /* argc */);
+
+	rb_include_module(typedObjectClass, rb_mEnumerable);
 	
 	rb_define_method(
 		typedObjectClass,
@@ -946,6 +1808,12 @@ Init_TypedObject()
 		RUBY_METHOD_FUNC(TypedObject_deref),
 		0 /* argc */);
 	
+	rb_define_method(
+		typedObjectClass,
+		"slice",
+		RUBY_METHOD_FUNC(TypedObject_slice),
+		-1 /* argc */);
+	
 	// Indexer method. Can take string or int key, for field or array access,
 	// respectively.
 	//
@@ -957,6 +1825,27 @@ Init_TypedObject()
 		RUBY_METHOD_FUNC(TypedObject_get_item),
 		1);
 
+	// Equal if the same type at the same address, so TypedObjects work as Hash
+	// keys.
+	//
+	rb_define_method(
+		typedObjectClass,
+		"hash",
+		RUBY_METHOD_FUNC(TypedObject_hash),
+		0 /* argc */);
+
+	rb_define_method(
+		typedObjectClass,
+		"eql?",
+		RUBY_METHOD_FUNC(TypedObject_eql),
+		1 /* argc */);
+
+	rb_define_method(
+		typedObjectClass,
+		"==",
+		RUBY_METHOD_FUNC(TypedObject_eql),
+		1 /* argc */);
+
 	// Implement 'method_missing' so that we can support virtual properties.
 	//
 	rb_define_method(
@@ -972,4 +1861,52 @@ Init_TypedObject()
 	// Save the thread class so others can instantiate it.
 	//
 	GetRubyProvGlobals()->TypedObjectClass = typedObjectClass;
+	GetRubyProvGlobals()->TypedObjectPool.BlockSize = sizeof(DbgScriptTypedObject);
+
+	// Lazy view over a range of array elements, returned by obj.slice.
+	//
+	VALUE arraySliceClass = rb_define_class_under(
+		GetRubyProvGlobals()->DbgScriptModule,
+		"ArraySlice",
+		rb_cObject);
+	
+	rb_define_alloc_func(arraySliceClass, ArraySlice_alloc);
+
+	rb_define_method(
+		arraySliceClass,
+		"length",
+		RUBY_METHOD_FUNC(ArraySlice_length),
+		0 /* argc */);
+	
+    rb_define_alias(arraySliceClass, "size", "length");
+
+	rb_define_method(
+		arraySliceClass,
+		"[]",
+		RUBY_METHOD_FUNC(ArraySlice_get_item),
+		1 /* argc */);
+
+	rb_define_method(
+		arraySliceClass,
+		"each",
+		RUBY_METHOD_FUNC(ArraySlice_each),
+		0 /* argc */);
+
+	rb_include_module(arraySliceClass, rb_mEnumerable);
+	
+	rb_define_method(
+		arraySliceClass,
+		"slice",
+		RUBY_METHOD_FUNC(ArraySlice_slice),
+		-1 /* argc */);
+	
+	rb_define_method(
+		arraySliceClass,
+		"values",
+		RUBY_METHOD_FUNC(ArraySlice_values),
+		0 /* argc */);
+	
+	LockDownClass(arraySliceClass);
+	
+	GetRubyProvGlobals()->ArraySliceClass = arraySliceClass;
 }
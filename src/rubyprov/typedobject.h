@@ -26,3 +26,10 @@ AllocTypedObject(
 	_In_ UINT64 moduleBase,
 	_In_ UINT64 virtualAddress,
 	_In_ bool wantPointer);
+
+void
+ClearTypedObjectIdentities();
+
+_Check_return_ VALUE
+GetRuntimeObjects(
+	_In_ VALUE objs);
@@ -0,0 +1,437 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: arena.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Size-class allocator for an embedded VM, released in bulk.
+//
+// Notes:
+//
+//  Scripts allocate and free large numbers of small objects. Served from the
+//  CRT heap, they leave it fragmented after the VM is gone, and the debugger
+//  keeps the memory. An arena serves them instead:
+//
+//  Blocks up to ARENA_MAX_SMALL bytes are rounded up to a multiple of
+//  ARENA_GRANULARITY, and each size is a class with its own list of freed
+//  blocks. New blocks are carved off the end of a reserved region, which is
+//  committed as it fills. Blocks have no header: like Lua's allocator
+//  interface, the caller passes the block's size back when it frees or resizes
+//  it. Larger blocks come from a private heap.
+//
+//  Nothing is returned to the system until ArenaDestroy, which releases the
+//  regions and the heap whole, whatever the VM left allocated. Providers
+//  destroy their arena when their VM stops, i.e. at the end of each run
+//  unless the VM is persistent (!startvm).
+//
+// @EndHeader@
+//******************************************************************************
+#include "arena.h"
+#include <string.h>
+
+// Address space reserved for each region, and how much of it is committed at a
+// time.
+//
+const SIZE_T ARENA_REGION_RESERVE = 4 * 1024 * 1024;
+
+const SIZE_T ARENA_COMMIT_STEP = 64 * 1024;
+
+struct ArenaRegion
+{
+	// Region carved from before this one, if any.
+	//
+	ArenaRegion* Prev;
+
+	// Next free byte, end of the committed part, and end of the reservation.
+	//
+	BYTE* Next;
+
+	BYTE* Committed;
+
+	BYTE* End;
+};
+
+// Space taken by the region header, keeping the blocks after it aligned.
+//
+const SIZE_T ARENA_REGION_HEADER =
+	(sizeof(ArenaRegion) + ARENA_GRANULARITY - 1) & ~(ARENA_GRANULARITY - 1);
+
+//------------------------------------------------------------------------------
+// Function: sizeClass
+//
+// Description:
+//
+//  Size class of a small block.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static ULONG
+sizeClass(
+	_In_ SIZE_T size)
+{
+	return size ? (ULONG)((size - 1) / ARENA_GRANULARITY) : 0;
+}
+
+//------------------------------------------------------------------------------
+// Function: newRegion
+//
+// Description:
+//
+//  Reserve a new region and make it current.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The region, or nullptr if out of memory.
+//
+// Notes:
+//
+static ArenaRegion*
+newRegion(
+	_Inout_ Arena* arena)
+{
+	BYTE* base = (BYTE*)VirtualAlloc(
+		nullptr, ARENA_REGION_RESERVE, MEM_RESERVE, PAGE_NOACCESS);
+	if (!base)
+	{
+		return nullptr;
+	}
+
+	if (!VirtualAlloc(base, ARENA_COMMIT_STEP, MEM_COMMIT, PAGE_READWRITE))
+	{
+		VirtualFree(base, 0, MEM_RELEASE);
+		return nullptr;
+	}
+
+	ArenaRegion* region = (ArenaRegion*)base;
+	region->Prev = arena->Regions;
+	region->Next = base + ARENA_REGION_HEADER;
+	region->Committed = base + ARENA_COMMIT_STEP;
+	region->End = base + ARENA_REGION_RESERVE;
+
+	arena->Regions = region;
+	arena->CommittedBytes += ARENA_COMMIT_STEP;
+	return region;
+}
+
+//------------------------------------------------------------------------------
+// Function: carveBlock
+//
+// Description:
+//
+//  Take a new small block from the current region.
+//
+// Parameters:
+//
+//  cb - Size of the block. A multiple of ARENA_GRANULARITY.
+//
+// Returns:
+//
+//  The block, or nullptr if out of memory.
+//
+// Notes:
+//
+//  Whatever is left at the end of a full region is abandoned.
+//
+static void*
+carveBlock(
+	_Inout_ Arena* arena,
+	_In_ SIZE_T cb)
+{
+	ArenaRegion* region = arena->Regions;
+
+	if (!region || (SIZE_T)(region->End - region->Next) < cb)
+	{
+		region = newRegion(arena);
+		if (!region)
+		{
+			return nullptr;
+		}
+	}
+
+	if ((SIZE_T)(region->Committed - region->Next) < cb)
+	{
+		if (!VirtualAlloc(
+				region->Committed, ARENA_COMMIT_STEP, MEM_COMMIT, PAGE_READWRITE))
+		{
+			return nullptr;
+		}
+		region->Committed += ARENA_COMMIT_STEP;
+		arena->CommittedBytes += ARENA_COMMIT_STEP;
+	}
+
+	void* block = region->Next;
+	region->Next += cb;
+	return block;
+}
+
+//------------------------------------------------------------------------------
+// Function: countAlloc
+//
+// Description:
+//
+//  Account for a change in the bytes the VM holds.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+countAlloc(
+	_Inout_ Arena* arena,
+	_In_ SIZE_T oldSize,
+	_In_ SIZE_T newSize)
+{
+	arena->CurrentBytes = arena->CurrentBytes - oldSize + newSize;
+	if (arena->CurrentBytes > arena->PeakBytes)
+	{
+		arena->PeakBytes = arena->CurrentBytes;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: allocBlock
+//
+// Description:
+//
+//  Allocate a block without accounting for it.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void*
+allocBlock(
+	_Inout_ Arena* arena,
+	_In_ SIZE_T size)
+{
+	if (size > ARENA_MAX_SMALL)
+	{
+		if (!arena->LargeHeap)
+		{
+			arena->LargeHeap = HeapCreate(HEAP_NO_SERIALIZE, 0, 0);
+			if (!arena->LargeHeap)
+			{
+				return nullptr;
+			}
+		}
+		return HeapAlloc(arena->LargeHeap, 0, size);
+	}
+
+	const ULONG cls = sizeClass(size);
+	void* block = arena->FreeLists[cls];
+	if (block)
+	{
+		arena->FreeLists[cls] = *(void**)block;
+		++arena->ReusedBlocks;
+		return block;
+	}
+
+	return carveBlock(arena, (cls + 1) * ARENA_GRANULARITY);
+}
+
+//------------------------------------------------------------------------------
+// Function: freeBlock
+//
+// Description:
+//
+//  Free a block without accounting for it.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+freeBlock(
+	_Inout_ Arena* arena,
+	_In_ void* ptr,
+	_In_ SIZE_T size)
+{
+	if (size > ARENA_MAX_SMALL)
+	{
+		HeapFree(arena->LargeHeap, 0, ptr);
+		return;
+	}
+
+	const ULONG cls = sizeClass(size);
+	*(void**)ptr = arena->FreeLists[cls];
+	arena->FreeLists[cls] = ptr;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArenaAlloc
+//
+// Description:
+//
+//  Allocate a block.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The block, aligned to ARENA_GRANULARITY, or nullptr if out of memory.
+//
+// Notes:
+//
+_Check_return_ void*
+ArenaAlloc(
+	_Inout_ Arena* arena,
+	_In_ SIZE_T size)
+{
+	void* block = allocBlock(arena, size);
+	if (block)
+	{
+		countAlloc(arena, 0, size);
+	}
+	return block;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArenaFree
+//
+// Description:
+//
+//  Free a block.
+//
+// Parameters:
+//
+//  size - Size the block was allocated (or last resized) with.
+//
+// Returns:
+//
+// Notes:
+//
+void
+ArenaFree(
+	_Inout_ Arena* arena,
+	_In_opt_ void* ptr,
+	_In_ SIZE_T size)
+{
+	if (ptr)
+	{
+		freeBlock(arena, ptr, size);
+		countAlloc(arena, size, 0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: ArenaRealloc
+//
+// Description:
+//
+//  Resize a block, moving it if needed.
+//
+// Parameters:
+//
+//  oldSize - Size the block was allocated (or last resized) with.
+//
+// Returns:
+//
+//  The block, or nullptr if out of memory, in which case 'ptr' is untouched.
+//
+// Notes:
+//
+//  Never fails to shrink a block, as Lua requires. A small block that shrinks
+//  stays where it is, and is freed to the smaller size class later; it is
+//  bigger than that class needs, which is harmless. Likewise a large block
+//  that can't be moved into a size class.
+//
+_Check_return_ void*
+ArenaRealloc(
+	_Inout_ Arena* arena,
+	_In_opt_ void* ptr,
+	_In_ SIZE_T oldSize,
+	_In_ SIZE_T newSize)
+{
+	void* block = nullptr;
+
+	if (!ptr)
+	{
+		return ArenaAlloc(arena, newSize);
+	}
+
+	// Small blocks stay put if they shrink or keep their size class.
+	//
+	if (oldSize <= ARENA_MAX_SMALL &&
+		(newSize <= oldSize || sizeClass(newSize) == sizeClass(oldSize)))
+	{
+		countAlloc(arena, oldSize, newSize);
+		return ptr;
+	}
+
+	if (oldSize > ARENA_MAX_SMALL && newSize > ARENA_MAX_SMALL)
+	{
+		block = HeapReAlloc(arena->LargeHeap, 0, ptr, newSize);
+		if (!block && newSize <= oldSize)
+		{
+			block = ptr;
+		}
+	}
+	else
+	{
+		block = allocBlock(arena, newSize);
+		if (block)
+		{
+			memcpy(block, ptr, min(oldSize, newSize));
+			freeBlock(arena, ptr, oldSize);
+		}
+		else if (newSize <= oldSize)
+		{
+			block = ptr;
+		}
+	}
+
+	if (block)
+	{
+		countAlloc(arena, oldSize, newSize);
+	}
+	return block;
+}
+
+//------------------------------------------------------------------------------
+// Function: ArenaDestroy
+//
+// Description:
+//
+//  Release all of an arena's memory, including blocks not yet freed.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Leaves the arena zeroed, ready for reuse.
+//
+void
+ArenaDestroy(
+	_Inout_ Arena* arena)
+{
+	ArenaRegion* region = arena->Regions;
+	while (region)
+	{
+		ArenaRegion* prev = region->Prev;
+		VirtualFree(region, 0, MEM_RELEASE);
+		region = prev;
+	}
+
+	if (arena->LargeHeap)
+	{
+		HeapDestroy(arena->LargeHeap);
+	}
+
+	ZeroMemory(arena, sizeof(*arena));
+}
@@ -0,0 +1,89 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: arena.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Size-class allocator for an embedded VM, released in bulk.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+
+// Blocks are rounded up to a multiple of this. Also their alignment.
+//
+const SIZE_T ARENA_GRANULARITY = 16;
+
+// Largest block served from a size class. Bigger ones come from the arena's
+// private heap.
+//
+const SIZE_T ARENA_MAX_SMALL = 2048;
+
+const ULONG ARENA_SIZE_CLASSES = (ULONG)(ARENA_MAX_SMALL / ARENA_GRANULARITY);
+
+// ArenaRegion - A reserved range of address space that small blocks are carved
+// from. Committed as it fills.
+//
+struct ArenaRegion;
+
+// Arena - Allocator state. Embedded in each provider. Zero-initialize before
+// use. Not thread-safe.
+//
+struct Arena
+{
+	// Head of each size class' list of freed blocks. The link is kept in the
+	// block itself.
+	//
+	void* FreeLists[ARENA_SIZE_CLASSES];
+
+	// Region small blocks are currently carved from, linked to the earlier
+	// ones.
+	//
+	ArenaRegion* Regions;
+
+	// Private heap for large blocks. Created on first use.
+	//
+	HANDLE LargeHeap;
+
+	// Bytes the VM has asked for and not freed, and the most there have been.
+	//
+	UINT64 CurrentBytes;
+
+	UINT64 PeakBytes;
+
+	// Bytes committed in regions.
+	//
+	UINT64 CommittedBytes;
+
+	// Small blocks served from a free list rather than carved anew.
+	//
+	UINT64 ReusedBlocks;
+};
+
+_Check_return_ void*
+ArenaAlloc(
+	_Inout_ Arena* arena,
+	_In_ SIZE_T size);
+
+void
+ArenaFree(
+	_Inout_ Arena* arena,
+	_In_opt_ void* ptr,
+	_In_ SIZE_T size);
+
+_Check_return_ void*
+ArenaRealloc(
+	_Inout_ Arena* arena,
+	_In_opt_ void* ptr,
+	_In_ SIZE_T oldSize,
+	_In_ SIZE_T newSize);
+
+void
+ArenaDestroy(
+	_Inout_ Arena* arena);
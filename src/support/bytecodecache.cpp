@@ -0,0 +1,452 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: bytecodecache.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  On-disk cache of compiled script bytecode.
+//
+// Notes:
+//
+//  Providers whose language has no bytecode cache of its own (Lua and Ruby)
+//  use this to skip parsing and compiling scripts and the libraries they
+//  require on every run. Entries live in the directory set by !bytecodecache
+//  and are named after a hash of the source path. Each starts with a header
+//  recording the source's full path, size and last write time; an entry is
+//  only used if all three still match.
+//
+//  The bytecode itself is opaque here. Each provider is responsible for
+//  rejecting bytecode from a different interpreter version, after which it
+//  compiles the source and overwrites the entry.
+//
+//  Entries are written to a temporary file and renamed into place, so a
+//  reader never sees a partial entry.
+//
+// @EndHeader@
+//******************************************************************************
+#include "bytecodecache.h"
+#include "../common.h"
+#include <strsafe.h>
+#include <ctype.h>
+
+// "DSBC"
+//
+const ULONG BYTECODE_CACHE_MAGIC = 0x43425344;
+
+// Bump when BytecodeCacheHeader changes.
+//
+const ULONG BYTECODE_CACHE_VERSION = 1;
+
+// Largest entry we'll read. Anything bigger is treated as corrupt.
+//
+const ULONG BYTECODE_CACHE_MAX_CODE = 64 * 1024 * 1024;
+
+// BytecodeCacheHeader - Start of every cache entry. Followed by CodeSize
+// bytes of bytecode.
+//
+struct BytecodeCacheHeader
+{
+	ULONG Magic;
+	ULONG Version;
+	UINT64 SourceSize;
+	UINT64 SourceWriteTime;
+	ULONG CodeSize;
+
+	// Guards against two paths with the same hash.
+	//
+	char SourcePath[MAX_PATH];
+};
+
+//------------------------------------------------------------------------------
+// Function: hashPath
+//
+// Description:
+//
+//  FNV-1a hash of a path, ignoring case.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+hashPath(
+	_In_z_ const char* path)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	for (const char* p = path; *p; ++p)
+	{
+		hash ^= (UCHAR)tolower((UCHAR)*p);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: createDirectories
+//
+// Description:
+//
+//  Create a directory and any missing parents.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true if the directory exists afterwards.
+//
+// Notes:
+//
+static bool
+createDirectories(
+	_In_z_ const char* dir)
+{
+	char path[MAX_PATH];
+	if (FAILED(StringCchCopyA(STRING_AND_CCH(path), dir)))
+	{
+		return false;
+	}
+
+	// Create each parent in turn. Failures are expected for the ones that
+	// already exist (and for the drive or share), so only the final result
+	// counts.
+	//
+	for (char* p = path + 1; *p; ++p)
+	{
+		if (*p == '\\' || *p == '/')
+		{
+			const char saved = *p;
+			*p = 0;
+			CreateDirectoryA(path, nullptr);
+			*p = saved;
+		}
+	}
+	CreateDirectoryA(path, nullptr);
+
+	const DWORD attrs = GetFileAttributesA(path);
+	return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+//------------------------------------------------------------------------------
+// Function: readFully
+//
+// Description:
+//
+//  Read exactly 'cb' bytes from a file.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success.
+//
+// Notes:
+//
+static bool
+readFully(
+	_In_ HANDLE file,
+	_Out_writes_bytes_(cb) void* buf,
+	_In_ ULONG cb)
+{
+	DWORD cbRead = 0;
+	return ReadFile(file, buf, cb, &cbRead, nullptr) && cbRead == cb;
+}
+
+//------------------------------------------------------------------------------
+// Function: BytecodeCacheLookup
+//
+// Description:
+//
+//  Look up the cached bytecode for a source file.
+//
+// Parameters:
+//
+//  sourcePath - Path of the source file. Relative paths are resolved against
+//   the current directory.
+//
+//  ext - Extension of the cache entry. Distinguishes providers.
+//
+//  key - Receives the entry's key, for BytecodeCacheStore.
+//
+//  code - Receives the bytecode on a hit, to be freed with
+//   BytecodeCacheFree. Null otherwise.
+//
+//  cbCode - Receives the size of the bytecode.
+//
+// Returns:
+//
+//  S_OK on a hit, S_FALSE otherwise.
+//
+// Notes:
+//
+//  On a miss, the caller compiles the source and stores the result with
+//  'key'. If the cache is disabled or the source can't be found, 'key' is
+//  left empty and storing is a no-op.
+//
+_Check_return_ HRESULT
+BytecodeCacheLookup(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* sourcePath,
+	_In_z_ const char* ext,
+	_Out_ BytecodeCacheKey* key,
+	_Outptr_result_bytebuffer_maybenull_(*cbCode) BYTE** code,
+	_Out_ ULONG* cbCode)
+{
+	HRESULT hr = S_FALSE;
+	WIN32_FILE_ATTRIBUTE_DATA attrs = {};
+	HANDLE file = INVALID_HANDLE_VALUE;
+	BytecodeCacheHeader header = {};
+	BYTE* buf = nullptr;
+	DWORD fullPathLen = 0;
+
+	ZeroMemory(key, sizeof(*key));
+	*code = nullptr;
+	*cbCode = 0;
+
+	if (!hostCtxt->BytecodeCacheDir[0])
+	{
+		goto exit;
+	}
+
+	// Canonicalize so that the same script reached through different paths
+	// (e.g. relative to different working directories) maps to one entry, and
+	// different scripts never share one.
+	//
+	fullPathLen = GetFullPathNameA(
+		sourcePath,
+		_countof(key->SourcePath),
+		key->SourcePath,
+		nullptr);
+	if (!fullPathLen || fullPathLen >= _countof(key->SourcePath))
+	{
+		ZeroMemory(key, sizeof(*key));
+		goto exit;
+	}
+
+	if (!GetFileAttributesExA(key->SourcePath, GetFileExInfoStandard, &attrs))
+	{
+		ZeroMemory(key, sizeof(*key));
+		goto exit;
+	}
+
+	if (FAILED(StringCchPrintfA(
+			STRING_AND_CCH(key->CachePath),
+			"%s\\%016I64x.%s",
+			hostCtxt->BytecodeCacheDir,
+			hashPath(key->SourcePath),
+			ext)))
+	{
+		ZeroMemory(key, sizeof(*key));
+		goto exit;
+	}
+
+	key->SourceSize = ((UINT64)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+	key->SourceWriteTime =
+		((UINT64)attrs.ftLastWriteTime.dwHighDateTime << 32) |
+		attrs.ftLastWriteTime.dwLowDateTime;
+
+	file = CreateFileA(
+		key->CachePath,
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		goto exit;
+	}
+
+	if (!readFully(file, &header, sizeof(header)) ||
+		header.Magic != BYTECODE_CACHE_MAGIC ||
+		header.Version != BYTECODE_CACHE_VERSION ||
+		header.SourceSize != key->SourceSize ||
+		header.SourceWriteTime != key->SourceWriteTime ||
+		header.CodeSize == 0 ||
+		header.CodeSize > BYTECODE_CACHE_MAX_CODE)
+	{
+		goto exit;
+	}
+
+	header.SourcePath[_countof(header.SourcePath) - 1] = 0;
+	if (_stricmp(header.SourcePath, key->SourcePath))
+	{
+		goto exit;
+	}
+
+	buf = (BYTE*)HeapAlloc(GetProcessHeap(), 0, header.CodeSize);
+	if (!buf)
+	{
+		goto exit;
+	}
+
+	if (!readFully(file, buf, header.CodeSize))
+	{
+		goto exit;
+	}
+
+	*code = buf;
+	*cbCode = header.CodeSize;
+	buf = nullptr;
+	hr = S_OK;
+
+exit:
+	BytecodeCacheFree(buf);
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: BytecodeCacheFree
+//
+// Description:
+//
+//  Free bytecode returned by BytecodeCacheLookup.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+BytecodeCacheFree(
+	_In_opt_ BYTE* code)
+{
+	if (code)
+	{
+		HeapFree(GetProcessHeap(), 0, code);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: BytecodeCacheStore
+//
+// Description:
+//
+//  Store the bytecode compiled for a source file that missed the cache.
+//
+// Parameters:
+//
+//  key - Key filled in by BytecodeCacheLookup.
+//
+//  code - Bytecode to store.
+//
+//  cbCode - Size of the bytecode.
+//
+// Returns:
+//
+//  S_OK if stored, S_FALSE if the cache is disabled, or a failure HRESULT.
+//
+// Notes:
+//
+//  Callers can ignore failures: the source is simply compiled again next
+//  time.
+//
+_Check_return_ HRESULT
+BytecodeCacheStore(
+	_In_ const BytecodeCacheKey* key,
+	_In_reads_bytes_(cbCode) const void* code,
+	_In_ ULONG cbCode)
+{
+	HRESULT hr = S_OK;
+	char dir[MAX_PATH];
+	char tempPath[MAX_PATH];
+	char* lastBackSlash = nullptr;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	BytecodeCacheHeader header = {};
+	DWORD cbWritten = 0;
+	bool written = false;
+
+	if (!key->CachePath[0])
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	if (!cbCode || cbCode > BYTECODE_CACHE_MAX_CODE)
+	{
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	StringCchCopyA(STRING_AND_CCH(dir), key->CachePath);
+	lastBackSlash = strrchr(dir, '\\');
+	if (lastBackSlash)
+	{
+		*lastBackSlash = 0;
+		if (!createDirectories(dir))
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+			goto exit;
+		}
+	}
+
+	// Unique per thread, so concurrent writers (e.g. two debuggers) don't
+	// collide.
+	//
+	hr = StringCchPrintfA(
+		STRING_AND_CCH(tempPath),
+		"%s.%lu.%lu.tmp",
+		key->CachePath,
+		GetCurrentProcessId(),
+		GetCurrentThreadId());
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	file = CreateFileA(
+		tempPath,
+		GENERIC_WRITE,
+		0 /* share mode */,
+		nullptr,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	header.Magic = BYTECODE_CACHE_MAGIC;
+	header.Version = BYTECODE_CACHE_VERSION;
+	header.SourceSize = key->SourceSize;
+	header.SourceWriteTime = key->SourceWriteTime;
+	header.CodeSize = cbCode;
+	StringCchCopyA(STRING_AND_CCH(header.SourcePath), key->SourcePath);
+
+	written =
+		WriteFile(file, &header, sizeof(header), &cbWritten, nullptr) &&
+		cbWritten == sizeof(header) &&
+		WriteFile(file, code, cbCode, &cbWritten, nullptr) &&
+		cbWritten == cbCode;
+	if (!written)
+	{
+		hr = E_FAIL;
+	}
+
+	CloseHandle(file);
+
+	if (written && !MoveFileExA(tempPath, key->CachePath, MOVEFILE_REPLACE_EXISTING))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		written = false;
+	}
+
+	if (!written)
+	{
+		DeleteFileA(tempPath);
+	}
+
+exit:
+	return hr;
+}
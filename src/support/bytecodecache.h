@@ -0,0 +1,56 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: bytecodecache.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  On-disk cache of compiled script bytecode.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// BytecodeCacheKey - Identifies the cache entry for one version of a source
+// file. Filled in by BytecodeCacheLookup and passed to BytecodeCacheStore.
+//
+struct BytecodeCacheKey
+{
+	// Path of the cache entry, or empty if the cache is disabled.
+	//
+	char CachePath[MAX_PATH];
+
+	// Full path of the source file.
+	//
+	char SourcePath[MAX_PATH];
+
+	// Size and last write time of the source file when it was looked up.
+	//
+	UINT64 SourceSize;
+	UINT64 SourceWriteTime;
+};
+
+_Check_return_ HRESULT
+BytecodeCacheLookup(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* sourcePath,
+	_In_z_ const char* ext,
+	_Out_ BytecodeCacheKey* key,
+	_Outptr_result_bytebuffer_maybenull_(*cbCode) BYTE** code,
+	_Out_ ULONG* cbCode);
+
+void
+BytecodeCacheFree(
+	_In_opt_ BYTE* code);
+
+_Check_return_ HRESULT
+BytecodeCacheStore(
+	_In_ const BytecodeCacheKey* key,
+	_In_reads_bytes_(cbCode) const void* code,
+	_In_ ULONG cbCode);
@@ -16,7 +16,151 @@
 #include "../common.h"
 #include "util.h"
 #include "symcache.h"
+#include "trace.h"
+#include "stats.h"
 #include <strsafe.h>
+#include <map>
+#include <unordered_map>
+#include <string>
+
+// Key is module/type-id of an array type, value is the typed data of its
+// element zero.
+//
+typedef std::map<ModuleAndTypeId, DEBUG_TYPED_DATA> ElemTypeCacheMapT;
+
+// Key is module/type-id, value is the typed data of some instance of that type,
+// which is rebased to create further instances.
+//
+typedef std::map<ModuleAndTypeId, DEBUG_TYPED_DATA> TypeTemplateCacheMapT;
+
+// Key is module/type-id of a pointer type, value is the size of the type it
+// points to.
+//
+typedef std::map<ModuleAndTypeId, ULONG> PointeeSizeCacheMapT;
+
+// FieldAccessor - Precomputed access to one field of a type.
+//
+struct FieldAccessor
+{
+	// Name of the field. Guards against hash collisions.
+	//
+	std::string Name;
+
+	// Offset of the field from the start of the containing object.
+	//
+	ULONG Offset;
+
+	// Typed data of the field in some instance, without its value. Gives the
+	// field's type; 'Offset' is rebased for each containing object.
+	//
+	DEBUG_TYPED_DATA Template;
+
+	// Must the value be read when the field is accessed? True for pointers,
+	// whose typed data carries the pointer value for dereferencing. Other
+	// primitives are read on demand by the providers.
+	//
+	bool ReadValue;
+
+	// Can't be located from the layout, e.g. a member of a virtual base, whose
+	// offset depends on the most-derived object. Always resolved by DbgEng.
+	//
+	bool Uncacheable;
+};
+
+// TypeLayout - Fields of one type accessed so far. Key is a hash of the field
+// name.
+//
+typedef std::unordered_map<UINT64, FieldAccessor> TypeLayout;
+
+// Key is module/type-id of a UDT, value is its field accessors.
+//
+typedef std::map<ModuleAndTypeId, TypeLayout> TypeLayoutCacheMapT;
+
+static ElemTypeCacheMapT s_ElemTypeCache;
+static TypeTemplateCacheMapT s_TypeTemplateCache;
+static PointeeSizeCacheMapT s_PointeeSizeCache;
+static TypeLayoutCacheMapT s_TypeLayoutCache;
+
+// Most recently used layout, since scripts tend to access several fields of
+// the same type in a row.
+//
+static ModuleAndTypeId s_LastLayoutKey;
+static TypeLayout* s_LastLayout;
+
+// Field names up to this long are requested from DbgEng without allocating.
+//
+const ULONG FIELD_REQUEST_STACK_NAME_LEN = 128;
+
+//------------------------------------------------------------------------------
+// Function: typedDataRequest
+//
+// Description:
+//
+//  Issue an EXT_TYPED_DATA request to DbgEng.
+//
+// Parameters:
+//
+//  request - Request buffer.
+//  cbRequest - Size of 'request'.
+//  response - Response buffer.
+//  cbResponse - Size of 'response'.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Traced (see trace.h).
+//
+static _Check_return_ HRESULT
+typedDataRequest(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_reads_bytes_(cbRequest) EXT_TYPED_DATA* request,
+	_In_ ULONG cbRequest,
+	_Out_writes_bytes_(cbResponse) EXT_TYPED_DATA* response,
+	_In_ ULONG cbResponse)
+{
+	HRESULT hr = S_OK;
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallTypedData,
+			request,
+			cbRequest,
+			nullptr,
+			0,
+			response,
+			cbResponse,
+			nullptr,
+			&hr))
+	{
+		return hr;
+	}
+
+	const LONGLONG start = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugAdvanced->Request(
+		DEBUG_REQUEST_EXT_TYPED_DATA_ANSI,
+		request,
+		cbRequest,
+		response,
+		cbResponse,
+		nullptr);
+	StatsEnd(hostCtxt, StatsTimerTypedData, start);
+
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallTypedData,
+		request,
+		cbRequest,
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? response : nullptr,
+		cbResponse,
+		hr);
+
+	return hr;
+}
 
 //------------------------------------------------------------------------------
 // Function: fillTypeAndModuleName
@@ -96,6 +240,7 @@ DsWrapTypedData(
 
 	typObj->TypedData = *typedData;
 	typObj->TypedDataValid = true;
+	typObj->ValueValid = false;
 
 	hr = fillTypeAndModuleName(
 		hostCtxt,
@@ -110,6 +255,144 @@ exit:
 	return hr;
 }
 
+//------------------------------------------------------------------------------
+// Function: identityKey
+//
+// Description:
+//
+//  Where a typed object lives: its address, or for a value that isn't in
+//  memory (e.g. a pointer computed by DsTypedObjectOffset), the value itself.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+identityKey(
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	return (typedData->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY) ?
+		typedData->Offset : typedData->Data;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsTypedDataHash
+//
+// Description:
+//
+//  Hash of the identity of a typed object: its address (or value, if it isn't
+//  in memory), module and type.
+//
+// Parameters:
+//
+// Returns:
+//
+//  FNV-1a hash of the identity.
+//
+// Notes:
+//
+//  Scripts use this (through the providers' hash functions) to put
+//  TypedObjects in sets and dictionaries, and providers use it to find a live
+//  wrapper for the same object instead of creating another.
+//
+_Check_return_ UINT64
+DsTypedDataHash(
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	const UINT64 parts[] =
+	{
+		identityKey(typedData),
+		typedData->ModBase,
+		typedData->TypeId,
+		typedData->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY
+	};
+	const BYTE* bytes = (const BYTE*)parts;
+	UINT64 hash = 14695981039346656037ULL;
+
+	for (ULONG i = 0; i < sizeof(parts); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsTypedDataSameObject
+//
+// Description:
+//
+//  Do two typed objects represent the same object, i.e. the same type at the
+//  same address?
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Names don't count: a field and a pointer to it dereferenced are the same
+//  object. Values that aren't in memory have no address, and are the same only
+//  if their types and values are.
+//
+_Check_return_ bool
+DsTypedDataSameObject(
+	_In_ const DEBUG_TYPED_DATA* a,
+	_In_ const DEBUG_TYPED_DATA* b)
+{
+	return (a->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY) ==
+			(b->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY) &&
+		identityKey(a) == identityKey(b) &&
+		a->ModBase == b->ModBase &&
+		a->TypeId == b->TypeId;
+}
+
+//------------------------------------------------------------------------------
+// Function: rebaseTypeTemplate
+//
+// Description:
+//
+//  Create the typed data of an object from a cached instance of its type.
+//
+// Parameters:
+//
+//  typeId - Type of the object.
+//  moduleBase - Module containing the type.
+//  virtualAddress - Address of the object.
+//  typObj - Object to populate.
+//
+// Returns:
+//
+//  true if the type was cached and 'typObj' was populated.
+//
+// Notes:
+//
+//  Only aggregates (UDTs, arrays) are cached. Their typed data depends on
+//  their address only through 'Offset', so a template can be moved anywhere.
+//
+static bool
+rebaseTypeTemplate(
+	_In_ ULONG typeId,
+	_In_ UINT64 moduleBase,
+	_In_ UINT64 virtualAddress,
+	_Out_ DbgScriptTypedObject* typObj)
+{
+	const ModuleAndTypeId key = { typeId, moduleBase };
+	TypeTemplateCacheMapT::iterator it = s_TypeTemplateCache.find(key);
+	if (it == s_TypeTemplateCache.end())
+	{
+		return false;
+	}
+
+	typObj->TypedData = it->second;
+	typObj->TypedData.Offset = virtualAddress;
+	typObj->TypedDataValid = true;
+
+	return true;
+}
+
 _Check_return_ HRESULT
 DsInitializeTypedObject(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -122,6 +405,11 @@ DsInitializeTypedObject(
 	_Out_ DbgScriptTypedObject* typObj)
 {
 	HRESULT hr = S_OK;
+
+	// Callers may hand us uninitialized memory.
+	//
+	typObj->TypedDataValid = false;
+	typObj->ValueValid = false;
 	
 	if (name)
 	{
@@ -161,7 +449,14 @@ DsInitializeTypedObject(
 	// Can't generate typed data for null pointers. Then again, doesn't matter
 	// much since can't traverse a null pointer anyway.
 	//
-	if (virtualAddress)
+	if (virtualAddress && !wantPointer &&
+		rebaseTypeTemplate(typeId, moduleBase, virtualAddress, typObj))
+	{
+		// Created from a previous instance of the type. No DbgEng request
+		// needed.
+		//
+	}
+	else if (virtualAddress)
 	{
 		EXT_TYPED_DATA request = {};
 		EXT_TYPED_DATA response = {};
@@ -174,13 +469,12 @@ DsInitializeTypedObject(
 		request.InData.Offset = virtualAddress;
 		request.InData.TypeId = typeId;
 
-		hr = hostCtxt->DebugAdvanced->Request(
-			DEBUG_REQUEST_EXT_TYPED_DATA_ANSI,
+		hr = typedDataRequest(
+			hostCtxt,
 			&request,
 			sizeof(request),
 			&response,
-			sizeof(response),
-			nullptr);
+			sizeof(response));
 		if (FAILED(hr))
 		{
 			hostCtxt->DebugControl->Output(
@@ -197,6 +491,15 @@ DsInitializeTypedObject(
 		if (!wantPointer)
 		{
 			assert(typObj->TypedData.Offset == virtualAddress);
+
+			// Primitives (including pointers) carry their value in 'Data',
+			// which DbgEng relies on, so only aggregates can be rebased.
+			//
+			if (!DsTypedObjectIsPrimitive(typObj))
+			{
+				const ModuleAndTypeId key = { typeId, moduleBase };
+				s_TypeTemplateCache[key] = typObj->TypedData;
+			}
 		}
 	}
 	else
@@ -209,65 +512,357 @@ exit:
 	return hr;
 }
 
-_Check_return_ HRESULT
-DsTypedObjectGetField(
+//------------------------------------------------------------------------------
+// Function: hashFieldName
+//
+// Description:
+//
+//  FNV-1a hash of a field name.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+hashFieldName(
+	_In_z_ const char* fieldName)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	for (const char* p = fieldName; *p; ++p)
+	{
+		hash ^= (BYTE)*p;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: isLayoutCacheable
+//
+// Description:
+//
+//  Can fields of this object be located from its type's layout?
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Only UDTs in memory: fields of register-based objects (and of pointers,
+//  which DbgEng dereferences implicitly) don't live at a fixed offset from
+//  the object.
+//
+static bool
+isLayoutCacheable(
+	_In_ const DEBUG_TYPED_DATA* typedData)
+{
+	return typedData->Tag == SymTagUDT &&
+		(typedData->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY) &&
+		typedData->Offset;
+}
+
+//------------------------------------------------------------------------------
+// Function: findTypeLayout
+//
+// Description:
+//
+//  Get the layout of a type, optionally creating it.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The layout, or nullptr if it doesn't exist and 'create' is false.
+//
+// Notes:
+//
+static TypeLayout*
+findTypeLayout(
+	_In_ const DEBUG_TYPED_DATA* typedData,
+	_In_ bool create)
+{
+	const ModuleAndTypeId key = { typedData->TypeId, typedData->ModBase };
+
+	if (s_LastLayout &&
+		s_LastLayoutKey.TypeId == key.TypeId &&
+		s_LastLayoutKey.ModuleBase == key.ModuleBase)
+	{
+		return s_LastLayout;
+	}
+
+	TypeLayoutCacheMapT::iterator it = s_TypeLayoutCache.find(key);
+	if (it == s_TypeLayoutCache.end())
+	{
+		if (!create)
+		{
+			return nullptr;
+		}
+
+		it = s_TypeLayoutCache.insert(
+			TypeLayoutCacheMapT::value_type(key, TypeLayout())).first;
+	}
+
+	s_LastLayoutKey = key;
+	s_LastLayout = &it->second;
+	return s_LastLayout;
+}
+
+//------------------------------------------------------------------------------
+// Function: getCachedField
+//
+// Description:
+//
+//  Produce the typed data of a field from its type's layout.
+//
+// Parameters:
+//
+//  parent - Object containing the field.
+//  fieldName - Name of the field.
+//  nameHash - hashFieldName(fieldName).
+//  outData - Receives the field's typed data.
+//
+// Returns:
+//
+//  S_OK if produced, S_FALSE if the field isn't in the layout, or a failure
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+getCachedField(
 	_In_ DbgScriptHostContext* hostCtxt,
-	_In_ DbgScriptTypedObject* typedObj,
+	_In_ const DEBUG_TYPED_DATA* parent,
 	_In_z_ const char* fieldName,
-	_In_ bool fPrintMissing,
+	_In_ UINT64 nameHash,
 	_Out_ DEBUG_TYPED_DATA* outData)
 {
-	HRESULT hr = S_OK;
-	EXT_TYPED_DATA* request = nullptr;
-	EXT_TYPED_DATA* responseBuf = nullptr;
-	BYTE* requestBuf = nullptr;
-	const ULONG fieldNameLen = (ULONG)strlen(fieldName);
-	const ULONG reqSize = sizeof(EXT_TYPED_DATA) + fieldNameLen + 1;
+	HRESULT hr = S_FALSE;
+	TypeLayout* layout = nullptr;
+	TypeLayout::iterator it;
 
-	requestBuf = (BYTE*)malloc(reqSize);
-	if (!requestBuf)
+	if (!isLayoutCacheable(parent))
 	{
-		hr = E_OUTOFMEMORY;
 		goto exit;
 	}
 
-	// Response buffer must be as big as request since dbgeng memcpy's from
-	// request to response as a first step.
-	//
-	responseBuf = (EXT_TYPED_DATA*)malloc(reqSize);
-	if (!responseBuf)
+	layout = findTypeLayout(parent, false /* create */);
+	if (!layout)
 	{
-		hr = E_OUTOFMEMORY;
 		goto exit;
 	}
 
-	memset(requestBuf, 0, reqSize);
-
-	// TODO: Currently this doesn't support register-based variables, as the
-	// virtual address is not correct.
-	// Figure out what to do about them.
-	//
-	request = (EXT_TYPED_DATA*)requestBuf;
-	request->Operation = EXT_TDOP_GET_FIELD;
-	request->InData = typedObj->TypedData;
-	request->InStrIndex = sizeof(EXT_TYPED_DATA);
+	it = layout->find(nameHash);
+	if (it == layout->end() ||
+		it->second.Name != fieldName ||
+		it->second.Uncacheable)
+	{
+		goto exit;
+	}
 
-	// Must be NULL terminated.
-	//
-	memcpy(requestBuf + sizeof(EXT_TYPED_DATA), fieldName, fieldNameLen + 1);
+	*outData = it->second.Template;
+	outData->Offset = parent->Offset + it->second.Offset;
 
-	hr = hostCtxt->DebugAdvanced->Request(
-		DEBUG_REQUEST_EXT_TYPED_DATA_ANSI,
-		request,
-		reqSize,
-		responseBuf,
-		reqSize,
-		nullptr);
-	if (hr == E_NOINTERFACE)
+	if (it->second.ReadValue)
 	{
-		// This means there was no such member.
-		//
-		if (fPrintMissing)
+		hr = UtilReadPointer(hostCtxt, outData->Offset, &outData->Data);
+		if (FAILED(hr))
+		{
+			hostCtxt->DebugControl->Output(
+				DEBUG_OUTPUT_ERROR,
+				"Error: Failed to read field '%s'. Error 0x%08x.\n",
+				fieldName,
+				hr);
+			goto exit;
+		}
+	}
+
+	hr = S_OK;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: cacheField
+//
+// Description:
+//
+//  Add a field DbgEng just resolved to its type's layout.
+//
+// Parameters:
+//
+//  parent - Object containing the field.
+//  fieldName - Name of the field.
+//  nameHash - hashFieldName(fieldName).
+//  field - The field's typed data.
+//
+// Returns:
+//
+// Notes:
+//
+//  Fields that don't lie within the object (e.g. static members) aren't
+//  cached, since their address doesn't depend on the object's. Nor are fields
+//  that aren't at their type's static offset: members of virtual bases are
+//  found through the object's vbtable, so they aren't at the same offset in
+//  every object of the type. Such fields are marked so that later accesses go
+//  straight to DbgEng.
+//
+static void
+cacheField(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DEBUG_TYPED_DATA* parent,
+	_In_z_ const char* fieldName,
+	_In_ UINT64 nameHash,
+	_In_ const DEBUG_TYPED_DATA* field)
+{
+	if (!isLayoutCacheable(parent) ||
+		!(field->Flags & DEBUG_TYPED_DATA_IS_IN_MEMORY) ||
+		field->Offset < parent->Offset ||
+		field->Offset + field->Size > parent->Offset + parent->Size)
+	{
+		return;
+	}
+
+	TypeLayout* layout = findTypeLayout(parent, true /* create */);
+	if (layout->count(nameHash))
+	{
+		// Already cached, or a different field with the same hash.
+		//
+		return;
+	}
+
+	const ModuleAndTypeId key = { parent->TypeId, parent->ModBase };
+	const ULONG offset = (ULONG)(field->Offset - parent->Offset);
+	ULONG staticOffset = 0;
+
+	FieldAccessor& accessor = (*layout)[nameHash];
+	accessor.Name = fieldName;
+
+	if (FAILED(GetCachedFieldOffset(hostCtxt, key, fieldName, &staticOffset)) ||
+		staticOffset != offset)
+	{
+		accessor.Uncacheable = true;
+		return;
+	}
+
+	accessor.Offset = offset;
+	accessor.Template = *field;
+	accessor.Template.Data = 0;
+	accessor.ReadValue = field->Tag == SymTagPointerType;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsTypedObjectGetField
+//
+// Description:
+//
+//  Get the typed data of a field of an object.
+//
+// Parameters:
+//
+//  typedObj - Object containing the field.
+//  fieldName - Name of the field.
+//  fPrintMissing - Output an error if there is no such field.
+//  outData - Receives the field's typed data.
+//
+// Returns:
+//
+//  HRESULT. E_NOINTERFACE if there is no such field.
+//
+// Notes:
+//
+//  The first access to each field of a type goes to DbgEng. It's recorded in
+//  the type's layout (offset, type, and whether the value must be read), so
+//  later accesses to that field of any object of the type are computed
+//  directly: no request, and no allocation. Members of virtual bases are
+//  always resolved by DbgEng (see cacheField).
+//
+_Check_return_ HRESULT
+DsTypedObjectGetField(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typedObj,
+	_In_z_ const char* fieldName,
+	_In_ bool fPrintMissing,
+	_Out_ DEBUG_TYPED_DATA* outData)
+{
+	HRESULT hr = S_OK;
+	EXT_TYPED_DATA* request = nullptr;
+	EXT_TYPED_DATA* responseBuf = nullptr;
+	BYTE* requestBuf = nullptr;
+	const ULONG fieldNameLen = (ULONG)strlen(fieldName);
+	const ULONG reqSize = sizeof(EXT_TYPED_DATA) + fieldNameLen + 1;
+	const UINT64 nameHash = hashFieldName(fieldName);
+	const bool onStack = fieldNameLen <= FIELD_REQUEST_STACK_NAME_LEN;
+	BYTE stackRequest[sizeof(EXT_TYPED_DATA) + FIELD_REQUEST_STACK_NAME_LEN + 1];
+	BYTE stackResponse[sizeof(EXT_TYPED_DATA) + FIELD_REQUEST_STACK_NAME_LEN + 1];
+
+	hr = getCachedField(
+		hostCtxt,
+		&typedObj->TypedData,
+		fieldName,
+		nameHash,
+		outData);
+	if (hr != S_FALSE)
+	{
+		goto exit;
+	}
+
+	hr = S_OK;
+
+	if (onStack)
+	{
+		requestBuf = stackRequest;
+		responseBuf = (EXT_TYPED_DATA*)stackResponse;
+	}
+	else
+	{
+		requestBuf = (BYTE*)malloc(reqSize);
+		if (!requestBuf)
+		{
+			hr = E_OUTOFMEMORY;
+			goto exit;
+		}
+
+		// Response buffer must be as big as request since dbgeng memcpy's from
+		// request to response as a first step.
+		//
+		responseBuf = (EXT_TYPED_DATA*)malloc(reqSize);
+		if (!responseBuf)
+		{
+			hr = E_OUTOFMEMORY;
+			goto exit;
+		}
+	}
+
+	memset(requestBuf, 0, reqSize);
+
+	// TODO: Currently this doesn't support register-based variables, as the
+	// virtual address is not correct.
+	// Figure out what to do about them.
+	//
+	request = (EXT_TYPED_DATA*)requestBuf;
+	request->Operation = EXT_TDOP_GET_FIELD;
+	request->InData = typedObj->TypedData;
+	request->InStrIndex = sizeof(EXT_TYPED_DATA);
+
+	// Must be NULL terminated.
+	//
+	memcpy(requestBuf + sizeof(EXT_TYPED_DATA), fieldName, fieldNameLen + 1);
+
+	hr = typedDataRequest(
+		hostCtxt,
+		request,
+		reqSize,
+		responseBuf,
+		reqSize);
+	if (hr == E_NOINTERFACE)
+	{
+		// This means there was no such member.
+		//
+		if (fPrintMissing)
 		{
 			hostCtxt->DebugControl->Output(
 				DEBUG_OUTPUT_ERROR,
@@ -285,24 +880,40 @@ DsTypedObjectGetField(
 
 	*outData = responseBuf->OutData;
 
+	cacheField(hostCtxt, &typedObj->TypedData, fieldName, nameHash, outData);
+
 exit:
-	if (requestBuf)
+	if (!onStack)
 	{
 		free(requestBuf);
-		requestBuf = nullptr;
-	}
-	if (responseBuf)
-	{
 		free(responseBuf);
-		responseBuf = nullptr;
 	}
 	return hr;
 }
 
-_Check_return_ HRESULT
-DsTypedObjectGetArrayElement(
+//------------------------------------------------------------------------------
+// Function: getArrayElement
+//
+// Description:
+//
+//  Issue an EXT_TDOP_GET_ARRAY_ELEMENT request.
+//
+// Parameters:
+//
+//  base - Typed data of the array or pointer to index.
+//  index - Index of the element.
+//  outData - Receives the element's typed data.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+static _Check_return_ HRESULT
+getArrayElement(
 	_In_ DbgScriptHostContext* hostCtxt,
-	_In_ DbgScriptTypedObject* typObj,
+	_In_ const DEBUG_TYPED_DATA* base,
 	_In_ UINT64 index,
 	_Out_ DEBUG_TYPED_DATA* outData)
 {
@@ -310,32 +921,19 @@ DsTypedObjectGetArrayElement(
 	EXT_TYPED_DATA request = {};
 	EXT_TYPED_DATA response = {};
 
-	if (typObj->TypedData.Tag != SymTagPointerType &&
-		typObj->TypedData.Tag != SymTagArrayType)
-	{
-		// Not a pointer or array.
-		//
-		hostCtxt->DebugControl->Output(
-			DEBUG_OUTPUT_ERROR,
-			"Error: Object not a pointer or array.\n");
-		hr = E_INVALIDARG;
-		goto exit;
-	}
-
 	request.Operation = EXT_TDOP_GET_ARRAY_ELEMENT;
-	request.InData = typObj->TypedData;
+	request.InData = *base;
 	request.In64 = index;
 
 	static_assert(sizeof(request) == sizeof(response),
 		"Request and response must be equi-sized");
 
-	hr = hostCtxt->DebugAdvanced->Request(
-		DEBUG_REQUEST_EXT_TYPED_DATA_ANSI,
+	hr = typedDataRequest(
+		hostCtxt,
 		&request,
 		sizeof(request),
 		&response,
-		sizeof(response),
-		nullptr);
+		sizeof(response));
 	if (FAILED(hr))
 	{
 		hostCtxt->DebugControl->Output(
@@ -350,6 +948,33 @@ exit:
 	return hr;
 }
 
+_Check_return_ HRESULT
+DsTypedObjectGetArrayElement(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_In_ UINT64 index,
+	_Out_ DEBUG_TYPED_DATA* outData)
+{
+	HRESULT hr = S_OK;
+
+	if (typObj->TypedData.Tag != SymTagPointerType &&
+		typObj->TypedData.Tag != SymTagArrayType)
+	{
+		// Not a pointer or array.
+		//
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			"Error: Object not a pointer or array.\n");
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	hr = getArrayElement(hostCtxt, &typObj->TypedData, index, outData);
+	
+exit:
+	return hr;
+}
+
 _Check_return_ bool
 DsTypedObjectIsPrimitive(
 	_In_ DbgScriptTypedObject* typObj)
@@ -369,20 +994,27 @@ DsTypedObjectIsPrimitive(
 }
 
 //------------------------------------------------------------------------------
-// Function: DsTypedObjectGetRuntimeType
+// Function: DsTypedObjectTryGetRuntimeType
 //
 // Description:
 //
-//  Get runtime type of an object by inspecting its vtable.
+//  Get runtime type of an object by inspecting its vtable, if it has one.
 //
 // Parameters:
 //
 // Returns:
 //
+//  S_OK if 'newTypObj' was populated. S_FALSE if the object has no vtable.
+//
 // Notes:
 //
+//  Doesn't complain about objects without a vtable, so it's suitable for
+//  probing many objects of unknown kinds. Vtable lookups are cached in the
+//  host context, so after the first object of each runtime type this only
+//  reads the vptr.
+//
 _Check_return_ HRESULT
-DsTypedObjectGetRuntimeType(
+DsTypedObjectTryGetRuntimeType(
 	_In_ DbgScriptHostContext* hostCtxt,
 	_In_ const DbgScriptTypedObject* typObj,
 	_Out_ DbgScriptTypedObject* newTypObj)
@@ -390,7 +1022,7 @@ DsTypedObjectGetRuntimeType(
 	HRESULT hr = S_OK;
 	UINT64 ptrVal = 0;
 	UINT64 objAddr = typObj->TypedData.Offset;
-	char name[MAX_SYMBOL_NAME_LEN] = {};
+	ModuleAndTypeId typeInfo = {0};
 
 	// Read the vptr.
 	//
@@ -424,47 +1056,12 @@ DsTypedObjectGetRuntimeType(
 		objAddr = ptrVal;
 		ptrVal = newPtrVal;
 	}
-	
-	hr = hostCtxt->DebugSymbols->GetNameByOffset(
-		ptrVal, STRING_AND_CCH(name), nullptr, nullptr);
-	if (FAILED(hr))
-	{
-		hostCtxt->DebugControl->Output(
-			DEBUG_OUTPUT_ERROR,
-			ERR_FAILED_GET_NAME_BY_OFFSET,
-			ptrVal,
-			hr);
-		goto exit;
-	}
 
-	// If the object has a vptr, it points to a vtable with a symbol like:
-	//
-	//   hkengine!HkLogImpl::`vftable'
-	//
-	char* found = strstr(name, "::`vftable'");
-	if (!found)
-	{
-		hostCtxt->DebugControl->Output(
-			DEBUG_OUTPUT_ERROR,
-			ERR_NO_VTABLE,
-			ptrVal);
-		goto exit;
-	}
-
-	// Null out the colon.
-	//
-	*found = 0;
-	
-	// Lookup typeid/moduleBase from type name.
-	//
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, name);
-	if (!typeInfo)
+	hr = GetCachedRuntimeType(hostCtxt, ptrVal, &typeInfo);
+	if (hr != S_OK)
 	{
-		hostCtxt->DebugControl->Output(
-			DEBUG_OUTPUT_ERROR,
-			ERR_FAILED_GET_TYPE_ID,
-			name,
-			hr);
+		// No vtable, or failure.
+		//
 		goto exit;
 	}
 
@@ -474,8 +1071,8 @@ DsTypedObjectGetRuntimeType(
 		hostCtxt,
 		typObj->TypedData.Size,
 		typObj->Name,
-		typeInfo->TypeId,
-		typeInfo->ModuleBase,
+		typeInfo.TypeId,
+		typeInfo.ModuleBase,
 		objAddr,
 		false /* wantPointer */,
 		newTypObj);
@@ -492,3 +1089,736 @@ exit:
 	return hr;
 }
 
+//------------------------------------------------------------------------------
+// Function: DsTypedObjectGetRuntimeType
+//
+// Description:
+//
+//  Get runtime type of an object by inspecting its vtable.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. Fails if the object has no vtable.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+DsTypedObjectGetRuntimeType(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptTypedObject* newTypObj)
+{
+	HRESULT hr = DsTypedObjectTryGetRuntimeType(hostCtxt, typObj, newTypObj);
+	if (hr == S_FALSE)
+	{
+		hr = E_INVALIDARG;
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			ERR_NO_VTABLE,
+			typObj->TypedData.Offset);
+	}
+
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: getElementZero
+//
+// Description:
+//
+//  Get the typed data of element zero of an array or pointer object.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  For arrays, element zero lives at the array's own address, so its typed
+//  data is cached per array type and only the first lookup for a given type
+//  issues a DbgEng request. Pointers always need a request since we don't know
+//  where they point.
+//
+static _Check_return_ HRESULT
+getElementZero(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ DEBUG_TYPED_DATA* elemData)
+{
+	HRESULT hr = S_OK;
+	const bool isArray = typObj->TypedData.Tag == SymTagArrayType;
+	const ModuleAndTypeId key =
+		{ typObj->TypedData.TypeId, typObj->TypedData.ModBase };
+
+	if (isArray)
+	{
+		ElemTypeCacheMapT::iterator it = s_ElemTypeCache.find(key);
+		if (it != s_ElemTypeCache.end())
+		{
+			// Found.
+			//
+			*elemData = it->second;
+			elemData->Offset = typObj->TypedData.Offset;
+			goto exit;
+		}
+	}
+
+	hr = DsTypedObjectGetArrayElement(
+		hostCtxt,
+		typObj,
+		0,
+		elemData);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	if (isArray)
+	{
+		// Don't hang on to this instance's value.
+		//
+		DEBUG_TYPED_DATA& cached = s_ElemTypeCache[key];
+		cached = *elemData;
+		cached.Data = 0;
+	}
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsTypedObjectGetArrayLength
+//
+// Description:
+//
+//  Get the number of elements in an array object.
+//
+// Parameters:
+//
+//  numElems - Receives the number of elements.
+//
+// Returns:
+//
+//  HRESULT. E_INVALIDARG if the object is not an array.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+DsTypedObjectGetArrayLength(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ UINT64* numElems)
+{
+	HRESULT hr = S_OK;
+	DEBUG_TYPED_DATA elemData = {0};
+
+	*numElems = 0;
+
+	if (typObj->TypedData.Tag != SymTagArrayType)
+	{
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	hr = getElementZero(hostCtxt, typObj, &elemData);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	if (elemData.Size)
+	{
+		*numElems = typObj->TypedData.Size / elemData.Size;
+	}
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsTypedObjectOffset
+//
+// Description:
+//
+//  Compute the object 'count' elements away from this one, as with C pointer
+//  arithmetic.
+//
+// Parameters:
+//
+//  typObj - Object to offset from.
+//  count - Number of elements to move by. May be negative.
+//  newTypObj - Receives the new object.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  For a pointer, the result is a pointer of the same type, advanced by
+//  'count' times the size of the pointee. It doesn't live anywhere in the
+//  target, so only its value is meaningful. For anything else the result is an
+//  object of the same type, 'count' times its size away from this one.
+//
+//  Only the first offset of a given pointer type issues a DbgEng request, to
+//  learn the pointee size.
+//
+_Check_return_ HRESULT
+DsTypedObjectOffset(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_In_ INT64 count,
+	_Out_ DbgScriptTypedObject* newTypObj)
+{
+	HRESULT hr = S_OK;
+	const ModuleAndTypeId key =
+		{ typObj->TypedData.TypeId, typObj->TypedData.ModBase };
+	DEBUG_TYPED_DATA typedData = typObj->TypedData;
+	PointeeSizeCacheMapT::iterator it;
+
+	if (typObj->TypedData.Tag != SymTagPointerType)
+	{
+		typedData.Offset += (UINT64)(count * (INT64)typObj->TypedData.Size);
+
+		// Value must be refetched from the new location.
+		//
+		typedData.Data = 0;
+
+		hr = DsWrapTypedData(hostCtxt, typObj->Name, &typedData, newTypObj);
+		goto exit;
+	}
+
+	it = s_PointeeSizeCache.find(key);
+	if (it == s_PointeeSizeCache.end())
+	{
+		DEBUG_TYPED_DATA elemData = {0};
+		hr = getElementZero(hostCtxt, typObj, &elemData);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+
+		it = s_PointeeSizeCache.insert(
+			PointeeSizeCacheMapT::value_type(key, elemData.Size)).first;
+	}
+
+	typedData.Data += (UINT64)(count * (INT64)it->second);
+	typedData.Offset = 0;
+	typedData.Flags &= ~DEBUG_TYPED_DATA_IS_IN_MEMORY;
+
+	hr = DsWrapTypedData(hostCtxt, typObj->Name, &typedData, newTypObj);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	// There's no memory to read the value from, so supply it now.
+	//
+	newTypObj->Value.Value.UI64Val = typedData.Data;
+	newTypObj->ValueValid = true;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: sliceElementAddress
+//
+// Description:
+//
+//  Compute the address of an element of a slice.
+//
+// Parameters:
+//
+//  index - Index into the slice. Not bounds-checked.
+//
+// Returns:
+//
+//  Virtual address of the element.
+//
+// Notes:
+//
+static UINT64
+sliceElementAddress(
+	_In_ const DbgScriptArraySlice* slice,
+	_In_ UINT64 index)
+{
+	const INT64 elemIndex = slice->Start + (INT64)index * slice->Step;
+
+	return slice->Elem.TypedData.Offset +
+		(UINT64)(elemIndex * (INT64)slice->ElemSize);
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArraySliceInit
+//
+// Description:
+//
+//  Initialize a slice covering all the elements of an array, or the buffer a
+//  pointer points to.
+//
+// Parameters:
+//
+//  typObj - Array or pointer object.
+//  slice - Slice to initialize.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Pointers have no intrinsic length, so their slices are unbounded
+//  (Count == ARRAY_SLICE_UNBOUNDED) until narrowed with
+//  DsArraySliceGetSubSlice.
+//
+//  No target memory is read here. At most one DbgEng request is issued, to
+//  learn the element type.
+//
+_Check_return_ HRESULT
+DsArraySliceInit(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptArraySlice* slice)
+{
+	HRESULT hr = S_OK;
+	DEBUG_TYPED_DATA elemData = {0};
+
+	hr = getElementZero(hostCtxt, typObj, &elemData);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = DsWrapTypedData(
+		hostCtxt,
+		ARRAY_ELEM_NAME,
+		&elemData,
+		&slice->Elem);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	slice->Base = typObj->TypedData;
+	slice->ElemSize = elemData.Size;
+	slice->Start = 0;
+	slice->Step = 1;
+
+	if (typObj->TypedData.Tag == SymTagArrayType)
+	{
+		slice->Count = slice->ElemSize ?
+			typObj->TypedData.Size / slice->ElemSize : 0;
+	}
+	else
+	{
+		slice->Count = ARRAY_SLICE_UNBOUNDED;
+	}
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArraySliceGetSubSlice
+//
+// Description:
+//
+//  Narrow a slice down to a sub-range of its elements.
+//
+// Parameters:
+//
+//  slice - Slice to narrow.
+//  start - Index, within 'slice', of the first element of the sub-slice.
+//  count - Number of elements in the sub-slice.
+//  step - Distance, within 'slice', between consecutive elements of the
+//   sub-slice. May be negative, but not zero.
+//  subSlice - Receives the sub-slice. May alias 'slice'.
+//
+// Returns:
+//
+//  HRESULT. E_BOUNDS if the sub-slice would reach outside of 'slice'.
+//
+// Notes:
+//
+//  Purely arithmetic: no DbgEng requests are issued.
+//
+_Check_return_ HRESULT
+DsArraySliceGetSubSlice(
+	_In_ const DbgScriptArraySlice* slice,
+	_In_ UINT64 start,
+	_In_ UINT64 count,
+	_In_ INT64 step,
+	_Out_ DbgScriptArraySlice* subSlice)
+{
+	HRESULT hr = S_OK;
+
+	if (step == 0)
+	{
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	if (count)
+	{
+		const INT64 last = (INT64)start + (INT64)(count - 1) * step;
+		if (start >= slice->Count ||
+			last < 0 ||
+			(UINT64)last >= slice->Count)
+		{
+			hr = E_BOUNDS;
+			goto exit;
+		}
+	}
+
+	if (subSlice != slice)
+	{
+		*subSlice = *slice;
+	}
+
+	subSlice->Start = slice->Start + (INT64)start * slice->Step;
+	subSlice->Step = slice->Step * step;
+	subSlice->Count = count;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArraySliceGetElement
+//
+// Description:
+//
+//  Get an element of a slice.
+//
+// Parameters:
+//
+//  slice - Slice to index.
+//  index - Index of the element within the slice.
+//  elem - Receives the element.
+//
+// Returns:
+//
+//  HRESULT. E_BOUNDS if the index is past the end of the slice.
+//
+// Notes:
+//
+//  Elements of compound type are derived from element zero without DbgEng
+//  requests. Primitive elements (e.g. pointers) are resolved by DbgEng so
+//  that their value is their own.
+//
+_Check_return_ HRESULT
+DsArraySliceGetElement(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DbgScriptArraySlice* slice,
+	_In_ UINT64 index,
+	_Out_ DbgScriptTypedObject* elem)
+{
+	HRESULT hr = S_OK;
+
+	if (index >= slice->Count)
+	{
+		hr = E_BOUNDS;
+		goto exit;
+	}
+
+	*elem = slice->Elem;
+	elem->TypedData.Offset = sliceElementAddress(slice, index);
+
+	if (DsTypedObjectIsPrimitive(&slice->Elem))
+	{
+		// The template carries element zero's value. Don't let it leak into
+		// other elements.
+		//
+		elem->TypedData.Data = 0;
+
+		hr = getArrayElement(
+			hostCtxt,
+			&slice->Base,
+			(UINT64)(slice->Start + (INT64)index * slice->Step),
+			&elem->TypedData);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+	}
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArrayCursorInitFromSlice
+//
+// Description:
+//
+//  Prepare a cursor to walk the elements of a slice.
+//
+// Parameters:
+//
+//  slice - Slice to walk. Must be bounded.
+//  cursor - Cursor to initialize.
+//
+// Returns:
+//
+//  void.
+//
+// Notes:
+//
+void
+DsArrayCursorInitFromSlice(
+	_In_ const DbgScriptArraySlice* slice,
+	_Out_ DbgScriptArrayCursor* cursor)
+{
+	assert(slice->Count != ARRAY_SLICE_UNBOUNDED);
+
+	if (&cursor->Slice != slice)
+	{
+		cursor->Slice = *slice;
+	}
+	cursor->Index = 0;
+	cursor->PrefetchAddr = 0;
+	cursor->PrefetchLen = 0;
+	cursor->PrefetchSpan = nullptr;
+	cursor->PrefetchGeneration = 0;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArrayCursorInit
+//
+// Description:
+//
+//  Prepare a cursor to walk all the elements of an array.
+//
+// Parameters:
+//
+//  typObj - Array to walk.
+//  cursor - Cursor to initialize.
+//
+// Returns:
+//
+//  HRESULT. E_INVALIDARG if the object is not an array.
+//
+// Notes:
+//
+//  At most one DbgEng request is issued, to resolve element zero. Later
+//  elements are derived from it without going back to DbgEng.
+//
+_Check_return_ HRESULT
+DsArrayCursorInit(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ DbgScriptTypedObject* typObj,
+	_Out_ DbgScriptArrayCursor* cursor)
+{
+	HRESULT hr = S_OK;
+
+	if (typObj->TypedData.Tag != SymTagArrayType)
+	{
+		hr = E_INVALIDARG;
+		goto exit;
+	}
+
+	hr = DsArraySliceInit(hostCtxt, typObj, &cursor->Slice);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	DsArrayCursorInitFromSlice(&cursor->Slice, cursor);
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: readAheadValue
+//
+// Description:
+//
+//  Populate the value of a primitive element from the cursor's read-ahead
+//  window, refilling the window if the element falls outside of it.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true if the value was populated.
+//
+// Notes:
+//
+//  Failure is not an error: the caller falls back to resolving the element
+//  on its own.
+//
+//  If the mapped dump captures every remaining element in one piece, the
+//  window covers all of them and points into the mapping, so the rest of the
+//  walk copies nothing into the window and never refills it.
+//
+static _Check_return_ bool
+readAheadValue(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptArrayCursor* cursor,
+	_In_ UINT64 addr,
+	_Inout_ DbgScriptTypedObject* elem)
+{
+	const ULONG elemSize = cursor->Slice.ElemSize;
+
+	if (cursor->PrefetchSpan &&
+		(cursor->PrefetchGeneration != hostCtxt->DumpMapGeneration ||
+		 hostCtxt->Trace))
+	{
+		// The dump was unmapped, or reads must now be traced.
+		//
+		cursor->PrefetchSpan = nullptr;
+		cursor->PrefetchLen = 0;
+	}
+
+	if (addr < cursor->PrefetchAddr ||
+		addr + elemSize > cursor->PrefetchAddr + cursor->PrefetchLen)
+	{
+		const INT64 stride = cursor->Slice.Step * (INT64)elemSize;
+		const UINT64 absStride = stride < 0 ? -stride : stride;
+		const UINT64 remaining = cursor->Slice.Count - cursor->Index;
+
+		cursor->PrefetchSpan = nullptr;
+
+		if (remaining - 1 <= (ULONG_MAX - elemSize) / absStride)
+		{
+			// Try to cover every remaining element without copying.
+			//
+			const ULONG cbAll = (ULONG)((remaining - 1) * absStride + elemSize);
+			const UINT64 spanAddr = stride < 0 ? addr + elemSize - cbAll : addr;
+
+			cursor->PrefetchSpan = UtilGetSpan(hostCtxt, spanAddr, cbAll);
+			if (cursor->PrefetchSpan)
+			{
+				cursor->PrefetchAddr = spanAddr;
+				cursor->PrefetchLen = cbAll;
+				cursor->PrefetchGeneration = hostCtxt->DumpMapGeneration;
+			}
+		}
+
+		if (!cursor->PrefetchSpan)
+		{
+			// Refill the window with as many of the remaining elements as
+			// fit, in the direction we're walking.
+			//
+			UINT64 numElems = 1 + (ARRAY_CURSOR_PREFETCH_SIZE - elemSize) / absStride;
+			if (numElems > remaining)
+			{
+				numElems = remaining;
+			}
+
+			const ULONG cbToRead = (ULONG)((numElems - 1) * absStride + elemSize);
+			const UINT64 windowAddr = stride < 0 ? addr + elemSize - cbToRead : addr;
+
+			ULONG cbRead = 0;
+			HRESULT hr = UtilReadBytes(
+				hostCtxt,
+				windowAddr,
+				(char*)cursor->PrefetchBuf,
+				cbToRead,
+				&cbRead);
+
+			cursor->PrefetchAddr = windowAddr;
+			cursor->PrefetchLen = SUCCEEDED(hr) ? cbRead : 0;
+
+			if (addr + elemSize > cursor->PrefetchAddr + cursor->PrefetchLen)
+			{
+				return false;
+			}
+		}
+	}
+
+	const BYTE* window =
+		cursor->PrefetchSpan ? cursor->PrefetchSpan : cursor->PrefetchBuf;
+
+	memset(&elem->Value, 0, sizeof(elem->Value));
+	memcpy(
+		&elem->Value.Value,
+		window + (addr - cursor->PrefetchAddr),
+		elemSize);
+
+	elem->TypedData.Data = elem->Value.Value.UI64Val;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: DsArrayCursorNext
+//
+// Description:
+//
+//  Produce the next element from a cursor.
+//
+// Parameters:
+//
+//  cursor - Initialized cursor.
+//  elem - Receives the element.
+//
+// Returns:
+//
+//  S_OK if an element was produced. S_FALSE when the cursor is exhausted.
+//
+// Notes:
+//
+//  Elements of primitive type come back with their value already populated
+//  (ValueValid is set), so reading it costs no further round trips. Elements
+//  the read-ahead window can't cover are resolved one at a time instead.
+//
+_Check_return_ HRESULT
+DsArrayCursorNext(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ DbgScriptArrayCursor* cursor,
+	_Out_ DbgScriptTypedObject* elem)
+{
+	HRESULT hr = S_OK;
+	UINT64 addr = 0;
+	DbgScriptArraySlice* slice = &cursor->Slice;
+
+	if (cursor->Index >= slice->Count)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	addr = sliceElementAddress(slice, cursor->Index);
+
+	*elem = slice->Elem;
+	elem->TypedData.Offset = addr;
+
+	if (DsTypedObjectIsPrimitive(&slice->Elem) &&
+		slice->ElemSize &&
+		slice->ElemSize <= sizeof(elem->Value.Value))
+	{
+		// The template carries element zero's value. Don't let it leak into
+		// other elements.
+		//
+		elem->TypedData.Data = 0;
+
+		elem->ValueValid = readAheadValue(hostCtxt, cursor, addr, elem);
+		if (!elem->ValueValid)
+		{
+			// The window doesn't cover this element. Have DbgEng resolve it
+			// so that its value (e.g. the target of a pointer) is its own.
+			//
+			hr = getArrayElement(
+				hostCtxt,
+				&slice->Base,
+				(UINT64)(slice->Start + (INT64)cursor->Index * slice->Step),
+				&elem->TypedData);
+			if (FAILED(hr))
+			{
+				goto exit;
+			}
+		}
+	}
+
+	++cursor->Index;
+
+exit:
+	return hr;
+}
@@ -0,0 +1,665 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: dumpmap.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Direct memory backend over a memory-mapped minidump file.
+//
+// Notes:
+//
+//  Every read through DbgEng's dump layer is a separate engine request. When
+//  the target is a user-mode minidump, we can instead map the dump file
+//  ourselves and serve reads straight out of the mapping. Anything the dump's
+//  memory lists don't cover (e.g. image pages DbgEng pulls from module files)
+//  falls back to DbgEng.
+//
+// @EndHeader@
+//******************************************************************************
+#include "dumpmap.h"
+#include "util.h"
+#include "../common.h"
+#include <dbghelp.h>
+#include <algorithm>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Function: isValidRva
+//
+// Description:
+//
+//  Check if [rva, rva + cb) lies within the view.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true if valid.
+//
+// Notes:
+//
+static bool
+isValidRva(
+	_In_ UINT64 viewSize,
+	_In_ UINT64 rva,
+	_In_ UINT64 cb)
+{
+	return rva <= viewSize && cb <= viewSize - rva;
+}
+
+//------------------------------------------------------------------------------
+// Function: addRange
+//
+// Description:
+//
+//  Append a range described by the dump to 'ranges', if it's well-formed.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+addRange(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_In_ UINT64 start,
+	_In_ UINT64 cb,
+	_In_ UINT64 rva,
+	_Inout_ std::vector<DumpMemoryRange>* ranges)
+{
+	if (!cb || !isValidRva(viewSize, rva, cb) || start + cb < start)
+	{
+		// Empty, truncated or wraps around the address space.
+		//
+		return;
+	}
+
+	DumpMemoryRange range = {start, start + cb, view + rva};
+	ranges->push_back(range);
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapParse
+//
+// Description:
+//
+//  Build the sorted range table from a minidump's memory list streams.
+//
+// Parameters:
+//
+//  view - Contents of the dump file.
+//  viewSize - Size of 'view' in bytes.
+//  ranges - On success, receives the range table. Free with delete[].
+//  rangeCount - On success, receives the number of ranges.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Both MemoryListStream (minidumps) and Memory64ListStream (full-memory
+//  dumps) are handled. Overlapping ranges keep the earlier contents, and
+//  ranges that are adjacent both in the address space and in the file are
+//  merged so that bulk reads and searches can be served as a single span.
+//
+//  Doesn't depend on DbgEng so it can be exercised on synthetic dumps.
+//
+_Check_return_ HRESULT
+DumpMapParse(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_Outptr_result_buffer_(*rangeCount) DumpMemoryRange** ranges,
+	_Out_ ULONG* rangeCount)
+{
+	HRESULT hr = S_OK;
+	const MINIDUMP_HEADER* header = (const MINIDUMP_HEADER*)view;
+	const MINIDUMP_DIRECTORY* dir = nullptr;
+	std::vector<DumpMemoryRange> found;
+	std::vector<DumpMemoryRange> merged;
+
+	*ranges = nullptr;
+	*rangeCount = 0;
+
+	if (viewSize < sizeof(*header) || header->Signature != MINIDUMP_SIGNATURE)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto exit;
+	}
+
+	if (!isValidRva(
+			viewSize,
+			header->StreamDirectoryRva,
+			(UINT64)header->NumberOfStreams * sizeof(MINIDUMP_DIRECTORY)))
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto exit;
+	}
+
+	dir = (const MINIDUMP_DIRECTORY*)(view + header->StreamDirectoryRva);
+
+	for (ULONG i = 0; i < header->NumberOfStreams; ++i)
+	{
+		const MINIDUMP_LOCATION_DESCRIPTOR& loc = dir[i].Location;
+		if (!isValidRva(viewSize, loc.Rva, loc.DataSize))
+		{
+			continue;
+		}
+
+		if (dir[i].StreamType == MemoryListStream &&
+			loc.DataSize >= sizeof(MINIDUMP_MEMORY_LIST))
+		{
+			const MINIDUMP_MEMORY_LIST* list =
+				(const MINIDUMP_MEMORY_LIST*)(view + loc.Rva);
+			const UINT64 maxRanges =
+				(loc.DataSize - sizeof(*list)) / sizeof(MINIDUMP_MEMORY_DESCRIPTOR);
+			const UINT64 count = min((UINT64)list->NumberOfMemoryRanges, maxRanges);
+
+			for (UINT64 j = 0; j < count; ++j)
+			{
+				const MINIDUMP_MEMORY_DESCRIPTOR& desc = list->MemoryRanges[j];
+				addRange(
+					view,
+					viewSize,
+					desc.StartOfMemoryRange,
+					desc.Memory.DataSize,
+					desc.Memory.Rva,
+					&found);
+			}
+		}
+		else if (dir[i].StreamType == Memory64ListStream &&
+			loc.DataSize >= sizeof(MINIDUMP_MEMORY64_LIST))
+		{
+			// Memory64 ranges are stored back to back starting at BaseRva.
+			//
+			const MINIDUMP_MEMORY64_LIST* list =
+				(const MINIDUMP_MEMORY64_LIST*)(view + loc.Rva);
+			const UINT64 maxRanges =
+				(loc.DataSize - sizeof(*list)) / sizeof(MINIDUMP_MEMORY_DESCRIPTOR64);
+			const UINT64 count = min((UINT64)list->NumberOfMemoryRanges, maxRanges);
+			UINT64 rva = list->BaseRva;
+
+			for (UINT64 j = 0; j < count; ++j)
+			{
+				const MINIDUMP_MEMORY_DESCRIPTOR64& desc = list->MemoryRanges[j];
+				addRange(
+					view,
+					viewSize,
+					desc.StartOfMemoryRange,
+					desc.DataSize,
+					rva,
+					&found);
+
+				rva += desc.DataSize;
+				if (rva < desc.DataSize)
+				{
+					// Overflow. Everything after this is garbage.
+					//
+					break;
+				}
+			}
+		}
+	}
+
+	std::stable_sort(
+		found.begin(),
+		found.end(),
+		[](const DumpMemoryRange& a, const DumpMemoryRange& b)
+		{
+			return a.Start < b.Start;
+		});
+
+	for (size_t i = 0; i < found.size(); ++i)
+	{
+		DumpMemoryRange range = found[i];
+
+		if (!merged.empty())
+		{
+			DumpMemoryRange& prev = merged.back();
+
+			if (range.Start < prev.End)
+			{
+				// Overlaps the previous range. Keep only the tail, if any.
+				//
+				if (range.End <= prev.End)
+				{
+					continue;
+				}
+
+				range.Data += prev.End - range.Start;
+				range.Start = prev.End;
+			}
+
+			if (range.Start == prev.End &&
+				range.Data == prev.Data + (prev.End - prev.Start))
+			{
+				prev.End = range.End;
+				continue;
+			}
+		}
+
+		merged.push_back(range);
+	}
+
+	if (merged.size() > ULONG_MAX)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto exit;
+	}
+
+	*ranges = new DumpMemoryRange[merged.empty() ? 1 : merged.size()];
+	if (!merged.empty())
+	{
+		memcpy(*ranges, &merged[0], merged.size() * sizeof(DumpMemoryRange));
+	}
+	*rangeCount = (ULONG)merged.size();
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: destroyMap
+//
+// Description:
+//
+//  Release everything held by a map, and the map itself.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+destroyMap(
+	_In_ DumpMemoryMap* map)
+{
+	delete[] map->Ranges;
+
+	if (map->View)
+	{
+		UnmapViewOfFile(map->View);
+	}
+
+	if (map->Mapping)
+	{
+		CloseHandle(map->Mapping);
+	}
+
+	if (map->File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(map->File);
+	}
+
+	delete map;
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapOpen
+//
+// Description:
+//
+//  Map the current target's dump file and build its range table.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if already open. HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED)
+//  if the target isn't a user-mode dump.
+//
+// Notes:
+//
+//  The map is stored in the host context so all providers share it.
+//
+_Check_return_ HRESULT
+DumpMapOpen(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	HRESULT hr = S_OK;
+	ULONG debuggeeClass = 0;
+	ULONG debuggeeQual = 0;
+	IDebugClient4* client4 = nullptr;
+	WCHAR dumpPath[MAX_PATH] = {};
+	ULONG64 dumpHandle = 0;
+	ULONG dumpType = 0;
+	LARGE_INTEGER fileSize = {};
+	DumpMemoryMap* map = nullptr;
+
+	if (hostCtxt->DumpMap)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	hr = hostCtxt->DebugControl->GetDebuggeeType(&debuggeeClass, &debuggeeQual);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	if (debuggeeClass != DEBUG_CLASS_USER_WINDOWS ||
+		debuggeeQual < DEBUG_USER_WINDOWS_SMALL_DUMP)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+		goto exit;
+	}
+
+	hr = hostCtxt->DebugClient->QueryInterface(
+		__uuidof(IDebugClient4), (void**)&client4);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	hr = client4->GetDumpFileWide(
+		0 /* index */,
+		STRING_AND_CCH(dumpPath),
+		nullptr,
+		&dumpHandle,
+		&dumpType);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	map = new DumpMemoryMap;
+	memset(map, 0, sizeof(*map));
+	map->File = INVALID_HANDLE_VALUE;
+
+	// DbgEng already has the file open, so share everything.
+	//
+	map->File = CreateFileW(
+		dumpPath,
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (map->File == INVALID_HANDLE_VALUE)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if (!GetFileSizeEx(map->File, &fileSize))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if ((UINT64)fileSize.QuadPart > SIZE_MAX)
+	{
+		// Can't map the whole file into this process.
+		//
+		hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		goto exit;
+	}
+
+	map->Mapping = CreateFileMappingW(
+		map->File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!map->Mapping)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	map->View = (const BYTE*)MapViewOfFile(
+		map->Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!map->View)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	map->ViewSize = fileSize.QuadPart;
+
+	hr = DumpMapParse(map->View, map->ViewSize, &map->Ranges, &map->RangeCount);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	map->Is64Bit = hostCtxt->DebugControl->IsPointer64Bit() == S_OK;
+
+	hostCtxt->DumpMap = map;
+	++hostCtxt->DumpMapGeneration;
+	map = nullptr;
+
+exit:
+	if (map)
+	{
+		destroyMap(map);
+	}
+
+	if (client4)
+	{
+		client4->Release();
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapClose
+//
+// Description:
+//
+//  Unmap the dump, if mapped. Reads go back through DbgEng.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Spans handed out by DumpMapGetSpan are invalid afterwards.
+//
+void
+DumpMapClose(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	DumpMemoryMap* map = hostCtxt->DumpMap;
+	if (!map)
+	{
+		return;
+	}
+
+	hostCtxt->DumpMap = nullptr;
+	++hostCtxt->DumpMapGeneration;
+	destroyMap(map);
+}
+
+//------------------------------------------------------------------------------
+// Function: findRange
+//
+// Description:
+//
+//  Binary search for the range containing 'addr'.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The range, or nullptr if 'addr' wasn't captured.
+//
+// Notes:
+//
+static _Check_return_ const DumpMemoryRange*
+findRange(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 addr)
+{
+	const DumpMemoryRange* begin = map->Ranges;
+	const DumpMemoryRange* end = begin + map->RangeCount;
+
+	// First range starting after 'addr'; the one before it is the candidate.
+	//
+	const DumpMemoryRange* it = std::upper_bound(
+		begin,
+		end,
+		addr,
+		[](UINT64 a, const DumpMemoryRange& r)
+		{
+			return a < r.Start;
+		});
+	if (it == begin)
+	{
+		return nullptr;
+	}
+
+	--it;
+	return addr < it->End ? it : nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapGetSpan
+//
+// Description:
+//
+//  Get a pointer into the mapping for [addr, addr + cb), without copying.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Pointer to the bytes, or nullptr if the span isn't entirely captured in a
+//  single range.
+//
+// Notes:
+//
+//  The pointer is good until the dump is unmapped (see
+//  DbgScriptHostContext::DumpMapGeneration).
+//
+_Check_return_ const BYTE*
+DumpMapGetSpan(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 addr,
+	_In_ ULONG cb)
+{
+	const DumpMemoryRange* range = findRange(map, addr);
+	if (!range || cb > range->End - addr)
+	{
+		return nullptr;
+	}
+
+	return range->Data + (addr - range->Start);
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapRead
+//
+// Description:
+//
+//  Copy [addr, addr + cb) out of the mapping.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true if the whole request was captured in the dump. Otherwise the contents
+//  of 'buf' are undefined and the caller should fall back to DbgEng.
+//
+// Notes:
+//
+//  May span several ranges as long as there are no gaps between them.
+//
+_Check_return_ bool
+DumpMapRead(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 addr,
+	_Out_writes_bytes_(cb) void* buf,
+	_In_ ULONG cb)
+{
+	BYTE* out = (BYTE*)buf;
+	const DumpMemoryRange* range = findRange(map, addr);
+	const DumpMemoryRange* end = map->Ranges + map->RangeCount;
+
+	while (cb)
+	{
+		if (!range || range == end || addr < range->Start || addr >= range->End)
+		{
+			return false;
+		}
+
+		const ULONG cbChunk = (ULONG)min((UINT64)cb, range->End - addr);
+		memcpy(out, range->Data + (addr - range->Start), cbChunk);
+
+		out += cbChunk;
+		addr += cbChunk;
+		cb -= cbChunk;
+		++range;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: DumpMapSearch
+//
+// Description:
+//
+//  Search [start, start + size) for 'pattern', like SearchVirtual.
+//
+// Parameters:
+//
+//  patternGranularity - Only matches at a multiple of this from 'start' are
+//   considered.
+//  matchAddr - On success, address of the first match.
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if the region isn't entirely captured in the dump, in
+//  which case the caller should fall back to DbgEng.
+//  HRESULT_FROM_NT(STATUS_NO_MORE_ENTRIES) if not found.
+//
+// Notes:
+//
+//  A match must lie entirely within the region.
+//
+_Check_return_ HRESULT
+DumpMapSearch(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 start,
+	_In_ UINT64 size,
+	_In_reads_bytes_(patternSize) const void* pattern,
+	_In_ ULONG patternSize,
+	_In_ ULONG patternGranularity,
+	_Out_ UINT64* matchAddr)
+{
+	const BYTE* pat = (const BYTE*)pattern;
+
+	*matchAddr = 0;
+
+	if (!patternSize || !patternGranularity ||
+		patternSize % patternGranularity != 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	const DumpMemoryRange* range = findRange(map, start);
+	if (!range || size > range->End - start)
+	{
+		return S_FALSE;
+	}
+
+	const BYTE* data = range->Data + (start - range->Start);
+
+	for (UINT64 off = 0;
+		size >= patternSize && off <= size - patternSize;
+		off += patternGranularity)
+	{
+		if (data[off] == pat[0] && !memcmp(data + off, pat, patternSize))
+		{
+			*matchAddr = start + off;
+			return S_OK;
+		}
+	}
+
+	return HRESULT_FROM_NT(STATUS_NO_MORE_ENTRIES);
+}
@@ -0,0 +1,98 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: dumpmap.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Direct memory backend over a memory-mapped minidump file.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// DumpMemoryRange - A range of target virtual memory captured in the dump.
+//
+struct DumpMemoryRange
+{
+	// First virtual address of the range.
+	//
+	UINT64 Start;
+
+	// One past the last virtual address of the range.
+	//
+	UINT64 End;
+
+	// Contents of the range, inside the mapped view.
+	//
+	const BYTE* Data;
+};
+
+// DumpMemoryMap - A memory-mapped minidump and its sorted range table.
+//
+struct DumpMemoryMap
+{
+	HANDLE File;
+
+	HANDLE Mapping;
+
+	// Start of the mapped view and its size in bytes.
+	//
+	const BYTE* View;
+
+	UINT64 ViewSize;
+
+	// Captured memory ranges, sorted by address and non-overlapping.
+	//
+	DumpMemoryRange* Ranges;
+
+	ULONG RangeCount;
+
+	// Is the target 64-bit? Determines the pointer size.
+	//
+	bool Is64Bit;
+};
+
+_Check_return_ HRESULT
+DumpMapParse(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_Outptr_result_buffer_(*rangeCount) DumpMemoryRange** ranges,
+	_Out_ ULONG* rangeCount);
+
+_Check_return_ HRESULT
+DumpMapOpen(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+DumpMapClose(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+_Check_return_ const BYTE*
+DumpMapGetSpan(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 addr,
+	_In_ ULONG cb);
+
+_Check_return_ bool
+DumpMapRead(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 addr,
+	_Out_writes_bytes_(cb) void* buf,
+	_In_ ULONG cb);
+
+_Check_return_ HRESULT
+DumpMapSearch(
+	_In_ const DumpMemoryMap* map,
+	_In_ UINT64 start,
+	_In_ UINT64 size,
+	_In_reads_bytes_(patternSize) const void* pattern,
+	_In_ ULONG patternSize,
+	_In_ ULONG patternGranularity,
+	_Out_ UINT64* matchAddr);
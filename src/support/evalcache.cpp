@@ -0,0 +1,185 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: evalcache.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  LRU cache of code compiled for !evalstring.
+//
+// Notes:
+//
+//  Breakpoint commands such as bp foo "!evalstring -l py check()" evaluate
+//  the same string every time the breakpoint is hit. With a persistent VM
+//  (!startvm), providers look the string up here first and only parse and
+//  compile it on a miss.
+//
+//  The cache doesn't know what compiled code is: each provider stores a
+//  handle to it and supplies a callback to release it on eviction. The cache
+//  is small, so lookups are a linear scan comparing hashes.
+//
+// @EndHeader@
+//******************************************************************************
+#include "evalcache.h"
+#include <string.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// Function: hashText
+//
+// Description:
+//
+//  FNV-1a hash of a string.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+hashText(
+	_In_z_ const char* text)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	for (const char* p = text; *p; ++p)
+	{
+		hash ^= (BYTE)*p;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: EvalCacheFind
+//
+// Description:
+//
+//  Look up the compiled code for a string.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The entry, or nullptr on a miss.
+//
+// Notes:
+//
+_Check_return_ EvalCacheEntry*
+EvalCacheFind(
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* text)
+{
+	const UINT64 hash = hashText(text);
+
+	for (ULONG i = 0; i < EVAL_CACHE_SIZE; ++i)
+	{
+		EvalCacheEntry* entry = &cache->Entries[i];
+		if (entry->Text && entry->Hash == hash && !strcmp(entry->Text, text))
+		{
+			entry->LastUse = ++cache->Clock;
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Function: EvalCacheInsert
+//
+// Description:
+//
+//  Add the compiled code for a string that missed the cache, evicting the
+//  least recently used entry if full.
+//
+// Parameters:
+//
+//  code - Handle to the compiled code. Owned by the cache from now on.
+//
+//  release - Releases the handle of an evicted entry (or 'code' itself, on
+//   failure).
+//
+// Returns:
+//
+//  The new entry, or nullptr if out of memory.
+//
+// Notes:
+//
+_Check_return_ EvalCacheEntry*
+EvalCacheInsert(
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* text,
+	_In_ UINT_PTR code,
+	_In_ EvalCacheReleaseCb release)
+{
+	EvalCacheEntry* victim = &cache->Entries[0];
+
+	for (ULONG i = 0; i < EVAL_CACHE_SIZE; ++i)
+	{
+		EvalCacheEntry* entry = &cache->Entries[i];
+		if (!entry->Text)
+		{
+			victim = entry;
+			break;
+		}
+
+		if (entry->LastUse < victim->LastUse)
+		{
+			victim = entry;
+		}
+	}
+
+	char* copy = _strdup(text);
+	if (!copy)
+	{
+		release(code);
+		return nullptr;
+	}
+
+	if (victim->Text)
+	{
+		release(victim->Code);
+		free(victim->Text);
+	}
+
+	victim->Hash = hashText(text);
+	victim->Text = copy;
+	victim->Code = code;
+	victim->LastUse = ++cache->Clock;
+	return victim;
+}
+
+//------------------------------------------------------------------------------
+// Function: EvalCacheClear
+//
+// Description:
+//
+//  Release every entry.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Providers call this before their VM goes away, or when the environment
+//  the code was compiled against changes.
+//
+void
+EvalCacheClear(
+	_Inout_ EvalCache* cache,
+	_In_ EvalCacheReleaseCb release)
+{
+	for (ULONG i = 0; i < EVAL_CACHE_SIZE; ++i)
+	{
+		EvalCacheEntry* entry = &cache->Entries[i];
+		if (entry->Text)
+		{
+			release(entry->Code);
+			free(entry->Text);
+		}
+	}
+
+	ZeroMemory(cache, sizeof(*cache));
+}
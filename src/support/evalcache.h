@@ -0,0 +1,72 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: evalcache.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  LRU cache of code compiled for !evalstring.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+
+// Number of compiled strings each provider keeps.
+//
+const ULONG EVAL_CACHE_SIZE = 64;
+
+// EvalCacheEntry - One compiled string. Free if 'Text' is null.
+//
+struct EvalCacheEntry
+{
+	UINT64 Hash;
+
+	// Copy of the source string.
+	//
+	char* Text;
+
+	// Provider's handle to the compiled code (e.g. an object reference).
+	//
+	UINT_PTR Code;
+
+	// Value of the cache's clock when last used.
+	//
+	UINT64 LastUse;
+};
+
+// EvalCache - Embedded in each provider. Zero-initialize before use.
+//
+struct EvalCache
+{
+	EvalCacheEntry Entries[EVAL_CACHE_SIZE];
+
+	UINT64 Clock;
+};
+
+// EvalCacheReleaseCb - Release a provider's handle to compiled code.
+//
+typedef void
+(*EvalCacheReleaseCb)(
+	_In_ UINT_PTR code);
+
+_Check_return_ EvalCacheEntry*
+EvalCacheFind(
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* text);
+
+_Check_return_ EvalCacheEntry*
+EvalCacheInsert(
+	_Inout_ EvalCache* cache,
+	_In_z_ const char* text,
+	_In_ UINT_PTR code,
+	_In_ EvalCacheReleaseCb release);
+
+void
+EvalCacheClear(
+	_Inout_ EvalCache* cache,
+	_In_ EvalCacheReleaseCb release);
@@ -0,0 +1,1324 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: pdbreader.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Direct reader for the type stream of a PDB file.
+//
+// Notes:
+//
+//  Answers type sizes, field offsets and enum constants by name straight from
+//  the PDB's TPI stream, without going through DbgEng's symbol engine. Only
+//  the subset of CodeView needed for that is understood; anything else makes
+//  the lookup fail so the caller can fall back to DbgEng.
+//
+//  The IPI stream holds function and source IDs rather than type layouts, so
+//  it isn't read.
+//
+// @EndHeader@
+//******************************************************************************
+#include "pdbreader.h"
+#include <strsafe.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// MSF container superblock, at the start of the file.
+//
+struct MsfSuperBlock
+{
+	char Magic[32];
+	ULONG BlockSize;
+	ULONG FreeBlockMapBlock;
+	ULONG NumBlocks;
+	ULONG NumDirectoryBytes;
+	ULONG Unknown;
+	ULONG BlockMapAddr;
+};
+
+static const char MSF_MAGIC[] = "Microsoft C/C++ MSF 7.00\r\n\x1a" "DS\0\0";
+
+// Header of the TPI stream.
+//
+struct TpiStreamHeader
+{
+	ULONG Version;
+	ULONG HeaderSize;
+	ULONG TypeIndexBegin;
+	ULONG TypeIndexEnd;
+	ULONG TypeRecordBytes;
+	USHORT HashStreamIndex;
+	USHORT HashAuxStreamIndex;
+	ULONG HashKeySize;
+	ULONG NumHashBuckets;
+	LONG HashValueBufferOffset;
+	ULONG HashValueBufferLength;
+	LONG IndexOffsetBufferOffset;
+	ULONG IndexOffsetBufferLength;
+	LONG HashAdjBufferOffset;
+	ULONG HashAdjBufferLength;
+};
+
+const ULONG PDB_STREAM_TPI = 2;
+
+// CodeView leaf kinds.
+//
+const USHORT LF_MODIFIER = 0x1001;
+const USHORT LF_BCLASS = 0x1400;
+const USHORT LF_VBCLASS = 0x1401;
+const USHORT LF_IVBCLASS = 0x1402;
+const USHORT LF_INDEX = 0x1404;
+const USHORT LF_VFUNCTAB = 0x1409;
+const USHORT LF_ENUMERATE = 0x1502;
+const USHORT LF_CLASS = 0x1504;
+const USHORT LF_STRUCTURE = 0x1505;
+const USHORT LF_UNION = 0x1506;
+const USHORT LF_ENUM = 0x1507;
+const USHORT LF_MEMBER = 0x150d;
+const USHORT LF_STMEMBER = 0x150e;
+const USHORT LF_METHOD = 0x150f;
+const USHORT LF_NESTTYPE = 0x1510;
+const USHORT LF_ONEMETHOD = 0x1511;
+const USHORT LF_INTERFACE = 0x1519;
+
+// Numeric leaves. Values below LF_NUMERIC are stored inline.
+//
+const USHORT LF_NUMERIC = 0x8000;
+const USHORT LF_CHAR = 0x8000;
+const USHORT LF_SHORT = 0x8001;
+const USHORT LF_USHORT = 0x8002;
+const USHORT LF_LONG = 0x8003;
+const USHORT LF_ULONG = 0x8004;
+const USHORT LF_QUADWORD = 0x8009;
+const USHORT LF_UQUADWORD = 0x800a;
+
+// Padding bytes between field list members are LF_PAD0 and up.
+//
+const BYTE LF_PAD0 = 0xf0;
+
+// Aggregate property: this is a forward reference.
+//
+const USHORT CV_PROP_FWDREF = 0x0080;
+
+// Bound on the field list records (including continuations and those of base
+// classes) visited to look up one member. Keeps a corrupt PDB whose records
+// refer back to themselves from sending us around in circles.
+//
+const ULONG MAX_PDB_FIELD_LISTS = 256;
+
+// Key is the type name, value is its type index.
+//
+typedef std::unordered_map<std::string, ULONG> PdbNameIndexT;
+
+struct PdbFile
+{
+	// Type record bytes of the TPI stream.
+	//
+	std::vector<BYTE> Records;
+
+	// Type index of the first record.
+	//
+	ULONG TypeIndexBegin;
+
+	// Offset of each record in 'Records', indexed by type index minus
+	// 'TypeIndexBegin'.
+	//
+	std::vector<ULONG> RecordOffsets;
+
+	// Name of each defined (non-forward) aggregate and enum to its type index.
+	//
+	PdbNameIndexT NameIndex;
+};
+
+// LeafCursor - Bounds-checked cursor over a type record.
+//
+struct LeafCursor
+{
+	const BYTE* Pos;
+	const BYTE* End;
+};
+
+// AggregateInfo - Parsed class, struct, union or enum record.
+//
+struct AggregateInfo
+{
+	USHORT Kind;
+	USHORT Property;
+	ULONG FieldList;
+	UINT64 Size;
+	const char* Name;
+};
+
+//------------------------------------------------------------------------------
+// Function: readU16
+//
+// Description:
+//
+//  Read an unaligned 16-bit value and advance the cursor.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success. false if the record is too short.
+//
+// Notes:
+//
+static bool
+readU16(
+	_Inout_ LeafCursor* cur,
+	_Out_ USHORT* val)
+{
+	if (cur->End - cur->Pos < (ptrdiff_t)sizeof(*val))
+	{
+		return false;
+	}
+
+	memcpy(val, cur->Pos, sizeof(*val));
+	cur->Pos += sizeof(*val);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: readU32
+//
+// Description:
+//
+//  Read an unaligned 32-bit value and advance the cursor.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success. false if the record is too short.
+//
+// Notes:
+//
+static bool
+readU32(
+	_Inout_ LeafCursor* cur,
+	_Out_ ULONG* val)
+{
+	if (cur->End - cur->Pos < (ptrdiff_t)sizeof(*val))
+	{
+		return false;
+	}
+
+	memcpy(val, cur->Pos, sizeof(*val));
+	cur->Pos += sizeof(*val);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: readNumeric
+//
+// Description:
+//
+//  Read a CodeView numeric leaf and advance the cursor.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success. false if the record is too short or the leaf isn't an
+//  integer.
+//
+// Notes:
+//
+//  Signed leaves are sign-extended.
+//
+static bool
+readNumeric(
+	_Inout_ LeafCursor* cur,
+	_Out_ UINT64* val)
+{
+	USHORT leaf = 0;
+	ULONG u32 = 0;
+
+	*val = 0;
+
+	if (!readU16(cur, &leaf))
+	{
+		return false;
+	}
+
+	if (leaf < LF_NUMERIC)
+	{
+		*val = leaf;
+		return true;
+	}
+
+	switch (leaf)
+	{
+	case LF_CHAR:
+		if (cur->Pos == cur->End)
+		{
+			return false;
+		}
+		*val = (UINT64)(INT64)(CHAR)*cur->Pos;
+		cur->Pos += 1;
+		return true;
+
+	case LF_SHORT:
+	case LF_USHORT:
+	{
+		USHORT u16 = 0;
+		if (!readU16(cur, &u16))
+		{
+			return false;
+		}
+		*val = leaf == LF_SHORT ? (UINT64)(INT64)(SHORT)u16 : u16;
+		return true;
+	}
+
+	case LF_LONG:
+	case LF_ULONG:
+		if (!readU32(cur, &u32))
+		{
+			return false;
+		}
+		*val = leaf == LF_LONG ? (UINT64)(INT64)(LONG)u32 : u32;
+		return true;
+
+	case LF_QUADWORD:
+	case LF_UQUADWORD:
+		if (cur->End - cur->Pos < (ptrdiff_t)sizeof(*val))
+		{
+			return false;
+		}
+		memcpy(val, cur->Pos, sizeof(*val));
+		cur->Pos += sizeof(*val);
+		return true;
+
+	default:
+		// Floating point, etc.
+		//
+		return false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: readName
+//
+// Description:
+//
+//  Read a NUL-terminated name and advance the cursor.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success. false if the name isn't terminated within the record.
+//
+// Notes:
+//
+static bool
+readName(
+	_Inout_ LeafCursor* cur,
+	_Outptr_result_z_ const char** name)
+{
+	const BYTE* nul = (const BYTE*)memchr(cur->Pos, 0, cur->End - cur->Pos);
+	if (!nul)
+	{
+		return false;
+	}
+
+	*name = (const char*)cur->Pos;
+	cur->Pos = nul + 1;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: skipPadding
+//
+// Description:
+//
+//  Skip the LF_PADx bytes that align field list members.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+skipPadding(
+	_Inout_ LeafCursor* cur)
+{
+	while (cur->Pos < cur->End && *cur->Pos >= LF_PAD0)
+	{
+		++cur->Pos;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: getRecord
+//
+// Description:
+//
+//  Locate the record of a type index.
+//
+// Parameters:
+//
+//  kind - Receives the leaf kind of the record.
+//  cur - Receives a cursor over the record, past the kind.
+//
+// Returns:
+//
+//  true on success. false if 'ti' is primitive or out of range.
+//
+// Notes:
+//
+static bool
+getRecord(
+	_In_ const PdbFile* pdb,
+	_In_ ULONG ti,
+	_Out_ USHORT* kind,
+	_Out_ LeafCursor* cur)
+{
+	if (ti < pdb->TypeIndexBegin ||
+		ti - pdb->TypeIndexBegin >= pdb->RecordOffsets.size())
+	{
+		return false;
+	}
+
+	const ULONG offset = pdb->RecordOffsets[ti - pdb->TypeIndexBegin];
+	const BYTE* rec = &pdb->Records[0] + offset;
+	USHORT len = 0;
+
+	// Records were validated when indexed.
+	//
+	memcpy(&len, rec, sizeof(len));
+	cur->Pos = rec + sizeof(len);
+	cur->End = cur->Pos + len;
+
+	return readU16(cur, kind);
+}
+
+//------------------------------------------------------------------------------
+// Function: primitiveSize
+//
+// Description:
+//
+//  Size of a primitive type.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Size in bytes, or 0 if unknown.
+//
+// Notes:
+//
+static ULONG
+primitiveSize(
+	_In_ ULONG ti)
+{
+	// Mode bits (pointer flavor) take precedence over the base type.
+	//
+	switch (ti & 0x0f00)
+	{
+	case 0x0000:
+		break;
+	case 0x0400:
+		return 4;
+	case 0x0600:
+		return 8;
+	default:
+		return 0;
+	}
+
+	switch (ti & 0xff)
+	{
+	case 0x10: case 0x20: case 0x30: case 0x68: case 0x69: case 0x70:
+		return 1;
+	case 0x11: case 0x21: case 0x31: case 0x71: case 0x72: case 0x73:
+	case 0x7a:
+		return 2;
+	case 0x08: case 0x12: case 0x22: case 0x32: case 0x40: case 0x74:
+	case 0x75: case 0x7b:
+		return 4;
+	case 0x13: case 0x23: case 0x33: case 0x41: case 0x76: case 0x77:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: parseAggregate
+//
+// Description:
+//
+//  Parse a class, struct, interface, union or enum record.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success.
+//
+// Notes:
+//
+//  For enums, 'Size' is the size of the underlying type.
+//
+static bool
+parseAggregate(
+	_In_ const PdbFile* pdb,
+	_In_ ULONG ti,
+	_Out_ AggregateInfo* info)
+{
+	LeafCursor cur = {};
+	USHORT count = 0;
+	ULONG ignored = 0;
+	ULONG utype = 0;
+
+	memset(info, 0, sizeof(*info));
+
+	if (!getRecord(pdb, ti, &info->Kind, &cur))
+	{
+		return false;
+	}
+
+	switch (info->Kind)
+	{
+	case LF_CLASS:
+	case LF_STRUCTURE:
+	case LF_INTERFACE:
+		// count, property, field list, derived list, vshape, size, name.
+		//
+		return readU16(&cur, &count) &&
+			readU16(&cur, &info->Property) &&
+			readU32(&cur, &info->FieldList) &&
+			readU32(&cur, &ignored) &&
+			readU32(&cur, &ignored) &&
+			readNumeric(&cur, &info->Size) &&
+			readName(&cur, &info->Name);
+
+	case LF_UNION:
+		// count, property, field list, size, name.
+		//
+		return readU16(&cur, &count) &&
+			readU16(&cur, &info->Property) &&
+			readU32(&cur, &info->FieldList) &&
+			readNumeric(&cur, &info->Size) &&
+			readName(&cur, &info->Name);
+
+	case LF_ENUM:
+		// count, property, underlying type, field list, name.
+		//
+		if (!(readU16(&cur, &count) &&
+			readU16(&cur, &info->Property) &&
+			readU32(&cur, &utype) &&
+			readU32(&cur, &info->FieldList) &&
+			readName(&cur, &info->Name)))
+		{
+			return false;
+		}
+		info->Size = primitiveSize(utype);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: resolveDefinition
+//
+// Description:
+//
+//  Parse the defining record of an aggregate, looking through modifiers
+//  (const/volatile) and forward references.
+//
+// Parameters:
+//
+// Returns:
+//
+//  true on success.
+//
+// Notes:
+//
+static bool
+resolveDefinition(
+	_In_ const PdbFile* pdb,
+	_In_ ULONG ti,
+	_Out_ AggregateInfo* info)
+{
+	LeafCursor cur = {};
+	USHORT kind = 0;
+
+	if (getRecord(pdb, ti, &kind, &cur) && kind == LF_MODIFIER)
+	{
+		if (!readU32(&cur, &ti))
+		{
+			return false;
+		}
+	}
+
+	if (!parseAggregate(pdb, ti, info))
+	{
+		return false;
+	}
+
+	if (info->Property & CV_PROP_FWDREF)
+	{
+		PdbNameIndexT::const_iterator it = pdb->NameIndex.find(info->Name);
+		if (it == pdb->NameIndex.end())
+		{
+			return false;
+		}
+
+		return parseAggregate(pdb, it->second, info);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: findMember
+//
+// Description:
+//
+//  Find a data member by name in a field list, including inherited members of
+//  non-virtual base classes.
+//
+// Parameters:
+//
+//  fieldList - Type index of the field list.
+//  name - Member name.
+//  budget - Number of field list records we may still visit. Shared by the
+//   whole lookup.
+//  offset - On success, offset of the member.
+//  memberType - On success, type index of the member.
+//
+// Returns:
+//
+//  true if found.
+//
+// Notes:
+//
+//  Members of virtual bases live at run-time dependent offsets and are never
+//  found.
+//
+static bool
+findMember(
+	_In_ const PdbFile* pdb,
+	_In_ ULONG fieldList,
+	_In_z_ const char* name,
+	_Inout_ ULONG* budget,
+	_Out_ ULONG* offset,
+	_Out_ ULONG* memberType)
+{
+	std::vector<std::pair<ULONG, UINT64>> bases;
+	LeafCursor cur = {};
+	USHORT kind = 0;
+	USHORT attr = 0;
+	USHORT pad = 0;
+	ULONG type = 0;
+	ULONG ignored = 0;
+	UINT64 value = 0;
+	const char* memberName = nullptr;
+
+	*offset = 0;
+	*memberType = 0;
+
+	if (!*budget || !getRecord(pdb, fieldList, &kind, &cur))
+	{
+		return false;
+	}
+	--*budget;
+
+	while (cur.Pos < cur.End)
+	{
+		if (!readU16(&cur, &kind))
+		{
+			return false;
+		}
+
+		switch (kind)
+		{
+		case LF_MEMBER:
+			if (!(readU16(&cur, &attr) &&
+				readU32(&cur, &type) &&
+				readNumeric(&cur, &value) &&
+				readName(&cur, &memberName)))
+			{
+				return false;
+			}
+
+			if (!strcmp(memberName, name))
+			{
+				*offset = (ULONG)value;
+				*memberType = type;
+				return true;
+			}
+			break;
+
+		case LF_BCLASS:
+			if (!(readU16(&cur, &attr) &&
+				readU32(&cur, &type) &&
+				readNumeric(&cur, &value)))
+			{
+				return false;
+			}
+			bases.push_back(std::make_pair(type, value));
+			break;
+
+		case LF_VBCLASS:
+		case LF_IVBCLASS:
+			if (!(readU16(&cur, &attr) &&
+				readU32(&cur, &type) &&
+				readU32(&cur, &ignored) &&
+				readNumeric(&cur, &value) &&
+				readNumeric(&cur, &value)))
+			{
+				return false;
+			}
+			break;
+
+		case LF_INDEX:
+			// Continuation of this field list in another record.
+			//
+			if (!(*budget &&
+				readU16(&cur, &pad) &&
+				readU32(&cur, &type) &&
+				getRecord(pdb, type, &kind, &cur)))
+			{
+				return false;
+			}
+			--*budget;
+			continue;
+
+		case LF_VFUNCTAB:
+			if (!(readU16(&cur, &pad) && readU32(&cur, &type)))
+			{
+				return false;
+			}
+			break;
+
+		case LF_STMEMBER:
+			if (!(readU16(&cur, &attr) &&
+				readU32(&cur, &type) &&
+				readName(&cur, &memberName)))
+			{
+				return false;
+			}
+			break;
+
+		case LF_METHOD:
+			if (!(readU16(&cur, &pad) &&
+				readU32(&cur, &type) &&
+				readName(&cur, &memberName)))
+			{
+				return false;
+			}
+			break;
+
+		case LF_ONEMETHOD:
+		{
+			if (!(readU16(&cur, &attr) && readU32(&cur, &type)))
+			{
+				return false;
+			}
+
+			// Introducing virtuals carry their vtable offset.
+			//
+			const USHORT mprop = (attr >> 2) & 7;
+			if ((mprop == 4 || mprop == 6) && !readU32(&cur, &ignored))
+			{
+				return false;
+			}
+
+			if (!readName(&cur, &memberName))
+			{
+				return false;
+			}
+			break;
+		}
+
+		case LF_NESTTYPE:
+			if (!(readU16(&cur, &pad) &&
+				readU32(&cur, &type) &&
+				readName(&cur, &memberName)))
+			{
+				return false;
+			}
+			break;
+
+		case LF_ENUMERATE:
+			if (!(readU16(&cur, &attr) &&
+				readNumeric(&cur, &value) &&
+				readName(&cur, &memberName)))
+			{
+				return false;
+			}
+			break;
+
+		default:
+			// Don't know how to skip it.
+			//
+			return false;
+		}
+
+		skipPadding(&cur);
+	}
+
+	for (size_t i = 0; i < bases.size(); ++i)
+	{
+		AggregateInfo base = {};
+		if (resolveDefinition(pdb, bases[i].first, &base) &&
+			findMember(pdb, base.FieldList, name, budget, offset, memberType))
+		{
+			*offset += (ULONG)bases[i].second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Function: copyBlocks
+//
+// Description:
+//
+//  Gather a list of MSF blocks into a contiguous buffer.
+//
+// Parameters:
+//
+//  blocks - Block numbers.
+//  cb - Number of bytes to copy; the last block may be partial.
+//
+// Returns:
+//
+//  true on success. false if a block lies outside the file.
+//
+// Notes:
+//
+//  A stream can't be bigger than the file, which bounds the buffer before any
+//  block is looked at.
+//
+static bool
+copyBlocks(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_In_ ULONG blockSize,
+	_In_ const ULONG* blocks,
+	_In_ ULONG cb,
+	_Out_ std::vector<BYTE>* out)
+{
+	if (cb > viewSize)
+	{
+		return false;
+	}
+
+	out->resize(cb);
+
+	size_t i = 0;
+	for (UINT64 pos = 0; pos < cb; ++i, pos += blockSize)
+	{
+		ULONG block = 0;
+		memcpy(&block, &blocks[i], sizeof(block));
+
+		const UINT64 blockOffset = (UINT64)block * blockSize;
+		if (blockOffset > viewSize || blockSize > viewSize - blockOffset)
+		{
+			return false;
+		}
+
+		memcpy(&(*out)[(size_t)pos], view + blockOffset, (size_t)min((UINT64)blockSize, cb - pos));
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbParse
+//
+// Description:
+//
+//  Parse the type stream out of a PDB file's contents.
+//
+// Parameters:
+//
+//  view - Contents of the PDB file.
+//  viewSize - Size of 'view' in bytes.
+//  pdb - On success, receives the parsed PDB. Free with PdbClose.
+//
+// Returns:
+//
+//  HRESULT. HRESULT_FROM_WIN32(ERROR_BAD_FORMAT) if the file isn't an MSF 7.00
+//  PDB or is corrupt.
+//
+// Notes:
+//
+//  The type records are copied out, so 'view' needn't outlive 'pdb'. Doesn't
+//  depend on DbgEng so it can be exercised on any PDB, e.g. one produced by
+//  clang-cl/lld-link.
+//
+_Check_return_ HRESULT
+PdbParse(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_Outptr_ PdbFile** pdb)
+{
+	HRESULT hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+	const MsfSuperBlock* sb = (const MsfSuperBlock*)view;
+	std::vector<BYTE> dir;
+	std::vector<BYTE> tpi;
+	TpiStreamHeader tpiHeader = {};
+	PdbFile* newPdb = nullptr;
+	ULONG numStreams = 0;
+	ULONG numDirBlocks = 0;
+	UINT64 blockMapOffset = 0;
+	UINT64 dirPos = 0;
+	UINT64 tpiBlocksPos = 0;
+	ULONG tpiSize = 0;
+	ULONG offset = 0;
+
+	*pdb = nullptr;
+
+	if (viewSize < sizeof(*sb) ||
+		memcmp(sb->Magic, MSF_MAGIC, sizeof(sb->Magic)) != 0 ||
+		sb->BlockSize < 512 || (sb->BlockSize & (sb->BlockSize - 1)) != 0)
+	{
+		goto exit;
+	}
+
+	// The block map lists the blocks holding the stream directory.
+	//
+	numDirBlocks = (ULONG)(((UINT64)sb->NumDirectoryBytes + sb->BlockSize - 1) / sb->BlockSize);
+	blockMapOffset = (UINT64)sb->BlockMapAddr * sb->BlockSize;
+	if (blockMapOffset > viewSize ||
+		(UINT64)numDirBlocks * sizeof(ULONG) > viewSize - blockMapOffset)
+	{
+		goto exit;
+	}
+
+	if (!copyBlocks(
+			view,
+			viewSize,
+			sb->BlockSize,
+			(const ULONG*)(view + blockMapOffset),
+			sb->NumDirectoryBytes,
+			&dir))
+	{
+		goto exit;
+	}
+
+	// Directory: stream count, size of each stream, then the block list of each
+	// stream.
+	//
+	if (dir.size() < sizeof(ULONG))
+	{
+		goto exit;
+	}
+
+	memcpy(&numStreams, &dir[0], sizeof(numStreams));
+	if (numStreams <= PDB_STREAM_TPI ||
+		((UINT64)numStreams + 1) * sizeof(ULONG) > dir.size())
+	{
+		goto exit;
+	}
+
+	dirPos = (UINT64)(numStreams + 1) * sizeof(ULONG);
+	for (ULONG i = 0; i < numStreams; ++i)
+	{
+		ULONG size = 0;
+		memcpy(&size, &dir[(i + 1) * sizeof(ULONG)], sizeof(size));
+		if (size == 0xffffffff)
+		{
+			// Nil stream.
+			//
+			size = 0;
+		}
+
+		if (i == PDB_STREAM_TPI)
+		{
+			tpiBlocksPos = dirPos;
+			tpiSize = size;
+			break;
+		}
+
+		dirPos += ((UINT64)size + sb->BlockSize - 1) / sb->BlockSize * sizeof(ULONG);
+	}
+
+	if (tpiBlocksPos > dir.size() ||
+		((UINT64)tpiSize + sb->BlockSize - 1) / sb->BlockSize * sizeof(ULONG) >
+			dir.size() - tpiBlocksPos)
+	{
+		goto exit;
+	}
+
+	if (!copyBlocks(
+			view,
+			viewSize,
+			sb->BlockSize,
+			(const ULONG*)(&dir[0] + tpiBlocksPos),
+			tpiSize,
+			&tpi))
+	{
+		goto exit;
+	}
+
+	if (tpi.size() < sizeof(tpiHeader))
+	{
+		goto exit;
+	}
+
+	memcpy(&tpiHeader, &tpi[0], sizeof(tpiHeader));
+	if (tpiHeader.HeaderSize < sizeof(tpiHeader) ||
+		tpiHeader.HeaderSize > tpi.size() ||
+		tpiHeader.TypeRecordBytes > tpi.size() - tpiHeader.HeaderSize)
+	{
+		goto exit;
+	}
+
+	newPdb = new PdbFile;
+	newPdb->TypeIndexBegin = tpiHeader.TypeIndexBegin;
+	newPdb->Records.assign(
+		tpi.begin() + tpiHeader.HeaderSize,
+		tpi.begin() + tpiHeader.HeaderSize + tpiHeader.TypeRecordBytes);
+
+	// Index the records. Each is a 16-bit length followed by that many bytes,
+	// the first two of which are the leaf kind.
+	//
+	while ((UINT64)offset + 2 * sizeof(USHORT) <= newPdb->Records.size())
+	{
+		USHORT len = 0;
+		memcpy(&len, &newPdb->Records[offset], sizeof(len));
+		if (len < sizeof(USHORT) ||
+			(UINT64)offset + sizeof(len) + len > newPdb->Records.size())
+		{
+			goto exit;
+		}
+
+		const ULONG ti = newPdb->TypeIndexBegin + (ULONG)newPdb->RecordOffsets.size();
+		newPdb->RecordOffsets.push_back(offset);
+
+		AggregateInfo info = {};
+		if (parseAggregate(newPdb, ti, &info) &&
+			!(info.Property & CV_PROP_FWDREF) &&
+			strcmp(info.Name, "<unnamed-tag>") != 0)
+		{
+			// First definition wins.
+			//
+			newPdb->NameIndex.insert(std::make_pair(std::string(info.Name), ti));
+		}
+
+		offset += (ULONG)sizeof(len) + len;
+	}
+
+	*pdb = newPdb;
+	newPdb = nullptr;
+	hr = S_OK;
+
+exit:
+	delete newPdb;
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbOpen
+//
+// Description:
+//
+//  Map a PDB file and parse its type stream.
+//
+// Parameters:
+//
+//  path - Path to the PDB.
+//  pdb - On success, receives the parsed PDB. Free with PdbClose.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  The mapping is only held while parsing.
+//
+_Check_return_ HRESULT
+PdbOpen(
+	_In_z_ const char* path,
+	_Outptr_ PdbFile** pdb)
+{
+	HRESULT hr = S_OK;
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+	const BYTE* view = nullptr;
+	LARGE_INTEGER fileSize = {};
+
+	*pdb = nullptr;
+
+	file = CreateFileA(
+		path,
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if ((UINT64)fileSize.QuadPart > SIZE_MAX)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+		goto exit;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	view = (const BYTE*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	hr = PdbParse(view, fileSize.QuadPart, pdb);
+
+exit:
+	if (view)
+	{
+		UnmapViewOfFile(view);
+	}
+
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbClose
+//
+// Description:
+//
+//  Free a parsed PDB.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+PdbClose(
+	_In_ PdbFile* pdb)
+{
+	delete pdb;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbGetTypeSize
+//
+// Description:
+//
+//  Get the size of a class, struct, union or enum by name.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. HRESULT_FROM_WIN32(ERROR_NOT_FOUND) if the PDB can't answer.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+PdbGetTypeSize(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_Out_ ULONG* size)
+{
+	AggregateInfo info = {};
+
+	*size = 0;
+
+	PdbNameIndexT::const_iterator it = pdb->NameIndex.find(type);
+	if (it == pdb->NameIndex.end() ||
+		!parseAggregate(pdb, it->second, &info) ||
+		!info.Size)
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+	}
+
+	*size = (ULONG)info.Size;
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbGetFieldOffset
+//
+// Description:
+//
+//  Get the offset of a field in a class, struct or union by name.
+//
+// Parameters:
+//
+//  field - Field name. May be a dotted path into nested members, e.g. "a.b".
+//
+// Returns:
+//
+//  HRESULT. HRESULT_FROM_WIN32(ERROR_NOT_FOUND) if the PDB can't answer.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+PdbGetFieldOffset(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_In_z_ const char* field,
+	_Out_ ULONG* offset)
+{
+	AggregateInfo info = {};
+	std::string path(field);
+	size_t start = 0;
+	ULONG total = 0;
+
+	*offset = 0;
+
+	PdbNameIndexT::const_iterator it = pdb->NameIndex.find(type);
+	if (it == pdb->NameIndex.end() ||
+		!parseAggregate(pdb, it->second, &info) ||
+		info.Kind == LF_ENUM)
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+	}
+
+	for (;;)
+	{
+		size_t dot = path.find('.', start);
+		const std::string name = path.substr(
+			start, dot == std::string::npos ? std::string::npos : dot - start);
+		ULONG memberOffset = 0;
+		ULONG memberType = 0;
+		ULONG budget = MAX_PDB_FIELD_LISTS;
+
+		if (!findMember(pdb, info.FieldList, name.c_str(), &budget, &memberOffset, &memberType))
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+		}
+
+		total += memberOffset;
+
+		if (dot == std::string::npos)
+		{
+			break;
+		}
+
+		// Descend into the member's type.
+		//
+		if (!resolveDefinition(pdb, memberType, &info) || info.Kind == LF_ENUM)
+		{
+			return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+		}
+
+		start = dot + 1;
+	}
+
+	*offset = total;
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: PdbGetEnumName
+//
+// Description:
+//
+//  Get the name of the enumerant of an enum type with a given value.
+//
+// Parameters:
+//
+//  cchBuf - Size of 'buf' in characters.
+//
+// Returns:
+//
+//  HRESULT. HRESULT_FROM_WIN32(ERROR_NOT_FOUND) if the PDB can't answer.
+//
+// Notes:
+//
+//  Values are compared at the width of the enum's underlying type.
+//
+_Check_return_ HRESULT
+PdbGetEnumName(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_In_ UINT64 value,
+	_Out_writes_(cchBuf) char* buf,
+	_In_ size_t cchBuf)
+{
+	AggregateInfo info = {};
+	LeafCursor cur = {};
+	USHORT kind = 0;
+	USHORT attr = 0;
+	UINT64 mask = ~0ULL;
+
+	if (cchBuf)
+	{
+		buf[0] = '\0';
+	}
+
+	PdbNameIndexT::const_iterator it = pdb->NameIndex.find(type);
+	if (it == pdb->NameIndex.end() ||
+		!parseAggregate(pdb, it->second, &info) ||
+		info.Kind != LF_ENUM ||
+		!getRecord(pdb, info.FieldList, &kind, &cur))
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+	}
+
+	if (info.Size && info.Size < sizeof(mask))
+	{
+		mask = (1ULL << (info.Size * 8)) - 1;
+	}
+
+	while (cur.Pos < cur.End)
+	{
+		UINT64 enumValue = 0;
+		const char* name = nullptr;
+
+		if (!(readU16(&cur, &kind) &&
+			kind == LF_ENUMERATE &&
+			readU16(&cur, &attr) &&
+			readNumeric(&cur, &enumValue) &&
+			readName(&cur, &name)))
+		{
+			break;
+		}
+
+		if ((enumValue & mask) == (value & mask))
+		{
+			return StringCchCopyA(buf, cchBuf, name);
+		}
+
+		skipPadding(&cur);
+	}
+
+	return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+}
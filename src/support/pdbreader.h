@@ -0,0 +1,55 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: pdbreader.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Direct reader for the type stream of a PDB file.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+
+struct PdbFile;
+
+_Check_return_ HRESULT
+PdbParse(
+	_In_reads_bytes_(viewSize) const BYTE* view,
+	_In_ UINT64 viewSize,
+	_Outptr_ PdbFile** pdb);
+
+_Check_return_ HRESULT
+PdbOpen(
+	_In_z_ const char* path,
+	_Outptr_ PdbFile** pdb);
+
+void
+PdbClose(
+	_In_ PdbFile* pdb);
+
+_Check_return_ HRESULT
+PdbGetTypeSize(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_Out_ ULONG* size);
+
+_Check_return_ HRESULT
+PdbGetFieldOffset(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_In_z_ const char* field,
+	_Out_ ULONG* offset);
+
+_Check_return_ HRESULT
+PdbGetEnumName(
+	_In_ const PdbFile* pdb,
+	_In_z_ const char* type,
+	_In_ UINT64 value,
+	_Out_writes_(cchBuf) char* buf,
+	_In_ size_t cchBuf);
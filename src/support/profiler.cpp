@@ -0,0 +1,866 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: profiler.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Sampling profiler for scripts, written as folded stacks.
+//
+// Notes:
+//
+//  Started for a run with !runscript -profile <file>. While a provider runs a
+//  script it attaches a stack walker and installs an interpreter hook (a trace
+//  function in Python, a count hook in Lua, a line tracepoint in Ruby) that
+//  calls ProfilerSample. Once per sampling interval, ProfilerSample walks the
+//  script's stack and charges it the time elapsed since the previous sample.
+//
+//  Interpreters can't be interrupted in the middle of a native call, so time
+//  spent in the debugger engine is measured by the stats hooks instead (see
+//  stats.h) and held until the next sample. It is then charged to the sampled
+//  stack extended with the script API that made the engine call and the call
+//  itself, e.g. "main (t.py:1);dbgscript_read_ptr;ReadPointer". The rest of
+//  the interval is charged to the stack alone.
+//
+//  The file has one line per distinct stack: the frames separated by ';', a
+//  space, and the time charged to the stack in microseconds. This is the
+//  input format of flamegraph.pl and speedscope.
+//
+//  Like the stats block, the profiler is shared by every provider and lives
+//  on the process heap. The stack walker is per module, since each provider
+//  links its own copy of this library.
+//
+// @EndHeader@
+//******************************************************************************
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strsafe.h>
+
+// Sampling interval, in microseconds.
+//
+const ULONG PROFILER_INTERVAL_US = 1000;
+
+// Maximum length of a folded stack, including the engine call.
+//
+const ULONG PROFILER_MAX_STACK = 4096;
+
+// Number of distinct engine calls held between samples. Further calls are
+// charged to the last one.
+//
+const ULONG PROFILER_MAX_PENDING = 32;
+
+// Initial number of slots in the stack table. A power of two.
+//
+const ULONG PROFILER_INITIAL_SLOTS = 1024;
+
+// Initial size of the stack name pool, in bytes.
+//
+const ULONG PROFILER_INITIAL_NAMES = 64 * 1024;
+
+// Stack sampled when the script isn't running any frame.
+//
+static const char x_NoStack[] = "[script]";
+
+// ProfilerPendingCall - Engine time not yet charged to a stack.
+//
+struct ProfilerPendingCall
+{
+	// Script API that made the call, or nullptr if none.
+	//
+	const char* Api;
+
+	// Name of the engine call.
+	//
+	const char* Call;
+
+	LONGLONG Ticks;
+};
+
+// ProfilerStackSlot - Time charged to one folded stack. Free if 'Length' is
+// zero.
+//
+struct ProfilerStackSlot
+{
+	UINT64 Hash;
+
+	// Offset of the stack in the name pool, and its length.
+	//
+	ULONG Offset;
+
+	ULONG Length;
+
+	LONGLONG Ticks;
+};
+
+struct DbgScriptProfiler
+{
+	FILE* File;
+
+	// Performance counter frequency, and the sampling interval, in ticks.
+	//
+	LONGLONG Frequency;
+
+	LONGLONG IntervalTicks;
+
+	// When the previous sample was taken, and when the next one is due.
+	//
+	LONGLONG LastSample;
+
+	LONGLONG NextSample;
+
+	// Script API most recently entered, or nullptr if none since the last
+	// sample.
+	//
+	const char* CurrentApi;
+
+	ProfilerPendingCall Pending[PROFILER_MAX_PENDING];
+
+	ULONG PendingCount;
+
+	// Stack table, open-addressed by hash of the stack. 'SlotCount' is a
+	// power of two.
+	//
+	ProfilerStackSlot* Slots;
+
+	ULONG SlotCount;
+
+	ULONG UsedSlots;
+
+	// Pool holding the text of every stack in the table.
+	//
+	char* Names;
+
+	ULONG NamesSize;
+
+	ULONG NamesUsed;
+
+	// Did an allocation fail? Samples were dropped.
+	//
+	bool OutOfMemory;
+};
+
+// Stack walker of the provider in this module running a script, or nullptr.
+//
+static ProfilerWalkStackCb s_WalkStack;
+
+// Name pool of the stacks being sorted by ProfilerStop.
+//
+static const char* s_SortNames;
+
+//------------------------------------------------------------------------------
+// Function: hashStack
+//
+// Description:
+//
+//  FNV-1a hash of a folded stack.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Hash.
+//
+// Notes:
+//
+static UINT64
+hashStack(
+	_In_reads_(len) const char* stack,
+	_In_ ULONG len)
+{
+	UINT64 hash = 14695981039346656037ULL;
+
+	for (ULONG i = 0; i < len; ++i)
+	{
+		hash ^= (BYTE)stack[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: growSlots
+//
+// Description:
+//
+//  Double the size of the stack table.
+//
+// Parameters:
+//
+// Returns:
+//
+//  false if out of memory.
+//
+// Notes:
+//
+static _Check_return_ bool
+growSlots(
+	_In_ DbgScriptProfiler* prof)
+{
+	const ULONG newCount = prof->SlotCount * 2;
+	const ULONG mask = newCount - 1;
+	ProfilerStackSlot* slots = (ProfilerStackSlot*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, newCount * sizeof(ProfilerStackSlot));
+	if (!slots)
+	{
+		return false;
+	}
+
+	for (ULONG i = 0; i < prof->SlotCount; ++i)
+	{
+		const ProfilerStackSlot& old = prof->Slots[i];
+		if (old.Length)
+		{
+			ULONG j = (ULONG)old.Hash & mask;
+			while (slots[j].Length)
+			{
+				j = (j + 1) & mask;
+			}
+			slots[j] = old;
+		}
+	}
+
+	HeapFree(GetProcessHeap(), 0, prof->Slots);
+	prof->Slots = slots;
+	prof->SlotCount = newCount;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: chargeStack
+//
+// Description:
+//
+//  Charge time to a folded stack.
+//
+// Parameters:
+//
+//  stack - Folded stack. Must not be empty.
+//  ticks - Time to charge.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+chargeStack(
+	_In_ DbgScriptProfiler* prof,
+	_In_z_ const char* stack,
+	_In_ LONGLONG ticks)
+{
+	const ULONG len = (ULONG)strlen(stack);
+	const UINT64 hash = hashStack(stack, len);
+	ULONG mask = 0;
+	ULONG i = 0;
+
+	if ((prof->UsedSlots + 1) * 2 > prof->SlotCount && !growSlots(prof))
+	{
+		prof->OutOfMemory = true;
+		return;
+	}
+
+	mask = prof->SlotCount - 1;
+	for (i = (ULONG)hash & mask; prof->Slots[i].Length; i = (i + 1) & mask)
+	{
+		ProfilerStackSlot& slot = prof->Slots[i];
+		if (slot.Hash == hash &&
+			slot.Length == len &&
+			!memcmp(prof->Names + slot.Offset, stack, len))
+		{
+			slot.Ticks += ticks;
+			return;
+		}
+	}
+
+	// New stack. Make room for it in the pool.
+	//
+	if (len > prof->NamesSize - prof->NamesUsed)
+	{
+		const ULONG newSize = max(prof->NamesSize * 2, prof->NamesUsed + len);
+		char* names = (char*)HeapReAlloc(GetProcessHeap(), 0, prof->Names, newSize);
+		if (!names)
+		{
+			prof->OutOfMemory = true;
+			return;
+		}
+
+		prof->Names = names;
+		prof->NamesSize = newSize;
+	}
+
+	memcpy(prof->Names + prof->NamesUsed, stack, len);
+
+	ProfilerStackSlot& slot = prof->Slots[i];
+	slot.Hash = hash;
+	slot.Offset = prof->NamesUsed;
+	slot.Length = len;
+	slot.Ticks = ticks;
+
+	prof->NamesUsed += len;
+	++prof->UsedSlots;
+}
+
+//------------------------------------------------------------------------------
+// Function: takeSample
+//
+// Description:
+//
+//  Charge the time since the previous sample to the script's stack, and the
+//  engine calls made since to the stack extended with each call.
+//
+// Parameters:
+//
+//  now - Current time, in ticks.
+//  walkCtxt - Passed to the stack walker.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+takeSample(
+	_In_ DbgScriptProfiler* prof,
+	_In_ LONGLONG now,
+	_In_opt_ void* walkCtxt)
+{
+	char stack[PROFILER_MAX_STACK];
+	char key[PROFILER_MAX_STACK];
+	LONGLONG engineTicks = 0;
+
+	stack[0] = 0;
+	if (s_WalkStack)
+	{
+		s_WalkStack(walkCtxt, stack, _countof(stack));
+	}
+
+	if (!stack[0])
+	{
+		StringCchCopyA(stack, _countof(stack), x_NoStack);
+	}
+
+	for (ULONG i = 0; i < prof->PendingCount; ++i)
+	{
+		const ProfilerPendingCall& call = prof->Pending[i];
+
+		StringCchPrintfA(
+			key,
+			_countof(key),
+			"%s;%s;%s",
+			stack,
+			call.Api ? call.Api : "[host]",
+			call.Call);
+		chargeStack(prof, key, call.Ticks);
+		engineTicks += call.Ticks;
+	}
+
+	if (now - prof->LastSample > engineTicks)
+	{
+		chargeStack(prof, stack, now - prof->LastSample - engineTicks);
+	}
+
+	prof->PendingCount = 0;
+	prof->CurrentApi = nullptr;
+	prof->LastSample = now;
+	prof->NextSample = now + prof->IntervalTicks;
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerStart
+//
+// Description:
+//
+//  Start profiling, to be written to 'path' by ProfilerStop.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if already profiling.
+//
+// Notes:
+//
+//  The file is created now so a bad path fails before the script runs.
+//
+_Check_return_ HRESULT
+ProfilerStart(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path)
+{
+	HRESULT hr = S_OK;
+	FILE* fp = nullptr;
+	DbgScriptProfiler* prof = nullptr;
+	LARGE_INTEGER freq = {};
+
+	if (hostCtxt->Profiler)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	if (fopen_s(&fp, path, "w"))
+	{
+		hr = HRESULT_FROM_WIN32(_doserrno);
+		goto exit;
+	}
+
+	prof = (DbgScriptProfiler*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DbgScriptProfiler));
+	if (!prof)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	prof->Slots = (ProfilerStackSlot*)HeapAlloc(
+		GetProcessHeap(),
+		HEAP_ZERO_MEMORY,
+		PROFILER_INITIAL_SLOTS * sizeof(ProfilerStackSlot));
+	prof->Names = (char*)HeapAlloc(GetProcessHeap(), 0, PROFILER_INITIAL_NAMES);
+	if (!prof->Slots || !prof->Names)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	prof->SlotCount = PROFILER_INITIAL_SLOTS;
+	prof->NamesSize = PROFILER_INITIAL_NAMES;
+
+	QueryPerformanceFrequency(&freq);
+	prof->Frequency = freq.QuadPart;
+	prof->IntervalTicks = freq.QuadPart * PROFILER_INTERVAL_US / 1000000;
+
+	prof->File = fp;
+	fp = nullptr;
+
+	hostCtxt->Profiler = prof;
+	prof = nullptr;
+exit:
+	if (prof)
+	{
+		if (prof->Slots)
+		{
+			HeapFree(GetProcessHeap(), 0, prof->Slots);
+		}
+		if (prof->Names)
+		{
+			HeapFree(GetProcessHeap(), 0, prof->Names);
+		}
+		HeapFree(GetProcessHeap(), 0, prof);
+	}
+
+	if (fp)
+	{
+		fclose(fp);
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: compareSlots
+//
+// Description:
+//
+//  qsort comparer for pointers to stack slots, by stack.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  The stacks are in s_SortNames.
+//
+static int __cdecl
+compareSlots(
+	_In_ const void* a,
+	_In_ const void* b)
+{
+	const ProfilerStackSlot* slotA = *(const ProfilerStackSlot* const*)a;
+	const ProfilerStackSlot* slotB = *(const ProfilerStackSlot* const*)b;
+	const int cmp = memcmp(
+		s_SortNames + slotA->Offset,
+		s_SortNames + slotB->Offset,
+		min(slotA->Length, slotB->Length));
+
+	if (cmp)
+	{
+		return cmp;
+	}
+	return (int)slotA->Length - (int)slotB->Length;
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerStop
+//
+// Description:
+//
+//  Stop profiling and write out the folded stacks, sorted.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. E_OUTOFMEMORY if samples were dropped for lack of memory; the
+//  rest are still written.
+//
+// Notes:
+//
+//  Called by the host after the provider has detached, so no engine time is
+//  left pending.
+//
+_Check_return_ HRESULT
+ProfilerStop(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	HRESULT hr = S_OK;
+	DbgScriptProfiler* prof = hostCtxt->Profiler;
+	const ProfilerStackSlot** sorted = nullptr;
+	ULONG count = 0;
+	FILE* fp = nullptr;
+
+	if (!prof)
+	{
+		goto exit;
+	}
+
+	hostCtxt->Profiler = nullptr;
+	fp = prof->File;
+
+	sorted = (const ProfilerStackSlot**)HeapAlloc(
+		GetProcessHeap(), 0, max(prof->UsedSlots, 1UL) * sizeof(*sorted));
+	if (sorted)
+	{
+		for (ULONG i = 0; i < prof->SlotCount; ++i)
+		{
+			if (prof->Slots[i].Length)
+			{
+				sorted[count++] = &prof->Slots[i];
+			}
+		}
+
+		s_SortNames = prof->Names;
+		qsort(sorted, count, sizeof(*sorted), compareSlots);
+		s_SortNames = nullptr;
+
+		for (ULONG i = 0; i < count; ++i)
+		{
+			const UINT64 us = (UINT64)sorted[i]->Ticks * 1000000 / prof->Frequency;
+			if (us)
+			{
+				fprintf(
+					fp,
+					"%.*s %I64u\n",
+					sorted[i]->Length,
+					prof->Names + sorted[i]->Offset,
+					us);
+			}
+		}
+
+		HeapFree(GetProcessHeap(), 0, sorted);
+	}
+	else
+	{
+		prof->OutOfMemory = true;
+	}
+
+	if (ferror(fp))
+	{
+		hr = E_FAIL;
+	}
+
+	if (fclose(fp))
+	{
+		hr = E_FAIL;
+	}
+
+	if (SUCCEEDED(hr) && prof->OutOfMemory)
+	{
+		hr = E_OUTOFMEMORY;
+	}
+
+	HeapFree(GetProcessHeap(), 0, prof->Slots);
+	HeapFree(GetProcessHeap(), 0, prof->Names);
+	HeapFree(GetProcessHeap(), 0, prof);
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerAttach
+//
+// Description:
+//
+//  Called by a provider about to run a script.
+//
+// Parameters:
+//
+//  walkStack - Describes the script's stack when a sample is taken.
+//
+// Returns:
+//
+//  true if profiling, in which case the caller must install its interpreter
+//  hook, and remove it and call ProfilerDetach when the script ends. false if
+//  not profiling, or if a script of this provider is already being profiled
+//  (the script is nested in it, and uses its hook).
+//
+// Notes:
+//
+_Check_return_ bool
+ProfilerAttach(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ ProfilerWalkStackCb walkStack)
+{
+	DbgScriptProfiler* prof = hostCtxt->Profiler;
+	LARGE_INTEGER now = {};
+
+	if (!prof || s_WalkStack)
+	{
+		return false;
+	}
+
+	// Time before now wasn't spent running the script.
+	//
+	QueryPerformanceCounter(&now);
+	prof->LastSample = now.QuadPart;
+	prof->NextSample = now.QuadPart + prof->IntervalTicks;
+	prof->PendingCount = 0;
+	prof->CurrentApi = nullptr;
+
+	s_WalkStack = walkStack;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerDetach
+//
+// Description:
+//
+//  Called by a provider when the script attached with ProfilerAttach ends.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  The time since the last sample is charged now, while the names the
+//  provider passed in are still loaded. The script's frames are gone by now,
+//  so it is charged to the script as a whole.
+//
+void
+ProfilerDetach(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	DbgScriptProfiler* prof = hostCtxt->Profiler;
+	LARGE_INTEGER now = {};
+
+	s_WalkStack = nullptr;
+	if (!prof)
+	{
+		return;
+	}
+
+	QueryPerformanceCounter(&now);
+	takeSample(prof, now.QuadPart, nullptr);
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerSample
+//
+// Description:
+//
+//  Take a sample if one is due. Called by interpreter hooks.
+//
+// Parameters:
+//
+//  walkCtxt - Passed to the stack walker, e.g. the interpreter state.
+//
+// Returns:
+//
+// Notes:
+//
+void
+ProfilerSample(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_opt_ void* walkCtxt)
+{
+	DbgScriptProfiler* prof = hostCtxt->Profiler;
+	LARGE_INTEGER now = {};
+
+	if (!prof || !s_WalkStack)
+	{
+		return;
+	}
+
+	QueryPerformanceCounter(&now);
+	if (now.QuadPart >= prof->NextSample)
+	{
+		takeSample(prof, now.QuadPart, walkCtxt);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerEnterApi
+//
+// Description:
+//
+//  Note the script API being entered, to tag engine calls it makes.
+//
+// Parameters:
+//
+//  api - Name of the API's implementation. Must stay loaded until the
+//   provider detaches.
+//
+// Returns:
+//
+// Notes:
+//
+void
+ProfilerEnterApi(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* api)
+{
+	if (hostCtxt->Profiler)
+	{
+		hostCtxt->Profiler->CurrentApi = api;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerChargeEngine
+//
+// Description:
+//
+//  Hold time spent in a debugger engine call until the next sample.
+//
+// Parameters:
+//
+//  call - Name of the call. Must stay loaded until the provider detaches.
+//  ticks - Time spent in the call.
+//
+// Returns:
+//
+// Notes:
+//
+void
+ProfilerChargeEngine(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* call,
+	_In_ LONGLONG ticks)
+{
+	DbgScriptProfiler* prof = hostCtxt->Profiler;
+	ULONG i = 0;
+
+	if (!prof)
+	{
+		return;
+	}
+
+	for (i = 0; i < prof->PendingCount; ++i)
+	{
+		if (prof->Pending[i].Api == prof->CurrentApi &&
+			prof->Pending[i].Call == call)
+		{
+			break;
+		}
+	}
+
+	if (i == prof->PendingCount)
+	{
+		if (prof->PendingCount == PROFILER_MAX_PENDING)
+		{
+			// Full. Charge to the last one.
+			//
+			i = PROFILER_MAX_PENDING - 1;
+		}
+		else
+		{
+			ProfilerPendingCall& pending = prof->Pending[prof->PendingCount++];
+			pending.Api = prof->CurrentApi;
+			pending.Call = call;
+			pending.Ticks = 0;
+		}
+	}
+
+	prof->Pending[i].Ticks += ticks;
+}
+
+//------------------------------------------------------------------------------
+// Function: ProfilerAppendFrame
+//
+// Description:
+//
+//  Append a frame to a folded stack being built by a stack walker.
+//
+// Parameters:
+//
+//  func - Function name, or nullptr if unknown.
+//  file - Source file, or nullptr if unknown. Only the file name is kept.
+//  line - Line the function starts on, or zero if unknown.
+//
+// Returns:
+//
+// Notes:
+//
+//  The stack is truncated if it doesn't fit.
+//
+void
+ProfilerAppendFrame(
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf,
+	_In_opt_z_ const char* func,
+	_In_opt_z_ const char* file,
+	_In_ int line)
+{
+	char frame[256];
+
+	if (!func)
+	{
+		func = "?";
+	}
+
+	if (file)
+	{
+		const char* slash = strrchr(file, '\\');
+		const char* fwdSlash = strrchr(file, '/');
+		if (fwdSlash > slash)
+		{
+			slash = fwdSlash;
+		}
+		if (slash)
+		{
+			file = slash + 1;
+		}
+
+		if (line > 0)
+		{
+			StringCchPrintfA(frame, _countof(frame), "%s (%s:%d)", func, file, line);
+		}
+		else
+		{
+			StringCchPrintfA(frame, _countof(frame), "%s (%s)", func, file);
+		}
+	}
+	else
+	{
+		StringCchCopyA(frame, _countof(frame), func);
+	}
+
+	// ';' separates frames and a line ends the stack.
+	//
+	for (char* p = frame; *p; ++p)
+	{
+		if (*p == ';' || *p == '\r' || *p == '\n')
+		{
+			*p = '_';
+		}
+	}
+
+	if (buf[0])
+	{
+		StringCchCatA(buf, cchBuf, ";");
+	}
+	StringCchCatA(buf, cchBuf, frame);
+}
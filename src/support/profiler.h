@@ -0,0 +1,71 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: profiler.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Sampling profiler for scripts, written as folded stacks.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// ProfilerWalkStackCb - Describe the running script's stack with
+// ProfilerAppendFrame, outermost frame first.
+//
+// walkCtxt is the value passed to ProfilerSample.
+//
+typedef void
+(*ProfilerWalkStackCb)(
+	_In_opt_ void* walkCtxt,
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf);
+
+_Check_return_ HRESULT
+ProfilerStart(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path);
+
+_Check_return_ HRESULT
+ProfilerStop(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+_Check_return_ bool
+ProfilerAttach(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ ProfilerWalkStackCb walkStack);
+
+void
+ProfilerDetach(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+ProfilerSample(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_opt_ void* walkCtxt);
+
+void
+ProfilerEnterApi(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* api);
+
+void
+ProfilerChargeEngine(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* call,
+	_In_ LONGLONG ticks);
+
+void
+ProfilerAppendFrame(
+	_Inout_updates_z_(cchBuf) char* buf,
+	_In_ size_t cchBuf,
+	_In_opt_z_ const char* func,
+	_In_opt_z_ const char* file,
+	_In_ int line);
@@ -0,0 +1,1009 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: stats.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Call counters and latency histograms for the host, providers and support
+//  library.
+//
+// Notes:
+//
+//  Collection is off unless enabled with !dbgscriptstats on or
+//  !runscript -stats. When off, the host context has no stats block and every
+//  entry point here returns after a null check, so instrumented call sites cost
+//  next to nothing.
+//
+//  The same hooks feed the timeline, if one is being recorded (see
+//  timeline.h), and the profiler, if one is running (see profiler.h).
+//
+//  Latencies are kept in histograms with power-of-two buckets in microseconds:
+//  bucket 0 is under 1us, bucket i counts [2^(i-1), 2^i) us, and the last
+//  bucket takes everything longer.
+//
+//  The stats block is shared by every provider, and the Ruby provider is built
+//  against a different CRT than the others, so it holds no STL containers and
+//  lives on the process heap.
+//
+// @EndHeader@
+//******************************************************************************
+#include "stats.h"
+#include "timeline.h"
+#include "profiler.h"
+#include <psapi.h>
+#include <strsafe.h>
+#include <stdlib.h>
+
+const ULONG STATS_HISTOGRAM_BUCKETS = 24;
+
+// Number of slots in the API call count table. A power of two, and well above
+// the number of script-facing APIs.
+//
+const ULONG STATS_API_SLOTS = 512;
+
+// Number of slots in the !evalstring cache table. A power of two. Strings
+// beyond this many aren't counted.
+//
+const ULONG STATS_EVAL_SLOTS = 128;
+
+// Number of VMs whose memory use is reported. One per provider.
+//
+const ULONG STATS_VM_SLOTS = 8;
+
+// StatsTimerData - Statistics of one timer.
+//
+struct StatsTimerData
+{
+	UINT64 Count;
+
+	// Total and longest time, in performance counter ticks.
+	//
+	UINT64 TotalTicks;
+
+	UINT64 MaxTicks;
+
+	UINT64 Buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+// StatsApiCount - Number of calls to one script-facing API. Free if 'Name' is
+// empty.
+//
+struct StatsApiCount
+{
+	char Name[64];
+
+	UINT64 Count;
+};
+
+// StatsEvalCount - Compiled-code cache lookups (see evalcache.h) for one
+// !evalstring string. Free if 'Text' is empty.
+//
+struct StatsEvalCount
+{
+	// Hash of the whole string. 'Text' may be truncated.
+	//
+	UINT64 Hash;
+
+	char Text[64];
+
+	UINT64 Hits;
+
+	UINT64 Misses;
+};
+
+// StatsVMMemory - Memory use of one provider's VM, as of its last run. Free if
+// 'Name' is empty.
+//
+struct StatsVMMemory
+{
+	char Name[16];
+
+	UINT64 CurrentBytes;
+
+	UINT64 PeakBytes;
+};
+
+struct DbgScriptStats
+{
+	StatsTimerData Timers[StatsTimerMax];
+
+	UINT64 Counters[StatsCounterMax];
+
+	// Open-addressed by hash of the name.
+	//
+	StatsApiCount ApiCounts[STATS_API_SLOTS];
+
+	// Open-addressed by Hash.
+	//
+	StatsEvalCount EvalCounts[STATS_EVAL_SLOTS];
+
+	StatsVMMemory VMMemory[STATS_VM_SLOTS];
+
+	// Performance counter frequency, in ticks per second.
+	//
+	LONGLONG Frequency;
+};
+
+// Names of the timers and counters, for output.
+//
+static const char* const s_TimerNames[StatsTimerMax] =
+{
+	"ReadVirtual",
+	"ReadPointer",
+	"SearchVirtual",
+	"TypedData",
+	"GetSymbolTypeId",
+	"GetFieldOffset",
+	"GetTypeSize",
+	"GetNameByOffset",
+	"ReadTypedData",
+	"GetInterrupt",
+	"ProviderLoad",
+	"VMStart",
+	"VMReset",
+	"FindScript",
+	"Script",
+	"OutputFlush",
+};
+
+// Names of the argument of each timer in the timeline, or nullptr if it has
+// none.
+//
+static const char* const s_TimerArgNames[StatsTimerMax] =
+{
+	"addr",
+	"addr",
+	"start",
+	nullptr,
+	nullptr,
+	"type_id",
+	"type_id",
+	"addr",
+	"addr",
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	"bytes",
+};
+
+static const char* const s_CounterNames[StatsCounterMax] =
+{
+	"BytesRead",
+	"CacheHits",
+	"CacheMisses",
+	"ScriptPathHits",
+	"ScriptPathMisses",
+	"WrapperReuses",
+	"WrapperAllocs",
+};
+
+//------------------------------------------------------------------------------
+// Function: ticksToUs
+//
+// Description:
+//
+//  Convert performance counter ticks to microseconds.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Microseconds.
+//
+// Notes:
+//
+static UINT64
+ticksToUs(
+	_In_ const DbgScriptStats* stats,
+	_In_ UINT64 ticks)
+{
+	return ticks * 1000000 / stats->Frequency;
+}
+
+//------------------------------------------------------------------------------
+// Function: compareApiCounts
+//
+// Description:
+//
+//  qsort comparer for pointers to StatsApiCount, by name.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static int __cdecl
+compareApiCounts(
+	_In_ const void* a,
+	_In_ const void* b)
+{
+	return strcmp(
+		(*(const StatsApiCount* const*)a)->Name,
+		(*(const StatsApiCount* const*)b)->Name);
+}
+
+//------------------------------------------------------------------------------
+// Function: sortApiCounts
+//
+// Description:
+//
+//  Collect the APIs that were called, sorted by name.
+//
+// Parameters:
+//
+//  sorted - Receives the API counts. Must have STATS_API_SLOTS entries.
+//
+// Returns:
+//
+//  Number of APIs.
+//
+// Notes:
+//
+static ULONG
+sortApiCounts(
+	_In_ const DbgScriptStats* stats,
+	_Out_writes_(STATS_API_SLOTS) const StatsApiCount** sorted)
+{
+	ULONG count = 0;
+
+	for (ULONG i = 0; i < STATS_API_SLOTS; ++i)
+	{
+		if (stats->ApiCounts[i].Name[0])
+		{
+			sorted[count++] = &stats->ApiCounts[i];
+		}
+	}
+
+	qsort(sorted, count, sizeof(*sorted), compareApiCounts);
+	return count;
+}
+
+//------------------------------------------------------------------------------
+// Function: compareEvalCounts
+//
+// Description:
+//
+//  qsort comparer for pointers to StatsEvalCount, most hits first.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static int __cdecl
+compareEvalCounts(
+	_In_ const void* a,
+	_In_ const void* b)
+{
+	const StatsEvalCount* evalA = *(const StatsEvalCount* const*)a;
+	const StatsEvalCount* evalB = *(const StatsEvalCount* const*)b;
+
+	if (evalA->Hits != evalB->Hits)
+	{
+		return evalA->Hits > evalB->Hits ? -1 : 1;
+	}
+	return strcmp(evalA->Text, evalB->Text);
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsEnable
+//
+// Description:
+//
+//  Start collecting statistics.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if already collecting.
+//
+// Notes:
+//
+//  The statistics are stored in the host context so all providers share them.
+//
+_Check_return_ HRESULT
+StatsEnable(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	LARGE_INTEGER freq = {};
+
+	if (hostCtxt->Stats)
+	{
+		return S_FALSE;
+	}
+
+	QueryPerformanceFrequency(&freq);
+
+	// From the process heap, since it may be freed by a different module.
+	//
+	DbgScriptStats* stats = (DbgScriptStats*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DbgScriptStats));
+	if (!stats)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	stats->Frequency = freq.QuadPart;
+
+	hostCtxt->Stats = stats;
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsDisable
+//
+// Description:
+//
+//  Stop collecting statistics and discard them.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsDisable(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	if (hostCtxt->Stats)
+	{
+		HeapFree(GetProcessHeap(), 0, hostCtxt->Stats);
+		hostCtxt->Stats = nullptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsReset
+//
+// Description:
+//
+//  Zero the statistics collected so far.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsReset(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	DbgScriptStats* stats = hostCtxt->Stats;
+	if (!stats)
+	{
+		return;
+	}
+
+	ZeroMemory(stats->Timers, sizeof(stats->Timers));
+	ZeroMemory(stats->Counters, sizeof(stats->Counters));
+	ZeroMemory(stats->ApiCounts, sizeof(stats->ApiCounts));
+	ZeroMemory(stats->EvalCounts, sizeof(stats->EvalCounts));
+	ZeroMemory(stats->VMMemory, sizeof(stats->VMMemory));
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsBegin
+//
+// Description:
+//
+//  Start timing an operation.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Timestamp to pass to StatsEnd. Zero if not collecting statistics,
+//  recording a timeline or profiling.
+//
+// Notes:
+//
+_Check_return_ LONGLONG
+StatsBegin(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	LARGE_INTEGER now = {};
+
+	if (!hostCtxt->Stats && !hostCtxt->Timeline && !hostCtxt->Profiler)
+	{
+		return 0;
+	}
+
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsEnd
+//
+// Description:
+//
+//  Finish timing an operation started with StatsBegin.
+//
+// Parameters:
+//
+//  timer - Timer to charge the operation to.
+//  start - Return value of StatsBegin.
+//  arg - Argument of the operation, shown in the timeline.
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsEnd(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsTimer timer,
+	_In_ LONGLONG start,
+	_In_ UINT64 arg)
+{
+	DbgScriptStats* stats = hostCtxt->Stats;
+	LARGE_INTEGER now = {};
+	ULONG bucket = 0;
+
+	if (!start)
+	{
+		return;
+	}
+
+	QueryPerformanceCounter(&now);
+
+	TimelineComplete(
+		hostCtxt,
+		s_TimerNames[timer],
+		timer < StatsTimerFirstHost ? TimelineCategoryEngine : TimelineCategoryHost,
+		start,
+		now.QuadPart,
+		s_TimerArgNames[timer],
+		arg);
+
+	const UINT64 ticks = now.QuadPart > start ? (UINT64)(now.QuadPart - start) : 0;
+
+	if (timer < StatsTimerFirstHost)
+	{
+		ProfilerChargeEngine(hostCtxt, s_TimerNames[timer], (LONGLONG)ticks);
+	}
+
+	if (!stats)
+	{
+		return;
+	}
+
+	UINT64 us = ticksToUs(stats, ticks);
+	StatsTimerData* data = &stats->Timers[timer];
+
+	while (us && bucket < STATS_HISTOGRAM_BUCKETS - 1)
+	{
+		us >>= 1;
+		++bucket;
+	}
+
+	++data->Count;
+	data->TotalTicks += ticks;
+	data->MaxTicks = max(data->MaxTicks, ticks);
+	++data->Buckets[bucket];
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsCount
+//
+// Description:
+//
+//  Add to a counter.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsCount(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsCounter counter,
+	_In_ UINT64 n)
+{
+	if (hostCtxt->Stats)
+	{
+		hostCtxt->Stats->Counters[counter] += n;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsCountApi
+//
+// Description:
+//
+//  Count a call to a script-facing API, mark it on the timeline, and tag the
+//  engine calls it makes for the profiler.
+//
+// Parameters:
+//
+//  api - Name of the API's implementation.
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsCountApi(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* api)
+{
+	DbgScriptStats* stats = hostCtxt->Stats;
+	UINT64 hash = 14695981039346656037ULL;
+
+	TimelineInstant(hostCtxt, api, TimelineCategoryApi, nullptr, 0);
+	ProfilerEnterApi(hostCtxt, api);
+
+	if (!stats)
+	{
+		return;
+	}
+
+	// FNV-1a over the name as it will be stored.
+	//
+	for (ULONG i = 0; api[i] && i < _countof(stats->ApiCounts[0].Name) - 1; ++i)
+	{
+		hash ^= (BYTE)api[i];
+		hash *= 1099511628211ULL;
+	}
+
+	for (ULONG i = 0; i < STATS_API_SLOTS; ++i)
+	{
+		StatsApiCount& slot = stats->ApiCounts[(hash + i) & (STATS_API_SLOTS - 1)];
+
+		if (!slot.Name[0])
+		{
+			StringCchCopyA(slot.Name, _countof(slot.Name), api);
+		}
+		else if (strncmp(slot.Name, api, _countof(slot.Name) - 1) != 0)
+		{
+			continue;
+		}
+
+		++slot.Count;
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsCountEval
+//
+// Description:
+//
+//  Count a lookup of an !evalstring string in a provider's compiled-code
+//  cache.
+//
+// Parameters:
+//
+//  text - String evaluated.
+//  hit - Whether its compiled code was cached.
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsCountEval(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* text,
+	_In_ bool hit)
+{
+	DbgScriptStats* stats = hostCtxt->Stats;
+	UINT64 hash = 14695981039346656037ULL;
+
+	if (!stats)
+	{
+		return;
+	}
+
+	for (const char* p = text; *p; ++p)
+	{
+		hash ^= (BYTE)*p;
+		hash *= 1099511628211ULL;
+	}
+
+	for (ULONG i = 0; i < STATS_EVAL_SLOTS; ++i)
+	{
+		StatsEvalCount& slot = stats->EvalCounts[(hash + i) & (STATS_EVAL_SLOTS - 1)];
+
+		if (!slot.Text[0])
+		{
+			slot.Hash = hash;
+			StringCchCopyA(slot.Text, _countof(slot.Text), text);
+		}
+		else if (slot.Hash != hash)
+		{
+			continue;
+		}
+
+		if (hit)
+		{
+			++slot.Hits;
+		}
+		else
+		{
+			++slot.Misses;
+		}
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsSetVMMemory
+//
+// Description:
+//
+//  Record the memory use of a provider's VM.
+//
+// Parameters:
+//
+//  vm - Name of the VM, e.g. "lua".
+//  currentBytes - Bytes the VM holds.
+//  peakBytes - Most bytes it has held since it started.
+//
+// Returns:
+//
+// Notes:
+//
+//  Providers whose VM allocates from an arena (see arena.h) call this after
+//  each run. Replaces the VM's previous figures.
+//
+void
+StatsSetVMMemory(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* vm,
+	_In_ UINT64 currentBytes,
+	_In_ UINT64 peakBytes)
+{
+	DbgScriptStats* stats = hostCtxt->Stats;
+
+	if (!stats)
+	{
+		return;
+	}
+
+	for (ULONG i = 0; i < STATS_VM_SLOTS; ++i)
+	{
+		StatsVMMemory& slot = stats->VMMemory[i];
+
+		if (!slot.Name[0])
+		{
+			StringCchCopyA(slot.Name, _countof(slot.Name), vm);
+		}
+		else if (strncmp(slot.Name, vm, _countof(slot.Name) - 1) != 0)
+		{
+			continue;
+		}
+
+		slot.CurrentBytes = currentBytes;
+		slot.PeakBytes = peakBytes;
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: getMemoryCounters
+//
+// Description:
+//
+//  Get the process' peak working set and private bytes, in KB.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Zero if they can't be queried.
+//
+static void
+getMemoryCounters(
+	_Out_ UINT64* peakWorkingSetKb,
+	_Out_ UINT64* privateKb)
+{
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+
+	if (!GetProcessMemoryInfo(
+			GetCurrentProcess(),
+			(PROCESS_MEMORY_COUNTERS*)&counters,
+			sizeof(counters)))
+	{
+		ZeroMemory(&counters, sizeof(counters));
+	}
+
+	*peakWorkingSetKb = counters.PeakWorkingSetSize / 1024;
+	*privateKb = counters.PrivateUsage / 1024;
+}
+
+//------------------------------------------------------------------------------
+// Function: outputTimers
+//
+// Description:
+//
+//  Output the timers in a range, with their latency histograms.
+//
+// Parameters:
+//
+//  first - First timer to output.
+//  last - One past the last timer to output.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+outputTimers(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DbgScriptStats* stats,
+	_In_ ULONG first,
+	_In_ ULONG last)
+{
+	for (ULONG i = first; i < last; ++i)
+	{
+		const StatsTimerData& data = stats->Timers[i];
+		if (!data.Count)
+		{
+			continue;
+		}
+
+		const UINT64 totalUs = ticksToUs(stats, data.TotalTicks);
+
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"  %-16s %10I64u %10I64u.%03I64u %10I64u %10I64u\n",
+			s_TimerNames[i],
+			data.Count,
+			totalUs / 1000,
+			totalUs % 1000,
+			totalUs / data.Count,
+			ticksToUs(stats, data.MaxTicks));
+
+		// Only output the populated buckets, by their lower bound.
+		//
+		hostCtxt->DebugControl->Output(DEBUG_OUTPUT_NORMAL, "  %-16s", "");
+		for (ULONG bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; ++bucket)
+		{
+			if (!data.Buckets[bucket])
+			{
+				continue;
+			}
+
+			if (bucket == 0)
+			{
+				hostCtxt->DebugControl->Output(
+					DEBUG_OUTPUT_NORMAL, " <1us:%I64u", data.Buckets[bucket]);
+			}
+			else
+			{
+				hostCtxt->DebugControl->Output(
+					DEBUG_OUTPUT_NORMAL,
+					" %I64uus:%I64u",
+					1ui64 << (bucket - 1),
+					data.Buckets[bucket]);
+			}
+		}
+		hostCtxt->DebugControl->Output(DEBUG_OUTPUT_NORMAL, "\n");
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsOutput
+//
+// Description:
+//
+//  Output the statistics collected so far.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+StatsOutput(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	const DbgScriptStats* stats = hostCtxt->Stats;
+	UINT64 peakWorkingSetKb = 0;
+	UINT64 privateKb = 0;
+	const StatsApiCount* sortedApis[STATS_API_SLOTS];
+	ULONG apiCount = 0;
+	const StatsEvalCount* sortedEvals[STATS_EVAL_SLOTS];
+	ULONG evalCount = 0;
+
+	if (!stats)
+	{
+		return;
+	}
+
+	hostCtxt->DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"Engine calls:     %10s %14s %10s %10s\n",
+		"calls",
+		"total ms",
+		"avg us",
+		"max us");
+	outputTimers(hostCtxt, stats, 0, StatsTimerFirstHost);
+
+	hostCtxt->DebugControl->Output(DEBUG_OUTPUT_NORMAL, "Host phases:\n");
+	outputTimers(hostCtxt, stats, StatsTimerFirstHost, StatsTimerMax);
+
+	hostCtxt->DebugControl->Output(DEBUG_OUTPUT_NORMAL, "Counters:\n");
+	for (ULONG i = 0; i < StatsCounterMax; ++i)
+	{
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"  %-16s %10I64u\n",
+			s_CounterNames[i],
+			stats->Counters[i]);
+	}
+
+	apiCount = sortApiCounts(stats, sortedApis);
+	if (apiCount)
+	{
+		hostCtxt->DebugControl->Output(DEBUG_OUTPUT_NORMAL, "API calls:\n");
+		for (ULONG i = 0; i < apiCount; ++i)
+		{
+			hostCtxt->DebugControl->Output(
+				DEBUG_OUTPUT_NORMAL,
+				"  %-32s %10I64u\n",
+				sortedApis[i]->Name,
+				sortedApis[i]->Count);
+		}
+	}
+
+	for (ULONG i = 0; i < STATS_EVAL_SLOTS; ++i)
+	{
+		if (stats->EvalCounts[i].Text[0])
+		{
+			sortedEvals[evalCount++] = &stats->EvalCounts[i];
+		}
+	}
+
+	if (evalCount)
+	{
+		qsort(sortedEvals, evalCount, sizeof(*sortedEvals), compareEvalCounts);
+
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL, "Eval cache (hits, misses):\n");
+		for (ULONG i = 0; i < evalCount; ++i)
+		{
+			hostCtxt->DebugControl->Output(
+				DEBUG_OUTPUT_NORMAL,
+				"  %-32s %10I64u %10I64u\n",
+				sortedEvals[i]->Text,
+				sortedEvals[i]->Hits,
+				sortedEvals[i]->Misses);
+		}
+	}
+
+	for (ULONG i = 0; i < STATS_VM_SLOTS; ++i)
+	{
+		const StatsVMMemory& slot = stats->VMMemory[i];
+		if (!slot.Name[0])
+		{
+			continue;
+		}
+
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_NORMAL,
+			"VM memory: %-8s %I64u KB current, %I64u KB peak\n",
+			slot.Name,
+			slot.CurrentBytes / 1024,
+			slot.PeakBytes / 1024);
+	}
+
+	getMemoryCounters(&peakWorkingSetKb, &privateKb);
+	hostCtxt->DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"Memory: %I64u KB private bytes, %I64u KB peak working set\n",
+		privateKb,
+		peakWorkingSetKb);
+}
+
+//------------------------------------------------------------------------------
+// Function: StatsEnumerate
+//
+// Description:
+//
+//  Enumerate the statistics collected so far as flat name/value pairs.
+//
+// Parameters:
+//
+//  callback - Called with each name and value.
+//
+// Returns:
+//
+//  false if not collecting.
+//
+// Notes:
+//
+//  Names are:
+//
+//   api.<name>                       Calls to a script-facing API.
+//   timer.<name>.{count,us,max_us}   Calls, total and longest time of an
+//                                    engine call or host phase.
+//   <counter name>                   Counters, e.g. BytesRead.
+//   memory.{peak_working_set_kb,private_kb}
+//   vm.<name>.{current_bytes,peak_bytes}
+//                                    Memory use of a provider's VM.
+//
+_Check_return_ bool
+StatsEnumerate(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsEnumCb callback,
+	_In_opt_ void* userctxt)
+{
+	const DbgScriptStats* stats = hostCtxt->Stats;
+	char name[MAX_PATH];
+	UINT64 peakWorkingSetKb = 0;
+	UINT64 privateKb = 0;
+	const StatsApiCount* sortedApis[STATS_API_SLOTS];
+
+	if (!stats)
+	{
+		return false;
+	}
+
+	const ULONG apiCount = sortApiCounts(stats, sortedApis);
+	for (ULONG i = 0; i < apiCount; ++i)
+	{
+		StringCchPrintfA(name, _countof(name), "api.%s", sortedApis[i]->Name);
+		callback(name, sortedApis[i]->Count, userctxt);
+	}
+
+	for (ULONG i = 0; i < StatsTimerMax; ++i)
+	{
+		const StatsTimerData& data = stats->Timers[i];
+		if (!data.Count)
+		{
+			continue;
+		}
+
+		StringCchPrintfA(name, _countof(name), "timer.%s.count", s_TimerNames[i]);
+		callback(name, data.Count, userctxt);
+
+		StringCchPrintfA(name, _countof(name), "timer.%s.us", s_TimerNames[i]);
+		callback(name, ticksToUs(stats, data.TotalTicks), userctxt);
+
+		StringCchPrintfA(name, _countof(name), "timer.%s.max_us", s_TimerNames[i]);
+		callback(name, ticksToUs(stats, data.MaxTicks), userctxt);
+	}
+
+	for (ULONG i = 0; i < StatsCounterMax; ++i)
+	{
+		callback(s_CounterNames[i], stats->Counters[i], userctxt);
+	}
+
+	getMemoryCounters(&peakWorkingSetKb, &privateKb);
+	callback("memory.peak_working_set_kb", peakWorkingSetKb, userctxt);
+	callback("memory.private_kb", privateKb, userctxt);
+
+	for (ULONG i = 0; i < STATS_VM_SLOTS; ++i)
+	{
+		const StatsVMMemory& slot = stats->VMMemory[i];
+		if (!slot.Name[0])
+		{
+			continue;
+		}
+
+		StringCchPrintfA(name, _countof(name), "vm.%s.current_bytes", slot.Name);
+		callback(name, slot.CurrentBytes, userctxt);
+
+		StringCchPrintfA(name, _countof(name), "vm.%s.peak_bytes", slot.Name);
+		callback(name, slot.PeakBytes, userctxt);
+	}
+
+	return true;
+}
@@ -0,0 +1,130 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: stats.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Call counters and latency histograms for the host, providers and support
+//  library.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// StatsTimer - A timed operation.
+//
+enum StatsTimer
+{
+	// Debugger engine calls.
+	//
+	StatsTimerReadVirtual,
+	StatsTimerReadPointer,
+	StatsTimerSearchVirtual,
+	StatsTimerTypedData,
+	StatsTimerGetSymbolTypeId,
+	StatsTimerGetFieldOffset,
+	StatsTimerGetTypeSize,
+	StatsTimerGetNameByOffset,
+	StatsTimerReadTypedData,
+	StatsTimerGetInterrupt,
+
+	// First timer that isn't a debugger engine call.
+	//
+	StatsTimerFirstHost,
+
+	// Host phases.
+	//
+	StatsTimerProviderLoad = StatsTimerFirstHost,
+	StatsTimerVMStart,
+	StatsTimerVMReset,
+	StatsTimerFindScript,
+	StatsTimerScript,
+	StatsTimerOutputFlush,
+
+	StatsTimerMax
+};
+
+// StatsCounter - A counted quantity.
+//
+enum StatsCounter
+{
+	StatsCounterBytesRead,
+	StatsCounterCacheHits,
+	StatsCounterCacheMisses,
+	StatsCounterScriptPathHits,
+	StatsCounterScriptPathMisses,
+	StatsCounterWrapperReuses,
+	StatsCounterWrapperAllocs,
+
+	StatsCounterMax
+};
+
+_Check_return_ HRESULT
+StatsEnable(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+StatsDisable(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+StatsReset(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+_Check_return_ LONGLONG
+StatsBegin(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+StatsEnd(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsTimer timer,
+	_In_ LONGLONG start,
+	_In_ UINT64 arg = 0);
+
+void
+StatsCount(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsCounter counter,
+	_In_ UINT64 n);
+
+void
+StatsCountApi(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* api);
+
+void
+StatsCountEval(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* text,
+	_In_ bool hit);
+
+void
+StatsSetVMMemory(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* vm,
+	_In_ UINT64 currentBytes,
+	_In_ UINT64 peakBytes);
+
+void
+StatsOutput(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+typedef void
+(*StatsEnumCb)(
+	_In_z_ const char* name,
+	_In_ UINT64 value,
+	_In_opt_ void* ctxt);
+
+_Check_return_ bool
+StatsEnumerate(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ StatsEnumCb callback,
+	_In_opt_ void* userctxt);
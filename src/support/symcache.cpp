@@ -14,8 +14,18 @@
 //******************************************************************************
 
 #include "symcache.h"
+#include "pdbreader.h"
+#include "trace.h"
+#include "stats.h"
 #include "../common.h"
+#include <dserrors.h>
+#include <assert.h>
+#include <strsafe.h>
+#include <algorithm>
+#include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 // Key is symbol name.
 //
@@ -29,9 +39,204 @@ typedef std::map<UINT64, std::string> ModuleCacheMapT;
 //
 typedef std::map<ModuleAndTypeId, std::string> TypeNameCacheMapT;
 
+// Key is module/type-id and field name, value is cached field offset.
+//
+typedef std::map<std::pair<ModuleAndTypeId, std::string>, ULONG>
+	FieldOffsetCacheMapT;
+
 static SymCacheMapT s_SymCache;
 static ModuleCacheMapT s_ModCache;
 static TypeNameCacheMapT s_TypeNameCache;
+static FieldOffsetCacheMapT s_FieldOffsetCache;
+
+// SymbolIndexEntry - A symbol's start address, size and qualified name.
+//
+struct SymbolIndexEntry
+{
+	UINT64 Offset;
+
+	// Zero if unknown (e.g. for public symbols).
+	//
+	ULONG Size;
+
+	std::string Name;
+};
+
+// ModuleSymbolIndex - All symbols of a module, sorted by address. Each symbol
+// covers its size, or if that's unknown, the interval up to the next one.
+//
+struct ModuleSymbolIndex
+{
+	// One past the last address of the module.
+	//
+	UINT64 End;
+
+	std::vector<SymbolIndexEntry> Symbols;
+};
+
+// Key is the module base.
+//
+typedef std::map<UINT64, ModuleSymbolIndex> SymbolIndexMapT;
+
+static SymbolIndexMapT s_SymbolIndex;
+
+// LRU of formatted nearest-symbol names. Most recently used at the front.
+//
+typedef std::list<std::pair<UINT64, std::string>> NameLruListT;
+typedef std::unordered_map<UINT64, NameLruListT::iterator> NameLruMapT;
+
+const size_t NAME_LRU_CAPACITY = 4096;
+
+static NameLruListT s_NameLru;
+static NameLruMapT s_NameLruMap;
+
+// Value of DbgScriptHostContext::SymbolGeneration the caches above (and the
+// module names) were filled under.
+//
+static ULONG s_SymbolGeneration;
+
+// Key is the module name, value is the module's parsed PDB, or null if it
+// can't be read directly.
+//
+typedef std::map<std::string, PdbFile*> PdbCacheMapT;
+
+static PdbCacheMapT s_PdbCache;
+
+// NameByOffsetResult - Traced response of GetNameByOffset. Only as much of
+// 'Name' as was filled in is recorded.
+//
+struct NameByOffsetResult
+{
+	UINT64 Disp;
+
+	ULONG CchActual;
+
+	char Name[MAX_SYMBOL_NAME_LEN];
+};
+
+//------------------------------------------------------------------------------
+// Function: getNameByOffset
+//
+// Description:
+//
+//  Traced wrapper of IDebugSymbols::GetNameByOffset.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  'cchBuf' must be at most MAX_SYMBOL_NAME_LEN.
+//
+static _Check_return_ HRESULT
+getNameByOffset(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_Out_writes_(cchBuf) char* buf,
+	_In_ ULONG cchBuf,
+	_Out_opt_ ULONG* cchActual,
+	_Out_opt_ UINT64* disp)
+{
+	HRESULT hr = S_OK;
+	NameByOffsetResult result = {};
+	ULONG cbResult = 0;
+	LONGLONG start = 0;
+
+	assert(cchBuf <= MAX_SYMBOL_NAME_LEN);
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallGetNameByOffset,
+			&addr,
+			sizeof(addr),
+			nullptr,
+			0,
+			&result,
+			sizeof(result),
+			&cbResult,
+			&hr))
+	{
+		// The recorded name is NUL-terminated, and 'result' is zeroed past it.
+		//
+		if (SUCCEEDED(hr) &&
+			StringCchCopyA(buf, cchBuf, result.Name) == STRSAFE_E_INSUFFICIENT_BUFFER)
+		{
+			hr = S_FALSE;
+		}
+		goto exit;
+	}
+
+	start = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugSymbols->GetNameByOffset(
+		addr, buf, cchBuf, &result.CchActual, &result.Disp);
+	StatsEnd(hostCtxt, StatsTimerGetNameByOffset, start, addr);
+
+	if (SUCCEEDED(hr))
+	{
+		const ULONG cchCopy = min(result.CchActual, cchBuf);
+		memcpy(result.Name, buf, cchCopy);
+		cbResult = FIELD_OFFSET(NameByOffsetResult, Name) + cchCopy;
+	}
+
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallGetNameByOffset,
+		&addr,
+		sizeof(addr),
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? &result : nullptr,
+		cbResult,
+		hr);
+
+exit:
+	if (cchActual)
+	{
+		*cchActual = result.CchActual;
+	}
+	if (disp)
+	{
+		*disp = result.Disp;
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: flushStaleSymbols
+//
+// Description:
+//
+//  Drop the caches keyed by address if the target's modules or their symbols
+//  have changed since they were filled.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  The host bumps the generation when it sees a change (see
+//  DbgScriptHostContext::SymbolGeneration). Each provider links its own copy of
+//  these caches, so each flushes on its own next lookup.
+//
+static void
+flushStaleSymbols(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	if (s_SymbolGeneration == hostCtxt->SymbolGeneration)
+	{
+		return;
+	}
+
+	s_ModCache.clear();
+	s_SymbolIndex.clear();
+	s_NameLru.clear();
+	s_NameLruMap.clear();
+	s_SymbolGeneration = hostCtxt->SymbolGeneration;
+}
 
 //------------------------------------------------------------------------------
 // Function: GetCachedSymbolType
@@ -59,15 +264,44 @@ GetCachedSymbolType(
 	{
 		// Found.
 		//
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
 		return &it->second;
 	}
 
 	// Not found. Lookup from source of truth.
 	//
-	HRESULT hr = hostCtxt->DebugSymbols->GetSymbolTypeId(
-		sym,
-		&tmp.TypeId,
-		&tmp.ModuleBase);
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
+	HRESULT hr = S_OK;
+	if (!TraceReplayCall(
+			hostCtxt,
+			TraceCallGetSymbolTypeId,
+			sym,
+			(ULONG)strlen(sym),
+			nullptr,
+			0,
+			&tmp,
+			sizeof(tmp),
+			nullptr,
+			&hr))
+	{
+		const LONGLONG start = StatsBegin(hostCtxt);
+		hr = hostCtxt->DebugSymbols->GetSymbolTypeId(
+			sym,
+			&tmp.TypeId,
+			&tmp.ModuleBase);
+		StatsEnd(hostCtxt, StatsTimerGetSymbolTypeId, start);
+
+		TraceRecordCall(
+			hostCtxt,
+			TraceCallGetSymbolTypeId,
+			sym,
+			(ULONG)strlen(sym),
+			nullptr,
+			0,
+			SUCCEEDED(hr) ? &tmp : nullptr,
+			sizeof(tmp),
+			hr);
+	}
 	if (FAILED(hr))
 	{
 		return nullptr;
@@ -102,16 +336,21 @@ GetCachedModuleName(
 	_In_ UINT64 modBase)
 {
 	char modName[MAX_MODULE_NAME_LEN] = {};
+
+	flushStaleSymbols(hostCtxt);
+
 	ModuleCacheMapT::iterator it = s_ModCache.find(modBase);
 	if (it != s_ModCache.end())
 	{
 		// Found.
 		//
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
 		return it->second.c_str();
 	}
 
 	// Not found. Populate cache.
 	//
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
 	HRESULT hr = hostCtxt->DebugSymbols->GetModuleNames(
 		DEBUG_ANY_ID,
 		modBase,
@@ -162,11 +401,13 @@ GetCachedTypeName(
 	{
 		// Found.
 		//
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
 		return it->second.c_str();
 	}
 
 	// Not found. Populate cache.
 	//
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
 	HRESULT hr = hostCtxt->DebugSymbols->GetTypeName(
 		modAndTypeId.ModuleBase,
 		modAndTypeId.TypeId,
@@ -183,4 +424,669 @@ GetCachedTypeName(
 	return str.c_str();
 }
 
+//------------------------------------------------------------------------------
+// Function: GetCachedFieldOffset
+//
+// Description:
+//
+//  Given a module and type id, returns the offset of a field within the type.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Failed lookups are not cached.
+//
+_Check_return_ HRESULT
+GetCachedFieldOffset(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const ModuleAndTypeId& modAndTypeId,
+	_In_z_ const char* field,
+	_Out_ ULONG* offset)
+{
+	std::pair<ModuleAndTypeId, std::string> key(modAndTypeId, field);
+	FieldOffsetCacheMapT::iterator it = s_FieldOffsetCache.find(key);
+	if (it != s_FieldOffsetCache.end())
+	{
+		// Found.
+		//
+		*offset = it->second;
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
+		return S_OK;
+	}
+
+	// Not found. Populate cache.
+	//
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
+	HRESULT hr = S_OK;
+	const UINT64 traceKey[] = { modAndTypeId.ModuleBase, modAndTypeId.TypeId };
+	if (!TraceReplayCall(
+			hostCtxt,
+			TraceCallGetFieldOffset,
+			traceKey,
+			sizeof(traceKey),
+			field,
+			(ULONG)strlen(field),
+			offset,
+			sizeof(*offset),
+			nullptr,
+			&hr))
+	{
+		const LONGLONG start = StatsBegin(hostCtxt);
+		hr = hostCtxt->DebugSymbols->GetFieldOffset(
+			modAndTypeId.ModuleBase,
+			modAndTypeId.TypeId,
+			field,
+			offset);
+		StatsEnd(hostCtxt, StatsTimerGetFieldOffset, start, modAndTypeId.TypeId);
+
+		TraceRecordCall(
+			hostCtxt,
+			TraceCallGetFieldOffset,
+			traceKey,
+			sizeof(traceKey),
+			field,
+			(ULONG)strlen(field),
+			SUCCEEDED(hr) ? offset : nullptr,
+			sizeof(*offset),
+			hr);
+	}
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	s_FieldOffsetCache[key] = *offset;
+
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: GetCachedRuntimeType
+//
+// Description:
+//
+//  Given the address of a vtable, returns the type it belongs to.
+//
+// Parameters:
+//
+// Returns:
+//
+//  S_OK if 'vtableAddr' is a vtable. S_FALSE if not. Failure HRESULT if the
+//  owning type could not be found.
+//
+// Notes:
+//
+//  Both outcomes are cached, so walking a large polymorphic container only
+//  looks up each distinct vtable (or non-vtable) once. The cache is held in the
+//  host context and shared by all providers.
+//
+_Check_return_ HRESULT
+GetCachedRuntimeType(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 vtableAddr,
+	_Out_ ModuleAndTypeId* typeInfo)
+{
+	HRESULT hr = S_OK;
+	char name[MAX_SYMBOL_NAME_LEN] = {};
+	char* found = nullptr;
+	ModuleAndTypeId* symTypeInfo = nullptr;
+
+	// Vtables are pointer-aligned, so drop the low bits to spread entries.
+	//
+	RuntimeTypeCacheEntry* entry = &hostCtxt->RuntimeTypeCache[
+		(vtableAddr >> 3) & (RUNTIME_TYPE_CACHE_SIZE - 1)];
+
+	if (!vtableAddr)
+	{
+		// Null vptr; never a vtable.
+		//
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	if (entry->VtableAddr == vtableAddr)
+	{
+		// Found.
+		//
+		typeInfo->ModuleBase = entry->ModuleBase;
+		typeInfo->TypeId = entry->TypeId;
+		hr = entry->ModuleBase ? S_OK : S_FALSE;
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
+		goto exit;
+	}
+
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
+
+	// Not found. If the address has a symbol like:
+	//
+	//   hkengine!HkLogImpl::`vftable'
+	//
+	// it's a vtable for the type named by the prefix.
+	//
+	hr = getNameByOffset(
+		hostCtxt, vtableAddr, STRING_AND_CCH(name), nullptr, nullptr);
+	if (SUCCEEDED(hr))
+	{
+		found = strstr(name, "::`vftable'");
+	}
+
+	if (!found)
+	{
+		// Remember that this isn't a vtable.
+		//
+		entry->VtableAddr = vtableAddr;
+		entry->ModuleBase = 0;
+		entry->TypeId = 0;
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	// Null out the colon.
+	//
+	*found = 0;
+	
+	// Lookup typeid/moduleBase from type name.
+	//
+	symTypeInfo = GetCachedSymbolType(hostCtxt, name);
+	if (!symTypeInfo)
+	{
+		hr = E_FAIL;
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			ERR_FAILED_GET_TYPE_ID,
+			name,
+			hr);
+		goto exit;
+	}
+
+	*typeInfo = *symTypeInfo;
+
+	entry->VtableAddr = vtableAddr;
+	entry->ModuleBase = symTypeInfo->ModuleBase;
+	entry->TypeId = symTypeInfo->TypeId;
+	hr = S_OK;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: buildSymbolIndex
+//
+// Description:
+//
+//  Enumerate all the symbols of a module into a sorted index.
+//
+// Parameters:
+//
+//  modBase - Base of the module.
+//  modEnd - One past the last address of the module.
+//  index - Index to populate.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  This forces the module's symbols to load, so it's only done on demand.
+//
+static _Check_return_ HRESULT
+buildSymbolIndex(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 modBase,
+	_In_ UINT64 modEnd,
+	_Out_ ModuleSymbolIndex* index)
+{
+	HRESULT hr = S_OK;
+	char pattern[MAX_MODULE_NAME_LEN + 2] = {};
+	char name[MAX_SYMBOL_NAME_LEN] = {};
+	ULONG cIds = 0;
+	std::vector<DEBUG_MODULE_AND_ID> ids;
+	std::vector<SymbolIndexEntry> sorted;
+
+	index->End = modEnd;
+	index->Symbols.clear();
+
+	const char* modName = GetCachedModuleName(hostCtxt, modBase);
+	if (!modName)
+	{
+		hr = E_FAIL;
+		goto exit;
+	}
+
+	hr = StringCchPrintfA(STRING_AND_CCH(pattern), "%s!*", modName);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	// Ask for the count, then the entries. Symbol entries (unlike symbol
+	// matches) carry their sizes.
+	//
+	hr = hostCtxt->DebugSymbols->GetSymbolEntriesByName(
+		pattern, 0 /* flags */, nullptr, 0, &cIds);
+	if (FAILED(hr))
+	{
+		goto exit;
+	}
+
+	ids.resize(cIds);
+	if (cIds)
+	{
+		hr = hostCtxt->DebugSymbols->GetSymbolEntriesByName(
+			pattern, 0 /* flags */, &ids[0], cIds, &cIds);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+		ids.resize(min(cIds, (ULONG)ids.size()));
+	}
+
+	sorted.reserve(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i)
+	{
+		DEBUG_SYMBOL_ENTRY info = {};
+		if (FAILED(hostCtxt->DebugSymbols->GetSymbolEntryInformation(&ids[i], &info)) ||
+			info.Offset < modBase ||
+			info.Offset >= modEnd)
+		{
+			continue;
+		}
+
+		// S_FALSE means the name was truncated, which is still good enough to
+		// display.
+		//
+		if (FAILED(hostCtxt->DebugSymbols->GetSymbolEntryString(
+				&ids[i], 0 /* which */, STRING_AND_CCH(name), nullptr)))
+		{
+			continue;
+		}
+
+		SymbolIndexEntry entry;
+		entry.Offset = info.Offset;
+		entry.Size = info.Size;
+		entry.Name = std::string(modName) + "!" + name;
+		sorted.push_back(entry);
+	}
+
+	// Sort by address. Where several symbols share an address, keep the first
+	// one enumerated, but the largest known size.
+	//
+	std::stable_sort(
+		sorted.begin(),
+		sorted.end(),
+		[](const SymbolIndexEntry& a, const SymbolIndexEntry& b)
+		{
+			return a.Offset < b.Offset;
+		});
+
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		if (!index->Symbols.empty() &&
+			index->Symbols.back().Offset == sorted[i].Offset)
+		{
+			index->Symbols.back().Size =
+				max(index->Symbols.back().Size, sorted[i].Size);
+			continue;
+		}
+		index->Symbols.push_back(sorted[i]);
+	}
+
+	hr = S_OK;
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: getModuleSymbolIndex
+//
+// Description:
+//
+//  Find (or build) the symbol index of the module containing an address.
+//
+// Parameters:
+//
+//  addr - Address to look up.
+//
+// Returns:
+//
+//  Index, or nullptr if the address isn't in a module or its symbols couldn't
+//  be enumerated.
+//
+// Notes:
+//
+//  A failed build isn't cached, so a later lookup, e.g. after the module's
+//  symbols have been fixed up, tries again.
+//
+static _Check_return_ const ModuleSymbolIndex*
+getModuleSymbolIndex(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr)
+{
+	UINT64 modBase = 0;
+	DEBUG_MODULE_PARAMETERS params = {};
+
+	// Find the last module starting at or before 'addr'.
+	//
+	SymbolIndexMapT::iterator it = s_SymbolIndex.upper_bound(addr);
+	if (it != s_SymbolIndex.begin())
+	{
+		--it;
+		if (addr < it->second.End)
+		{
+			// Found.
+			//
+			return &it->second;
+		}
+	}
+
+	// Not found. Lookup from source of truth.
+	//
+	HRESULT hr = hostCtxt->DebugSymbols->GetModuleByOffset(
+		addr, 0 /* startIndex */, nullptr, &modBase);
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	hr = hostCtxt->DebugSymbols->GetModuleParameters(
+		1, &modBase, 0 /* start */, &params);
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	ModuleSymbolIndex index;
+	hr = buildSymbolIndex(hostCtxt, modBase, modBase + params.Size, &index);
+	if (FAILED(hr))
+	{
+		// Lookups fall back to the engine.
+		//
+		return nullptr;
+	}
+
+	ModuleSymbolIndex& cached = s_SymbolIndex[modBase];
+	cached.End = index.End;
+	cached.Symbols.swap(index.Symbols);
+	return &cached;
+}
+
+//------------------------------------------------------------------------------
+// Function: lookupSymbolIndex
+//
+// Description:
+//
+//  Find the nearest symbol at or before an address using the symbol index.
+//
+// Parameters:
+//
+//  addr - Address to look up.
+//  disp - Receives the displacement of 'addr' from the symbol.
+//
+// Returns:
+//
+//  Symbol name, or nullptr if the index can't answer.
+//
+// Notes:
+//
+//  An address past the end of the symbol before it (by the symbol's size) is
+//  left to the engine, which knows about gaps the index doesn't.
+//
+static _Check_return_ const char*
+lookupSymbolIndex(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_Out_ UINT64* disp)
+{
+	const ModuleSymbolIndex* index = getModuleSymbolIndex(hostCtxt, addr);
+	if (!index || index->Symbols.empty())
+	{
+		return nullptr;
+	}
+
+	// Binary search for the first symbol after 'addr'; the one before it is
+	// the nearest.
+	//
+	std::vector<SymbolIndexEntry>::const_iterator it = std::upper_bound(
+		index->Symbols.begin(),
+		index->Symbols.end(),
+		addr,
+		[](UINT64 a, const SymbolIndexEntry& e)
+		{
+			return a < e.Offset;
+		});
+	if (it == index->Symbols.begin())
+	{
+		// Before the first symbol of the module.
+		//
+		return nullptr;
+	}
+
+	--it;
+	if (it->Size && addr - it->Offset >= it->Size)
+	{
+		return nullptr;
+	}
+
+	*disp = addr - it->Offset;
+	return it->Name.c_str();
+}
 
+//------------------------------------------------------------------------------
+// Function: GetCachedNearestSymbol
+//
+// Description:
+//
+//  Given an address, returns the nearest symbol as 'module!name+disp'.
+//
+// Parameters:
+//
+//  addr - Virtual address to probe.
+//  buf - On successful return, name of nearest symbol. Expected to be
+//   a buffer of MAX_SYMBOL_NAME_LEN characters longs.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Answered from a per-module index of symbol addresses, built the first time
+//  an address in the module is looked up, with an LRU of recently formatted
+//  names in front. Addresses the index can't answer fall back to
+//  GetNameByOffset. Both are dropped when the target's modules change.
+//
+//  Doesn't output anything on failure.
+//
+_Check_return_ HRESULT
+GetCachedNearestSymbol(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf)
+{
+	HRESULT hr = S_OK;
+	UINT64 disp = 0;
+	ULONG cchActual = 0;
+
+	flushStaleSymbols(hostCtxt);
+
+	NameLruMapT::iterator it = s_NameLruMap.find(addr);
+	if (it != s_NameLruMap.end())
+	{
+		// Found. Move to front.
+		//
+		s_NameLru.splice(s_NameLru.begin(), s_NameLru, it->second);
+		StatsCount(hostCtxt, StatsCounterCacheHits, 1);
+		return StringCchCopyA(buf, MAX_SYMBOL_NAME_LEN, it->second->second.c_str());
+	}
+
+	StatsCount(hostCtxt, StatsCounterCacheMisses, 1);
+
+	// While tracing, skip the index so the lookup goes through a traced call.
+	//
+	const char* name =
+		hostCtxt->Trace ? nullptr : lookupSymbolIndex(hostCtxt, addr, &disp);
+	if (name)
+	{
+		hr = StringCchCopyA(buf, MAX_SYMBOL_NAME_LEN, name);
+		if (hr == STRSAFE_E_INSUFFICIENT_BUFFER)
+		{
+			// Truncated, like GetNameByOffset would.
+			//
+			hr = S_FALSE;
+		}
+		cchActual = (ULONG)strlen(buf) + 1;
+	}
+	else
+	{
+		hr = getNameByOffset(
+			hostCtxt, addr, buf, MAX_SYMBOL_NAME_LEN, &cchActual, &disp);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+	}
+
+	// If we have a displacement, append it to the name. Don't do it for S_FALSE
+	// since that means the symbol was already truncated. No point in appending
+	// anything more.
+	//
+	if (disp && hr != S_FALSE && MAX_SYMBOL_NAME_LEN - cchActual > 0)
+	{
+		// 'cchActual' includes the NUL, so we want to start writing
+		// just before 'cchActual'.
+		//
+		hr = StringCchPrintfA(
+			buf + (cchActual - 1),
+			MAX_SYMBOL_NAME_LEN - (cchActual - 1),
+			"+%#I64x",
+			disp);
+
+		assert(hr != STRSAFE_E_INVALID_PARAMETER);
+		if (FAILED(hr))
+		{
+			goto exit;
+		}
+	}
+
+	// Remember the formatted name, evicting the least recently used.
+	//
+	if (s_NameLru.size() >= NAME_LRU_CAPACITY)
+	{
+		s_NameLruMap.erase(s_NameLru.back().first);
+		s_NameLru.pop_back();
+	}
+
+	s_NameLru.push_front(std::make_pair(addr, std::string(buf)));
+	s_NameLruMap[addr] = s_NameLru.begin();
+
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: GetCachedModulePdb
+//
+// Description:
+//
+//  Given a module-qualified name ('module!name'), returns the parsed PDB of the
+//  module so the name can be looked up directly.
+//
+// Parameters:
+//
+//  qualifiedName - Module-qualified type name.
+//  name - On success, points at the unqualified part of 'qualifiedName'.
+//
+// Returns:
+//
+//  The PDB, or nullptr if the name isn't qualified or the module's symbols
+//  aren't a local PDB that we can read.
+//
+// Notes:
+//
+//  Do not free the returned pointer!
+//
+//  Uses whatever symbol file DbgEng matched to the module. If the module's
+//  symbols haven't been loaded yet, nothing is cached so that a later call,
+//  after DbgEng has loaded them, can pick the PDB up.
+//
+//  Returns nullptr while a trace (see trace.h) is active.
+//
+_Check_return_ const PdbFile*
+GetCachedModulePdb(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* qualifiedName,
+	_Outptr_result_z_ const char** name)
+{
+	char symFile[MAX_PATH] = {};
+	UINT64 modBase = 0;
+	PdbFile* pdb = nullptr;
+
+	*name = qualifiedName;
+
+	if (hostCtxt->Trace)
+	{
+		// Keep type lookups on traced calls while recording or replaying.
+		//
+		return nullptr;
+	}
+
+	const char* bang = strchr(qualifiedName, '!');
+	if (!bang)
+	{
+		return nullptr;
+	}
+
+	const std::string modName(qualifiedName, bang - qualifiedName);
+	*name = bang + 1;
+
+	PdbCacheMapT::iterator it = s_PdbCache.find(modName);
+	if (it != s_PdbCache.end())
+	{
+		// Found.
+		//
+		return it->second;
+	}
+
+	// Not found. Ask DbgEng where the module's symbols came from.
+	//
+	HRESULT hr = hostCtxt->DebugSymbols->GetModuleByModuleName(
+		modName.c_str(), 0 /* startIndex */, nullptr, &modBase);
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	hr = hostCtxt->DebugSymbols->GetModuleNameString(
+		DEBUG_MODNAME_SYMBOL_FILE,
+		DEBUG_ANY_ID,
+		modBase,
+		STRING_AND_CCH(symFile),
+		nullptr);
+	if (FAILED(hr) || !symFile[0])
+	{
+		// Symbols not loaded (yet).
+		//
+		return nullptr;
+	}
+
+	const size_t cchSymFile = strlen(symFile);
+	if (cchSymFile > 4 && !_stricmp(symFile + cchSymFile - 4, ".pdb"))
+	{
+		hr = PdbOpen(symFile, &pdb);
+		if (FAILED(hr))
+		{
+			pdb = nullptr;
+		}
+	}
+
+	s_PdbCache[modName] = pdb;
+	return pdb;
+}
@@ -17,6 +17,8 @@
 #include <windows.h>
 #include <hostcontext.h>
 
+struct PdbFile;
+
 struct ModuleAndTypeId
 {
 	ULONG TypeId;
@@ -48,3 +50,28 @@ _Check_return_ const char*
 GetCachedTypeName(
 	_In_ DbgScriptHostContext* hostCtxt,
 	_In_ const ModuleAndTypeId& modAndTypeId);
+
+_Check_return_ HRESULT
+GetCachedFieldOffset(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const ModuleAndTypeId& modAndTypeId,
+	_In_z_ const char* field,
+	_Out_ ULONG* offset);
+
+_Check_return_ HRESULT
+GetCachedRuntimeType(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 vtableAddr,
+	_Out_ ModuleAndTypeId* typeInfo);
+
+_Check_return_ HRESULT
+GetCachedNearestSymbol(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf);
+
+_Check_return_ const PdbFile*
+GetCachedModulePdb(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* qualifiedName,
+	_Outptr_result_z_ const char** name);
@@ -0,0 +1,567 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: timeline.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Timeline of script execution, written in Chrome trace event format.
+//
+// Notes:
+//
+//  Started for a run with !runscript -timeline <file>. Engine calls and host
+//  phases are recorded as complete events by the stats hooks (see stats.h),
+//  script API calls and thread/frame switches as instant events, and spans
+//  opened by scripts (trace_span) as begin/end pairs. The file is written when
+//  the run ends and can be opened in Perfetto or chrome://tracing.
+//
+//  Events go into a buffer of fixed-size chunks. A slot is claimed with an
+//  interlocked increment and chunks are published with an interlocked compare
+//  exchange, so recording never takes a lock. Names are copied into the event
+//  since they may live in a provider DLL that is unloaded before the timeline
+//  is written.
+//
+//  Chunks are allocated from the process heap: they are allocated by whichever
+//  provider records into them but freed by the host, and the Ruby provider
+//  uses a different CRT than the host.
+//
+// @EndHeader@
+//******************************************************************************
+#include "timeline.h"
+#include <stdio.h>
+#include <strsafe.h>
+
+// Each chunk holds 2^TIMELINE_CHUNK_SHIFT events. Events past the last chunk
+// are dropped.
+//
+const ULONG TIMELINE_CHUNK_SHIFT = 16;
+const ULONG TIMELINE_CHUNK_EVENTS = 1 << TIMELINE_CHUNK_SHIFT;
+const ULONG TIMELINE_MAX_CHUNKS = 256;
+
+// TimelineEvent - One recorded event.
+//
+struct TimelineEvent
+{
+	// Start and duration, in performance counter ticks.
+	//
+	LONGLONG Start;
+
+	LONGLONG Duration;
+
+	UINT64 Arg;
+
+	ULONG ThreadId;
+
+	// Chrome trace event phase: 'X' (complete), 'i' (instant), 'B' (begin) or
+	// 'E' (end).
+	//
+	char Phase;
+
+	BYTE Category;
+
+	// Name of the argument. Empty if none.
+	//
+	char ArgName[14];
+
+	char Name[64];
+};
+
+struct DbgScriptTimeline
+{
+	FILE* File;
+
+	// Next slot to claim. May run past the capacity; see Dropped.
+	//
+	volatile LONGLONG NextEvent;
+
+	TimelineEvent* volatile Chunks[TIMELINE_MAX_CHUNKS];
+
+	LARGE_INTEGER StartTime;
+
+	LARGE_INTEGER Frequency;
+};
+
+static const char* const s_CategoryNames[TimelineCategoryMax] =
+{
+	"engine",
+	"host",
+	"api",
+	"script",
+};
+
+//------------------------------------------------------------------------------
+// Function: TimelineStart
+//
+// Description:
+//
+//  Start recording a timeline, to be written to 'path' by TimelineStop.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if a timeline is already being recorded.
+//
+// Notes:
+//
+//  The file is created now so a bad path fails before the script runs.
+//
+_Check_return_ HRESULT
+TimelineStart(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path)
+{
+	HRESULT hr = S_OK;
+	FILE* fp = nullptr;
+	DbgScriptTimeline* timeline = nullptr;
+
+	if (hostCtxt->Timeline)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	if (fopen_s(&fp, path, "w"))
+	{
+		hr = HRESULT_FROM_WIN32(_doserrno);
+		goto exit;
+	}
+
+	timeline = (DbgScriptTimeline*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DbgScriptTimeline));
+	if (!timeline)
+	{
+		fclose(fp);
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	timeline->File = fp;
+	QueryPerformanceFrequency(&timeline->Frequency);
+	QueryPerformanceCounter(&timeline->StartTime);
+
+	hostCtxt->Timeline = timeline;
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: allocEvent
+//
+// Description:
+//
+//  Claim the next event slot.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Event, or nullptr if the buffer is full or out of memory.
+//
+// Notes:
+//
+static _Check_return_ TimelineEvent*
+allocEvent(
+	_In_ DbgScriptTimeline* timeline)
+{
+	const LONGLONG slot = InterlockedIncrement64(&timeline->NextEvent) - 1;
+	const ULONG chunk = (ULONG)(slot >> TIMELINE_CHUNK_SHIFT);
+	if (chunk >= TIMELINE_MAX_CHUNKS)
+	{
+		return nullptr;
+	}
+
+	TimelineEvent* events = timeline->Chunks[chunk];
+	if (!events)
+	{
+		// Publish a new chunk. If another thread beat us to it, use theirs.
+		//
+		TimelineEvent* newEvents = (TimelineEvent*)HeapAlloc(
+			GetProcessHeap(), 0, TIMELINE_CHUNK_EVENTS * sizeof(TimelineEvent));
+		if (!newEvents)
+		{
+			return nullptr;
+		}
+
+		events = (TimelineEvent*)InterlockedCompareExchangePointer(
+			(PVOID volatile*)&timeline->Chunks[chunk], newEvents, nullptr);
+		if (events)
+		{
+			HeapFree(GetProcessHeap(), 0, newEvents);
+		}
+		else
+		{
+			events = newEvents;
+		}
+	}
+
+	return &events[slot & (TIMELINE_CHUNK_EVENTS - 1)];
+}
+
+//------------------------------------------------------------------------------
+// Function: recordEvent
+//
+// Description:
+//
+//  Record an event.
+//
+// Parameters:
+//
+//  phase - Chrome trace event phase.
+//  name - Name of the event. Truncated to fit.
+//  argName - Name of 'arg', or nullptr if the event has no argument.
+//
+// Returns:
+//
+// Notes:
+//
+static void
+recordEvent(
+	_In_ DbgScriptTimeline* timeline,
+	_In_ char phase,
+	_In_ TimelineCategory category,
+	_In_z_ const char* name,
+	_In_ LONGLONG start,
+	_In_ LONGLONG duration,
+	_In_opt_z_ const char* argName,
+	_In_ UINT64 arg)
+{
+	TimelineEvent* ev = allocEvent(timeline);
+	if (!ev)
+	{
+		return;
+	}
+
+	ev->Start = start;
+	ev->Duration = duration;
+	ev->Arg = arg;
+	ev->ThreadId = GetCurrentThreadId();
+	ev->Phase = phase;
+	ev->Category = (BYTE)category;
+
+	// Truncation is fine.
+	//
+	(void)StringCchCopyA(ev->Name, _countof(ev->Name), name);
+	(void)StringCchCopyA(ev->ArgName, _countof(ev->ArgName), argName ? argName : "");
+}
+
+//------------------------------------------------------------------------------
+// Function: now
+//
+// Description:
+//
+//  Get the performance counter.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static LONGLONG
+now()
+{
+	LARGE_INTEGER ticks = {};
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+// Function: TimelineComplete
+//
+// Description:
+//
+//  Record an operation that ran from 'start' to 'end'.
+//
+// Parameters:
+//
+//  start, end - Performance counter values.
+//  argName - Name of 'arg', or nullptr if the operation has no argument.
+//
+// Returns:
+//
+// Notes:
+//
+void
+TimelineComplete(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name,
+	_In_ TimelineCategory category,
+	_In_ LONGLONG start,
+	_In_ LONGLONG end,
+	_In_opt_z_ const char* argName,
+	_In_ UINT64 arg)
+{
+	if (hostCtxt->Timeline)
+	{
+		recordEvent(
+			hostCtxt->Timeline, 'X', category, name, start, end - start, argName, arg);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: TimelineInstant
+//
+// Description:
+//
+//  Record a point in time, such as a script API call.
+//
+// Parameters:
+//
+//  argName - Name of 'arg', or nullptr if the event has no argument.
+//
+// Returns:
+//
+// Notes:
+//
+void
+TimelineInstant(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name,
+	_In_ TimelineCategory category,
+	_In_opt_z_ const char* argName,
+	_In_ UINT64 arg)
+{
+	if (hostCtxt->Timeline)
+	{
+		recordEvent(
+			hostCtxt->Timeline, 'i', category, name, now(), 0, argName, arg);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: TimelineBeginSpan
+//
+// Description:
+//
+//  Open a span named by a script. Spans nest.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+TimelineBeginSpan(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name)
+{
+	if (hostCtxt->Timeline)
+	{
+		recordEvent(
+			hostCtxt->Timeline, 'B', TimelineCategoryScript, name, now(), 0, nullptr, 0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: TimelineEndSpan
+//
+// Description:
+//
+//  Close the innermost span opened by TimelineBeginSpan.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+TimelineEndSpan(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	if (hostCtxt->Timeline)
+	{
+		recordEvent(
+			hostCtxt->Timeline, 'E', TimelineCategoryScript, "", now(), 0, nullptr, 0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: writeJsonString
+//
+// Description:
+//
+//  Write a quoted, escaped JSON string.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+writeJsonString(
+	_In_ FILE* fp,
+	_In_z_ const char* str)
+{
+	fputc('"', fp);
+	for (const char* p = str; *p; ++p)
+	{
+		const UCHAR c = (UCHAR)*p;
+		if (c == '"' || c == '\\')
+		{
+			fputc('\\', fp);
+			fputc(c, fp);
+		}
+		else if (c < 0x20)
+		{
+			fprintf(fp, "\\u%04x", c);
+		}
+		else
+		{
+			fputc(c, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+//------------------------------------------------------------------------------
+// Function: writeMicroseconds
+//
+// Description:
+//
+//  Write a tick count as microseconds with nanosecond precision.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Split into seconds and remainder so long runs don't overflow.
+//
+static void
+writeMicroseconds(
+	_In_ FILE* fp,
+	_In_ const DbgScriptTimeline* timeline,
+	_In_ LONGLONG ticks)
+{
+	const UINT64 freq = (UINT64)timeline->Frequency.QuadPart;
+	const UINT64 t = ticks > 0 ? (UINT64)ticks : 0;
+	const UINT64 ns = (t / freq) * 1000000000 + (t % freq) * 1000000000 / freq;
+
+	fprintf(fp, "%I64u.%03I64u", ns / 1000, ns % 1000);
+}
+
+//------------------------------------------------------------------------------
+// Function: TimelineStop
+//
+// Description:
+//
+//  Stop recording the timeline and write it out.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+TimelineStop(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	HRESULT hr = S_OK;
+	DbgScriptTimeline* timeline = hostCtxt->Timeline;
+	const DWORD pid = GetCurrentProcessId();
+	const UINT64 capacity = (UINT64)TIMELINE_MAX_CHUNKS * TIMELINE_CHUNK_EVENTS;
+	FILE* fp = nullptr;
+	UINT64 total = 0;
+	UINT64 count = 0;
+
+	if (!timeline)
+	{
+		goto exit;
+	}
+
+	// Stop recording before reading the buffer.
+	//
+	hostCtxt->Timeline = nullptr;
+
+	fp = timeline->File;
+	total = (UINT64)timeline->NextEvent;
+	count = min(total, capacity);
+
+	fprintf(
+		fp,
+		"{\"traceEvents\":[\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,"
+		"\"args\":{\"name\":\"dbgscript\"}}",
+		pid);
+
+	for (UINT64 i = 0; i < count; ++i)
+	{
+		const TimelineEvent* events = timeline->Chunks[i >> TIMELINE_CHUNK_SHIFT];
+		if (!events)
+		{
+			// Couldn't be allocated; its events were dropped.
+			//
+			i |= TIMELINE_CHUNK_EVENTS - 1;
+			continue;
+		}
+
+		const TimelineEvent& ev = events[i & (TIMELINE_CHUNK_EVENTS - 1)];
+
+		fputs(",\n{\"name\":", fp);
+		writeJsonString(fp, ev.Name);
+		fprintf(
+			fp,
+			",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":%lu,\"tid\":%lu,\"ts\":",
+			s_CategoryNames[ev.Category],
+			ev.Phase,
+			pid,
+			ev.ThreadId);
+		writeMicroseconds(fp, timeline, ev.Start - timeline->StartTime.QuadPart);
+
+		if (ev.Phase == 'X')
+		{
+			fputs(",\"dur\":", fp);
+			writeMicroseconds(fp, timeline, ev.Duration);
+		}
+		else if (ev.Phase == 'i')
+		{
+			// Thread-scoped instant.
+			//
+			fputs(",\"s\":\"t\"", fp);
+		}
+
+		if (ev.ArgName[0])
+		{
+			fprintf(fp, ",\"args\":{\"%s\":\"%#I64x\"}", ev.ArgName, ev.Arg);
+		}
+
+		fputc('}', fp);
+	}
+
+	fprintf(
+		fp,
+		"\n],\n\"displayTimeUnit\":\"ms\",\n"
+		"\"otherData\":{\"events\":\"%I64u\",\"dropped\":\"%I64u\"}}\n",
+		count,
+		total - count);
+
+	if (ferror(fp))
+	{
+		hr = E_FAIL;
+	}
+
+	if (fclose(fp))
+	{
+		hr = E_FAIL;
+	}
+
+	for (ULONG i = 0; i < TIMELINE_MAX_CHUNKS; ++i)
+	{
+		if (timeline->Chunks[i])
+		{
+			HeapFree(GetProcessHeap(), 0, timeline->Chunks[i]);
+		}
+	}
+	HeapFree(GetProcessHeap(), 0, timeline);
+exit:
+	return hr;
+}
@@ -0,0 +1,66 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: timeline.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Timeline of script execution, written in Chrome trace event format.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// TimelineCategory - Category of a timeline event.
+//
+enum TimelineCategory
+{
+	TimelineCategoryEngine,
+	TimelineCategoryHost,
+	TimelineCategoryApi,
+	TimelineCategoryScript,
+
+	TimelineCategoryMax
+};
+
+_Check_return_ HRESULT
+TimelineStart(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path);
+
+_Check_return_ HRESULT
+TimelineStop(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+TimelineComplete(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name,
+	_In_ TimelineCategory category,
+	_In_ LONGLONG start,
+	_In_ LONGLONG end,
+	_In_opt_z_ const char* argName,
+	_In_ UINT64 arg);
+
+void
+TimelineInstant(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name,
+	_In_ TimelineCategory category,
+	_In_opt_z_ const char* argName,
+	_In_ UINT64 arg);
+
+void
+TimelineBeginSpan(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* name);
+
+void
+TimelineEndSpan(
+	_In_ DbgScriptHostContext* hostCtxt);
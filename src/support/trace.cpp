@@ -0,0 +1,1031 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: trace.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Record/replay of debugger engine calls made by the support library.
+//
+// Notes:
+//
+//  While recording, each distinct request made through a traced call site is
+//  appended to a binary trace together with its response and HRESULT. While
+//  replaying, the trace is memory-mapped and indexed by a hash of the request,
+//  and traced call sites are served from it instead of DbgEng. Requests that
+//  aren't in the trace fail rather than reaching DbgEng, so a replayed run is
+//  deterministic.
+//
+//  A replay can add a fixed latency to every call it serves, to stand in for
+//  the round trip to a remote debugger engine. Both modes count calls by kind
+//  so the cost of a script in engine requests can be measured.
+//
+//  File format: TraceFileHeader, then a sequence of TraceEntryHeader, each
+//  followed by its key and response bytes.
+//
+//  The trace lives in the host context and is used by every provider, and the
+//  Ruby provider is built against a different CRT than the others. So the
+//  trace's tables are plain open-addressed arrays on the process heap rather
+//  than STL containers, which must not cross CRTs.
+//
+// @EndHeader@
+//******************************************************************************
+#include "trace.h"
+#include <psapi.h>
+
+const ULONG TRACE_MAGIC = 0x52545344; // 'DSTR'
+const ULONG TRACE_VERSION = 2;
+
+// Recorded entries are buffered and written out in chunks of at most this
+// size.
+//
+const size_t TRACE_BUFFER_SIZE = 64 * 1024;
+
+// Initial number of slots in the set of recorded requests. A power of two.
+//
+const ULONG TRACE_RECORDED_INITIAL_SIZE = 4096;
+
+struct TraceFileHeader
+{
+	ULONG Magic;
+	ULONG Version;
+};
+
+struct TraceEntryHeader
+{
+	ULONG Kind;
+	HRESULT Hr;
+	ULONG CbKey;
+	ULONG CbResponse;
+};
+
+// TraceIndexSlot - Slot in the replay index. Free if 'Entry' is null.
+//
+struct TraceIndexSlot
+{
+	// Hash of the entry's request.
+	//
+	UINT64 Hash;
+
+	// Entry in the mapped trace.
+	//
+	const TraceEntryHeader* Entry;
+};
+
+// Names of the call kinds, for TraceOutputStats.
+//
+static const char* const s_TraceCallNames[TraceCallMax] =
+{
+	nullptr,
+	"ReadVirtual",
+	"ReadPointer",
+	"SearchVirtual",
+	"TypedData",
+	"GetSymbolTypeId",
+	"GetFieldOffset",
+	"GetTypeSize",
+	"GetNameByOffset",
+	"ReadTypedData",
+};
+
+struct DbgScriptTrace
+{
+	// Are we replaying (as opposed to recording)?
+	//
+	bool Replay;
+
+	HANDLE File;
+
+	// Recording: entries not yet written (TRACE_BUFFER_SIZE bytes).
+	//
+	BYTE* Buffer;
+
+	size_t BufferUsed;
+
+	// Recording: hashes of requests already recorded, open-addressed. Zero
+	// marks a free slot. 'RecordedSize' is a power of two.
+	//
+	UINT64* Recorded;
+
+	ULONG RecordedSize;
+
+	ULONG RecordedCount;
+
+	// Did a write fail? Reported when recording stops.
+	//
+	HRESULT WriteHr;
+
+	// Replay: the mapped trace and its index.
+	//
+	HANDLE Mapping;
+
+	const BYTE* View;
+
+	TraceIndexSlot* Index;
+
+	// Number of slots in 'Index'. A power of two.
+	//
+	ULONG IndexSize;
+
+	// Replay: latency added to every call served, in microseconds, expressed
+	// in performance counter ticks.
+	//
+	LONGLONG LatencyTicks;
+
+	// Number of calls made through traced call sites, by kind, and when the
+	// trace started.
+	//
+	UINT64 Calls[TraceCallMax];
+
+	LARGE_INTEGER StartTime;
+
+	// Process private bytes when the trace started.
+	//
+	SIZE_T StartPrivateBytes;
+};
+
+//------------------------------------------------------------------------------
+// Function: hashRequest
+//
+// Description:
+//
+//  FNV-1a hash of a request.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Hash.
+//
+// Notes:
+//
+static UINT64
+hashRequest(
+	_In_ ULONG kind,
+	_In_reads_bytes_(cbKey) const void* key,
+	_In_ ULONG cbKey,
+	_In_reads_bytes_opt_(cbKeyTail) const void* keyTail,
+	_In_ ULONG cbKeyTail)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	const ULONG cbTotal = cbKey + cbKeyTail;
+	const BYTE* parts[] = {(const BYTE*)&kind, (const BYTE*)&cbTotal, (const BYTE*)key, (const BYTE*)keyTail};
+	const ULONG cbParts[] = {sizeof(kind), sizeof(cbTotal), cbKey, cbKeyTail};
+
+	for (ULONG i = 0; i < _countof(parts); ++i)
+	{
+		for (ULONG j = 0; j < cbParts[i]; ++j)
+		{
+			hash ^= parts[i][j];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Function: writeTrace
+//
+// Description:
+//
+//  Write bytes to the trace file.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Failures are remembered in the trace and stop further writes.
+//
+static void
+writeTrace(
+	_In_ DbgScriptTrace* trace,
+	_In_reads_bytes_(cb) const BYTE* data,
+	_In_ size_t cb)
+{
+	size_t pos = 0;
+
+	while (pos < cb && SUCCEEDED(trace->WriteHr))
+	{
+		DWORD cbWritten = 0;
+		const DWORD cbChunk = (DWORD)min(cb - pos, (size_t)MAXDWORD);
+
+		if (!WriteFile(trace->File, data + pos, cbChunk, &cbWritten, nullptr))
+		{
+			trace->WriteHr = HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		pos += cbWritten;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: flushTrace
+//
+// Description:
+//
+//  Write out buffered entries.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+flushTrace(
+	_In_ DbgScriptTrace* trace)
+{
+	writeTrace(trace, trace->Buffer, trace->BufferUsed);
+	trace->BufferUsed = 0;
+}
+
+//------------------------------------------------------------------------------
+// Function: appendTrace
+//
+// Description:
+//
+//  Append bytes to the recording, flushing the buffer as it fills.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+appendTrace(
+	_In_ DbgScriptTrace* trace,
+	_In_reads_bytes_(cb) const void* data,
+	_In_ size_t cb)
+{
+	if (cb > TRACE_BUFFER_SIZE - trace->BufferUsed)
+	{
+		flushTrace(trace);
+	}
+
+	if (cb > TRACE_BUFFER_SIZE)
+	{
+		// Too big to buffer at all.
+		//
+		writeTrace(trace, (const BYTE*)data, cb);
+		return;
+	}
+
+	memcpy(trace->Buffer + trace->BufferUsed, data, cb);
+	trace->BufferUsed += cb;
+}
+
+//------------------------------------------------------------------------------
+// Function: insertRecorded
+//
+// Description:
+//
+//  Add a request hash to the set of recorded requests.
+//
+// Parameters:
+//
+//  hash - Hash of the request.
+//
+// Returns:
+//
+//  S_OK if added, S_FALSE if it was already there.
+//
+// Notes:
+//
+//  The set is doubled when half full.
+//
+static _Check_return_ HRESULT
+insertRecorded(
+	_In_ DbgScriptTrace* trace,
+	_In_ UINT64 hash)
+{
+	ULONG mask = trace->RecordedSize - 1;
+	ULONG i = 0;
+
+	// Zero marks a free slot.
+	//
+	if (!hash)
+	{
+		hash = 1;
+	}
+
+	if ((trace->RecordedCount + 1) * 2 > trace->RecordedSize)
+	{
+		const ULONG newSize = trace->RecordedSize * 2;
+		const ULONG newMask = newSize - 1;
+		UINT64* table = (UINT64*)HeapAlloc(
+			GetProcessHeap(), HEAP_ZERO_MEMORY, newSize * sizeof(UINT64));
+		if (!table)
+		{
+			return E_OUTOFMEMORY;
+		}
+
+		for (ULONG j = 0; j < trace->RecordedSize; ++j)
+		{
+			const UINT64 old = trace->Recorded[j];
+			if (old)
+			{
+				for (i = (ULONG)old & newMask; table[i]; i = (i + 1) & newMask)
+				{
+				}
+				table[i] = old;
+			}
+		}
+
+		HeapFree(GetProcessHeap(), 0, trace->Recorded);
+		trace->Recorded = table;
+		trace->RecordedSize = newSize;
+		mask = newMask;
+	}
+
+	for (i = (ULONG)hash & mask; trace->Recorded[i]; i = (i + 1) & mask)
+	{
+		if (trace->Recorded[i] == hash)
+		{
+			return S_FALSE;
+		}
+	}
+
+	trace->Recorded[i] = hash;
+	++trace->RecordedCount;
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Function: destroyTrace
+//
+// Description:
+//
+//  Release everything held by a trace, and the trace itself.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static void
+destroyTrace(
+	_In_ DbgScriptTrace* trace)
+{
+	if (trace->View)
+	{
+		UnmapViewOfFile(trace->View);
+	}
+
+	if (trace->Mapping)
+	{
+		CloseHandle(trace->Mapping);
+	}
+
+	if (trace->File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(trace->File);
+	}
+
+	if (trace->Buffer)
+	{
+		HeapFree(GetProcessHeap(), 0, trace->Buffer);
+	}
+
+	if (trace->Recorded)
+	{
+		HeapFree(GetProcessHeap(), 0, trace->Recorded);
+	}
+
+	if (trace->Index)
+	{
+		HeapFree(GetProcessHeap(), 0, trace->Index);
+	}
+
+	HeapFree(GetProcessHeap(), 0, trace);
+}
+
+//------------------------------------------------------------------------------
+// Function: getPrivateBytes
+//
+// Description:
+//
+//  Get the process' private bytes and, optionally, peak working set.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Private bytes. Zero if they can't be queried.
+//
+// Notes:
+//
+static SIZE_T
+getPrivateBytes(
+	_Out_opt_ SIZE_T* peakWorkingSet)
+{
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+
+	if (!GetProcessMemoryInfo(
+			GetCurrentProcess(),
+			(PROCESS_MEMORY_COUNTERS*)&counters,
+			sizeof(counters)))
+	{
+		ZeroMemory(&counters, sizeof(counters));
+	}
+
+	if (peakWorkingSet)
+	{
+		*peakWorkingSet = counters.PeakWorkingSetSize;
+	}
+	return counters.PrivateUsage;
+}
+
+//------------------------------------------------------------------------------
+// Function: newTrace
+//
+// Description:
+//
+//  Allocate an empty trace.
+//
+// Parameters:
+//
+// Returns:
+//
+//  Trace, or null if out of memory.
+//
+// Notes:
+//
+//  Allocated from the process heap, like everything the trace holds, since it
+//  may be freed by a different module than the one that allocated it.
+//
+static _Check_return_ DbgScriptTrace*
+newTrace(
+	_In_ bool replay)
+{
+	DbgScriptTrace* trace = (DbgScriptTrace*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(DbgScriptTrace));
+	if (!trace)
+	{
+		return nullptr;
+	}
+
+	trace->Replay = replay;
+	trace->File = INVALID_HANDLE_VALUE;
+	trace->WriteHr = S_OK;
+	QueryPerformanceCounter(&trace->StartTime);
+	trace->StartPrivateBytes = getPrivateBytes(nullptr);
+	return trace;
+}
+
+//------------------------------------------------------------------------------
+// Function: injectLatency
+//
+// Description:
+//
+//  Wait for the replay latency to pass.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Spins rather than sleeps, since latencies are well below the scheduler's
+//  granularity.
+//
+static void
+injectLatency(
+	_In_ const DbgScriptTrace* trace)
+{
+	LARGE_INTEGER start = {};
+	LARGE_INTEGER now = {};
+
+	if (!trace->LatencyTicks)
+	{
+		return;
+	}
+
+	QueryPerformanceCounter(&start);
+	do
+	{
+		YieldProcessor();
+		QueryPerformanceCounter(&now);
+	} while (now.QuadPart - start.QuadPart < trace->LatencyTicks);
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceStartRecording
+//
+// Description:
+//
+//  Start recording traced calls to a file.
+//
+// Parameters:
+//
+//  path - Trace file to create. Overwritten if it exists.
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if a trace is already active.
+//
+// Notes:
+//
+//  The trace is stored in the host context so all providers share it.
+//
+_Check_return_ HRESULT
+TraceStartRecording(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path)
+{
+	HRESULT hr = S_OK;
+	DbgScriptTrace* trace = nullptr;
+	TraceFileHeader header = {TRACE_MAGIC, TRACE_VERSION};
+
+	if (hostCtxt->Trace)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	trace = newTrace(false /* replay */);
+	if (!trace)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	trace->Buffer = (BYTE*)HeapAlloc(GetProcessHeap(), 0, TRACE_BUFFER_SIZE);
+	trace->Recorded = (UINT64*)HeapAlloc(
+		GetProcessHeap(),
+		HEAP_ZERO_MEMORY,
+		TRACE_RECORDED_INITIAL_SIZE * sizeof(UINT64));
+	if (!trace->Buffer || !trace->Recorded)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	trace->RecordedSize = TRACE_RECORDED_INITIAL_SIZE;
+
+	trace->File = CreateFileA(
+		path,
+		GENERIC_WRITE,
+		0 /* dwShareMode */,
+		nullptr,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (trace->File == INVALID_HANDLE_VALUE)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	appendTrace(trace, &header, sizeof(header));
+
+	// Start cold so that lookups cached before now get recorded too.
+	//
+	memset(hostCtxt->RuntimeTypeCache, 0, sizeof(hostCtxt->RuntimeTypeCache));
+
+	hostCtxt->Trace = trace;
+	trace = nullptr;
+
+exit:
+	if (trace)
+	{
+		destroyTrace(trace);
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceStartReplay
+//
+// Description:
+//
+//  Start serving traced calls from a previously recorded file.
+//
+// Parameters:
+//
+//  path - Trace file.
+//  latencyUs - Latency to add to every call served, in microseconds.
+//
+// Returns:
+//
+//  HRESULT. S_FALSE if a trace is already active.
+//  HRESULT_FROM_WIN32(ERROR_BAD_FORMAT) if the file isn't a valid trace.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+TraceStartReplay(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path,
+	_In_ ULONG latencyUs)
+{
+	HRESULT hr = S_OK;
+	DbgScriptTrace* trace = nullptr;
+	LARGE_INTEGER fileSize = {};
+	LARGE_INTEGER freq = {};
+	const TraceFileHeader* header = nullptr;
+	UINT64 pos = sizeof(TraceFileHeader);
+	ULONG entryCount = 0;
+
+	if (hostCtxt->Trace)
+	{
+		hr = S_FALSE;
+		goto exit;
+	}
+
+	trace = newTrace(true /* replay */);
+	if (!trace)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	trace->File = CreateFileA(
+		path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if (trace->File == INVALID_HANDLE_VALUE)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if (!GetFileSizeEx(trace->File, &fileSize))
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	if ((UINT64)fileSize.QuadPart < sizeof(TraceFileHeader) ||
+		(UINT64)fileSize.QuadPart > SIZE_MAX)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto exit;
+	}
+
+	trace->Mapping = CreateFileMappingA(
+		trace->File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!trace->Mapping)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	trace->View = (const BYTE*)MapViewOfFile(
+		trace->Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!trace->View)
+	{
+		hr = HRESULT_FROM_WIN32(GetLastError());
+		goto exit;
+	}
+
+	header = (const TraceFileHeader*)trace->View;
+	if (header->Magic != TRACE_MAGIC || header->Version != TRACE_VERSION)
+	{
+		hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+		goto exit;
+	}
+
+	// Validate and count the entries, then size the index to at most half
+	// full.
+	//
+	while (pos < (UINT64)fileSize.QuadPart)
+	{
+		const UINT64 cbLeft = fileSize.QuadPart - pos;
+		const TraceEntryHeader* entry = (const TraceEntryHeader*)(trace->View + pos);
+
+		if (cbLeft < sizeof(*entry) ||
+			(UINT64)entry->CbKey + entry->CbResponse > cbLeft - sizeof(*entry) ||
+			entryCount >= MAXLONG / 2)
+		{
+			hr = HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+			goto exit;
+		}
+
+		++entryCount;
+		pos += sizeof(*entry) + entry->CbKey + entry->CbResponse;
+	}
+
+	for (trace->IndexSize = 16; trace->IndexSize < entryCount * 2; trace->IndexSize *= 2)
+	{
+	}
+
+	trace->Index = (TraceIndexSlot*)HeapAlloc(
+		GetProcessHeap(), HEAP_ZERO_MEMORY, trace->IndexSize * sizeof(TraceIndexSlot));
+	if (!trace->Index)
+	{
+		hr = E_OUTOFMEMORY;
+		goto exit;
+	}
+
+	// Index every entry.
+	//
+	for (pos = sizeof(TraceFileHeader); pos < (UINT64)fileSize.QuadPart; )
+	{
+		const TraceEntryHeader* entry = (const TraceEntryHeader*)(trace->View + pos);
+		const UINT64 hash = hashRequest(entry->Kind, entry + 1, entry->CbKey, nullptr, 0);
+		const ULONG mask = trace->IndexSize - 1;
+		ULONG i = (ULONG)hash & mask;
+
+		while (trace->Index[i].Entry)
+		{
+			i = (i + 1) & mask;
+		}
+
+		trace->Index[i].Hash = hash;
+		trace->Index[i].Entry = entry;
+
+		pos += sizeof(*entry) + entry->CbKey + entry->CbResponse;
+	}
+
+	QueryPerformanceFrequency(&freq);
+	trace->LatencyTicks = freq.QuadPart * latencyUs / 1000000;
+
+	// Start cold, as the recording did.
+	//
+	memset(hostCtxt->RuntimeTypeCache, 0, sizeof(hostCtxt->RuntimeTypeCache));
+
+	hostCtxt->Trace = trace;
+	trace = nullptr;
+
+exit:
+	if (trace)
+	{
+		destroyTrace(trace);
+	}
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceStop
+//
+// Description:
+//
+//  Stop recording or replaying.
+//
+// Parameters:
+//
+// Returns:
+//
+//  HRESULT. Failure if any part of a recording couldn't be written.
+//
+// Notes:
+//
+_Check_return_ HRESULT
+TraceStop(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	HRESULT hr = S_OK;
+	DbgScriptTrace* trace = hostCtxt->Trace;
+	if (!trace)
+	{
+		return S_OK;
+	}
+
+	hostCtxt->Trace = nullptr;
+
+	if (!trace->Replay)
+	{
+		flushTrace(trace);
+		hr = trace->WriteHr;
+	}
+
+	destroyTrace(trace);
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceReplayCall
+//
+// Description:
+//
+//  Serve a call from the trace being replayed.
+//
+// Parameters:
+//
+//  kind - Call being made.
+//  key, keyTail - Request; the key is the concatenation of the two.
+//  response - Receives the recorded response.
+//  cbActual - Receives the size of the recorded response, clipped to
+//   'cbResponse'.
+//  hr - Receives the recorded HRESULT.
+//
+// Returns:
+//
+//  true if replaying, in which case the caller must not call DbgEng. Requests
+//  missing from the trace fail with HRESULT_FROM_WIN32(ERROR_NOT_FOUND).
+//
+// Notes:
+//
+_Check_return_ bool
+TraceReplayCall(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ TraceCallKind kind,
+	_In_reads_bytes_(cbKey) const void* key,
+	_In_ ULONG cbKey,
+	_In_reads_bytes_opt_(cbKeyTail) const void* keyTail,
+	_In_ ULONG cbKeyTail,
+	_Out_writes_bytes_to_(cbResponse, *cbActual) void* response,
+	_In_ ULONG cbResponse,
+	_Out_opt_ ULONG* cbActual,
+	_Out_ HRESULT* hr)
+{
+	DbgScriptTrace* trace = hostCtxt->Trace;
+	if (!trace || !trace->Replay)
+	{
+		return false;
+	}
+
+	++trace->Calls[kind];
+	injectLatency(trace);
+
+	if (cbActual)
+	{
+		*cbActual = 0;
+	}
+
+	*hr = HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+
+	const UINT64 hash = hashRequest(kind, key, cbKey, keyTail, cbKeyTail);
+	const ULONG mask = trace->IndexSize - 1;
+
+	for (ULONG i = (ULONG)hash & mask; trace->Index[i].Entry; i = (i + 1) & mask)
+	{
+		const TraceEntryHeader* entry = trace->Index[i].Entry;
+		const BYTE* entryKey = (const BYTE*)(entry + 1);
+
+		if (trace->Index[i].Hash != hash ||
+			entry->Kind != (ULONG)kind ||
+			entry->CbKey != cbKey + cbKeyTail ||
+			memcmp(entryKey, key, cbKey) != 0 ||
+			(cbKeyTail && memcmp(entryKey + cbKey, keyTail, cbKeyTail) != 0))
+		{
+			continue;
+		}
+
+		const ULONG cbCopy = min(entry->CbResponse, cbResponse);
+		memcpy(response, entryKey + entry->CbKey, cbCopy);
+		if (cbActual)
+		{
+			*cbActual = cbCopy;
+		}
+
+		*hr = entry->Hr;
+		break;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceRecordCall
+//
+// Description:
+//
+//  Append a call and its result to the trace being recorded.
+//
+// Parameters:
+//
+//  kind - Call that was made.
+//  key, keyTail - Request; the key is the concatenation of the two.
+//  response - Response returned by DbgEng.
+//  hr - HRESULT returned by DbgEng.
+//
+// Returns:
+//
+// Notes:
+//
+//  Only the first response to a given request is kept.
+//
+void
+TraceRecordCall(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ TraceCallKind kind,
+	_In_reads_bytes_(cbKey) const void* key,
+	_In_ ULONG cbKey,
+	_In_reads_bytes_opt_(cbKeyTail) const void* keyTail,
+	_In_ ULONG cbKeyTail,
+	_In_reads_bytes_opt_(cbResponse) const void* response,
+	_In_ ULONG cbResponse,
+	_In_ HRESULT hr)
+{
+	DbgScriptTrace* trace = hostCtxt->Trace;
+	if (!trace || trace->Replay)
+	{
+		return;
+	}
+
+	++trace->Calls[kind];
+
+	const HRESULT insertHr = insertRecorded(
+		trace, hashRequest(kind, key, cbKey, keyTail, cbKeyTail));
+	if (insertHr != S_OK)
+	{
+		// Already have it, or couldn't remember it.
+		//
+		if (FAILED(insertHr) && SUCCEEDED(trace->WriteHr))
+		{
+			trace->WriteHr = insertHr;
+		}
+		return;
+	}
+
+	if (!response)
+	{
+		cbResponse = 0;
+	}
+
+	TraceEntryHeader entry = {(ULONG)kind, hr, cbKey + cbKeyTail, cbResponse};
+
+	appendTrace(trace, &entry, sizeof(entry));
+	appendTrace(trace, key, cbKey);
+	if (cbKeyTail)
+	{
+		appendTrace(trace, keyTail, cbKeyTail);
+	}
+	if (cbResponse)
+	{
+		appendTrace(trace, response, cbResponse);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: TraceOutputStats
+//
+// Description:
+//
+//  Output the number of calls made through traced call sites since the active
+//  trace started, by kind, the time elapsed, and how much memory the process
+//  used.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+TraceOutputStats(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	const DbgScriptTrace* trace = hostCtxt->Trace;
+	LARGE_INTEGER now = {};
+	LARGE_INTEGER freq = {};
+	UINT64 total = 0;
+	SIZE_T peakWorkingSet = 0;
+
+	if (!trace)
+	{
+		return;
+	}
+
+	const SIZE_T privateBytes = getPrivateBytes(&peakWorkingSet);
+
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+
+	for (ULONG i = 0; i < TraceCallMax; ++i)
+	{
+		total += trace->Calls[i];
+	}
+
+	const UINT64 elapsedUs =
+		(UINT64)(now.QuadPart - trace->StartTime.QuadPart) * 1000000 / freq.QuadPart;
+
+	hostCtxt->DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"%s: %I64u engine requests in %I64u.%03I64u ms\n",
+		trace->Replay ? "Replay" : "Record",
+		total,
+		elapsedUs / 1000,
+		elapsedUs % 1000);
+
+	// Private bytes growth approximates what the script allocated.
+	//
+	hostCtxt->DebugControl->Output(
+		DEBUG_OUTPUT_NORMAL,
+		"Memory: %+I64d KB private bytes, %I64u KB peak working set\n",
+		((INT64)privateBytes - (INT64)trace->StartPrivateBytes) / 1024,
+		(UINT64)peakWorkingSet / 1024);
+
+	for (ULONG i = 1; i < TraceCallMax; ++i)
+	{
+		if (trace->Calls[i])
+		{
+			hostCtxt->DebugControl->Output(
+				DEBUG_OUTPUT_NORMAL,
+				"  %-16s %I64u\n",
+				s_TraceCallNames[i],
+				trace->Calls[i]);
+		}
+	}
+}
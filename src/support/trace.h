@@ -0,0 +1,81 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: trace.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Record/replay of debugger engine calls made by the support library.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// TraceCallKind - Identifies the debugger engine call a trace entry is for.
+//
+enum TraceCallKind
+{
+	TraceCallReadVirtual = 1,
+	TraceCallReadPointer,
+	TraceCallSearchVirtual,
+	TraceCallTypedData,
+	TraceCallGetSymbolTypeId,
+	TraceCallGetFieldOffset,
+	TraceCallGetTypeSize,
+	TraceCallGetNameByOffset,
+	TraceCallReadTypedData,
+
+	// Number of kinds, plus one. Not a real kind.
+	//
+	TraceCallMax
+};
+
+_Check_return_ HRESULT
+TraceStartRecording(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path);
+
+_Check_return_ HRESULT
+TraceStartReplay(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* path,
+	_In_ ULONG latencyUs);
+
+_Check_return_ HRESULT
+TraceStop(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+void
+TraceOutputStats(
+	_In_ DbgScriptHostContext* hostCtxt);
+
+_Check_return_ bool
+TraceReplayCall(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ TraceCallKind kind,
+	_In_reads_bytes_(cbKey) const void* key,
+	_In_ ULONG cbKey,
+	_In_reads_bytes_opt_(cbKeyTail) const void* keyTail,
+	_In_ ULONG cbKeyTail,
+	_Out_writes_bytes_to_(cbResponse, *cbActual) void* response,
+	_In_ ULONG cbResponse,
+	_Out_opt_ ULONG* cbActual,
+	_Out_ HRESULT* hr);
+
+void
+TraceRecordCall(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ TraceCallKind kind,
+	_In_reads_bytes_(cbKey) const void* key,
+	_In_ ULONG cbKey,
+	_In_reads_bytes_opt_(cbKeyTail) const void* keyTail,
+	_In_ ULONG cbKeyTail,
+	_In_reads_bytes_opt_(cbResponse) const void* response,
+	_In_ ULONG cbResponse,
+	_In_ HRESULT hr);
@@ -16,7 +16,15 @@
 #include "util.h"
 #include <assert.h>
 #include <strsafe.h>
+#include <wctype.h>
 #include "symcache.h"
+#include "dumpmap.h"
+#include "pdbreader.h"
+#include "trace.h"
+#include "stats.h"
+#include "timeline.h"
+#include <algorithm>
+#include <vector>
 
 //------------------------------------------------------------------------------
 // Function: UtilReadPointer
@@ -31,13 +39,81 @@
 //
 // Notes:
 //
+//  Served from the mapped dump, if any, when the pointer was captured.
+//  Traced (see trace.h).
+//
 _Check_return_ HRESULT
 UtilReadPointer(
 	_In_ DbgScriptHostContext* hostCtxt,
 	_In_ UINT64 addr,
 	_Out_ UINT64* ptrVal)
 {
-	return hostCtxt->DebugDataSpaces->ReadPointersVirtual(1, addr, ptrVal);
+	HRESULT hr = S_OK;
+	const DumpMemoryMap* map = hostCtxt->DumpMap;
+	LONGLONG start = 0;
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallReadPointer,
+			&addr,
+			sizeof(addr),
+			nullptr,
+			0,
+			ptrVal,
+			sizeof(*ptrVal),
+			nullptr,
+			&hr))
+	{
+		goto exit;
+	}
+
+	if (map)
+	{
+		if (map->Is64Bit)
+		{
+			if (DumpMapRead(map, addr, ptrVal, sizeof(*ptrVal)))
+			{
+				goto exit;
+			}
+		}
+		else
+		{
+			// Sign-extend like ReadPointersVirtual does.
+			//
+			LONG ptr32 = 0;
+			if (DumpMapRead(map, addr, &ptr32, sizeof(ptr32)))
+			{
+				*ptrVal = (UINT64)(INT64)ptr32;
+				goto exit;
+			}
+		}
+	}
+
+	start = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugDataSpaces->ReadPointersVirtual(1, addr, ptrVal);
+	StatsEnd(hostCtxt, StatsTimerReadPointer, start, addr);
+
+exit:
+	if (SUCCEEDED(hr))
+	{
+		StatsCount(hostCtxt, StatsCounterBytesRead, sizeof(*ptrVal));
+	}
+
+
+	// Record answers from the mapped dump too. No-op when replaying.
+	//
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallReadPointer,
+		&addr,
+		sizeof(addr),
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? ptrVal : nullptr,
+		sizeof(*ptrVal),
+		hr);
+
+	return hr;
 }
 
 //------------------------------------------------------------------------------
@@ -74,6 +150,8 @@ UtilGetPeb(
 //
 // Notes:
 //
+//  Answered from the module's PDB directly when possible.
+//
 _Check_return_ HRESULT
 UtilGetFieldOffset(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -82,12 +160,21 @@ UtilGetFieldOffset(
 	_Out_ ULONG* offset)
 {
 	HRESULT hr = S_OK;
+	ModuleAndTypeId* typeInfo = nullptr;
+	const char* pdbTypeName = nullptr;
+	
+	const PdbFile* pdb = GetCachedModulePdb(hostCtxt, type, &pdbTypeName);
+	if (pdb && SUCCEEDED(PdbGetFieldOffset(pdb, pdbTypeName, field, offset)))
+	{
+		goto exit;
+	}
 	
 	// Lookup typeid/moduleBase from type name.
 	//
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, type);
+	typeInfo = GetCachedSymbolType(hostCtxt, type);
 	if (!typeInfo)
 	{
+		hr = E_FAIL;
 		hostCtxt->DebugControl->Output(
 			DEBUG_OUTPUT_ERROR,
 			ERR_FAILED_GET_TYPE_ID,
@@ -96,11 +183,7 @@ UtilGetFieldOffset(
 		goto exit;
 	}
 	
-	hr = hostCtxt->DebugSymbols->GetFieldOffset(
-		typeInfo->ModuleBase,
-		typeInfo->TypeId,
-		field,
-		offset);
+	hr = GetCachedFieldOffset(hostCtxt, *typeInfo, field, offset);
 	
 exit:
 	return hr;
@@ -121,6 +204,8 @@ exit:
 //
 // Notes:
 //
+//  Answered from the module's PDB directly when possible.
+//
 _Check_return_ HRESULT
 UtilGetTypeSize(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -128,12 +213,23 @@ UtilGetTypeSize(
 	_Out_ ULONG* size)
 {
 	HRESULT hr = S_OK;
+	ModuleAndTypeId* typeInfo = nullptr;
+	const char* pdbTypeName = nullptr;
+	UINT64 traceKey[2] = {};
+	LONGLONG start = 0;
+	
+	const PdbFile* pdb = GetCachedModulePdb(hostCtxt, type, &pdbTypeName);
+	if (pdb && SUCCEEDED(PdbGetTypeSize(pdb, pdbTypeName, size)))
+	{
+		goto exit;
+	}
 	
 	// Lookup typeid/moduleBase from type name.
 	//
-	ModuleAndTypeId* typeInfo = GetCachedSymbolType(hostCtxt, type);
+	typeInfo = GetCachedSymbolType(hostCtxt, type);
 	if (!typeInfo)
 	{
+		hr = E_FAIL;
 		hostCtxt->DebugControl->Output(
 			DEBUG_OUTPUT_ERROR,
 			ERR_FAILED_GET_TYPE_ID,
@@ -142,10 +238,108 @@ UtilGetTypeSize(
 		goto exit;
 	}
 	
+	// Key on the fields rather than the struct so padding doesn't leak in.
+	//
+	traceKey[0] = typeInfo->ModuleBase;
+	traceKey[1] = typeInfo->TypeId;
+	
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallGetTypeSize,
+			traceKey,
+			sizeof(traceKey),
+			nullptr,
+			0,
+			size,
+			sizeof(*size),
+			nullptr,
+			&hr))
+	{
+		goto exit;
+	}
+	
+	start = StatsBegin(hostCtxt);
 	hr = hostCtxt->DebugSymbols->GetTypeSize(
 		typeInfo->ModuleBase,
 		typeInfo->TypeId,
 		size);
+	StatsEnd(hostCtxt, StatsTimerGetTypeSize, start, typeInfo->TypeId);
+	
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallGetTypeSize,
+		traceKey,
+		sizeof(traceKey),
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? size : nullptr,
+		sizeof(*size),
+		hr);
+	
+exit:
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilResolveEnum
+//
+// Description:
+//
+//  Get the name of the enumerant of an enum type with a given value.
+//
+// Parameters:
+//
+//  type - Enum type.
+//  value - Value to resolve.
+//  buf - On successful return, name of the enumerant. Expected to be a buffer
+//   of MAX_SYMBOL_NAME_LEN characters long.
+//
+// Returns:
+//
+//  HRESULT.
+//
+// Notes:
+//
+//  Answered from the module's PDB directly when possible.
+//
+_Check_return_ HRESULT
+UtilResolveEnum(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* type,
+	_In_ UINT64 value,
+	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf)
+{
+	HRESULT hr = S_OK;
+	ModuleAndTypeId* typeInfo = nullptr;
+	const char* pdbTypeName = nullptr;
+	
+	const PdbFile* pdb = GetCachedModulePdb(hostCtxt, type, &pdbTypeName);
+	if (pdb && SUCCEEDED(PdbGetEnumName(pdb, pdbTypeName, value, buf, MAX_SYMBOL_NAME_LEN)))
+	{
+		goto exit;
+	}
+	
+	// Lookup typeid/moduleBase from type name.
+	//
+	typeInfo = GetCachedSymbolType(hostCtxt, type);
+	if (!typeInfo)
+	{
+		hr = E_FAIL;
+		hostCtxt->DebugControl->Output(
+			DEBUG_OUTPUT_ERROR,
+			ERR_FAILED_GET_TYPE_ID,
+			type,
+			hr);
+		goto exit;
+	}
+	
+	hr = hostCtxt->DebugSymbols->GetConstantName(
+		typeInfo->ModuleBase,
+		typeInfo->TypeId,
+		value,
+		buf,
+		MAX_SYMBOL_NAME_LEN,
+		nullptr);
 	
 exit:
 	return hr;
@@ -176,10 +370,7 @@ UtilGetNearestSymbol(
 	_In_ UINT64 addr,
 	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf)
 {
-	UINT64 disp = 0;
-	ULONG cchActual = 0;
-	HRESULT hr = hostCtxt->DebugSymbols->GetNameByOffset(
-		addr, buf, MAX_SYMBOL_NAME_LEN, &cchActual, &disp);
+	HRESULT hr = GetCachedNearestSymbol(hostCtxt, addr, buf);
 	if (FAILED(hr))
 	{
 		hostCtxt->DebugControl->Output(
@@ -187,27 +378,74 @@ UtilGetNearestSymbol(
 			ERR_FAILED_GET_NAME_BY_OFFSET,
 			addr,
 			hr);
-		goto exit;
 	}
 
-	// If we have a displacement, append it to the name. Don't do it for S_FALSE
-	// since that means the symbol was already truncated. No point in appending
-	// anything more.
-	//
-	if (disp && hr != S_FALSE && MAX_SYMBOL_NAME_LEN - cchActual > 0)
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilGetNearestSymbols
+//
+// Description:
+//
+//  Lookup the nearest symbols of many addresses.
+//
+// Parameters:
+//
+//  count - Number of addresses.
+//  addrs - Virtual addresses to probe.
+//  callback - Called with the index (into 'addrs') and name of each result.
+//   The name is null if the lookup failed. Returning a failure stops the
+//   enumeration.
+//  userctxt - Passed to 'callback'.
+//
+// Returns:
+//
+//  HRESULT. S_OK even if some lookups fail.
+//
+// Notes:
+//
+//  Addresses are resolved in sorted order so that each module's symbol index
+//  is built once and then walked with good locality. The callback is therefore
+//  not called in index order.
+//
+_Check_return_ HRESULT
+UtilGetNearestSymbols(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ ULONG count,
+	_In_reads_(count) const UINT64* addrs,
+	_In_ GetNearestSymbolsCb callback,
+	_In_opt_ void* userctxt)
+{
+	HRESULT hr = S_OK;
+	char name[MAX_SYMBOL_NAME_LEN] = {};
+	std::vector<ULONG> order(count);
+
+	for (ULONG i = 0; i < count; ++i)
 	{
-		// 'cchActual' includes the NUL, so we want to start writing
-		// just before 'cchActual'.
-		//
-		hr = StringCchPrintfA(
-			buf + (cchActual - 1),
-			MAX_SYMBOL_NAME_LEN - (cchActual - 1),
-			"+%#I64x",
-			disp);
+		order[i] = i;
+	}
+
+	std::sort(
+		order.begin(),
+		order.end(),
+		[addrs](ULONG a, ULONG b)
+		{
+			return addrs[a] < addrs[b];
+		});
+
+	for (ULONG i = 0; i < count; ++i)
+	{
+		const ULONG idx = order[i];
+		HRESULT hrLookup = GetCachedNearestSymbol(hostCtxt, addrs[idx], name);
 
-		assert(hr != STRSAFE_E_INVALID_PARAMETER);
+		hr = callback(idx, SUCCEEDED(hrLookup) ? name : nullptr, userctxt);
+		if (FAILED(hr))
+		{
+			break;
+		}
 	}
-exit:
+
 	return hr;
 }
 
@@ -353,6 +591,9 @@ exit:
 //
 // Notes:
 //
+//  Served from the mapped dump, if any, when the whole range was captured.
+//  Traced (see trace.h).
+//
 _Check_return_ HRESULT
 UtilReadBytes(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -361,11 +602,292 @@ UtilReadBytes(
 	_In_ ULONG cbCount,
 	_Out_ ULONG* cbActualLen)
 {
-	return hostCtxt->DebugDataSpaces->ReadVirtual(
+	HRESULT hr = S_OK;
+	const UINT64 key[] = { addr, cbCount };
+	LONGLONG start = 0;
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallReadVirtual,
+			key,
+			sizeof(key),
+			nullptr,
+			0,
+			buf,
+			cbCount,
+			cbActualLen,
+			&hr))
+	{
+		goto exit;
+	}
+
+	if (hostCtxt->DumpMap && DumpMapRead(hostCtxt->DumpMap, addr, buf, cbCount))
+	{
+		*cbActualLen = cbCount;
+		goto exit;
+	}
+
+	start = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugDataSpaces->ReadVirtual(
 		addr,
 		buf,
 		cbCount,
 		cbActualLen);
+	StatsEnd(hostCtxt, StatsTimerReadVirtual, start, addr);
+
+exit:
+	if (SUCCEEDED(hr))
+	{
+		StatsCount(hostCtxt, StatsCounterBytesRead, *cbActualLen);
+	}
+
+
+	// Record answers from the mapped dump too. No-op when replaying.
+	//
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallReadVirtual,
+		key,
+		sizeof(key),
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? buf : nullptr,
+		SUCCEEDED(hr) ? *cbActualLen : 0,
+		hr);
+
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilGetSpan
+//
+// Description:
+//
+//  Get a pointer to target memory inside the mapped dump, without copying.
+//
+// Parameters:
+//
+//  cb - Number of bytes the caller intends to read.
+//
+// Returns:
+//
+//  Pointer to the bytes, or nullptr if there's no mapped dump, the range
+//  isn't captured in one piece, or reads are being traced. The caller should
+//  then fall back to UtilReadBytes.
+//
+// Notes:
+//
+//  The pointer is good for as long as DbgScriptHostContext::DumpMapGeneration
+//  doesn't change. Counted as 'cb' bytes read.
+//
+_Check_return_ const BYTE*
+UtilGetSpan(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_In_ ULONG cb)
+{
+	// Traces must see every read, so those go through UtilReadBytes.
+	//
+	if (!hostCtxt->DumpMap || hostCtxt->Trace)
+	{
+		return nullptr;
+	}
+
+	const BYTE* span = DumpMapGetSpan(hostCtxt->DumpMap, addr, cb);
+	if (span)
+	{
+		StatsCount(hostCtxt, StatsCounterBytesRead, cb);
+	}
+
+	return span;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilReadTypedData
+//
+// Description:
+//
+//  Read the value of a primitive typed object from the target.
+//
+// Parameters:
+//
+//  typedData - Object to read. Must be in memory.
+//  cbActualLen - Number of bytes read.
+//
+// Returns:
+//
+// Notes:
+//
+//  Served from the mapped dump, if any, when the value was captured: a
+//  primitive's value is just its bytes. Traced (see trace.h).
+//
+_Check_return_ HRESULT
+UtilReadTypedData(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DEBUG_TYPED_DATA* typedData,
+	_Out_writes_bytes_to_(cbBuf, *cbActualLen) void* buf,
+	_In_ ULONG cbBuf,
+	_Out_ ULONG* cbActualLen)
+{
+	HRESULT hr = S_OK;
+	const UINT64 key[] =
+	{
+		typedData->Offset,
+		typedData->ModBase,
+		typedData->TypeId,
+		cbBuf
+	};
+	LONGLONG start = 0;
+
+	*cbActualLen = 0;
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallReadTypedData,
+			key,
+			sizeof(key),
+			nullptr,
+			0,
+			buf,
+			cbBuf,
+			cbActualLen,
+			&hr))
+	{
+		goto exit;
+	}
+
+	if (hostCtxt->DumpMap &&
+		typedData->Size <= cbBuf &&
+		DumpMapRead(hostCtxt->DumpMap, typedData->Offset, buf, typedData->Size))
+	{
+		*cbActualLen = typedData->Size;
+		goto exit;
+	}
+
+	start = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugSymbols->ReadTypedDataVirtual(
+		typedData->Offset,
+		typedData->ModBase,
+		typedData->TypeId,
+		buf,
+		cbBuf,
+		cbActualLen);
+	StatsEnd(hostCtxt, StatsTimerReadTypedData, start, typedData->Offset);
+
+exit:
+	if (SUCCEEDED(hr))
+	{
+		StatsCount(hostCtxt, StatsCounterBytesRead, *cbActualLen);
+	}
+
+	// Record answers from the mapped dump too. No-op when replaying.
+	//
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallReadTypedData,
+		key,
+		sizeof(key),
+		nullptr,
+		0,
+		SUCCEEDED(hr) ? buf : nullptr,
+		SUCCEEDED(hr) ? *cbActualLen : 0,
+		hr);
+
+	return hr;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilSearchMemory
+//
+// Description:
+//
+//  Search the address space from [start, start + size) for 'pattern'.
+//
+// Parameters:
+//
+//  patternGranularity - Only matches at a multiple of this from 'start' are
+//   considered.
+//  matchAddr - On success, address of the first match.
+//
+// Returns:
+//
+//  HRESULT. HRESULT_FROM_NT(STATUS_NO_MORE_ENTRIES) if not found.
+//
+// Notes:
+//
+//  Served from the mapped dump, if any, when the whole region was captured.
+//  Traced (see trace.h).
+//
+_Check_return_ HRESULT
+UtilSearchMemory(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 start,
+	_In_ UINT64 size,
+	_In_reads_bytes_(patternSize) const void* pattern,
+	_In_ ULONG patternSize,
+	_In_ ULONG patternGranularity,
+	_Out_ UINT64* matchAddr)
+{
+	HRESULT hr = S_OK;
+	const UINT64 key[] = { start, size, patternGranularity };
+	LONGLONG statsStart = 0;
+
+	if (TraceReplayCall(
+			hostCtxt,
+			TraceCallSearchVirtual,
+			key,
+			sizeof(key),
+			pattern,
+			patternSize,
+			matchAddr,
+			sizeof(*matchAddr),
+			nullptr,
+			&hr))
+	{
+		goto exit;
+	}
+
+	if (hostCtxt->DumpMap)
+	{
+		hr = DumpMapSearch(
+			hostCtxt->DumpMap,
+			start,
+			size,
+			pattern,
+			patternSize,
+			patternGranularity,
+			matchAddr);
+		if (hr != S_FALSE)
+		{
+			goto exit;
+		}
+	}
+
+	statsStart = StatsBegin(hostCtxt);
+	hr = hostCtxt->DebugDataSpaces->SearchVirtual(
+		start,
+		size,
+		(PVOID)pattern,
+		patternSize,
+		patternGranularity,
+		matchAddr);
+	StatsEnd(hostCtxt, StatsTimerSearchVirtual, statsStart, start);
+
+exit:
+	// Record answers from the mapped dump too. No-op when replaying.
+	//
+	TraceRecordCall(
+		hostCtxt,
+		TraceCallSearchVirtual,
+		key,
+		sizeof(key),
+		pattern,
+		patternSize,
+		SUCCEEDED(hr) ? matchAddr : nullptr,
+		sizeof(*matchAddr),
+		hr);
+
+	return hr;
 }
 
 //------------------------------------------------------------------------------
@@ -373,7 +895,7 @@ UtilReadBytes(
 //
 // Description:
 //
-//  Checks debugger's abort bit.
+//  Checks debugger's abort bit, at most once every ABORT_CHECK_INTERVAL_MS.
 //
 // Parameters:
 //
@@ -381,17 +903,130 @@ UtilReadBytes(
 //
 // Notes:
 //
+//  Called at the top of nearly every script API, so asking DbgEng each time
+//  would cost an engine request per field access. Between checks this only
+//  reads the tick count, which is a load from shared user data.
+//
+//  GetInterrupt clears the abort bit, so an abort is reported once.
+//
 _Check_return_ bool
 UtilCheckAbort(
 	_In_ DbgScriptHostContext* hostCtxt)
 {
+	const ULONGLONG now = GetTickCount64();
+	if (now < hostCtxt->NextAbortCheck)
+	{
+		return false;
+	}
+
+	hostCtxt->NextAbortCheck = now + ABORT_CHECK_INTERVAL_MS;
+
+	const LONGLONG start = StatsBegin(hostCtxt);
 	HRESULT hr = hostCtxt->DebugControl->GetInterrupt();
+	StatsEnd(hostCtxt, StatsTimerGetInterrupt, start);
 
 	// S_OK means user has issued an Ctrl-C or Ctrl-Break.
 	//
 	return hr == S_OK;
 }
 
+//------------------------------------------------------------------------------
+// Function: abortTimerCallback
+//
+// Description:
+//
+//  Thread pool timer callback for UtilStartAbortTimer.
+//
+// Parameters:
+//
+//  context - UtilAbortTimerCb to call.
+//
+// Returns:
+//
+// Notes:
+//
+static VOID CALLBACK
+abortTimerCallback(
+	_Inout_ PTP_CALLBACK_INSTANCE /* instance */,
+	_Inout_opt_ PVOID context,
+	_Inout_ PTP_TIMER /* timer */)
+{
+	((UtilAbortTimerCb)context)();
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilStartAbortTimer
+//
+// Description:
+//
+//  Start calling 'callback' every ABORT_CHECK_INTERVAL_MS from the thread
+//  pool.
+//
+// Parameters:
+//
+//  callback - Schedules an abort check on the script's thread, e.g. as a
+//   pending call of the interpreter.
+//
+// Returns:
+//
+//  Timer to pass to UtilStopAbortTimer, or nullptr if it couldn't be created.
+//
+// Notes:
+//
+//  Lets providers interrupt loops that never call a script API, without
+//  taxing the interpreter when there's nothing to check.
+//
+_Check_return_ PTP_TIMER
+UtilStartAbortTimer(
+	_In_ UtilAbortTimerCb callback)
+{
+	FILETIME due = {};
+	ULARGE_INTEGER dueTime = {};
+
+	PTP_TIMER timer = CreateThreadpoolTimer(abortTimerCallback, (PVOID)callback, nullptr);
+	if (!timer)
+	{
+		return nullptr;
+	}
+
+	// Relative due time, in 100ns units.
+	//
+	dueTime.QuadPart = (ULONGLONG)-(LONGLONG)(ABORT_CHECK_INTERVAL_MS * 10000);
+	due.dwLowDateTime = dueTime.LowPart;
+	due.dwHighDateTime = dueTime.HighPart;
+
+	SetThreadpoolTimer(
+		timer, &due, ABORT_CHECK_INTERVAL_MS, ABORT_CHECK_INTERVAL_MS / 2 /* window */);
+	return timer;
+}
+
+//------------------------------------------------------------------------------
+// Function: UtilStopAbortTimer
+//
+// Description:
+//
+//  Stop a timer started by UtilStartAbortTimer and wait for its callbacks.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+UtilStopAbortTimer(
+	_In_opt_ PTP_TIMER timer)
+{
+	if (!timer)
+	{
+		return;
+	}
+
+	SetThreadpoolTimer(timer, nullptr, 0, 0);
+	WaitForThreadpoolTimerCallbacks(timer, TRUE /* cancel pending */);
+	CloseThreadpoolTimer(timer);
+}
+
 //------------------------------------------------------------------------------
 // Function: UtilConvertAnsiToWide
 //
@@ -481,10 +1116,12 @@ UtilFlushMessageBuffer(
 		assert(hostCtxt->BufPosition <= _countof(hostCtxt->MessageBuf) - 1);
 		hostCtxt->MessageBuf[hostCtxt->BufPosition] = 0;
 
+		const LONGLONG start = StatsBegin(hostCtxt);
 		hostCtxt->DebugControl->Output(
 			DEBUG_OUTPUT_NORMAL,
 			"%s",
 			hostCtxt->MessageBuf);
+		StatsEnd(hostCtxt, StatsTimerOutputFlush, start, hostCtxt->BufPosition);
 
 		// Reset position marker.
 		//
@@ -695,6 +1332,8 @@ CAutoSwitchThread::Switch()
 		}
 		
 		m_DidSwitch = true;
+		TimelineInstant(
+			m_HostCtxt, "SwitchThread", TimelineCategoryHost, "thread", m_TargetThreadId);
 	}
 exit:
 	return hr;
@@ -722,6 +1361,8 @@ CAutoSwitchThread::~CAutoSwitchThread()
 		HRESULT hr = m_HostCtxt->DebugSysObj->SetCurrentThreadId(m_PrevThreadId);
 		assert(SUCCEEDED(hr));
 		hr;
+		TimelineInstant(
+			m_HostCtxt, "SwitchThread", TimelineCategoryHost, "thread", m_PrevThreadId);
 	}
 }
 
@@ -789,6 +1430,8 @@ CAutoSwitchStackFrame::Switch()
 			goto exit;
 		}
 		m_DidSwitch = true;
+		TimelineInstant(
+			m_HostCtxt, "SwitchFrame", TimelineCategoryHost, "frame", m_TargetIdx);
 	}
 exit:
 	return hr;
@@ -821,6 +1464,8 @@ CAutoSwitchStackFrame::~CAutoSwitchStackFrame()
 					DEBUG_OUTPUT_ERROR,
 					ERR_FAILED_SET_SYM_SCOPE, hr);
 			}
+			TimelineInstant(
+				m_HostCtxt, "SwitchFrame", TimelineCategoryHost, "frame", m_PrevIdx);
 		}
 	}
 }
@@ -903,6 +1548,32 @@ CAutoSetOutputCallback::~CAutoSetOutputCallback()
 }
 
 
+//------------------------------------------------------------------------------
+// Function: hashWide
+//
+// Description:
+//
+//  FNV-1a hash of a wide string, ignoring case.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+static UINT64
+hashWide(
+	_In_z_ const WCHAR* str)
+{
+	UINT64 hash = 14695981039346656037ULL;
+	for (const WCHAR* p = str; *p; ++p)
+	{
+		hash ^= (WCHAR)towlower(*p);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 //------------------------------------------------------------------------------
 // Function: UtilFindScriptFile
 //
@@ -916,6 +1587,13 @@ CAutoSetOutputCallback::~CAutoSetOutputCallback()
 //
 // Notes:
 //
+//  Breakpoint-driven scripts run the same name over and over, and each
+//  search probes the file system once per script path element. Successful
+//  lookups are therefore cached for SCRIPT_PATH_CACHE_TTL_MS, keyed by name
+//  and current directory. Within that window a script that's been deleted,
+//  or newly shadowed by one earlier in the search order, isn't noticed.
+//  !scriptpath flushes the cache.
+//
 _Check_return_ HRESULT
 UtilFindScriptFile(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -924,6 +1602,27 @@ UtilFindScriptFile(
 	_In_ int cchFullPath)
 {
 	HRESULT hr = S_OK;
+	const LONGLONG statsStart = StatsBegin(hostCtxt);
+	const ULONGLONG now = GetTickCount64();
+	WCHAR curDir[MAX_PATH] = {};
+	UINT64 curDirHash = 0;
+	ScriptPathCacheEntry* entry = &hostCtxt->ScriptPathCache[
+		hashWide(scriptName) & (SCRIPT_PATH_CACHE_SIZE - 1)];
+
+	GetCurrentDirectory(_countof(curDir), curDir);
+	curDirHash = hashWide(curDir);
+
+	if (entry->Name[0] &&
+		now < entry->Expiry &&
+		entry->CurDirHash == curDirHash &&
+		!_wcsicmp(entry->Name, scriptName))
+	{
+		StatsCount(hostCtxt, StatsCounterScriptPathHits, 1);
+		hr = StringCchCopy(fullPath, cchFullPath, entry->FullPath);
+		goto exit;
+	}
+
+	StatsCount(hostCtxt, StatsCounterScriptPathMisses, 1);
 	
 	// First, initialize 'fullPath' with the input string.
 	//
@@ -960,11 +1659,47 @@ UtilFindScriptFile(
 		hr = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
 		goto exit;
 	}
+
+	// Names too long for the entry just aren't cached.
+	//
+	if (SUCCEEDED(StringCchCopy(STRING_AND_CCH(entry->Name), scriptName)) &&
+		SUCCEEDED(StringCchCopy(STRING_AND_CCH(entry->FullPath), fullPath)))
+	{
+		entry->CurDirHash = curDirHash;
+		entry->Expiry = now + SCRIPT_PATH_CACHE_TTL_MS;
+	}
+	else
+	{
+		entry->Name[0] = 0;
+	}
 	
 exit:
+	StatsEnd(hostCtxt, StatsTimerFindScript, statsStart);
 	return hr;
 }
 
+//------------------------------------------------------------------------------
+// Function: UtilFlushScriptPathCache
+//
+// Description:
+//
+//  Forget all resolved script paths.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+//  Called when the script path changes.
+//
+void
+UtilFlushScriptPathCache(
+	_In_ DbgScriptHostContext* hostCtxt)
+{
+	ZeroMemory(hostCtxt->ScriptPathCache, sizeof(hostCtxt->ScriptPathCache));
+}
+
 //------------------------------------------------------------------------------
 // Function: UtilCountStackFrameVariables
 //
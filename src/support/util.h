@@ -30,6 +30,15 @@
 //
 const int MAX_READ_STRING_LEN = 2048;
 
+// Minimum time between checks of the debugger's abort bit, in milliseconds.
+//
+const ULONG ABORT_CHECK_INTERVAL_MS = 10;
+
+// How long a resolved script path is trusted before the script path is
+// searched again, in milliseconds.
+//
+const ULONG SCRIPT_PATH_CACHE_TTL_MS = 5000;
+
 _Check_return_ HRESULT
 UtilReadPointer(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -54,12 +63,33 @@ UtilGetTypeSize(
 	_In_z_ const char* type,
 	_Out_ ULONG* size);
 
+_Check_return_ HRESULT
+UtilResolveEnum(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_z_ const char* type,
+	_In_ UINT64 value,
+	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf);
+
 _Check_return_ HRESULT
 UtilGetNearestSymbol(
 	_In_ DbgScriptHostContext* hostCtxt,
 	_In_ UINT64 addr,
 	_Out_writes_(MAX_SYMBOL_NAME_LEN) char* buf);
 
+typedef _Check_return_ HRESULT
+(*GetNearestSymbolsCb)(
+	_In_ ULONG idx,
+	_In_opt_z_ const char* name,
+	_In_opt_ void* ctxt);
+
+_Check_return_ HRESULT
+UtilGetNearestSymbols(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ ULONG count,
+	_In_reads_(count) const UINT64* addrs,
+	_In_ GetNearestSymbolsCb callback,
+	_In_opt_ void* userctxt);
+
 _Check_return_ HRESULT
 UtilReadWideString(
 	_In_ DbgScriptHostContext* hostCtxt,
@@ -84,10 +114,49 @@ UtilReadBytes(
 	_In_ ULONG cbCount,
 	_Out_ ULONG* cbActualLen);
 
+_Check_return_ const BYTE*
+UtilGetSpan(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 addr,
+	_In_ ULONG cb);
+
+_Check_return_ HRESULT
+UtilReadTypedData(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ const DEBUG_TYPED_DATA* typedData,
+	_Out_writes_bytes_to_(cbBuf, *cbActualLen) void* buf,
+	_In_ ULONG cbBuf,
+	_Out_ ULONG* cbActualLen);
+
+_Check_return_ HRESULT
+UtilSearchMemory(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_In_ UINT64 start,
+	_In_ UINT64 size,
+	_In_reads_bytes_(patternSize) const void* pattern,
+	_In_ ULONG patternSize,
+	_In_ ULONG patternGranularity,
+	_Out_ UINT64* matchAddr);
+
 _Check_return_ bool
 UtilCheckAbort(
 	_In_ DbgScriptHostContext* hostCtxt);
 
+// UtilAbortTimerCb - Called on a thread pool thread every
+// ABORT_CHECK_INTERVAL_MS while a script runs. Must only schedule an abort
+// check on the script's thread, not make it.
+//
+typedef void
+(*UtilAbortTimerCb)();
+
+_Check_return_ PTP_TIMER
+UtilStartAbortTimer(
+	_In_ UtilAbortTimerCb callback);
+
+void
+UtilStopAbortTimer(
+	_In_opt_ PTP_TIMER timer);
+
 _Check_return_ WCHAR*
 UtilConvertAnsiToWide(
 	_In_z_ const char* ansiStr);
@@ -118,6 +187,10 @@ UtilFindScriptFile(
 	_Out_writes_(cchFullPath) WCHAR* fullPath,
 	_In_ int cchFullPath);
 
+void
+UtilFlushScriptPathCache(
+	_In_ DbgScriptHostContext* hostCtxt);
+
 class CAutoSwitchStackFrame
 {
 public:
@@ -0,0 +1,124 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: wrapperpool.cpp
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Free lists for the memory of script wrapper objects.
+//
+// Notes:
+//
+//  Every field access, array element and stack frame a script touches gets a
+//  new wrapper, and in chained expressions (a.b.c) most are garbage right
+//  after one use. Providers that control where a wrapper's memory comes from
+//  (the Python and Ruby ones) take it from a pool per wrapper type, so the
+//  next wrapper reuses the last one's block instead of going to the heap.
+//
+//  Blocks come from the process heap, so they outlive the VM's own heap. Pools
+//  are drained when the VM stops.
+//
+//  Reuses and new allocations are counted in !dbgscriptstats as WrapperReuses
+//  and WrapperAllocs.
+//
+// @EndHeader@
+//******************************************************************************
+#include "wrapperpool.h"
+#include "stats.h"
+
+//------------------------------------------------------------------------------
+// Function: WrapperPoolAlloc
+//
+// Description:
+//
+//  Allocate a wrapper's block, reusing a freed one if possible.
+//
+// Parameters:
+//
+// Returns:
+//
+//  The block, zeroed, or nullptr if out of memory.
+//
+// Notes:
+//
+_Check_return_ void*
+WrapperPoolAlloc(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ WrapperPool* pool)
+{
+	void* block = pool->FreeList;
+
+	if (block)
+	{
+		pool->FreeList = *(void**)block;
+		--pool->FreeCount;
+		ZeroMemory(block, pool->BlockSize);
+		StatsCount(hostCtxt, StatsCounterWrapperReuses, 1);
+		return block;
+	}
+
+	StatsCount(hostCtxt, StatsCounterWrapperAllocs, 1);
+	return HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, pool->BlockSize);
+}
+
+//------------------------------------------------------------------------------
+// Function: WrapperPoolFree
+//
+// Description:
+//
+//  Free a block allocated by WrapperPoolAlloc.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+WrapperPoolFree(
+	_Inout_ WrapperPool* pool,
+	_In_opt_ void* block)
+{
+	if (!block)
+	{
+		return;
+	}
+
+	if (pool->FreeCount < WRAPPER_POOL_MAX_FREE)
+	{
+		*(void**)block = pool->FreeList;
+		pool->FreeList = block;
+		++pool->FreeCount;
+	}
+	else
+	{
+		HeapFree(GetProcessHeap(), 0, block);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: WrapperPoolDrain
+//
+// Description:
+//
+//  Return a pool's freed blocks to the heap.
+//
+// Parameters:
+//
+// Returns:
+//
+// Notes:
+//
+void
+WrapperPoolDrain(
+	_Inout_ WrapperPool* pool)
+{
+	while (pool->FreeList)
+	{
+		void* block = pool->FreeList;
+		pool->FreeList = *(void**)block;
+		HeapFree(GetProcessHeap(), 0, block);
+	}
+	pool->FreeCount = 0;
+}
@@ -0,0 +1,52 @@
+//******************************************************************************
+//  Copyright (c) Microsoft Corporation.
+//
+// @File: wrapperpool.h
+// @Author: alexbud
+//
+// Purpose:
+//
+//  Free lists for the memory of script wrapper objects.
+//
+// Notes:
+//
+// @EndHeader@
+//******************************************************************************
+#pragma once
+
+#include <windows.h>
+#include <hostcontext.h>
+
+// Most freed blocks a pool keeps. The rest go back to the heap.
+//
+const ULONG WRAPPER_POOL_MAX_FREE = 256;
+
+// WrapperPool - Freed blocks of one wrapper type (e.g. TypedObject). Embedded
+// in each provider's globals. Zero-initialize, then set 'BlockSize'.
+//
+struct WrapperPool
+{
+	// Size of the wrapper.
+	//
+	SIZE_T BlockSize;
+
+	// Freed blocks. The link is kept in the block itself.
+	//
+	void* FreeList;
+
+	ULONG FreeCount;
+};
+
+_Check_return_ void*
+WrapperPoolAlloc(
+	_In_ DbgScriptHostContext* hostCtxt,
+	_Inout_ WrapperPool* pool);
+
+void
+WrapperPoolFree(
+	_Inout_ WrapperPool* pool,
+	_In_opt_ void* block);
+
+void
+WrapperPoolDrain(
+	_Inout_ WrapperPool* pool);
@@ -0,0 +1,141 @@
+#include <windows.h>
+#include <strsafe.h>
+
+#define STRING_AND_CCH(x) x, _countof(x)
+
+const int NUM_NODES = 10000;
+const int NUM_SAMPLES = 4096;
+const int NUM_PARTICLES = 256;
+const int NUM_WORKERS = 1000;
+const int HAYSTACK_SIZE = 1024 * 1024;
+
+struct Vector
+{
+	int x, y, z;
+};
+
+struct Particle
+{
+	int id;
+	char name[32];
+	double mass;
+	Vector pos;
+	Vector vel;
+};
+
+struct Node
+{
+	int data;
+	Node* next;
+};
+
+static volatile LONG s_WorkersReady;
+
+void beforeReturn()
+{
+	// Dummy function to break on.
+	//
+}
+
+void workerWait(HANDLE stopEvent)
+{
+	// Function for stack triage to find.
+	//
+	InterlockedIncrement(&s_WorkersReady);
+	WaitForSingleObject(stopEvent, INFINITE);
+}
+
+DWORD WINAPI workerMain(LPVOID param)
+{
+	workerWait((HANDLE)param);
+	return 0;
+}
+
+void initParticle(Particle* p, int id)
+{
+	p->id = id;
+	StringCchPrintfA(STRING_AND_CCH(p->name), "particle-%d", id);
+	p->mass = 1.5;
+	p->pos.x = 1;
+	p->pos.y = 2;
+	p->pos.z = 3;
+	p->vel.x = -1;
+	p->vel.y = -2;
+	p->vel.z = -3;
+}
+
+int main()
+{
+	Particle particle;
+	Vector path[16];
+	Particle particles[NUM_PARTICLES];
+	int samples[NUM_SAMPLES];
+	Node* head = nullptr;
+	char* haystack = nullptr;
+	HANDLE stopEvent = nullptr;
+
+	initParticle(&particle, 42);
+
+	for (int i = 0; i < _countof(path); ++i)
+	{
+		path[i].x = i;
+		path[i].y = i * 2;
+		path[i].z = i * 3;
+	}
+
+	for (int i = 0; i < _countof(particles); ++i)
+	{
+		initParticle(&particles[i], i);
+	}
+
+	for (int i = 0; i < _countof(samples); ++i)
+	{
+		samples[i] = i % 100;
+	}
+
+	// Build the list back to front so it's in order.
+	//
+	for (int i = NUM_NODES - 1; i >= 0; --i)
+	{
+		Node* node = new Node;
+		node->data = i;
+		node->next = head;
+		head = node;
+	}
+
+	// A needle near the end of a large buffer.
+	//
+	haystack = new char[HAYSTACK_SIZE];
+	memset(haystack, 'a', HAYSTACK_SIZE);
+	memcpy(haystack + HAYSTACK_SIZE - 64, "NEEDLE-1234", 11);
+
+	// Park the workers in workerWait.
+	//
+	stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	for (int i = 0; i < NUM_WORKERS; ++i)
+	{
+		HANDLE thread = CreateThread(
+			nullptr,
+			64 * 1024,
+			workerMain,
+			stopEvent,
+			STACK_SIZE_PARAM_IS_A_RESERVATION,
+			nullptr);
+		if (!thread)
+		{
+			return 1;
+		}
+		CloseHandle(thread);
+	}
+
+	while (s_WorkersReady < NUM_WORKERS)
+	{
+		Sleep(10);
+	}
+
+	beforeReturn();
+
+	SetEvent(stopEvent);
+
+	return 0;
+}
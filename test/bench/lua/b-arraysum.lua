@@ -0,0 +1,16 @@
+require 'utils'
+
+-- Sum a 4096-element int array, element by element and in bulk.
+--
+local samples = getLocal('samples')
+local total = 0
+for _, s in pairs(samples) do
+  total = total + s.value
+end
+
+local bulk = 0
+for _, v in ipairs(samples:slice(0, 4096):values()) do
+  bulk = bulk + v
+end
+
+print(total, bulk)
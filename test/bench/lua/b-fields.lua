@@ -0,0 +1,15 @@
+require 'utils'
+
+-- 1000 field accesses.
+--
+local particle = getLocal('particle')
+local total = 0
+for _ = 1, 100 do
+  local pos = particle.pos
+  local vel = particle.vel
+  total = total + particle.id.value + math.floor(particle.mass.value) +
+    pos.x.value + pos.y.value + pos.z.value +
+    vel.x.value + vel.y.value + vel.z.value
+end
+
+print(total)
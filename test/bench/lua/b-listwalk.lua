@@ -0,0 +1,15 @@
+require 'utils'
+
+-- Walk a 10000-node linked list.
+--
+local node = getLocal('head')
+local count = 0
+local total = 0
+while node.value ~= 0 do
+  local n = node.deref
+  count = count + 1
+  total = total + n.data.value
+  node = n.next
+end
+
+print(count, total)
@@ -0,0 +1,8 @@
+require 'utils'
+
+-- Find a needle at the end of a 1MB buffer.
+--
+local haystack = getLocal('haystack').value
+local match = dbgscript.searchMemory(haystack, 1024 * 1024, 'NEEDLE-1234', 1)
+
+print(match - haystack)
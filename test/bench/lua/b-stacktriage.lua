@@ -0,0 +1,18 @@
+-- Find the threads parked in workerWait, out of 1000 workers.
+--
+local prefix = 'benchapp!workerWait'
+local parked = 0
+for _, t in ipairs(dbgscript.getThreads()) do
+  local offsets = {}
+  for _, f in ipairs(t:getStack()) do
+    offsets[#offsets + 1] = f.instructionOffset
+  end
+  for _, sym in ipairs(dbgscript.getNearestSyms(offsets)) do
+    if sym and sym:sub(1, #prefix) == prefix then
+      parked = parked + 1
+      break
+    end
+  end
+end
+
+print(parked)
@@ -0,0 +1,17 @@
+require 'utils'
+
+-- Format every field of 256 structs.
+--
+local particles = getLocal('particles')
+local count = 0
+local chars = 0
+for _, p in pairs(particles) do
+  local line = string.format('%d %s %.2f (%d %d %d) (%d %d %d)',
+    p.id.value, p:f('name'):readString(), p.mass.value,
+    p.pos.x.value, p.pos.y.value, p.pos.z.value,
+    p.vel.x.value, p.vel.y.value, p.vel.z.value)
+  count = count + 1
+  chars = chars + #line
+end
+
+print(count, chars)
@@ -0,0 +1,9 @@
+function getLocal(name)
+  local f = dbgscript.currentThread():currentFrame()
+  for _, v in ipairs(f:getLocals()) do
+    if v.name == name then
+      return v
+    end
+  end
+  return nil
+end
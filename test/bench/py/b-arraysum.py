@@ -0,0 +1,10 @@
+from utils import *
+
+# Sum a 4096-element int array, element by element and in bulk.
+#
+samples = get_local('samples')
+total = 0
+for s in samples:
+  total += s.value
+
+print(total, sum(samples[0:4096].values()))
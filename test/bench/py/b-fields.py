@@ -0,0 +1,14 @@
+from utils import *
+
+# 1000 field accesses.
+#
+particle = get_local('particle')
+total = 0
+for _ in range(100):
+  pos = particle.pos
+  vel = particle.vel
+  total += (particle.id.value + int(particle.mass.value) +
+    pos.x.value + pos.y.value + pos.z.value +
+    vel.x.value + vel.y.value + vel.z.value)
+
+print(total)
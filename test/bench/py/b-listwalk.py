@@ -0,0 +1,14 @@
+from utils import *
+
+# Walk a 10000-node linked list.
+#
+node = get_local('head')
+count = 0
+total = 0
+while node.value != 0:
+  n = node.deref
+  count += 1
+  total += n.data.value
+  node = n.next
+
+print(count, total)
@@ -0,0 +1,8 @@
+from utils import *
+
+# Find a needle at the end of a 1MB buffer.
+#
+haystack = get_local('haystack').value
+match = dbgscript.search_memory(haystack, 1024 * 1024, b'NEEDLE-1234', 1)
+
+print(match - haystack)
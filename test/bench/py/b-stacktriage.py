@@ -0,0 +1,11 @@
+import dbgscript
+
+# Find the threads parked in workerWait, out of 1000 workers.
+#
+parked = 0
+for t in dbgscript.get_threads():
+  syms = dbgscript.get_nearest_syms([f.instruction_offset for f in t.get_stack()])
+  if any(s and s.startswith('benchapp!workerWait') for s in syms):
+    parked += 1
+
+print(parked)
@@ -0,0 +1,13 @@
+from utils import *
+
+# Format every field of 256 structs.
+#
+particles = get_local('particles')
+lines = []
+for p in particles:
+  lines.append('{} {} {:.2f} ({} {} {}) ({} {} {})'.format(
+    p.id.value, p['name'].read_string(), p.mass.value,
+    p.pos.x.value, p.pos.y.value, p.pos.z.value,
+    p.vel.x.value, p.vel.y.value, p.vel.z.value))
+
+print(len(lines), sum(len(l) for l in lines))
@@ -0,0 +1,5 @@
+import dbgscript
+
+def get_local(name):
+  f = dbgscript.current_thread().current_frame
+  return next(t for t in f.get_locals() if t.name == name)
@@ -0,0 +1,9 @@
+require_relative 'utils'
+
+# Sum a 4096-element int array, element by element and in bulk.
+#
+samples = get_local('samples')
+total = 0
+samples.each {|s| total += s.value }
+
+puts "#{total} #{samples.slice(0, 4096).values.inject(0, :+)}"
@@ -0,0 +1,15 @@
+require_relative 'utils'
+
+# 1000 field accesses.
+#
+particle = get_local('particle')
+total = 0
+100.times do
+  pos = particle.pos
+  vel = particle.vel
+  total += particle.id.value + particle.mass.value.to_i +
+    pos.x.value + pos.y.value + pos.z.value +
+    vel.x.value + vel.y.value + vel.z.value
+end
+
+puts total
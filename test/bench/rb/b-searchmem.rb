@@ -0,0 +1,8 @@
+require_relative 'utils'
+
+# Find a needle at the end of a 1MB buffer.
+#
+haystack = get_local('haystack').value
+match = DbgScript.search_memory(haystack, 1024 * 1024, 'NEEDLE-1234', 1)
+
+puts match - haystack
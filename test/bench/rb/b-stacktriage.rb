@@ -0,0 +1,8 @@
+# Find the threads parked in workerWait, out of 1000 workers.
+#
+parked = DbgScript.get_threads.count do |t|
+  syms = DbgScript.get_nearest_syms(t.get_stack.map(&:instruction_offset))
+  syms.any? {|s| s && s.start_with?('benchapp!workerWait') }
+end
+
+puts parked
@@ -0,0 +1,13 @@
+require_relative 'utils'
+
+# Format every field of 256 structs.
+#
+particles = get_local('particles')
+lines = particles.map do |p|
+  '%d %s %.2f (%d %d %d) (%d %d %d)' % [
+    p.id.value, p['name'].read_string, p.mass.value,
+    p.pos.x.value, p.pos.y.value, p.pos.z.value,
+    p.vel.x.value, p.vel.y.value, p.vel.z.value]
+end
+
+puts "#{lines.length} #{lines.map(&:length).inject(0, :+)}"
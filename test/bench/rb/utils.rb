@@ -0,0 +1,4 @@
+def get_local(name)
+  f = DbgScript.current_thread.current_frame
+  f.get_locals.find {|t| t.name == name}
+end
@@ -0,0 +1,2 @@
+@echo off
+nmake /nologo /s %*
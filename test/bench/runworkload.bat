@@ -0,0 +1,15 @@
+@echo off
+
+set WORKLOAD=%1
+set DMPNAME=%2
+
+for %%l in (py:py rb:rb lua:lua) do (
+	for /f "tokens=1,2 delims=:" %%a in ("%%l") do (
+		REM Record, then replay, the workload against the dump.
+		REM
+		cdb -z %DMPNAME% -c "$$>a<runbench.txt %WORKLOAD% %%a %%b" > NUL
+
+		echo %WORKLOAD% %%a:
+		findstr /b /c:"Record:" /c:"Replay:" /c:"Memory:" results\%WORKLOAD%-%%a.txt
+	)
+)
@@ -17,6 +17,37 @@ struct Car
 	Wheel wheels[4];
 };
 
+struct Engine
+{
+	int cylinders;
+};
+
+// Where Engine lies within a Part depends on the most-derived type.
+//
+struct Part : virtual Engine
+{
+	int serial;
+};
+
+struct Motor : Part
+{
+	int spares[4];
+};
+
+// Has a vtable, so a Truck can be found from a Vehicle pointer.
+//
+struct Vehicle
+{
+	virtual ~Vehicle() {}
+
+	int doors;
+};
+
+struct Truck : Vehicle
+{
+	int axles;
+};
+
 void beforeReturn()
 {
 	// Dummy function to break on.
@@ -37,6 +68,28 @@ int main()
 	{
 		car.wheels[i].diameter = 6.4643f;
 	}
+
+	Part part;
+	part.cylinders = 4;
+	part.serial = 1;
+
+	Motor motor;
+	motor.cylinders = 8;
+	motor.serial = 2;
+	motor.spares[0] = 0;
+
+	Part* motorPart = &motor;
+	motorPart->serial = 3;
+
+	// Each element points somewhere else.
+	//
+	int* coords[2] = { &car.y, &car.x };
+
+	Truck truck;
+	truck.doors = 2;
+	truck.axles = 3;
+
+	Vehicle* vehicle = &truck;
 	
 	beforeReturn();
 	
@@ -0,0 +1,489 @@
+// Checks the minidump range table (src\support\dumpmap.cpp) on synthetic
+// minidumps built in memory, then against damaged copies of them.
+//
+// Usage: dumpmaptest
+//
+// Needs no debugger, target or dump file: DumpMapParse only looks at the
+// bytes it's given, and the reads are served from a map built around its
+// result.
+//
+#include <windows.h>
+#include <dbghelp.h>
+#include <stdio.h>
+#include <vector>
+#include "../src/support/dumpmap.h"
+
+// Stream layout of the synthetic dumps: header, a one-entry stream directory,
+// the memory list, then the contents of the ranges back to back.
+//
+const ULONG DIRECTORY_RVA = sizeof(MINIDUMP_HEADER);
+const ULONG LIST_RVA = DIRECTORY_RVA + sizeof(MINIDUMP_DIRECTORY);
+
+// DumpMapSearch's answer when there's no match (STATUS_NO_MORE_ENTRIES).
+//
+const HRESULT NOT_FOUND = HRESULT_FROM_NT(0x8000001A);
+
+const int RANDOM_DAMAGE_ROUNDS = 500;
+
+// TestRange - A range of memory to capture in a synthetic dump. Its contents
+// are 'Size' copies of 'Fill'.
+//
+struct TestRange
+{
+	UINT64 Start;
+	ULONG Size;
+	BYTE Fill;
+};
+
+//------------------------------------------------------------------------------
+// Function: makeDump
+//
+// Description:
+//
+//  Build a minidump capturing 'ranges', in a MemoryListStream or, if
+//  'memory64', a Memory64ListStream.
+//
+// Notes:
+//
+//  Contents are laid out in the order given, so ranges next to each other in
+//  'ranges' are also next to each other in the file.
+//
+static std::vector<BYTE>
+makeDump(
+	_In_reads_(count) const TestRange* ranges,
+	_In_ ULONG count,
+	_In_ bool memory64)
+{
+	const ULONG listSize = memory64 ?
+		FIELD_OFFSET(MINIDUMP_MEMORY64_LIST, MemoryRanges) + count * (ULONG)sizeof(MINIDUMP_MEMORY_DESCRIPTOR64) :
+		FIELD_OFFSET(MINIDUMP_MEMORY_LIST, MemoryRanges) + count * (ULONG)sizeof(MINIDUMP_MEMORY_DESCRIPTOR);
+	ULONG rva = LIST_RVA + listSize;
+	std::vector<BYTE> file(rva);
+
+	MINIDUMP_HEADER* header = (MINIDUMP_HEADER*)&file[0];
+	header->Signature = MINIDUMP_SIGNATURE;
+	header->Version = MINIDUMP_VERSION;
+	header->NumberOfStreams = 1;
+	header->StreamDirectoryRva = DIRECTORY_RVA;
+
+	MINIDUMP_DIRECTORY* dir = (MINIDUMP_DIRECTORY*)&file[DIRECTORY_RVA];
+	dir->StreamType = memory64 ? Memory64ListStream : MemoryListStream;
+	dir->Location.DataSize = listSize;
+	dir->Location.Rva = LIST_RVA;
+
+	if (memory64)
+	{
+		MINIDUMP_MEMORY64_LIST* list = (MINIDUMP_MEMORY64_LIST*)&file[LIST_RVA];
+		list->NumberOfMemoryRanges = count;
+		list->BaseRva = rva;
+		for (ULONG i = 0; i < count; ++i)
+		{
+			list->MemoryRanges[i].StartOfMemoryRange = ranges[i].Start;
+			list->MemoryRanges[i].DataSize = ranges[i].Size;
+		}
+	}
+	else
+	{
+		MINIDUMP_MEMORY_LIST* list = (MINIDUMP_MEMORY_LIST*)&file[LIST_RVA];
+		list->NumberOfMemoryRanges = count;
+		for (ULONG i = 0; i < count; ++i)
+		{
+			list->MemoryRanges[i].StartOfMemoryRange = ranges[i].Start;
+			list->MemoryRanges[i].Memory.DataSize = ranges[i].Size;
+			list->MemoryRanges[i].Memory.Rva = rva;
+			rva += ranges[i].Size;
+		}
+	}
+
+	for (ULONG i = 0; i < count; ++i)
+	{
+		file.insert(file.end(), ranges[i].Size, ranges[i].Fill);
+	}
+
+	return file;
+}
+
+//------------------------------------------------------------------------------
+// Function: memoryList
+//
+// Description:
+//
+//  The memory list stream of a dump made by makeDump.
+//
+template <typename T>
+static T*
+memoryList(
+	_Inout_ std::vector<BYTE>* file)
+{
+	return (T*)&(*file)[LIST_RVA];
+}
+
+// TestMap - A dump parsed into a map that reads can be served from.
+//
+struct TestMap
+{
+	TestMap() :
+		Hr(E_FAIL)
+	{
+		memset(&Map, 0, sizeof(Map));
+	}
+
+	~TestMap()
+	{
+		delete[] Map.Ranges;
+	}
+
+	HRESULT Hr;
+	DumpMemoryMap Map;
+
+	// Copy of the dump, so that reading past its end is caught by the heap
+	// checks.
+	//
+	std::vector<BYTE> File;
+};
+
+//------------------------------------------------------------------------------
+// Function: parse
+//
+// Description:
+//
+//  Parse a dump into 'map'.
+//
+static void
+parse(
+	_In_ const std::vector<BYTE>& file,
+	_Out_ TestMap* map)
+{
+	map->File = file;
+	map->Map.View = map->File.empty() ? nullptr : &map->File[0];
+	map->Map.ViewSize = map->File.size();
+	map->Map.Is64Bit = true;
+	map->Hr = DumpMapParse(
+		map->Map.View,
+		map->Map.ViewSize,
+		&map->Map.Ranges,
+		&map->Map.RangeCount);
+}
+
+//------------------------------------------------------------------------------
+// Function: readsAs
+//
+// Description:
+//
+//  Check that [addr, addr + cb) reads back as 'expected' through DumpMapRead,
+//  or isn't captured if 'expected' is null.
+//
+static bool
+readsAs(
+	_In_ const TestMap* map,
+	_In_ UINT64 addr,
+	_In_ ULONG cb,
+	_In_opt_z_ const char* expected)
+{
+	std::vector<char> buf(cb + 1);
+
+	if (!DumpMapRead(&map->Map, addr, &buf[0], cb))
+	{
+		return !expected;
+	}
+
+	return expected && !memcmp(&buf[0], expected, cb);
+}
+
+//------------------------------------------------------------------------------
+// Function: spansAs
+//
+// Description:
+//
+//  Same as readsAs, through DumpMapGetSpan.
+//
+static bool
+spansAs(
+	_In_ const TestMap* map,
+	_In_ UINT64 addr,
+	_In_ ULONG cb,
+	_In_opt_z_ const char* expected)
+{
+	const BYTE* span = DumpMapGetSpan(&map->Map, addr, cb);
+	if (!span)
+	{
+		return !expected;
+	}
+
+	return expected && !memcmp(span, expected, cb);
+}
+
+//------------------------------------------------------------------------------
+// Function: report
+//
+// Description:
+//
+//  Print the verdict on one check.
+//
+static void
+report(
+	_In_z_ const char* what,
+	_In_ bool ok)
+{
+	printf("%s: %s\n", what, ok ? "ok" : "FAILED");
+}
+
+//------------------------------------------------------------------------------
+// Function: checkLayouts
+//
+// Description:
+//
+//  Well-formed dumps: the range table is sorted, adjacent ranges are merged
+//  only when they're also adjacent in the file, and overlaps keep the
+//  contents of the range that starts first.
+//
+static void
+checkLayouts()
+{
+	{
+		// Listed out of order, and adjacent in memory but not in the file.
+		//
+		const TestRange ranges[] =
+		{
+			{ 0x2000, 0x10, 'b' },
+			{ 0x1ff0, 0x10, 'a' },
+		};
+		TestMap map;
+		parse(makeDump(ranges, _countof(ranges), false), &map);
+
+		report(
+			"memory list",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 2 &&
+			map.Map.Ranges[0].Start == 0x1ff0 &&
+			map.Map.Ranges[1].Start == 0x2000);
+		report(
+			"read across ranges",
+			readsAs(&map, 0x1ffe, 4, "aabb"));
+		report(
+			"span across ranges",
+			spansAs(&map, 0x1ffe, 4, nullptr));
+		report(
+			"span within a range",
+			spansAs(&map, 0x2004, 4, "bbbb"));
+		report(
+			"read before the first range",
+			readsAs(&map, 0x1fef, 2, nullptr));
+		report(
+			"read past the last range",
+			readsAs(&map, 0x200f, 2, nullptr) &&
+			readsAs(&map, 0x2010, 1, nullptr) &&
+			spansAs(&map, 0x200f, 2, nullptr));
+	}
+
+	{
+		// Back to back in memory and in the file: one range.
+		//
+		const TestRange ranges[] =
+		{
+			{ 0x7ffe0000, 0x1000, 'x' },
+			{ 0x7ffe1000, 0x1000, 'y' },
+			{ 0x7ffe3000, 0x1000, 'z' },
+		};
+		TestMap map;
+		parse(makeDump(ranges, _countof(ranges), true), &map);
+
+		report(
+			"memory64 list",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 2 &&
+			map.Map.Ranges[0].Start == 0x7ffe0000 &&
+			map.Map.Ranges[0].End == 0x7ffe2000 &&
+			map.Map.Ranges[1].Start == 0x7ffe3000);
+		report(
+			"span across merged ranges",
+			spansAs(&map, 0x7ffe0ffe, 4, "xxyy"));
+		report(
+			"read across a gap",
+			readsAs(&map, 0x7ffe1ffe, 4, nullptr));
+
+		UINT64 match = 0;
+		report(
+			"search within a range",
+			DumpMapSearch(&map.Map, 0x7ffe0000, 0x2000, "y", 1, 1, &match) == S_OK &&
+			match == 0x7ffe1000);
+		report(
+			"search across a gap",
+			DumpMapSearch(&map.Map, 0x7ffe0000, 0x4000, "z", 1, 1, &match) == S_FALSE);
+		report(
+			"search that finds nothing",
+			DumpMapSearch(&map.Map, 0x7ffe3000, 0x1000, "x", 1, 1, &match) == NOT_FOUND);
+	}
+
+	{
+		const TestRange ranges[] =
+		{
+			{ 0x1000, 0x10, 'a' },
+			{ 0x1008, 0x10, 'b' },
+			{ 0x1002, 0x4, 'c' },
+			{ 0x1000, 0x4, 'd' },
+		};
+		TestMap map;
+		parse(makeDump(ranges, _countof(ranges), false), &map);
+
+		report(
+			"overlapping ranges",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 2 &&
+			readsAs(&map, 0x1000, 0x18, "aaaaaaaaaaaaaaaabbbbbbbb"));
+	}
+
+	{
+		TestMap map;
+		parse(makeDump(nullptr, 0, false), &map);
+
+		report(
+			"no ranges",
+			SUCCEEDED(map.Hr) &&
+			map.Map.Ranges &&
+			!map.Map.RangeCount &&
+			readsAs(&map, 0, 1, nullptr) &&
+			spansAs(&map, 0, 1, nullptr));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: checkCorrupt
+//
+// Description:
+//
+//  Damage to the header and stream directory must be rejected. Damaged
+//  ranges are dropped, leaving the rest of the dump usable.
+//
+static void
+checkCorrupt()
+{
+	const TestRange ranges[] =
+	{
+		{ 0x1000, 0x10, 'a' },
+		{ 0x3000, 0x10, 'b' },
+	};
+	const std::vector<BYTE> intact = makeDump(ranges, _countof(ranges), false);
+	const std::vector<BYTE> intact64 = makeDump(ranges, _countof(ranges), true);
+
+	{
+		TestMap map;
+		parse(std::vector<BYTE>(intact.begin(), intact.begin() + sizeof(MINIDUMP_HEADER) - 1), &map);
+		report("truncated header", map.Hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		((MINIDUMP_HEADER*)&file[0])->Signature = 0;
+		TestMap map;
+		parse(file, &map);
+		report("bad signature", map.Hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		((MINIDUMP_HEADER*)&file[0])->NumberOfStreams = 0xffffffff;
+		TestMap map;
+		parse(file, &map);
+		report("directory past the end", map.Hr == HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		((MINIDUMP_DIRECTORY*)&file[DIRECTORY_RVA])->Location.Rva = (ULONG)file.size();
+		TestMap map;
+		parse(file, &map);
+		report("memory list past the end", SUCCEEDED(map.Hr) && !map.Map.RangeCount);
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		memoryList<MINIDUMP_MEMORY_LIST>(&file)->NumberOfMemoryRanges = 0xffffffff;
+		TestMap map;
+		parse(file, &map);
+		report("range count past the stream", SUCCEEDED(map.Hr) && map.Map.RangeCount == 2);
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		memoryList<MINIDUMP_MEMORY_LIST>(&file)->MemoryRanges[0].Memory.Rva = (ULONG)file.size() - 8;
+		TestMap map;
+		parse(file, &map);
+		report(
+			"range contents past the end",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 1 &&
+			readsAs(&map, 0x3000, 0x10, "bbbbbbbbbbbbbbbb"));
+	}
+
+	{
+		std::vector<BYTE> file(intact);
+		memoryList<MINIDUMP_MEMORY_LIST>(&file)->MemoryRanges[1].StartOfMemoryRange = 0xfffffffffffffff8;
+		TestMap map;
+		parse(file, &map);
+		report(
+			"range wraps around the address space",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 1 &&
+			readsAs(&map, 0x1000, 0x10, "aaaaaaaaaaaaaaaa"));
+	}
+
+	{
+		std::vector<BYTE> file(intact64);
+		memoryList<MINIDUMP_MEMORY64_LIST>(&file)->MemoryRanges[0].DataSize = 0xfffffffffffffff0;
+		TestMap map;
+		parse(file, &map);
+		report("memory64 offsets wrap around", SUCCEEDED(map.Hr) && !map.Map.RangeCount);
+	}
+
+	{
+		std::vector<BYTE> file(intact64);
+		memoryList<MINIDUMP_MEMORY64_LIST>(&file)->MemoryRanges[1].DataSize = 0x11;
+		TestMap map;
+		parse(file, &map);
+		report(
+			"memory64 contents past the end",
+			SUCCEEDED(map.Hr) &&
+			map.Map.RangeCount == 1 &&
+			readsAs(&map, 0x1000, 0x10, "aaaaaaaaaaaaaaaa"));
+	}
+
+	{
+		// Whatever the damage, parsing and reading must come back. Fixed
+		// seed, so every run damages the same bytes.
+		//
+		ULONG seed = 0x5eed;
+
+		auto next = [&seed]() -> ULONG
+		{
+			seed = seed * 1103515245 + 12345;
+			return seed >> 8;
+		};
+
+		for (int round = 0; round < RANDOM_DAMAGE_ROUNDS; ++round)
+		{
+			std::vector<BYTE> file(round % 2 ? intact64 : intact);
+			for (ULONG i = 1 + next() % 8; i; --i)
+			{
+				file[next() % file.size()] ^= (BYTE)(1 + next() % 255);
+			}
+
+			TestMap map;
+			parse(file, &map);
+			if (SUCCEEDED(map.Hr))
+			{
+				(void)readsAs(&map, 0x1000, 0x2010, nullptr);
+			}
+		}
+
+		printf("random damage: survived\n");
+	}
+}
+
+int
+main()
+{
+	checkLayouts();
+	checkCorrupt();
+	return 0;
+}
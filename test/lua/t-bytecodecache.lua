@@ -0,0 +1,5 @@
+require 'utils'
+
+-- Cached chunks keep their debug info.
+--
+print(debug.getinfo(1, 'l').currentline, type(table.find))
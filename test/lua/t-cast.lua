@@ -0,0 +1,26 @@
+require 'utils'
+
+local car = getCar()
+local carType = car.module .. '!Car'
+
+-- CONTAINING_RECORD from the address of a field.
+--
+local c = dbgscript.containerOf(car.wheels.address, carType, 'wheels')
+print(c.address == car.address)
+print(c.y.value)
+
+-- Reinterpret an array's memory as its first element.
+--
+local w = car.wheels:cast(car.module .. '!Wheel')
+print(string.format('%.2f', w.diameter.value))
+
+-- Step between objects of the same type.
+--
+print(w:offset(3).address - w.address)
+print(car.wheels[3]:offset(-3).address == w.address)
+
+-- Pointer arithmetic.
+--
+local p = dbgscript.createTypedPointer('kernelbase!char', car:f('name').address)
+print(p:offset(4).value - p:offset(1).value)
+print(p:offset(3)[0].value)
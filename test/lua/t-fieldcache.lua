@@ -0,0 +1,30 @@
+require 'utils'
+
+local car = getCar()
+
+-- The same field of several objects of one type. Only the first access goes
+-- to the debugger engine; the rest are computed from the type's layout.
+--
+for i = 0, 3 do
+  local w = car.wheels[i]
+  print(string.format('%d %.2f', w.diameter.address - w.address, w.diameter.value))
+end
+
+-- Different fields of the same object.
+--
+print(car.x.value .. ' ' .. car.y.value)
+print(car.y.address - car.x.address)
+
+-- Properties of TypedObject itself still take precedence over fields.
+--
+print(car.address == car.x.address)
+
+-- Members of a virtual base aren't at the same offset in every object of a
+-- type: 'motorPart' is a Part within a Motor.
+--
+local locals = dbgscript.currentThread():currentFrame():getLocals()
+local part = table.find(locals, function (e) return e.name == 'part' end)
+local motorPart = table.find(locals, function (e) return e.name == 'motorPart' end)[0]
+for _ = 1, 2 do
+  print(part.cylinders.value .. ' ' .. motorPart.cylinders.value)
+end
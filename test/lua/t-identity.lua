@@ -0,0 +1,52 @@
+require 'utils'
+
+local car = getCar()
+
+-- Two accesses to the same field are equal.
+--
+local a = car.wheels[0]
+local b = car.wheels[0]
+print(a == b)
+
+-- While a TypedObject is alive, accessing the same field returns it.
+--
+print(rawequal(car.x, car.x))
+
+-- Different objects, and the same address seen as a different type, are not.
+--
+print(car.wheels[0] == car.wheels[1])
+print(car.x == car.y)
+print(car.wheels[0] == car.wheels[0].diameter)
+
+-- Offsets of one pointer don't live in memory, and are told apart by value.
+--
+local p = dbgscript.createTypedPointer(car.module .. '!Wheel', car:f('wheels').address)
+local q1 = p:offset(1)
+local q2 = p:offset(2)
+print(q1 == q2)
+print(q1 == p:offset(1))
+print(q2[0].address - q1[0].address)
+
+-- So a field can be used as a table key.
+--
+local names = {}
+names[car.x] = 'x'
+names[car.y] = 'y'
+print(names[car.x] .. ' ' .. names[car.y])
+
+-- However an object is reached, the live TypedObject for it is returned.
+--
+local w0 = car.wheels[0]
+local w1 = car.wheels[1]
+local first = nil
+for _, w in pairs(car.wheels) do
+  first = w
+  break
+end
+print(rawequal(first, w0), rawequal(car.wheels:slice(0, 2)[1], w1), rawequal(w0:offset(1), w1))
+
+local vehicle = table.find(
+  dbgscript.currentThread():currentFrame():getLocals(),
+  function (e) return e.name == 'vehicle' end)
+local truck = vehicle:getRuntimeObject()
+print(rawequal(vehicle:getRuntimeObject(), truck), rawequal(dbgscript.getRuntimeObjects({vehicle})[1], truck))
@@ -0,0 +1,29 @@
+require 'utils'
+
+local car = getCar()
+
+-- Iterate over an array of structs.
+--
+for i, wheel in pairs(car.wheels) do
+  print(string.format('%d %.2f', i, wheel.diameter.value))
+end
+
+-- Iterate over an array of primitives. Stop at the terminator since the rest
+-- of the buffer is uninitialized.
+--
+local chars = {}
+for _, c in pairs(car:f('name')) do
+  if c.value == '\0' then
+    break
+  end
+  chars[#chars + 1] = c.value
+end
+print(table.concat(chars))
+
+-- Only arrays can be iterated.
+-- Can't print 'err' because it contains full path of script.
+--
+local status, err = pcall(function()
+  pairs(car)
+end)
+print(status)
@@ -0,0 +1,4 @@
+require 'utils'
+
+local car = getCar()
+print(car.x.value, car.y.value)
@@ -0,0 +1,13 @@
+-- The dump is taken in main, just after the call to beforeReturn.
+--
+local pc = dbgscript.currentThread():getStack()[1].instructionOffset
+
+-- Batch lookups agree with single ones, whatever the order and repeats.
+--
+local syms = dbgscript.getNearestSyms({pc, 0, pc})
+print((syms[1]:gsub('%+.*', '')))
+print(syms[1] == syms[3] and syms[1] == dbgscript.getNearestSym(pc))
+
+-- Addresses outside any module have no symbol.
+--
+print(syms[2] == false)
@@ -0,0 +1,9 @@
+local function totalSize(n)
+  local total = 0
+  for i = 1, n do
+    total = total + dbgscript.getTypeSize('nt!GUID')
+  end
+  return total
+end
+
+print(totalSize(1000))
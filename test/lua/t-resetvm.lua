@@ -0,0 +1,2 @@
+print(arg[1], counter)
+counter = 1
@@ -0,0 +1,8 @@
+require 'utils'
+
+local car = getCar()
+
+-- Car has no vtable, so there is no runtime type to find.
+--
+local objs = dbgscript.getRuntimeObjects({car, car.wheels[0]})
+print(#objs, objs[1], objs[2])
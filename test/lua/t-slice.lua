@@ -0,0 +1,34 @@
+require 'utils'
+
+local car = getCar()
+
+-- Slices are views; nothing is read until asked.
+--
+local name = car:f('name'):slice(0, 6)
+print(table.concat(name:values()))
+print(table.concat(name:slice(1, 3):values()))
+print(table.concat(car:f('name'):slice(0, 6, 2):values()))
+
+print(#car.wheels:slice(1, 4))
+print(#car.wheels:slice(0, 4, 2))
+print(string.format('%.2f', car.wheels:slice(1, 4)[2].diameter.value))
+
+for i, wheel in pairs(car.wheels:slice(2, 4)) do
+  print(string.format('%d %.2f', i, wheel.diameter.value))
+end
+
+-- Each pointer in a slice points where it does, not where element zero does.
+--
+local coords = table.find(
+  dbgscript.currentThread():currentFrame():getLocals(),
+  function (e) return e.name == 'coords' end)
+print(coords:slice(0, 2)[0].deref.value, coords:slice(0, 2)[1].deref.value)
+print(coords:slice(1, 2)[0].deref.value)
+
+-- Only slices of primitives have values.
+-- Can't print 'err' because it contains full path of script.
+--
+local status, err = pcall(function()
+  car.wheels:slice(0, 2):values()
+end)
+print(status)
@@ -0,0 +1,6 @@
+dbgscript.getTypeSize('nt!GUID')
+dbgscript.getTypeSize('nt!GUID')
+s = dbgscript.stats()
+print(s == nil)
+print(s['api.dbgscript_getTypeSize'])
+print(s['memory.peak_working_set_kb'] ~= nil)
@@ -0,0 +1,4 @@
+print(dbgscript.traceSpan('outer', function (t)
+  return dbgscript.traceSpan('inner', dbgscript.getTypeSize, t)
+end, 'nt!GUID'))
+print(pcall(dbgscript.traceSpan, 'failing', error, 'boom', 0))
@@ -0,0 +1,18 @@
+require 'utils'
+
+local car = getCar()
+
+-- Churn through short-lived tables, strings and wrappers, so the arena both
+-- grows and takes back freed blocks.
+--
+local kept = {}
+for i = 1, 10000 do
+  kept[i % 100 + 1] = { i, tostring(i), car.x.value }
+end
+collectgarbage()
+
+local total = 0
+for _, t in ipairs(kept) do
+  total = total + t[3]
+end
+print(#kept, total)
@@ -0,0 +1,30 @@
+require 'utils'
+
+local car = getCar()
+
+-- Each access makes a wrapper that the GC frees. Collect every so often so
+-- later wrappers reuse the arena's freed blocks.
+--
+local total = 0
+for i = 0, 1999 do
+  total = total + car.x.value + car.y.value
+  if i % 100 == 99 then
+    collectgarbage()
+  end
+end
+
+-- So does each offset of a pointer, none of which is the same object.
+--
+local p = dbgscript.createTypedPointer(car.module .. '!Wheel', car:f('wheels').address)
+local offsets = 0
+for i = 0, 2999 do
+  if p:offset(i).value == p.value + i * 4 then
+    offsets = offsets + 1
+  end
+  if i % 500 == 499 then
+    collectgarbage()
+  end
+end
+print(total, offsets)
+
+print(dbgscript.stats()['WrapperReuses'] > 0)
@@ -0,0 +1,783 @@
+// Checks the direct PDB reader (src\support\pdbreader.cpp) against DbgEng's
+// symbol engine, then against damaged copies of the same PDB.
+//
+// Usage: pdbreadertest <dump> <pdb>
+//
+// Only whether the answers agree is printed, never the answers themselves, so
+// the expected output doesn't depend on the compiler's choice of layout.
+//
+#include <windows.h>
+#include <dbgeng.h>
+#include <stdio.h>
+#include <vector>
+#include "../src/support/pdbreader.h"
+
+// Pseudo stream numbers for 'patch': raw file offsets, and the stream
+// directory.
+//
+const ULONG RAW_FILE = 0xffffffff;
+const ULONG STREAM_DIRECTORY = 0xfffffffe;
+
+const ULONG PDB_STREAM_TPI = 2;
+
+// Superblock fields.
+//
+const ULONG MSF_BLOCK_SIZE = 32;
+const ULONG MSF_NUM_DIRECTORY_BYTES = 44;
+const ULONG MSF_BLOCK_MAP_ADDR = 52;
+const ULONG MSF_SUPERBLOCK_SIZE = 56;
+
+// TPI stream header fields.
+//
+const ULONG TPI_HEADER_SIZE = 4;
+const ULONG TPI_TYPE_INDEX_BEGIN = 8;
+const ULONG TPI_TYPE_RECORD_BYTES = 16;
+
+const USHORT LF_BCLASS = 0x1400;
+const USHORT LF_INDEX = 0x1404;
+const USHORT LF_STRUCTURE = 0x1505;
+const BYTE LF_PAD1 = 0xf1;
+const USHORT CV_PROP_FWDREF = 0x0080;
+
+const int RANDOM_DAMAGE_ROUNDS = 500;
+
+// Lookup - A question both DbgEng and the reader can answer: the size of
+// 'Type' if 'Field' is null, else the offset of 'Field' within it.
+//
+struct Lookup
+{
+	const char* Type;
+	const char* Field;
+};
+
+static const Lookup s_Lookups[] =
+{
+	{ "Car", nullptr },
+	{ "Car", "x" },
+	{ "Car", "y" },
+	{ "Car", "name" },
+	{ "Car", "wide_name" },
+	{ "Car", "wheels" },
+	{ "Wheel", nullptr },
+	{ "Wheel", "diameter" },
+	{ "Engine", nullptr },
+	{ "Engine", "cylinders" },
+	{ "Part", nullptr },
+	{ "Part", "serial" },
+	{ "Motor", nullptr },
+	{ "Motor", "serial" },
+	{ "Motor", "spares" },
+
+	// Lives in a virtual base, so the reader must decline.
+	//
+	{ "Part", "cylinders" },
+};
+
+const size_t NUM_LOOKUPS = _countof(s_Lookups);
+
+// Answer - Outcome of a lookup.
+//
+struct Answer
+{
+	HRESULT Hr;
+	ULONG Value;
+};
+
+// FieldListInfo - Where Car's field list lives in the TPI stream.
+//
+struct FieldListInfo
+{
+	// Type index of Car's definition.
+	//
+	ULONG CarTi;
+
+	// Type index of its field list.
+	//
+	ULONG ListTi;
+
+	// Position of the field list's members within the TPI stream, and their
+	// size in bytes.
+	//
+	ULONG BodyPos;
+	ULONG BodySize;
+};
+
+//------------------------------------------------------------------------------
+// Function: askPdb
+//
+// Description:
+//
+//  Answer every lookup from a parsed PDB.
+//
+static void
+askPdb(
+	_In_ const PdbFile* pdb,
+	_Out_writes_(NUM_LOOKUPS) Answer* answers)
+{
+	for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+	{
+		const Lookup& q = s_Lookups[i];
+		answers[i].Value = 0;
+		answers[i].Hr = q.Field ?
+			PdbGetFieldOffset(pdb, q.Type, q.Field, &answers[i].Value) :
+			PdbGetTypeSize(pdb, q.Type, &answers[i].Value);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: askDbgEng
+//
+// Description:
+//
+//  Answer every lookup through DbgEng's symbol engine.
+//
+static void
+askDbgEng(
+	_In_ IDebugSymbols* symbols,
+	_Out_writes_(NUM_LOOKUPS) Answer* answers)
+{
+	for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+	{
+		const Lookup& q = s_Lookups[i];
+		char qualifiedName[256];
+		ULONG typeId = 0;
+		UINT64 modBase = 0;
+
+		sprintf_s(qualifiedName, "dummy!%s", q.Type);
+
+		answers[i].Value = 0;
+		answers[i].Hr = symbols->GetSymbolTypeId(qualifiedName, &typeId, &modBase);
+		if (FAILED(answers[i].Hr))
+		{
+			continue;
+		}
+
+		answers[i].Hr = q.Field ?
+			symbols->GetFieldOffset(modBase, typeId, q.Field, &answers[i].Value) :
+			symbols->GetTypeSize(modBase, typeId, &answers[i].Value);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: sameAnswers
+//
+// Description:
+//
+//  Does a damaged PDB answer exactly as the intact one did?
+//
+static bool
+sameAnswers(
+	_In_reads_(NUM_LOOKUPS) const Answer* a,
+	_In_reads_(NUM_LOOKUPS) const Answer* b)
+{
+	for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+	{
+		if (SUCCEEDED(a[i].Hr) != SUCCEEDED(b[i].Hr) ||
+			(SUCCEEDED(a[i].Hr) && a[i].Value != b[i].Value))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: readFile
+//
+// Description:
+//
+//  Read a whole file into memory.
+//
+static bool
+readFile(
+	_In_z_ const char* path,
+	_Out_ std::vector<BYTE>* contents)
+{
+	FILE* f = nullptr;
+	BYTE buf[4096];
+	size_t cb = 0;
+	bool ok = false;
+
+	contents->clear();
+
+	if (fopen_s(&f, path, "rb"))
+	{
+		return false;
+	}
+
+	while ((cb = fread(buf, 1, sizeof(buf), f)) > 0)
+	{
+		contents->insert(contents->end(), buf, buf + cb);
+	}
+
+	ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Function: fileOffset
+//
+// Description:
+//
+//  Offset within the file of byte 'pos' of a stream.
+//
+// Notes:
+//
+//  Trusts the file to be intact: it's only used to aim the damage.
+//
+static size_t
+fileOffset(
+	_In_ const std::vector<BYTE>& file,
+	_In_ ULONG stream,
+	_In_ ULONG pos)
+{
+	if (stream == RAW_FILE)
+	{
+		return pos;
+	}
+
+	ULONG blockSize = 0;
+	ULONG blockMapAddr = 0;
+	memcpy(&blockSize, &file[MSF_BLOCK_SIZE], sizeof(blockSize));
+	memcpy(&blockMapAddr, &file[MSF_BLOCK_MAP_ADDR], sizeof(blockMapAddr));
+
+	// The block map lists the directory's blocks. The directory holds the
+	// stream count, the size of each stream, then each stream's block list.
+	//
+	auto dirOffset = [&](ULONG n) -> size_t
+	{
+		ULONG block = 0;
+		memcpy(
+			&block,
+			&file[(size_t)blockMapAddr * blockSize + n / blockSize * sizeof(ULONG)],
+			sizeof(block));
+		return (size_t)block * blockSize + n % blockSize;
+	};
+
+	auto dirU32 = [&](ULONG n) -> ULONG
+	{
+		ULONG v = 0;
+		for (ULONG i = 0; i < sizeof(v); ++i)
+		{
+			((BYTE*)&v)[i] = file[dirOffset(n + i)];
+		}
+		return v;
+	};
+
+	if (stream == STREAM_DIRECTORY)
+	{
+		return dirOffset(pos);
+	}
+
+	ULONG listPos = (dirU32(0) + 1) * (ULONG)sizeof(ULONG);
+	for (ULONG i = 0; i < stream; ++i)
+	{
+		ULONG size = dirU32((i + 1) * sizeof(ULONG));
+		if (size == 0xffffffff)
+		{
+			// Nil stream.
+			//
+			size = 0;
+		}
+		listPos += (size + blockSize - 1) / blockSize * (ULONG)sizeof(ULONG);
+	}
+
+	const ULONG block = dirU32(listPos + pos / blockSize * (ULONG)sizeof(ULONG));
+	return (size_t)block * blockSize + pos % blockSize;
+}
+
+//------------------------------------------------------------------------------
+// Function: patch
+//
+// Description:
+//
+//  Overwrite bytes of a stream.
+//
+static void
+patch(
+	_Inout_ std::vector<BYTE>* file,
+	_In_ ULONG stream,
+	_In_ ULONG pos,
+	_In_reads_bytes_(cb) const void* data,
+	_In_ ULONG cb)
+{
+	// Map every byte before writing any, in case we're damaging the map.
+	//
+	std::vector<size_t> offsets(cb);
+	for (ULONG i = 0; i < cb; ++i)
+	{
+		offsets[i] = fileOffset(*file, stream, pos + i);
+	}
+
+	for (ULONG i = 0; i < cb; ++i)
+	{
+		(*file)[offsets[i]] = ((const BYTE*)data)[i];
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: readStream
+//
+// Description:
+//
+//  Read bytes out of a stream.
+//
+static void
+readStream(
+	_In_ const std::vector<BYTE>& file,
+	_In_ ULONG stream,
+	_In_ ULONG pos,
+	_Out_writes_bytes_(cb) void* data,
+	_In_ ULONG cb)
+{
+	for (ULONG i = 0; i < cb; ++i)
+	{
+		((BYTE*)data)[i] = file[fileOffset(file, stream, pos + i)];
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: findCarFieldList
+//
+// Description:
+//
+//  Find the field list of struct Car in the TPI stream.
+//
+static bool
+findCarFieldList(
+	_In_ const std::vector<BYTE>& file,
+	_Out_ FieldListInfo* info)
+{
+	ULONG headerSize = 0;
+	ULONG tiBegin = 0;
+	ULONG recordBytes = 0;
+	std::vector<ULONG> recordPos;
+
+	memset(info, 0, sizeof(*info));
+
+	readStream(file, PDB_STREAM_TPI, TPI_HEADER_SIZE, &headerSize, sizeof(headerSize));
+	readStream(file, PDB_STREAM_TPI, TPI_TYPE_INDEX_BEGIN, &tiBegin, sizeof(tiBegin));
+	readStream(file, PDB_STREAM_TPI, TPI_TYPE_RECORD_BYTES, &recordBytes, sizeof(recordBytes));
+
+	for (ULONG pos = headerSize; pos + 2 * sizeof(USHORT) <= headerSize + recordBytes;)
+	{
+		USHORT len = 0;
+		USHORT kind = 0;
+		readStream(file, PDB_STREAM_TPI, pos, &len, sizeof(len));
+		readStream(file, PDB_STREAM_TPI, pos + 2, &kind, sizeof(kind));
+		recordPos.push_back(pos);
+
+		// count, property, field list, derived list, vshape, size, name. Car
+		// is small enough for its size to be an inline numeric leaf.
+		//
+		if (kind == LF_STRUCTURE && len >= 24)
+		{
+			USHORT prop = 0;
+			char name[4] = {};
+			readStream(file, PDB_STREAM_TPI, pos + 6, &prop, sizeof(prop));
+			readStream(file, PDB_STREAM_TPI, pos + 22, name, sizeof(name));
+
+			if (!(prop & CV_PROP_FWDREF) && !memcmp(name, "Car", sizeof(name)))
+			{
+				info->CarTi = tiBegin + (ULONG)recordPos.size() - 1;
+				readStream(file, PDB_STREAM_TPI, pos + 8, &info->ListTi, sizeof(info->ListTi));
+				break;
+			}
+		}
+
+		pos += (ULONG)sizeof(len) + len;
+	}
+
+	if (!info->CarTi ||
+		info->ListTi < tiBegin ||
+		info->ListTi - tiBegin >= recordPos.size())
+	{
+		return false;
+	}
+
+	// Field list record: length, kind, members.
+	//
+	USHORT len = 0;
+	const ULONG listPos = recordPos[info->ListTi - tiBegin];
+	readStream(file, PDB_STREAM_TPI, listPos, &len, sizeof(len));
+
+	info->BodyPos = listPos + 2 * (ULONG)sizeof(USHORT);
+	info->BodySize = len - (ULONG)sizeof(USHORT);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Function: fillFieldList
+//
+// Description:
+//
+//  Replace the members of a field list with as many copies of 'member' as fit,
+//  padding out the rest.
+//
+static void
+fillFieldList(
+	_Inout_ std::vector<BYTE>* file,
+	_In_ const FieldListInfo* info,
+	_In_reads_bytes_(cbMember) const BYTE* member,
+	_In_ ULONG cbMember)
+{
+	std::vector<BYTE> body(info->BodySize, LF_PAD1);
+
+	for (ULONG pos = 0; pos + cbMember <= info->BodySize; pos += cbMember)
+	{
+		memcpy(&body[pos], member, cbMember);
+	}
+
+	patch(file, PDB_STREAM_TPI, info->BodyPos, &body[0], info->BodySize);
+}
+
+//------------------------------------------------------------------------------
+// Function: checkRejected
+//
+// Description:
+//
+//  Check that a damaged PDB no longer parses.
+//
+static void
+checkRejected(
+	_In_z_ const char* what,
+	_In_ const std::vector<BYTE>& file)
+{
+	PdbFile* pdb = nullptr;
+
+	HRESULT hr = PdbParse(&file[0], file.size(), &pdb);
+	if (SUCCEEDED(hr))
+	{
+		PdbClose(pdb);
+	}
+
+	printf("%s: %s\n", what, FAILED(hr) ? "rejected" : "ACCEPTED");
+}
+
+//------------------------------------------------------------------------------
+// Function: askDamaged
+//
+// Description:
+//
+//  Parse a damaged PDB and, if it parses, ask it everything. Whatever it
+//  answers, it must come back.
+//
+static void
+askDamaged(
+	_In_ const std::vector<BYTE>& file)
+{
+	PdbFile* pdb = nullptr;
+	Answer answers[NUM_LOOKUPS];
+	char enumName[256];
+
+	if (SUCCEEDED(PdbParse(&file[0], file.size(), &pdb)))
+	{
+		askPdb(pdb, answers);
+		(void)PdbGetEnumName(pdb, "Car", 0, enumName, _countof(enumName));
+		PdbClose(pdb);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: compareWithDbgEng
+//
+// Description:
+//
+//  The reader agrees with DbgEng, or declines to answer.
+//
+// Parameters:
+//
+//  fromPdb - Receives the reader's answers.
+//
+static bool
+compareWithDbgEng(
+	_In_z_ const char* dumpPath,
+	_In_z_ const char* pdbPath,
+	_Out_writes_(NUM_LOOKUPS) Answer* fromPdb)
+{
+	IDebugClient* client = nullptr;
+	IDebugControl* control = nullptr;
+	IDebugSymbols* symbols = nullptr;
+	PdbFile* pdb = nullptr;
+	Answer fromDbgEng[NUM_LOOKUPS];
+	bool ok = false;
+
+	HRESULT hr = DebugCreate(__uuidof(IDebugClient), (void**)&client);
+	if (FAILED(hr) ||
+		FAILED(hr = client->QueryInterface(__uuidof(IDebugControl), (void**)&control)) ||
+		FAILED(hr = client->QueryInterface(__uuidof(IDebugSymbols), (void**)&symbols)) ||
+		FAILED(hr = symbols->AppendSymbolPath(".")) ||
+		FAILED(hr = client->OpenDumpFile(dumpPath)) ||
+		FAILED(hr = control->WaitForEvent(DEBUG_WAIT_DEFAULT, INFINITE)))
+	{
+		fprintf(stderr, "Failed to open dump '%s'. Error 0x%08x.\n", dumpPath, hr);
+		goto exit;
+	}
+
+	hr = PdbOpen(pdbPath, &pdb);
+	if (FAILED(hr))
+	{
+		fprintf(stderr, "Failed to open PDB '%s'. Error 0x%08x.\n", pdbPath, hr);
+		goto exit;
+	}
+
+	askDbgEng(symbols, fromDbgEng);
+	askPdb(pdb, fromPdb);
+
+	for (size_t i = 0; i < NUM_LOOKUPS; ++i)
+	{
+		const Lookup& q = s_Lookups[i];
+		const char* verdict = nullptr;
+
+		if (FAILED(fromPdb[i].Hr))
+		{
+			// Callers fall back to DbgEng.
+			//
+			verdict = "declined";
+		}
+		else if (FAILED(fromDbgEng[i].Hr))
+		{
+			verdict = "ANSWERED WHERE DBGENG FAILED";
+		}
+		else
+		{
+			verdict = fromPdb[i].Value == fromDbgEng[i].Value ? "match" : "MISMATCH";
+		}
+
+		printf(
+			"%s%s%s: %s\n",
+			q.Type,
+			q.Field ? "." : "",
+			q.Field ? q.Field : "",
+			verdict);
+	}
+
+	ok = true;
+
+exit:
+	if (pdb)
+	{
+		PdbClose(pdb);
+	}
+	if (symbols)
+	{
+		symbols->Release();
+	}
+	if (control)
+	{
+		control->Release();
+	}
+	if (client)
+	{
+		client->EndSession(DEBUG_END_PASSIVE);
+		client->Release();
+	}
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// Function: checkTruncated
+//
+// Description:
+//
+//  A truncated PDB must either be rejected or, if the missing tail held
+//  nothing we read, answer exactly as the whole one did.
+//
+static void
+checkTruncated(
+	_In_ const std::vector<BYTE>& intact,
+	_In_reads_(NUM_LOOKUPS) const Answer* fromPdb)
+{
+	const struct
+	{
+		const char* Name;
+		size_t Size;
+	} truncations[] =
+	{
+		{ "nothing", 0 },
+		{ "part of the magic", 16 },
+		{ "part of the superblock", MSF_SUPERBLOCK_SIZE - 1 },
+		{ "the superblock", MSF_SUPERBLOCK_SIZE },
+		{ "a quarter", intact.size() / 4 },
+		{ "a half", intact.size() / 2 },
+		{ "three quarters", intact.size() / 4 * 3 },
+		{ "all but one byte", intact.size() - 1 },
+	};
+
+	for (size_t i = 0; i < _countof(truncations); ++i)
+	{
+		// Copy, so that reading past the end is caught by the heap checks.
+		//
+		std::vector<BYTE> truncated(
+			intact.begin(),
+			intact.begin() + truncations[i].Size);
+		Answer answers[NUM_LOOKUPS];
+		PdbFile* pdb = nullptr;
+		bool ok = true;
+
+		if (SUCCEEDED(PdbParse(
+				truncated.empty() ? nullptr : &truncated[0],
+				truncated.size(),
+				&pdb)))
+		{
+			askPdb(pdb, answers);
+			ok = sameAnswers(answers, fromPdb);
+			PdbClose(pdb);
+		}
+
+		printf("truncated to %s: %s\n", truncations[i].Name, ok ? "ok" : "WRONG ANSWERS");
+	}
+}
+
+//------------------------------------------------------------------------------
+// Function: checkCorrupt
+//
+// Description:
+//
+//  Damage to the container and the TPI header must be caught while parsing.
+//  Damage to the type records themselves can't always be, but must not hang
+//  or crash the reader.
+//
+static void
+checkCorrupt(
+	_In_ const std::vector<BYTE>& intact)
+{
+	const struct
+	{
+		const char* Name;
+		ULONG Stream;
+		ULONG Pos;
+		ULONG Value;
+	} rejects[] =
+	{
+		{ "bad magic", RAW_FILE, 0, 0 },
+		{ "zero block size", RAW_FILE, MSF_BLOCK_SIZE, 0 },
+		{ "block size not a power of two", RAW_FILE, MSF_BLOCK_SIZE, 1000 },
+		{ "directory bigger than the file", RAW_FILE, MSF_NUM_DIRECTORY_BYTES, 0xffffffff },
+		{ "block map past the end", RAW_FILE, MSF_BLOCK_MAP_ADDR, 0xffffffff },
+		{ "stream count wraps", STREAM_DIRECTORY, 0, 0xffffffff },
+		{ "no type stream", STREAM_DIRECTORY, 0, PDB_STREAM_TPI },
+		{ "type stream bigger than the file", STREAM_DIRECTORY, (PDB_STREAM_TPI + 1) * (ULONG)sizeof(ULONG), 0x7fffffff },
+		{ "type stream header too small", PDB_STREAM_TPI, TPI_HEADER_SIZE, (ULONG)sizeof(ULONG) },
+		{ "type records past the stream", PDB_STREAM_TPI, TPI_TYPE_RECORD_BYTES, 0xffffffff },
+	};
+
+	for (size_t i = 0; i < _countof(rejects); ++i)
+	{
+		std::vector<BYTE> file(intact);
+		patch(&file, rejects[i].Stream, rejects[i].Pos, &rejects[i].Value, sizeof(rejects[i].Value));
+		checkRejected(rejects[i].Name, file);
+	}
+
+	{
+		// A record too short to hold its own kind.
+		//
+		std::vector<BYTE> file(intact);
+		ULONG headerSize = 0;
+		const USHORT len = 1;
+		readStream(file, PDB_STREAM_TPI, TPI_HEADER_SIZE, &headerSize, sizeof(headerSize));
+		patch(&file, PDB_STREAM_TPI, headerSize, &len, sizeof(len));
+		checkRejected("type record shorter than its kind", file);
+	}
+
+	FieldListInfo info = {};
+	if (!findCarFieldList(intact, &info))
+	{
+		printf("Car's field list: NOT FOUND\n");
+		return;
+	}
+
+	{
+		// Car's field list continues in itself.
+		//
+		std::vector<BYTE> file(intact);
+		BYTE member[8] = {};
+		memcpy(&member[0], &LF_INDEX, sizeof(LF_INDEX));
+		memcpy(&member[4], &info.ListTi, sizeof(info.ListTi));
+		fillFieldList(&file, &info, member, sizeof(member));
+		askDamaged(file);
+		printf("field list continued in itself: survived\n");
+	}
+
+	{
+		// Car derives from itself, several times over.
+		//
+		std::vector<BYTE> file(intact);
+		BYTE member[10] = {};
+		memcpy(&member[0], &LF_BCLASS, sizeof(LF_BCLASS));
+		memcpy(&member[4], &info.CarTi, sizeof(info.CarTi));
+		fillFieldList(&file, &info, member, sizeof(member));
+		askDamaged(file);
+		printf("class derived from itself: survived\n");
+	}
+
+	{
+		// Random bytes of the type records. Fixed seed, so every run damages
+		// the same bytes.
+		//
+		std::vector<BYTE> file(intact);
+		ULONG headerSize = 0;
+		ULONG recordBytes = 0;
+		ULONG seed = 0x5eed;
+
+		readStream(file, PDB_STREAM_TPI, TPI_HEADER_SIZE, &headerSize, sizeof(headerSize));
+		readStream(file, PDB_STREAM_TPI, TPI_TYPE_RECORD_BYTES, &recordBytes, sizeof(recordBytes));
+
+		auto next = [&seed]() -> ULONG
+		{
+			seed = seed * 1103515245 + 12345;
+			return seed >> 8;
+		};
+
+		for (int round = 0; round < RANDOM_DAMAGE_ROUNDS && recordBytes; ++round)
+		{
+			std::vector<size_t> offsets(1 + next() % 8);
+			for (size_t i = 0; i < offsets.size(); ++i)
+			{
+				offsets[i] = fileOffset(file, PDB_STREAM_TPI, headerSize + next() % recordBytes);
+				file[offsets[i]] ^= (BYTE)(1 + next() % 255);
+			}
+
+			askDamaged(file);
+
+			for (size_t i = 0; i < offsets.size(); ++i)
+			{
+				file[offsets[i]] = intact[offsets[i]];
+			}
+		}
+
+		printf("random damage to the type records: survived\n");
+	}
+}
+
+int
+main(
+	_In_ int argc,
+	_In_reads_(argc) char** argv)
+{
+	Answer fromPdb[NUM_LOOKUPS];
+	std::vector<BYTE> intact;
+
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: pdbreadertest <dump> <pdb>\n");
+		return 1;
+	}
+
+	if (!compareWithDbgEng(argv[1], argv[2], fromPdb))
+	{
+		return 1;
+	}
+
+	if (!readFile(argv[2], &intact) || intact.size() < MSF_SUPERBLOCK_SIZE)
+	{
+		fprintf(stderr, "Failed to read PDB '%s'.\n", argv[2]);
+		return 1;
+	}
+
+	checkTruncated(intact, fromPdb);
+	checkCorrupt(intact);
+
+	return 0;
+}
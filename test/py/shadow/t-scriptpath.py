@@ -0,0 +1,4 @@
+import dbgscript
+
+s = dbgscript.stats()
+print('shadow', s['ScriptPathHits'], s['ScriptPathMisses'])
@@ -0,0 +1,26 @@
+from utils import *
+
+car = get_car()
+car_type = car.module + '!Car'
+
+# CONTAINING_RECORD from the address of a field.
+#
+c = dbgscript.container_of(car['wheels'].address, car_type, 'wheels')
+print(c.address == car.address)
+print(c.y.value)
+
+# Reinterpret an array's memory as its first element.
+#
+w = car.wheels.cast(car.module + '!Wheel')
+print("{:.2f}".format(w.diameter.value))
+
+# Step between objects of the same type.
+#
+print(w.offset(3).address - w.address)
+print(car.wheels[3].offset(-3).address == w.address)
+
+# Pointer arithmetic.
+#
+p = dbgscript.create_typed_pointer('kernelbase!char', car['name'].address)
+print(p.offset(4).value - p.offset(1).value)
+print(p.offset(3)[0].value)
@@ -0,0 +1,28 @@
+from utils import *
+
+car = get_car()
+
+# The same field of several objects of one type. Only the first access goes
+# to the debugger engine; the rest are computed from the type's layout.
+#
+for i in range(4):
+    w = car.wheels[i]
+    print(w.diameter.address - w.address, "{:.2f}".format(w.diameter.value))
+
+# Different fields of the same object.
+#
+print(car.x.value, car.y.value)
+print(car.y.address - car.x.address)
+
+# Attributes of TypedObject itself still take precedence over fields.
+#
+print(car.address == car.x.address)
+
+# Members of a virtual base aren't at the same offset in every object of a
+# type: 'motor_part' is a Part within a Motor.
+#
+locals = dbgscript.current_thread().current_frame.get_locals()
+part = next(l for l in locals if l.name == 'part')
+motor_part = next(l for l in locals if l.name == 'motorPart')[0]
+for i in range(2):
+    print(part.cylinders.value, motor_part.cylinders.value)
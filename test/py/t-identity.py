@@ -0,0 +1,49 @@
+from utils import *
+
+car = get_car()
+
+# Two accesses to the same field are equal, and hash alike.
+#
+a = car.wheels[0]
+b = car.wheels[0]
+print(a == b, hash(a) == hash(b))
+
+# While a TypedObject is alive, accessing the same field returns it.
+#
+print(car.x is car.x)
+
+# Different objects, and the same address seen as a different type, are not.
+#
+print(car.wheels[0] == car.wheels[1])
+print(car.x == car.y)
+print(car.wheels[0] == car.wheels[0].diameter)
+
+# Offsets of one pointer don't live in memory, and are told apart by value.
+#
+p = dbgscript.create_typed_pointer(car.module + '!Wheel', car['wheels'].address)
+q1 = p.offset(1)
+q2 = p.offset(2)
+print(q1 == q2, q1 == p.offset(1))
+print(q2[0].address - q1[0].address)
+
+# TypedObjects can be used in sets and as dictionary keys.
+#
+seen = set()
+for i in range(4):
+    seen.add(car.wheels[i])
+seen.add(car.wheels[0])
+print(len(seen))
+
+names = {car.x: 'x', car.y: 'y'}
+print(names[car.x], names[car.y])
+
+# However an object is reached, the live TypedObject for it is returned.
+#
+w0 = car.wheels[0]
+w1 = car.wheels[1]
+print(next(iter(car.wheels)) is w0, car.wheels[0:2][1] is w1, w0.offset(1) is w1)
+
+locals = dbgscript.current_thread().current_frame.get_locals()
+vehicle = next(l for l in locals if l.name == 'vehicle')
+truck = vehicle.get_runtime_obj()
+print(vehicle.get_runtime_obj() is truck, dbgscript.get_runtime_objs([vehicle])[0] is truck)
@@ -0,0 +1,26 @@
+from utils import *
+import itertools
+
+car = get_car()
+
+# Iterate over an array of structs.
+#
+for wheel in car.wheels:
+  print("{:.2f}".format(wheel.diameter.value))
+
+# Iterate over an array of primitives. Stop at the terminator since the rest
+# of the buffer is uninitialized.
+#
+chars = (c.value for c in car['name'])
+print(''.join(itertools.takewhile(lambda c: c != '\0', chars)))
+
+# Iterators compose with builtins.
+#
+print(sum(1 for _ in car.wheels))
+
+# Only arrays can be iterated.
+#
+try:
+  iter(car)
+except ValueError:
+  print('Swallowed ValueError')
@@ -0,0 +1,4 @@
+from utils import *
+
+car = get_car()
+print(car.x.value, car.y.value)
@@ -0,0 +1,13 @@
+# The dump is taken in main, just after the call to beforeReturn.
+#
+pc = dbgscript.current_thread().get_stack()[0].instruction_offset
+
+# Batch lookups agree with single ones, whatever the order and repeats.
+#
+syms = dbgscript.get_nearest_syms([pc, 0, pc])
+print(syms[0].split('+')[0])
+print(syms[0] == syms[2] == dbgscript.get_nearest_sym(pc))
+
+# Addresses outside any module have no symbol.
+#
+print(syms[1] is None)
@@ -0,0 +1,7 @@
+def total_size(n):
+    total = 0
+    for i in range(n):
+        total += dbgscript.get_type_size('nt!GUID')
+    return total
+
+print(total_size(1000))
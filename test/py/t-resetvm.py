@@ -0,0 +1,5 @@
+import sys
+import json
+
+print(sys.argv[1:], 'counter' in globals())
+counter = 1
@@ -0,0 +1,7 @@
+from utils import *
+
+car = get_car()
+
+# Car has no vtable, so there is no runtime type to find.
+#
+print(dbgscript.get_runtime_objs([car, car.wheels[0]]))
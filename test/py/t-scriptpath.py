@@ -0,0 +1,4 @@
+import dbgscript
+
+s = dbgscript.stats()
+print('py', s['ScriptPathHits'], s['ScriptPathMisses'])
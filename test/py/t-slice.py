@@ -0,0 +1,31 @@
+from utils import *
+
+car = get_car()
+
+# Slices are views; nothing is read until asked.
+#
+name = car['name'][0:6]
+print(''.join(name.values()))
+print(''.join(name[1:3].values()))
+print(''.join(car['name'][5::-1].values()))
+
+print(len(car.wheels[1:4]))
+print(len(car.wheels[::2]))
+print("{:.2f}".format(car.wheels[1:][-1].diameter.value))
+
+for wheel in car.wheels[2:]:
+  print("{:.2f}".format(wheel.diameter.value))
+
+# Each pointer in a slice points where it does, not where element zero does.
+#
+locals = dbgscript.current_thread().current_frame.get_locals()
+coords = next(l for l in locals if l.name == 'coords')
+print(coords[0:2][0].deref.value, coords[0:2][1].deref.value)
+print(coords[1:][0].deref.value)
+
+# Only slices of primitives have values.
+#
+try:
+  car.wheels[0:2].values()
+except ValueError:
+  print('Swallowed ValueError')
@@ -0,0 +1,6 @@
+dbgscript.get_type_size('nt!GUID')
+dbgscript.get_type_size('nt!GUID')
+s = dbgscript.stats()
+print(s is None)
+print(s['api.dbgscript_get_type_size'])
+print('memory.peak_working_set_kb' in s)
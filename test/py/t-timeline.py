@@ -0,0 +1,8 @@
+with dbgscript.trace_span('outer'):
+    with dbgscript.trace_span('inner'):
+        print(dbgscript.get_type_size('nt!GUID'))
+try:
+    with dbgscript.trace_span('failing'):
+        raise ValueError
+except ValueError:
+    print('Swallowed ValueError')
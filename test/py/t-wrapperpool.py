@@ -0,0 +1,21 @@
+from utils import *
+
+car = get_car()
+
+# Each access makes a wrapper that is freed straight after, so the next one
+# comes from the free list.
+#
+total = 0
+for i in range(2000):
+  total += car.x.value + car.y.value
+
+# So does each offset of a pointer, none of which is the same object.
+#
+p = dbgscript.create_typed_pointer(car.module + '!Wheel', car['wheels'].address)
+offsets = 0
+for i in range(3000):
+  if p.offset(i).value == p.value + i * 4:
+    offsets += 1
+print(total, offsets)
+
+print(dbgscript.stats()['WrapperReuses'] > 0)
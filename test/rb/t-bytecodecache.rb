@@ -0,0 +1,5 @@
+require_relative 'utils'
+
+# Cached instruction sequences keep their line numbers.
+#
+puts __LINE__, respond_to?(:negative_test, true)
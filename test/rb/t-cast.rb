@@ -0,0 +1,26 @@
+require_relative 'utils'
+
+car = get_car
+car_type = car.module + '!Car'
+
+# CONTAINING_RECORD from the address of a field.
+#
+c = DbgScript.container_of(car['wheels'].address, car_type, 'wheels')
+puts c.address == car.address
+puts c['y'].value
+
+# Reinterpret an array's memory as its first element.
+#
+w = car['wheels'].cast(car.module + '!Wheel')
+puts '%.2f' % w.diameter.value
+
+# Step between objects of the same type.
+#
+puts w.offset(3).address - w.address
+puts car['wheels'][3].offset(-3).address == w.address
+
+# Pointer arithmetic.
+#
+p = DbgScript.create_typed_pointer('kernelbase!char', car['name'].address)
+puts p.offset(4).value - p.offset(1).value
+puts p.offset(3)[0].value
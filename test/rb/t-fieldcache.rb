@@ -0,0 +1,30 @@
+require_relative 'utils'
+
+car = get_car
+
+# The same field of several objects of one type. Only the first access goes
+# to the debugger engine; the rest are computed from the type's layout.
+#
+4.times do |i|
+  w = car['wheels'][i]
+  puts "#{w.diameter.address - w.address} #{'%.2f' % w.diameter.value}"
+end
+
+# Different fields of the same object.
+#
+puts "#{car['x'].value} #{car.y.value}"
+puts car.y.address - car['x'].address
+
+# Methods of TypedObject itself still take precedence over fields.
+#
+puts car.address == car['x'].address
+
+# Members of a virtual base aren't at the same offset in every object of a
+# type: 'motor_part' is a Part within a Motor.
+#
+locals = DbgScript.current_thread.current_frame.get_locals
+part = locals.find { |l| l.name == 'part' }
+motor_part = locals.find { |l| l.name == 'motorPart' }[0]
+2.times do
+  puts "#{part.cylinders.value} #{motor_part.cylinders.value}"
+end
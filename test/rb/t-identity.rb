@@ -0,0 +1,52 @@
+require_relative 'utils'
+
+car = get_car
+
+# Two accesses to the same field are equal, and hash alike.
+#
+a = car['wheels'][0]
+b = car['wheels'][0]
+puts "#{a == b} #{a.hash == b.hash}"
+
+# Within a run, accessing the same field returns the same object.
+#
+puts car['x'].equal?(car['x'])
+
+# Different objects, and the same address seen as a different type, are not.
+#
+puts car['wheels'][0] == car['wheels'][1]
+puts car['x'] == car.y
+puts car['wheels'][0] == car['wheels'][0].diameter
+
+# Offsets of one pointer don't live in memory, and are told apart by value.
+#
+p = DbgScript.create_typed_pointer(car.module + '!Wheel', car['wheels'].address)
+q1 = p.offset(1)
+q2 = p.offset(2)
+puts "#{q1 == q2} #{q1 == p.offset(1)}"
+puts q2[0].address - q1[0].address
+
+# TypedObjects can be used as hash keys.
+#
+seen = {}
+4.times do |i|
+  seen[car['wheels'][i]] = true
+end
+seen[car['wheels'][0]] = true
+puts seen.size
+
+names = { car['x'] => 'x', car.y => 'y' }
+puts "#{names[car['x']]} #{names[car.y]}"
+
+# However an object is reached, the recent TypedObject for it is returned.
+#
+w0 = car['wheels'][0]
+w1 = car['wheels'][1]
+first = nil
+car['wheels'].each {|w| first ||= w }
+puts "#{first.equal?(w0)} #{car['wheels'].slice(0, 2)[1].equal?(w1)} #{w0.offset(1).equal?(w1)}"
+
+locals = DbgScript.current_thread.current_frame.get_locals
+vehicle = locals.find {|l| l.name == 'vehicle'}
+truck = vehicle.get_runtime_obj
+puts "#{vehicle.get_runtime_obj.equal?(truck)} #{DbgScript.get_runtime_objs([vehicle])[0].equal?(truck)}"
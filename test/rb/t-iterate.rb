@@ -0,0 +1,22 @@
+require_relative 'utils'
+
+car = get_car
+
+# Iterate over an array of structs.
+#
+car.wheels.each {|wheel| puts '%.2f' % wheel.diameter.value }
+
+# Iterate over an array of primitives. Stop at the terminator since the rest
+# of the buffer is uninitialized.
+#
+puts car['name'].take_while {|c| c.value != "\0" }.map(&:value).join
+
+# Enumerable methods come for free.
+#
+puts car.wheels.count
+
+# Only arrays can be iterated.
+#
+negative_test(TypeError) {
+  car.each {}
+}
@@ -0,0 +1,4 @@
+require_relative 'utils'
+
+car = get_car
+puts "#{car.x.value} #{car.y.value}"
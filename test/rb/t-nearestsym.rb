@@ -0,0 +1,13 @@
+# The dump is taken in main, just after the call to beforeReturn.
+#
+pc = DbgScript.current_thread.get_stack[0].instruction_offset
+
+# Batch lookups agree with single ones, whatever the order and repeats.
+#
+syms = DbgScript.get_nearest_syms([pc, 0, pc])
+puts syms[0].split('+')[0]
+puts syms[0] == syms[2] && syms[0] == DbgScript.get_nearest_sym(pc)
+
+# Addresses outside any module have no symbol.
+#
+puts syms[1].nil?
@@ -0,0 +1,7 @@
+def total_size(n)
+  total = 0
+  n.times { total += DbgScript.get_type_size('nt!GUID') }
+  total
+end
+
+puts total_size(1000)
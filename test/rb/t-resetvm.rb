@@ -0,0 +1,2 @@
+puts ARGV[1..-1].inspect, defined?(Counter).inspect
+Counter = 1
@@ -0,0 +1,7 @@
+require_relative 'utils'
+
+car = get_car
+
+# Car has no vtable, so there is no runtime type to find.
+#
+p DbgScript.get_runtime_objs([car, car['wheels'][0]])
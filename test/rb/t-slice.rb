@@ -0,0 +1,29 @@
+require_relative 'utils'
+
+car = get_car
+
+# Slices are views; nothing is read until asked.
+#
+name = car['name'].slice(0, 6)
+puts name.values.join
+puts name.slice(1, 3).values.join
+puts car['name'].slice(0, 6, 2).values.join
+
+puts car.wheels.slice(1, 4).length
+puts car.wheels.slice(0, 4, 2).length
+puts '%.2f' % car.wheels.slice(1, 4)[-1].diameter.value
+
+car.wheels.slice(2, 4).each {|wheel| puts '%.2f' % wheel.diameter.value }
+
+# Each pointer in a slice points where it does, not where element zero does.
+#
+locals = DbgScript.current_thread.current_frame.get_locals
+coords = locals.find {|l| l.name == 'coords'}
+puts "#{coords.slice(0, 2)[0].deref.value} #{coords.slice(0, 2)[1].deref.value}"
+puts coords.slice(1, 2)[0].deref.value
+
+# Only slices of primitives have values.
+#
+negative_test(TypeError) {
+  car.wheels.slice(0, 2).values
+}
@@ -0,0 +1,6 @@
+DbgScript.get_type_size('nt!GUID')
+DbgScript.get_type_size('nt!GUID')
+s = DbgScript.stats
+puts s.nil?
+puts s['api.DbgScript_get_type_size']
+puts s.key?('memory.peak_working_set_kb')
@@ -0,0 +1,8 @@
+puts DbgScript.trace_span('outer') {
+  DbgScript.trace_span('inner') { DbgScript.get_type_size('nt!GUID') }
+}
+begin
+  DbgScript.trace_span('failing') { raise ArgumentError }
+rescue ArgumentError
+  puts 'ArgumentError'
+end
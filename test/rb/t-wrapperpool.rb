@@ -0,0 +1,24 @@
+require_relative 'utils'
+
+car = get_car
+
+# Within a run, a field is wrapped once however often it's accessed.
+#
+total = 0
+2000.times do
+  total += car.x.value + car.y.value
+end
+
+# Each offset of a pointer is a different object, and more of them are made
+# than the run keeps track of. Collect every so often so the GC frees the
+# rest and later wrappers come from the free list.
+#
+p = DbgScript.create_typed_pointer(car.module + '!Wheel', car['wheels'].address)
+offsets = 0
+3000.times do |i|
+  offsets += 1 if p.offset(i).value == p.value + i * 4
+  GC.start if i % 500 == 499
+end
+puts "#{total} #{offsets}"
+
+puts DbgScript.stats['WrapperReuses'] > 0